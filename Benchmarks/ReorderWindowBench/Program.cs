@@ -0,0 +1,111 @@
+﻿using System.Diagnostics;
+using ProcessTracer;
+
+namespace ReorderWindowBench
+{
+    /// <summary>
+    /// Merges lines of 1, 16 and 256 producer streams through a <see cref="ReorderWindow" />, as the tracer does with
+    /// <c>--reorder-window</c>, and prints the time per line. The streams share a coarse clock, so many lines of
+    /// different threads and of the same thread carry the same timestamp. --quick makes it a short smoke run.
+    /// </summary>
+    internal static class Program
+    {
+        private const int Capacity = 65536;
+        // how far a stream's lines may lag the newest one when they arrive, in clock ticks of 100 ns
+        private const int MaxLag = 64;
+
+        private static int Main(string[] args)
+        {
+            int lineCount = args.Contains("--quick") ? 10000 : 2000000;
+            // the first run only warms up the JIT
+            Run(1, Math.Min(lineCount, 100000), false);
+            bool ordered = true;
+            foreach (int streams in new[] { 1, 16, 256 })
+                ordered &= Run(streams, lineCount, true);
+            return ordered ? 0 : 1;
+        }
+
+        private static bool Run(int streams, int lineCount, bool report)
+        {
+            ReceivedLine[] lines = Generate(streams, lineCount);
+            var window = new ReorderWindow(TimeSpan.FromMinutes(1), Capacity);
+            var output = new List<string>(lineCount);
+            var stopwatch = Stopwatch.StartNew();
+            for (int i = 0; i < lines.Length; i++)
+            {
+                window.Add(lines[i]);
+                if ((i & 1023) == 1023)
+                    window.TakeDue(output);
+            }
+
+            window.TakeDue(output, true);
+            stopwatch.Stop();
+
+            bool ordered = IsOrdered(lines, output);
+            if (!report)
+                return ordered;
+            double seconds = stopwatch.Elapsed.TotalSeconds;
+            Console.WriteLine(
+                $"{$"ReorderWindow, {streams} streams",-48} {seconds * 1e9 / lineCount,10:F1} ns/op {lineCount / seconds,12:F0} op/s");
+            if (!ordered)
+                Console.Error.WriteLine($"{streams} streams: lines written out of order");
+            if (window.LateLines != 0)
+                Console.Error.WriteLine($"{streams} streams: {window.LateLines} late lines");
+            return ordered;
+        }
+
+        // Lines in arrival order. The clock advances by 0 or 1 tick per line and each stream's lines lag it by up to
+        // MaxLag ticks, without going back within the stream. One in eight lines with the timestamp of the stream's
+        // line before trades numbers with it, as if they came over different connections.
+        private static ReceivedLine[] Generate(int streams, int lineCount)
+        {
+            var random = new Random(24);
+            var last = new ulong[streams];
+            var sequence = new uint[streams];
+            var lastIndex = new int[streams];
+            var lines = new ReceivedLine[lineCount];
+            ulong clock = 1000000;
+            for (int i = 0; i < lineCount; i++)
+            {
+                clock += (ulong)random.Next(2) * 100;
+                int stream = random.Next(streams);
+                ulong timestamp = Math.Max(last[stream], clock - (ulong)random.Next(MaxLag) * 100);
+                lines[i] = new ReceivedLine(i.ToString(), LineKind.Other, 0, 1000 + stream / 16, 0, 2000 + stream,
+                    sequence[stream]++, timestamp);
+                if (sequence[stream] > 1 && timestamp == last[stream] && random.Next(8) == 0)
+                {
+                    int previous = lastIndex[stream];
+                    (lines[i], lines[previous]) = (lines[i] with { Sequence = lines[previous].Sequence },
+                        lines[previous] with { Sequence = lines[i].Sequence });
+                }
+
+                last[stream] = timestamp;
+                lastIndex[stream] = i;
+            }
+
+            return lines;
+        }
+
+        // every line written once, timestamps never go back and each thread's lines keep their numbering
+        private static bool IsOrdered(ReceivedLine[] lines, List<string> output)
+        {
+            if (output.Count != lines.Length)
+                return false;
+            var nextSequence = new Dictionary<int, uint>();
+            ulong timestamp = 0;
+            foreach (string text in output)
+            {
+                ReceivedLine line = lines[int.Parse(text)];
+                if (line.Timestamp < timestamp)
+                    return false;
+                timestamp = line.Timestamp;
+                nextSequence.TryGetValue(line.ThreadId, out uint expected);
+                if (line.Sequence != expected)
+                    return false;
+                nextSequence[line.ThreadId] = expected + 1;
+            }
+
+            return true;
+        }
+    }
+}
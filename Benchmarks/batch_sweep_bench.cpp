@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "hook_host.h"
+#include "bench.h"
+#include "logger.h"
+
+using namespace ProcessTracer::EventRecord;
+
+namespace
+{
+	// what a pipe write costs, roughly
+	constexpr uint64_t transport_write_ns = 5000;
+	// the paced producer writes one event per interval
+	constexpr auto paced_interval = std::chrono::microseconds(10);
+
+	std::vector<uint64_t> g_latencies;
+
+	void RecordLatency(const RecordHeader& header)
+	{
+		if (header.type == RecordType::HookInfo && g_latencies.size() < g_latencies.capacity())
+			g_latencies.push_back(ProcessTracer::Logger::g_logger.Now() - header.timestamp);
+	}
+
+	ProcessTracer::HookHarness::SessionOptions Options(size_t flush_bytes)
+	{
+		ProcessTracer::HookHarness::SessionOptions options;
+		options.batch.flush_bytes = flush_bytes;
+		options.budget.thread_buffer_bytes = 1024 * 1024;
+		options.transport_write_ns = transport_write_ns;
+		options.on_bulk_record = RecordLatency;
+		return options;
+	}
+
+	void LogEvent(size_t i)
+	{
+		LogHookInfoF(HookId::NtWriteFile, "[Length] %zu", i);
+	}
+
+	// One producer writes as fast as it can, until everything is shipped.
+	void BenchThroughput(size_t flush_bytes)
+	{
+		const size_t events = ProcessTracer::Bench::Iterations(1000000);
+		ProcessTracer::HookHarness::Session session(Options(flush_bytes));
+		const ProcessTracer::Bench::Stopwatch stopwatch;
+		for (size_t i = 0; i < events; ++i)
+			LogEvent(i);
+		session.Flush();
+		const double seconds = stopwatch.Seconds();
+		const std::string name = "flush_bytes " + std::to_string(flush_bytes) + " throughput";
+		ProcessTracer::Bench::Report(name.c_str(), events, seconds, session.Bulk().Bytes());
+	}
+
+	// One producer writes an event every paced_interval, the sender ships them as the policy says.
+	// The latency is from the hook's timestamp to the transport.
+	void BenchLatency(size_t flush_bytes)
+	{
+		const size_t events = ProcessTracer::Bench::Iterations(200000);
+		g_latencies.clear();
+		g_latencies.reserve(events);
+		{
+			ProcessTracer::HookHarness::Session session(Options(flush_bytes));
+			auto next = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < events; ++i)
+			{
+				while (std::chrono::steady_clock::now() < next)
+				{
+				}
+				LogEvent(i);
+				next += paced_interval;
+			}
+			// the sender ships the rest within max_latency_ms, as it would in a running process
+			while (session.Bulk().Records() < events)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		if (g_latencies.empty())
+			return;
+		std::sort(g_latencies.begin(), g_latencies.end());
+		const auto percentile = [](double fraction)
+		{
+			const auto index = static_cast<size_t>(fraction * static_cast<double>(g_latencies.size() - 1));
+			return static_cast<double>(g_latencies[index]) / 1000;
+		};
+		const std::string name = "flush_bytes " + std::to_string(flush_bytes) + " latency";
+		printf("%-48s %10.1f us p50 %10.1f us p99\n", name.c_str(), percentile(0.5), percentile(0.99));
+		fflush(stdout);
+	}
+}
+
+// Sweeps the batch size the sender wakes up at against a transport whose writes cost what a pipe
+// write does. Every size runs in a process of its own: the pipeline starts its sender thread once
+// per process, and each size needs one.
+int main(int argc, char** argv)
+{
+	ProcessTracer::Bench::Init(argc, argv);
+	for (const size_t flush_bytes : {128, 1024, 4096, 16384, 65536})
+	{
+		const pid_t child = fork();
+		if (child == 0)
+		{
+			BenchThroughput(flush_bytes);
+			_exit(0);
+		}
+		waitpid(child, nullptr, 0);
+		const pid_t latency_child = fork();
+		if (latency_child == 0)
+		{
+			BenchLatency(flush_bytes);
+			_exit(0);
+		}
+		waitpid(latency_child, nullptr, 0);
+	}
+	return 0;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+// Timing helpers shared by the benchmark executables. Every benchmark prints one line per
+// measurement: its name, the time per operation and, when bytes are given, the bandwidth.
+namespace ProcessTracer::Bench
+{
+	inline bool& QuickFlag()
+	{
+		static bool quick = false;
+		return quick;
+	}
+
+	// --quick turns every measurement into a short smoke run
+	inline void Init(int argc, char** argv)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			if (strcmp(argv[i], "--quick") == 0)
+				QuickFlag() = true;
+		}
+	}
+
+	inline bool Quick()
+	{
+		return QuickFlag();
+	}
+
+	// the iteration count to use, a thousandth of it with --quick
+	inline size_t Iterations(size_t full)
+	{
+		if (!Quick())
+			return full;
+		return full / 1000 != 0 ? full / 1000 : 1;
+	}
+
+	// Keeps the compiler from dropping a computation whose result is otherwise unused.
+	template <typename T>
+	void DoNotOptimize(const T& value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r,m"(value) : "memory");
+#else
+		static volatile const void* sink;
+		sink = &value;
+#endif
+	}
+
+	class Stopwatch
+	{
+		std::chrono::steady_clock::time_point m_start = std::chrono::steady_clock::now();
+
+	public:
+		double Seconds() const
+		{
+			return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+		}
+	};
+
+	// Runs body(iterations) once and returns the seconds it took.
+	template <typename Body>
+	double Measure(size_t iterations, Body&& body)
+	{
+		const Stopwatch stopwatch;
+		body(iterations);
+		return stopwatch.Seconds();
+	}
+
+	inline void Report(const char* name, size_t operations, double seconds, size_t bytes = 0)
+	{
+		const double ns_per_operation = operations ? seconds * 1e9 / static_cast<double>(operations) : 0;
+		const double operations_per_second = seconds > 0 ? static_cast<double>(operations) / seconds : 0;
+		if (bytes != 0)
+			printf("%-48s %10.1f ns/op %12.0f op/s %10.1f MB/s\n", name, ns_per_operation, operations_per_second,
+			       seconds > 0 ? static_cast<double>(bytes) / seconds / 1e6 : 0);
+		else
+			printf("%-48s %10.1f ns/op %12.0f op/s\n", name, ns_per_operation, operations_per_second);
+		fflush(stdout);
+	}
+}
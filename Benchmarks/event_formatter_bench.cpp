@@ -0,0 +1,83 @@
+#include <string>
+
+#include "bench.h"
+#include "event_formatter.h"
+
+using namespace ProcessTracer::EventRecord;
+
+namespace
+{
+	const std::u16string path = u"C:\\build\\obj\\x64\\Release\\ProcessTracerCore\\hook_func.obj";
+
+	size_t EncodeCreateFile(char* buffer, size_t capacity, uint64_t timestamp)
+	{
+		RecordWriter writer(buffer, capacity);
+		writer.Begin(RecordType::HookInfo, HookId::NtCreateFile, 1234, 5678, timestamp, 0);
+		writer.AddU32(FieldId::AccessMask, 0x80100080);
+		writer.AddU32(FieldId::Disposition, 1);
+		writer.AddUtf16(FieldId::Path, path.data(), path.size());
+		writer.AddU32(FieldId::Sequence, static_cast<uint32_t>(timestamp));
+		return writer.Finish();
+	}
+
+	size_t EncodeWriteSummary(char* buffer, size_t capacity)
+	{
+		RecordWriter writer(buffer, capacity);
+		writer.Begin(RecordType::HookInfo, HookId::NtWriteFile, 1234, 5678, 1, 0);
+		writer.AddU64(FieldId::WriteCount, 31);
+		writer.AddU64(FieldId::TotalBytes, 126976);
+		writer.AddU64(FieldId::FirstOffset, 0);
+		writer.AddU64(FieldId::LastOffset, 122880);
+		writer.AddU64(FieldId::FirstTimestamp, 100);
+		writer.AddU64(FieldId::LastTimestamp, 900);
+		writer.AddUtf16(FieldId::Path, path.data(), path.size());
+		return writer.Finish();
+	}
+
+	void BenchEncode()
+	{
+		const size_t iterations = ProcessTracer::Bench::Iterations(10000000);
+		char buffer[4096];
+		size_t bytes = 0;
+		const double seconds = ProcessTracer::Bench::Measure(iterations, [&](size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				bytes += EncodeCreateFile(buffer, sizeof(buffer), i);
+				ProcessTracer::Bench::DoNotOptimize(buffer);
+			}
+		});
+		ProcessTracer::Bench::Report("encode NtCreateFile record", iterations, seconds, bytes);
+	}
+
+	void BenchFormat(const char* name, const char* record, size_t size)
+	{
+		const size_t iterations = ProcessTracer::Bench::Iterations(5000000);
+		std::string line;
+		size_t bytes = 0;
+		const double seconds = ProcessTracer::Bench::Measure(iterations, [&](size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				line.clear();
+				FormatRecord(record, size, line);
+				bytes += line.size();
+				ProcessTracer::Bench::DoNotOptimize(line);
+			}
+		});
+		ProcessTracer::Bench::Report(name, iterations, seconds, bytes);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	ProcessTracer::Bench::Init(argc, argv);
+	BenchEncode();
+
+	char create_file[4096];
+	BenchFormat("format NtCreateFile record", create_file, EncodeCreateFile(create_file, sizeof(create_file), 1));
+	char write_summary[4096];
+	BenchFormat("format NtWriteFile summary record", write_summary,
+	            EncodeWriteSummary(write_summary, sizeof(write_summary)));
+	return 0;
+}
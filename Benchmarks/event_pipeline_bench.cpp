@@ -0,0 +1,59 @@
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hook_host.h"
+#include "bench.h"
+#include "event_pipeline.h"
+
+using namespace ProcessTracer::EventRecord;
+
+namespace
+{
+	// threads hook threads each write records of record_size bytes through the pipeline, the sender
+	// drains their rings into a transport that only parses what it gets. The first line is what the
+	// hook threads spend, the second includes shipping the rest after they are done.
+	void BenchPipeline(size_t threads, size_t record_size)
+	{
+		const size_t per_thread = ProcessTracer::Bench::Iterations(4000000) / threads;
+		const size_t records = per_thread * threads;
+		ProcessTracer::HookHarness::Session session;
+		char buffer[1024];
+		RecordWriter writer(buffer, sizeof(buffer));
+		writer.Begin(RecordType::Info, HookId::None, 1, 1, 0, 0);
+		const std::string text(record_size - sizeof(RecordHeader) - 4, 'p');
+		writer.AddUtf8(FieldId::Message, text.data(), text.size());
+		const size_t size = writer.Finish();
+
+		const ProcessTracer::Bench::Stopwatch stopwatch;
+		std::vector<std::thread> producers;
+		for (size_t thread = 0; thread < threads; ++thread)
+		{
+			producers.emplace_back([&writer, size, per_thread]
+			{
+				for (size_t i = 0; i < per_thread; ++i)
+					GetEventPipeline()->Write(writer.Data(), size);
+				ProcessTracer::HookHarness::DetachThread();
+			});
+		}
+		for (auto& producer : producers)
+			producer.join();
+		const double written = stopwatch.Seconds();
+		session.Flush();
+		const double shipped = stopwatch.Seconds();
+		ProcessTracer::Bench::DoNotOptimize(session.Bulk().Records());
+
+		const std::string name = "EventPipeline " + std::to_string(threads) + " threads " + std::to_string(size) + "B";
+		ProcessTracer::Bench::Report((name + " written").c_str(), records, written, records * size);
+		ProcessTracer::Bench::Report((name + " shipped").c_str(), records, shipped, records * size);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	ProcessTracer::Bench::Init(argc, argv);
+	for (const size_t threads : {1, 4, 16, 64})
+		BenchPipeline(threads, 128);
+	BenchPipeline(4, 512);
+	return 0;
+}
@@ -0,0 +1,156 @@
+#include <bitset>
+#include <string>
+
+#include "bench.h"
+#include "event_record.h"
+#include "utf16_to_utf8.h"
+
+using namespace ProcessTracer::EventRecord;
+
+namespace
+{
+	const std::u16string path = u"C:\\build\\obj\\x64\\Release\\ProcessTracerCore\\hook_func.obj";
+	constexpr uint32_t access_mask = 0x80100080;
+	constexpr uint32_t pid = 1234;
+
+	// What the collector needs from an NtCreateFile event.
+	struct CreateFileEvent
+	{
+		uint32_t pid = 0;
+		uint32_t access_mask = 0;
+		std::u16string path;
+	};
+
+	// The text line the hooks sent before the records, built the way the Logger built it.
+	std::string EncodeText()
+	{
+		std::string file_name;
+		ProcessTracer::Utf8::AppendFromUtf16(file_name, path.data(), path.size());
+		const std::bitset<32> binary(access_mask);
+		const auto message = "[DesiredAccess] " + binary.to_string() + ", [FileName] " + file_name;
+		const std::string hook_message = std::string("NtCreateFile") + " " + message;
+		return "pid:" + std::to_string(pid) + " " + std::string("[Hook] ") + hook_message + "\n";
+	}
+
+	// Splits the line apart again the way the collector parsed the text lines.
+	bool DecodeText(const std::string& line, CreateFileEvent& event)
+	{
+		const auto space = line.find(' ');
+		if (line.compare(0, 4, "pid:") != 0 || space == std::string::npos)
+			return false;
+		event.pid = static_cast<uint32_t>(std::stoul(line.substr(4, space - 4)));
+		const std::string rest = line.substr(space + 1);
+		const std::string access_prefix = "[Hook] NtCreateFile [DesiredAccess] ";
+		const std::string name_prefix = ", [FileName] ";
+		if (rest.compare(0, access_prefix.size(), access_prefix) != 0)
+			return false;
+		event.access_mask = static_cast<uint32_t>(std::bitset<32>(rest.substr(access_prefix.size(), 32)).to_ulong());
+		const auto name = rest.find(name_prefix);
+		if (name == std::string::npos)
+			return false;
+		const std::string file_name = rest.substr(name + name_prefix.size(), rest.size() - name - name_prefix.size() - 1);
+		event.path.assign(file_name.begin(), file_name.end());
+		return true;
+	}
+
+	size_t EncodeRecord(char* buffer, size_t capacity)
+	{
+		RecordWriter writer(buffer, capacity);
+		writer.Begin(RecordType::HookInfo, HookId::NtCreateFile, pid, 5678, 1, 0);
+		writer.AddU32(FieldId::AccessMask, access_mask);
+		writer.AddUtf16(FieldId::Path, path.data(), path.size());
+		return writer.Finish();
+	}
+
+	bool DecodeRecord(const char* data, size_t size, CreateFileEvent& event)
+	{
+		RecordReader reader;
+		if (!reader.Open(data, size))
+			return false;
+		event.pid = reader.Header().pid;
+		Field field;
+		while (reader.Next(field))
+		{
+			if (field.id == FieldId::AccessMask)
+				event.access_mask = field.AsU32();
+			else if (field.id == FieldId::Path)
+				event.path.assign(reinterpret_cast<const char16_t*>(field.value), field.length / sizeof(char16_t));
+		}
+		return true;
+	}
+
+	void BenchEncode()
+	{
+		const size_t iterations = ProcessTracer::Bench::Iterations(5000000);
+		size_t bytes = 0;
+		double seconds = ProcessTracer::Bench::Measure(iterations, [&](size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				const auto line = EncodeText();
+				bytes += line.size();
+				ProcessTracer::Bench::DoNotOptimize(line);
+			}
+		});
+		ProcessTracer::Bench::Report("encode NtCreateFile text line", iterations, seconds, bytes);
+
+		char buffer[1024];
+		bytes = 0;
+		seconds = ProcessTracer::Bench::Measure(iterations, [&](size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				bytes += EncodeRecord(buffer, sizeof(buffer));
+				ProcessTracer::Bench::DoNotOptimize(buffer);
+			}
+		});
+		ProcessTracer::Bench::Report("encode NtCreateFile record", iterations, seconds, bytes);
+	}
+
+	void BenchDecode()
+	{
+		const size_t iterations = ProcessTracer::Bench::Iterations(5000000);
+		CreateFileEvent event;
+		const auto line = EncodeText();
+		double seconds = ProcessTracer::Bench::Measure(iterations, [&](size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				DecodeText(line, event);
+				ProcessTracer::Bench::DoNotOptimize(event);
+			}
+		});
+		ProcessTracer::Bench::Report("decode NtCreateFile text line", iterations, seconds, iterations * line.size());
+
+		char buffer[1024];
+		const size_t size = EncodeRecord(buffer, sizeof(buffer));
+		seconds = ProcessTracer::Bench::Measure(iterations, [&](size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				DecodeRecord(buffer, size, event);
+				ProcessTracer::Bench::DoNotOptimize(event);
+			}
+		});
+		ProcessTracer::Bench::Report("decode NtCreateFile record", iterations, seconds, iterations * size);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	ProcessTracer::Bench::Init(argc, argv);
+	// both sides have to carry the same event
+	CreateFileEvent from_text;
+	CreateFileEvent from_record;
+	char buffer[1024];
+	if (!DecodeText(EncodeText(), from_text) || !DecodeRecord(buffer, EncodeRecord(buffer, sizeof(buffer)), from_record) ||
+		from_text.pid != from_record.pid || from_text.access_mask != from_record.access_mask ||
+		from_text.path != from_record.path)
+	{
+		fprintf(stderr, "event_record_bench: text and record decode differently\n");
+		return 1;
+	}
+	BenchEncode();
+	BenchDecode();
+	return 0;
+}
@@ -0,0 +1,106 @@
+#include <climits>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "handle_path_table.h"
+
+namespace
+{
+	uintptr_t Key(size_t handle)
+	{
+		return static_cast<uintptr_t>(handle + 1) * 4;
+	}
+
+	std::u16string PathOf(size_t handle)
+	{
+		const std::string path = "C:\\build\\obj\\module" + std::to_string(handle) + "\\main.obj";
+		return std::u16string(path.begin(), path.end());
+	}
+
+	// Lookups spread over every live handle; reports the time per lookup and the share that hit.
+	void BenchLookup(size_t live_handles)
+	{
+		const auto table = std::make_unique<ProcessTracer::HandlePathTable>();
+		size_t cached = 0;
+		for (size_t handle = 0; handle < live_handles; ++handle)
+		{
+			const auto path = PathOf(handle);
+			cached += table->Insert(Key(handle), path.data(), path.size());
+		}
+		const size_t iterations = ProcessTracer::Bench::Iterations(20000000);
+		size_t hits = 0;
+		const double seconds = ProcessTracer::Bench::Measure(iterations, [&](size_t count)
+		{
+			char16_t buffer[ProcessTracer::HandlePathTable::max_path_length];
+			for (size_t i = 0; i < count; ++i)
+				hits += table->Lookup(Key(i * 7919 % live_handles), buffer, std::size(buffer)) != 0;
+		});
+		char name[96];
+		snprintf(name, sizeof(name), "Lookup, %zu handles (%.1f%% cached, %.1f%% hit)", live_handles,
+		         100.0 * static_cast<double>(cached) / static_cast<double>(live_handles),
+		         100.0 * static_cast<double>(hits) / static_cast<double>(iterations));
+		ProcessTracer::Bench::Report(name, iterations, seconds);
+	}
+
+	// An open and a close: what NtCreateFile and NtClose add to the table.
+	void BenchInsertErase()
+	{
+		const auto table = std::make_unique<ProcessTracer::HandlePathTable>();
+		for (size_t handle = 0; handle < 256; ++handle)
+		{
+			const auto path = PathOf(handle);
+			table->Insert(Key(handle), path.data(), path.size());
+		}
+		const auto path = PathOf(100000);
+		const size_t iterations = ProcessTracer::Bench::Iterations(10000000);
+		const double seconds = ProcessTracer::Bench::Measure(iterations, [&](size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				const uintptr_t key = Key(1000 + i % 64);
+				table->Insert(key, path.data(), path.size());
+				table->Erase(key);
+			}
+		});
+		ProcessTracer::Bench::Report("Insert and Erase", iterations, seconds);
+	}
+
+	// The fallback on a miss: asking the kernel for the name of a descriptor, as NtQueryObject does
+	// for a handle.
+	void BenchQuery()
+	{
+		char path[] = "/tmp/handle_path_table_bench.XXXXXX";
+		const int fd = mkstemp(path);
+		if (fd < 0)
+			return;
+		char link[64];
+		snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+		const size_t iterations = ProcessTracer::Bench::Iterations(1000000);
+		const double seconds = ProcessTracer::Bench::Measure(iterations, [&link](size_t count)
+		{
+			char target[PATH_MAX];
+			for (size_t i = 0; i < count; ++i)
+				ProcessTracer::Bench::DoNotOptimize(readlink(link, target, sizeof(target)));
+		});
+		ProcessTracer::Bench::Report("Name query (readlink /proc/self/fd)", iterations, seconds);
+		close(fd);
+		unlink(path);
+	}
+}
+
+// The handle table against the name query it saves: lookups at a few fill levels of its 1024 slots,
+// the cost an open and close add, and the kernel query every miss falls back to.
+int main(int argc, char** argv)
+{
+	ProcessTracer::Bench::Init(argc, argv);
+	for (const size_t live_handles : {size_t{64}, size_t{512}, size_t{2048}})
+		BenchLookup(live_handles);
+	BenchInsertErase();
+	BenchQuery();
+	return 0;
+}
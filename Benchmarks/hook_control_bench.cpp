@@ -0,0 +1,79 @@
+#include <string>
+
+#include "hook_host.h"
+#include "bench.h"
+#include "hook_control.h"
+#include "hook_func.h"
+
+using namespace ProcessTracer::EventRecord;
+
+namespace
+{
+	ProcessTracer::Control::ControlBlock g_block = {};
+	std::u16string g_path = u"C:\\out\\main.obj";
+	UNICODE_STRING g_name;
+	OBJECT_ATTRIBUTES g_attributes;
+	IO_STATUS_BLOCK g_io;
+	HANDLE g_handle = nullptr;
+	char g_data[64] = {};
+
+	void SetWriteWord(uint32_t word)
+	{
+		g_block.hooks[static_cast<size_t>(HookId::NtWriteFile)].store(word, std::memory_order_relaxed);
+	}
+
+	template <typename Write>
+	void BenchWrite(const char* name, Write&& write)
+	{
+		const size_t iterations = ProcessTracer::Bench::Iterations(5000000);
+		const double seconds = ProcessTracer::Bench::Measure(iterations, [&write](size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+				write();
+		});
+		ProcessTracer::Bench::Report(name, iterations, seconds);
+	}
+
+	void HookedWrite()
+	{
+		HookNtWriteFile(g_handle, nullptr, nullptr, nullptr, &g_io, g_data, sizeof(g_data), nullptr, nullptr);
+	}
+}
+
+// What NtWriteFile costs the traced program with its hook switched off, sampled and on, against the
+// call without the hook and the switch check on its own.
+int main(int argc, char** argv)
+{
+	ProcessTracer::Bench::Init(argc, argv);
+	g_block.magic = ProcessTracer::Control::control_magic;
+	g_block.version = ProcessTracer::Control::control_version;
+	g_block.hook_count = static_cast<uint32_t>(HookId::Count);
+	GetHookControl()->Attach(&g_block);
+	ProcessTracer::HookHarness::Session session;
+	g_name.Length = static_cast<USHORT>(g_path.size() * sizeof(WCHAR));
+	g_name.MaximumLength = g_name.Length;
+	g_name.Buffer = reinterpret_cast<PWSTR>(g_path.data());
+	InitializeObjectAttributes(&g_attributes, &g_name, OBJ_CASE_INSENSITIVE, nullptr, nullptr);
+	HookNtCreateFile(&g_handle, GENERIC_WRITE, &g_attributes, &g_io, nullptr, FILE_ATTRIBUTE_NORMAL, 0,
+	                 FILE_OVERWRITE_IF, FILE_SYNCHRONOUS_IO_NONALERT, nullptr, 0);
+
+	SetWriteWord(0);
+	BenchWrite("ShouldLog, switched off", []
+	{
+		ProcessTracer::Bench::DoNotOptimize(GetHookControl()->ShouldLog(HookId::NtWriteFile));
+	});
+	BenchWrite("NtWriteFile", []
+	{
+		NtWriteFile(g_handle, nullptr, nullptr, nullptr, &g_io, g_data, sizeof(g_data), nullptr, nullptr);
+	});
+	BenchWrite("HookNtWriteFile, switched off", HookedWrite);
+	SetWriteWord(ProcessTracer::Control::hook_enabled | 1000);
+	BenchWrite("HookNtWriteFile, 1 in 1000 sampled", HookedWrite);
+	SetWriteWord(ProcessTracer::Control::hook_enabled | 1);
+	BenchWrite("HookNtWriteFile, every call logged", HookedWrite);
+
+	HookNtClose(g_handle);
+	session.Flush();
+	ProcessTracer::HookHarness::DetachThread();
+	return 0;
+}
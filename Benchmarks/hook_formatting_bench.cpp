@@ -0,0 +1,139 @@
+#include <bitset>
+#include <cstdio>
+#include <string>
+
+#include "allocation_counter.h"
+#include "hook_host.h"
+#include "bench.h"
+#include "event_formatter.h"
+#include "handle_path_table.h"
+#include "hook_func.h"
+#include "logger.h"
+#include "string_utils.h"
+#include "utf16_to_utf8.h"
+
+using namespace ProcessTracer::EventRecord;
+using ProcessTracer::HookHarness::Allocations;
+
+namespace
+{
+	std::u16string g_path = u"\\??\\C:\\build\\obj\\x64\\Release\\ProcessTracerCore\\hook_func.obj";
+	UNICODE_STRING g_name;
+	OBJECT_ATTRIBUTES g_attributes;
+	IO_STATUS_BLOCK g_io;
+	HANDLE g_handle = nullptr;
+	char g_data[64] = {};
+
+	// Runs call iterations times on the traced thread, prints the time and heap allocations per call.
+	template <typename Call>
+	void BenchHook(const char* name, Call&& call)
+	{
+		const size_t iterations = ProcessTracer::Bench::Iterations(1000000);
+		call();
+		const uint64_t allocations = Allocations();
+		const double seconds = ProcessTracer::Bench::Measure(iterations, [&call](size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+				call();
+		});
+		const double per_call = static_cast<double>(Allocations() - allocations) / static_cast<double>(iterations);
+		ProcessTracer::Bench::Report(name, iterations, seconds);
+		printf("%-48s %10.2f allocations/op\n", name, per_call);
+		fflush(stdout);
+	}
+
+	std::string ToUtf8(const char16_t* text, size_t length)
+	{
+		std::string converted;
+		ProcessTracer::Utf8::AppendFromUtf16(converted, text, length);
+		return converted;
+	}
+
+	// HookNtCreateFile as it was when hooks rendered text: the name converted once for the pipe name
+	// check and once for the line, the access mask spelled out as a bitset, the line concatenated.
+	void CreateRenderedInHook()
+	{
+		NtCreateFile(&g_handle, GENERIC_WRITE, &g_attributes, &g_io, nullptr, FILE_ATTRIBUTE_NORMAL, 0,
+		             FILE_OVERWRITE_IF, FILE_SYNCHRONOUS_IO_NONALERT, nullptr, 0);
+		const auto length = g_name.Length / sizeof(WCHAR);
+		const auto buffer = reinterpret_cast<const char16_t*>(g_name.Buffer);
+		if (!EndsWith(ToUtf8(buffer, length), "ProcessTracerPipe:1"))
+		{
+			const auto file_name = ToUtf8(buffer, length);
+			const std::bitset<32> binary(GENERIC_WRITE);
+			const auto message = "[DesiredAccess] " + binary.to_string() + ", [FileName] " + file_name;
+			LogHookInfo(HookId::NtCreateFile, message.c_str());
+		}
+		HookNtClose(g_handle);
+	}
+
+	void CreateRawRecord()
+	{
+		HookNtCreateFile(&g_handle, GENERIC_WRITE, &g_attributes, &g_io, nullptr, FILE_ATTRIBUTE_NORMAL, 0,
+		                 FILE_OVERWRITE_IF, FILE_SYNCHRONOUS_IO_NONALERT, nullptr, 0);
+		HookNtClose(g_handle);
+	}
+
+	// HookNtWriteFile rendering its line: the cached name converted into a new string.
+	void WriteRenderedInHook()
+	{
+		NtWriteFile(g_handle, nullptr, nullptr, nullptr, &g_io, g_data, sizeof(g_data), nullptr, nullptr);
+		char16_t name[ProcessTracer::HandlePathTable::max_path_length];
+		const size_t length = GetHandlePathTable()->Lookup(reinterpret_cast<uintptr_t>(g_handle), name,
+		                                                   std::size(name));
+		LogHookInfo(HookId::NtWriteFile, ToUtf8(name, length).c_str());
+	}
+
+	void WriteRawRecord()
+	{
+		HookNtWriteFile(g_handle, nullptr, nullptr, nullptr, &g_io, g_data, sizeof(g_data), nullptr, nullptr);
+	}
+
+	// What the collector now spends on each record, off the traced program's threads.
+	void BenchCollectorRendering()
+	{
+		char record[ProcessTracer::hook_record_capacity];
+		RecordWriter writer(record, sizeof(record));
+		writer.Begin(RecordType::HookInfo, HookId::NtCreateFile, 1, 2, 3, 0);
+		writer.AddU32(FieldId::AccessMask, GENERIC_WRITE);
+		writer.AddU32(FieldId::Disposition, FILE_OVERWRITE_IF);
+		writer.AddUtf16(FieldId::Path, g_path.data(), g_path.size());
+		const size_t size = writer.Finish();
+		std::string line;
+		BenchHook("collector: render NtCreateFile record", [&]
+		{
+			line.clear();
+			FormatRecord(record, size, line);
+			ProcessTracer::Bench::DoNotOptimize(line);
+		});
+	}
+}
+
+// What a hooked call costs the traced thread when the hook renders its text line, against the hook
+// capturing raw arguments into a record, with both shipped through the pipeline into memory. The
+// fake NtCreateFile allocates for every handle it opens, in both variants. The last line is the
+// rendering the collector does instead.
+int main(int argc, char** argv)
+{
+	ProcessTracer::Bench::Init(argc, argv);
+	ProcessTracer::HookHarness::Session session;
+	g_name.Length = static_cast<USHORT>(g_path.size() * sizeof(WCHAR));
+	g_name.MaximumLength = g_name.Length;
+	g_name.Buffer = reinterpret_cast<PWSTR>(g_path.data());
+	InitializeObjectAttributes(&g_attributes, &g_name, OBJ_CASE_INSENSITIVE, nullptr, nullptr);
+
+	BenchHook("NtCreateFile, text rendered in the hook", CreateRenderedInHook);
+	BenchHook("NtCreateFile, raw record", CreateRawRecord);
+	session.Flush();
+
+	HookNtCreateFile(&g_handle, GENERIC_WRITE, &g_attributes, &g_io, nullptr, FILE_ATTRIBUTE_NORMAL, 0,
+	                 FILE_OVERWRITE_IF, FILE_SYNCHRONOUS_IO_NONALERT, nullptr, 0);
+	BenchHook("NtWriteFile, text rendered in the hook", WriteRenderedInHook);
+	BenchHook("NtWriteFile, raw record", WriteRawRecord);
+	HookNtClose(g_handle);
+	session.Flush();
+
+	BenchCollectorRendering();
+	ProcessTracer::HookHarness::DetachThread();
+	return 0;
+}
@@ -0,0 +1,160 @@
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#include "allocation_counter.h"
+#include "bench.h"
+#include "call_stream.h"
+#include "hook_host.h"
+
+using ProcessTracer::EventRecord::HookId;
+using ProcessTracer::EventRecord::RecordType;
+using namespace ProcessTracer::HookHarness;
+
+namespace
+{
+	struct Options
+	{
+		WorkloadOptions workload;
+		size_t repeat = 2;
+		uint64_t call_cost_ns = 0;
+		bool aggregate_writes = false;
+		const char* stream = nullptr;
+	};
+
+	const char* usage =
+		"usage: hook_replay_bench [--quick] [--threads N] [--files N] [--writes N] [--repeat N] [--cost ns]\n"
+		"                         [--aggregate] [--stream file]\n";
+
+	bool ParseOptions(int argc, char** argv, Options& options)
+	{
+		if (ProcessTracer::Bench::Quick())
+		{
+			options.workload.threads = 16;
+			options.workload.files_per_thread = 8;
+			options.repeat = 1;
+		}
+		else
+		{
+			options.workload.threads = 2000;
+			options.workload.files_per_thread = 64;
+		}
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string option = argv[i];
+			if (option == "--quick")
+				continue;
+			if (option == "--aggregate")
+			{
+				options.aggregate_writes = true;
+				continue;
+			}
+			if (i + 1 == argc)
+				return false;
+			const char* value = argv[++i];
+			if (option == "--stream")
+				options.stream = value;
+			else if (option == "--threads")
+				options.workload.threads = strtoull(value, nullptr, 10);
+			else if (option == "--files")
+				options.workload.files_per_thread = strtoull(value, nullptr, 10);
+			else if (option == "--writes")
+				options.workload.writes_per_file = strtoull(value, nullptr, 10);
+			else if (option == "--repeat")
+				options.repeat = strtoull(value, nullptr, 10);
+			else if (option == "--cost")
+				options.call_cost_ns = strtoull(value, nullptr, 10);
+			else
+				return false;
+		}
+		return options.repeat != 0;
+	}
+
+	struct Run
+	{
+		double seconds;
+		uint64_t allocations;
+	};
+
+	Run Measure(const CallStream& stream, ReplayMode mode, size_t repeat)
+	{
+		const uint64_t allocations = Allocations();
+		const double seconds = Replay(stream, mode, repeat);
+		return {seconds, Allocations() - allocations};
+	}
+
+	uint64_t LossRecords(const CaptureTransport& transport)
+	{
+		uint64_t records = 0;
+		for (size_t hook = 0; hook < static_cast<size_t>(HookId::Count); ++hook)
+			records += transport.Records(RecordType::Loss, static_cast<HookId>(hook));
+		return records;
+	}
+
+	void Print(const char* name, double value, const char* unit)
+	{
+		printf("%-48s %10.1f %s\n", name, value, unit);
+	}
+}
+
+// Replays the calls of a build, thousands of threads writing their outputs, once straight into the
+// fake NT layer and once through the hooks. The difference is what the hooks cost per call; the
+// events are counted where the collector would receive them.
+int main(int argc, char** argv)
+{
+	ProcessTracer::Bench::Init(argc, argv);
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		fputs(usage, stderr);
+		return 2;
+	}
+	CallStream stream;
+	if (options.stream)
+	{
+		std::ifstream input(options.stream);
+		std::string error;
+		if (!input || !ParseCallStream(input, stream, error))
+		{
+			fprintf(stderr, "%s: %s\n", options.stream, input ? error.c_str() : "cannot be read");
+			return 1;
+		}
+	}
+	else
+	{
+		stream = GenerateCallStream(options.workload);
+	}
+	ProcessTracer::FakeWin32::SetCallCost(options.call_cost_ns);
+	const size_t calls = stream.Calls() * options.repeat;
+	printf("%zu threads, %zu calls\n", stream.threads.size(), calls);
+
+	const Run direct = Measure(stream, ReplayMode::Direct, options.repeat);
+	ProcessTracer::Bench::Report("replay without hooks", calls, direct.seconds);
+
+	SessionOptions session_options;
+	session_options.aggregate_writes = options.aggregate_writes;
+	Session session(session_options);
+	const Run hooked = Measure(stream, ReplayMode::Hooked, options.repeat);
+	session.Flush();
+	ProcessTracer::Bench::Report("replay through the hooks", calls, hooked.seconds);
+
+	const auto per_call = [calls](double value) { return value / static_cast<double>(calls); };
+	Print("hook overhead", per_call(hooked.seconds - direct.seconds) * 1e9, "ns/call");
+	// thread start-up allocates the same in both runs
+	Print("hook allocations",
+	      per_call(static_cast<double>(hooked.allocations) - static_cast<double>(direct.allocations)),
+	      "allocs/call");
+	const auto& bulk = session.Bulk();
+	Print("events", static_cast<double>(bulk.Records()), "records");
+	Print("NtCreateFile events", static_cast<double>(bulk.Records(RecordType::HookInfo, HookId::NtCreateFile)),
+	      "records");
+	Print("NtWriteFile events", static_cast<double>(bulk.Records(RecordType::HookInfo, HookId::NtWriteFile)),
+	      "records");
+	Print("NtSetInformationFile events",
+	      static_cast<double>(bulk.Records(RecordType::HookInfo, HookId::NtSetInformationFile)), "records");
+	Print("loss records", static_cast<double>(LossRecords(bulk)), "records");
+	Print("shipped", static_cast<double>(bulk.Bytes()) / static_cast<double>(calls), "bytes/call");
+	const uint64_t queries = ProcessTracer::FakeWin32::CallCount(ProcessTracer::FakeWin32::NtCall::QueryObject);
+	Print("NtQueryObject calls", static_cast<double>(queries), "calls");
+	return 0;
+}
@@ -0,0 +1,219 @@
+#include <cstring>
+#include <string>
+
+#include "bench.h"
+#include "event_formatter.h"
+#include "line_classifier.h"
+
+using namespace ProcessTracer::EventRecord;
+
+namespace
+{
+	// a line as the collector renders it from a record the hooks send
+	template <typename Add>
+	std::string Rendered(RecordType type, HookId hook_id, Add&& add)
+	{
+		char buffer[512];
+		RecordWriter writer(buffer, sizeof(buffer));
+		writer.Begin(type, hook_id, 4242, 4243, 0, 0);
+		add(writer);
+		std::string line;
+		FormatRecord(buffer, writer.Finish(), line);
+		return line;
+	}
+
+	// A receive buffer as the collector sees it: mostly file events of the usual length, every 64th
+	// line a message the tracer acts on.
+	std::string ReceiveBuffer(size_t& lines)
+	{
+		const std::string control[] = {
+			Rendered(RecordType::HookInfo, HookId::CreateProcessInternalW, [](RecordWriter& writer)
+			{
+				writer.AddU32(FieldId::ProcessId, 5151);
+			}),
+			Rendered(RecordType::HookInfo, HookId::ExitProcess, [](RecordWriter& writer)
+			{
+				writer.AddU32(FieldId::ExitCode, 0);
+			}),
+			Rendered(RecordType::HookInfo, HookId::ShellExecuteExW, [](RecordWriter& writer)
+			{
+				writer.AddUtf8(FieldId::Message, shell_execute_start_message);
+			}),
+			Rendered(RecordType::Loss, HookId::NtWriteFile, [](RecordWriter& writer)
+			{
+				writer.AddU64(FieldId::LostCount, 12);
+				writer.AddU32(FieldId::LossStage, static_cast<uint32_t>(LossStage::Buffer));
+			}),
+		};
+		std::string buffer;
+		lines = 0;
+		while (buffer.size() < 1024 * 1024)
+		{
+			if (lines % 64 == 63)
+				buffer += control[lines / 64 % 4];
+			else
+			{
+				const std::u16string path = u"C:\\build\\obj\\x64\\Release\\ProcessTracerCore\\unit" +
+					std::u16string(1, static_cast<char16_t>(u'0' + lines % 10)) + u".obj";
+				buffer += Rendered(RecordType::HookInfo, HookId::NtWriteFile, [&path](RecordWriter& writer)
+				{
+					writer.AddU32(FieldId::Length, 4096);
+					writer.AddUtf16(FieldId::Path, path.data(), path.size());
+				});
+			}
+			buffer += '\n';
+			++lines;
+		}
+		return buffer;
+	}
+
+	// The classifier before the rule table: exact and prefix comparisons picked by a switch on the hook
+	// name's first letter, with the lines split by memchr.
+	LineKind SwitchClassify(const char* line, size_t length, uint32_t& pid)
+	{
+		const auto starts_with = [](const char* text, size_t text_length, const char* prefix)
+		{
+			const size_t prefix_length = strlen(prefix);
+			return text_length >= prefix_length && memcmp(text, prefix, prefix_length) == 0;
+		};
+		const auto equals = [](const char* text, size_t text_length, const char* other)
+		{
+			return text_length == strlen(other) && memcmp(text, other, text_length) == 0;
+		};
+		pid = 0;
+		if (equals(line, length, "[CloseApp]"))
+			return LineKind::CloseApp;
+		if (starts_with(line, length, Detail::child_process_prefix))
+		{
+			constexpr size_t skip = sizeof(Detail::child_process_prefix) - 1;
+			pid = Detail::ParsePid(line + skip, length - skip, 0);
+			return LineKind::ChildProcess;
+		}
+		const auto space = static_cast<const char*>(memchr(line, ' ', length));
+		if (!space)
+			return LineKind::Other;
+		const char* text = space + 1;
+		const size_t text_length = length - (text - line);
+		if (starts_with(text, text_length, "[Hook] ") && text_length > 7)
+		{
+			switch (text[7])
+			{
+			case 'C':
+				if (starts_with(text, text_length, Detail::process_created_prefix))
+				{
+					constexpr size_t skip = sizeof(Detail::process_created_prefix) - 1;
+					pid = Detail::ParsePid(text + skip, text_length - skip, 0);
+					return LineKind::ProcessCreated;
+				}
+				break;
+			case 'E':
+				if (starts_with(text, text_length, Detail::process_exited_prefix))
+				{
+					constexpr size_t skip = sizeof(Detail::process_exited_prefix) - 1;
+					pid = Detail::ParsePid(text + skip, text_length - skip, ' ');
+					return LineKind::ProcessExited;
+				}
+				break;
+			case 'S':
+				if (equals(text, text_length, "[Hook] ShellExecuteExW Start HookShellExecuteW"))
+					return LineKind::ShellExecuteStart;
+				if (equals(text, text_length, "[Hook] ShellExecuteExW Error HookShellExecuteW"))
+					return LineKind::ShellExecuteError;
+				break;
+			default:
+				break;
+			}
+			return LineKind::Other;
+		}
+		if (equals(text, text_length, "[Info] Permission Request"))
+			return LineKind::PermissionRequest;
+		if (starts_with(text, text_length, "[Loss] "))
+			return LineKind::Loss;
+		return LineKind::Other;
+	}
+
+	void BenchSwitch(const std::string& buffer, size_t lines)
+	{
+		const size_t iterations = ProcessTracer::Bench::Iterations(2000);
+		const double seconds = ProcessTracer::Bench::Measure(iterations, [&](size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				uint32_t kinds = 0;
+				const char* line = buffer.data();
+				const char* const end = line + buffer.size();
+				const char* line_end;
+				while ((line_end = static_cast<const char*>(memchr(line, '\n', end - line))) != nullptr)
+				{
+					uint32_t pid;
+					kinds += static_cast<uint32_t>(SwitchClassify(line, line_end - line, pid)) + pid;
+					line = line_end + 1;
+				}
+				ProcessTracer::Bench::DoNotOptimize(kinds);
+			}
+		});
+		ProcessTracer::Bench::Report("memchr split, switch classify", iterations * lines, seconds,
+		                             iterations * buffer.size());
+	}
+
+	void BenchScanLines(const std::string& buffer, size_t lines)
+	{
+		const size_t iterations = ProcessTracer::Bench::Iterations(2000);
+		const double seconds = ProcessTracer::Bench::Measure(iterations, [&](size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				uint32_t kinds = 0;
+				ScanLines(buffer.data(), buffer.size(), [&kinds](const LineView& view)
+				{
+					kinds += static_cast<uint32_t>(view.kind) + view.pid;
+				});
+				ProcessTracer::Bench::DoNotOptimize(kinds);
+			}
+		});
+		ProcessTracer::Bench::Report("ScanLines", iterations * lines, seconds, iterations * buffer.size());
+	}
+
+	// the scan alone, over a line of 4 KB that ends with the byte
+	template <typename Find>
+	void BenchFind(const char* name, Find&& find)
+	{
+		std::string line(4096, 'x');
+		line.back() = '\n';
+		const size_t iterations = ProcessTracer::Bench::Iterations(1000000);
+		const double seconds = ProcessTracer::Bench::Measure(iterations, [&](size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				ProcessTracer::Bench::DoNotOptimize(line.data());
+				ProcessTracer::Bench::DoNotOptimize(find(line.data(), line.data() + line.size(), '\n'));
+			}
+		});
+		ProcessTracer::Bench::Report(name, iterations, seconds, iterations * line.size());
+	}
+}
+
+// Splitting and classifying a 1 MB receive buffer, the way the collector did it before against
+// ScanLines, then the newline scan on each instruction set and memchr.
+int main(int argc, char** argv)
+{
+	ProcessTracer::Bench::Init(argc, argv);
+	size_t lines;
+	const std::string buffer = ReceiveBuffer(lines);
+	BenchSwitch(buffer, lines);
+	BenchScanLines(buffer, lines);
+
+	BenchFind("FindByte scalar, 4 KB", Detail::FindByteScalar);
+#ifdef PROCESS_TRACER_SSE2
+	BenchFind("FindByte SSE2, 4 KB", Detail::FindByteSse2);
+#endif
+#ifdef PROCESS_TRACER_AVX2
+	if (ProcessTracer::Simd::avx2_supported)
+		BenchFind("FindByte AVX2, 4 KB", Detail::FindByteAvx2);
+#endif
+	BenchFind("memchr, 4 KB", [](const char* begin, const char* end, char byte)
+	{
+		return static_cast<const char*>(memchr(begin, byte, end - begin));
+	});
+	return 0;
+}
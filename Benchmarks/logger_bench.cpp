@@ -0,0 +1,83 @@
+#include <bitset>
+#include <cstdio>
+#include <string>
+
+#include "allocation_counter.h"
+#include "hook_host.h"
+#include "bench.h"
+#include "logger.h"
+
+using namespace ProcessTracer::EventRecord;
+using ProcessTracer::HookHarness::Allocations;
+
+namespace
+{
+	const std::u16string path = u"C:\\build\\obj\\x64\\Release\\ProcessTracerCore\\hook_func.obj";
+
+	// Runs log(i) iterations times, prints the time per call and the heap allocations per call.
+	template <typename Log>
+	void BenchLog(const char* name, Log&& log)
+	{
+		const size_t iterations = ProcessTracer::Bench::Iterations(2000000);
+		log(0);
+		const uint64_t allocations = Allocations();
+		const double seconds = ProcessTracer::Bench::Measure(iterations, [&log](size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+				log(i);
+		});
+		const double per_call = static_cast<double>(Allocations() - allocations) / static_cast<double>(iterations);
+		ProcessTracer::Bench::Report(name, iterations, seconds);
+		printf("%-48s %10.2f allocations/op\n", name, per_call);
+	}
+
+	// The NtCreateFile line the way the Logger built it before records: a bitset string, the file
+	// name converted into a std::string and the line concatenated from temporaries.
+	void FormatTextLine(uint64_t i)
+	{
+		const std::bitset<32> binary(static_cast<uint32_t>(i));
+		const std::string file_name(path.begin(), path.end());
+		const auto message = "[DesiredAccess] " + binary.to_string() + ", [FileName] " + file_name;
+		const std::string hook_message = std::string("NtCreateFile") + " " + message;
+		char buffer[1024];
+		snprintf(buffer, sizeof(buffer), "%s", hook_message.c_str());
+		const std::string line = "pid:" + std::to_string(1234) + " " + std::string("[Hook] ") + buffer + "\n";
+		ProcessTracer::Bench::DoNotOptimize(line);
+	}
+
+	void FormatRecord(uint64_t i)
+	{
+		char buffer[ProcessTracer::hook_record_capacity];
+		RecordWriter writer(buffer, sizeof(buffer));
+		ProcessTracer::Logger::g_logger.BeginRecord(writer, RecordType::HookInfo, HookId::NtCreateFile, 0);
+		writer.AddU32(FieldId::AccessMask, static_cast<uint32_t>(i));
+		writer.AddUtf16(FieldId::Path, path.data(), path.size());
+		ProcessTracer::Bench::DoNotOptimize(writer.Finish());
+		ProcessTracer::Bench::DoNotOptimize(buffer);
+	}
+}
+
+// Formatting alone, the old text line against a record, then whole logging calls through the
+// pipeline, which ships into memory.
+int main(int argc, char** argv)
+{
+	ProcessTracer::Bench::Init(argc, argv);
+	ProcessTracer::HookHarness::Session session;
+	BenchLog("format NtCreateFile text line", FormatTextLine);
+	BenchLog("format NtCreateFile record", FormatRecord);
+	BenchLog("LogInfo", [](uint64_t) { LogInfo("Start HookShellExecuteW"); });
+	BenchLog("LogHookInfoF", [](uint64_t i)
+	{
+		LogHookInfoF(HookId::NtWriteFile, "[Length] %llu", static_cast<unsigned long long>(i));
+	});
+	BenchLog("HookRecord NtCreateFile", [](uint64_t i)
+	{
+		ProcessTracer::HookRecord record(HookId::NtCreateFile);
+		record->AddU32(FieldId::AccessMask, static_cast<uint32_t>(i));
+		record->AddUtf16(FieldId::Path, path.data(), path.size());
+		record.Send();
+	});
+	session.Flush();
+	ProcessTracer::HookHarness::DetachThread();
+	return 0;
+}
@@ -0,0 +1,101 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "path_filter.h"
+
+namespace
+{
+	std::u16string Widen(const std::string& text)
+	{
+		return std::u16string(text.begin(), text.end());
+	}
+
+	// What a traced build touches: compiler temporaries, objects and binaries under the output tree,
+	// headers of the toolchain, system DLLs named by device path and files written next to sources.
+	std::vector<std::u16string> BuildPaths(size_t count)
+	{
+		static const char* const modules[] = {"core", "net", "ui", "storage", "render", "audio", "tools", "tests"};
+		static const char* const headers[] = {"vector", "string", "memory", "algorithm", "windows.h", "winternl.h"};
+		static const char* const dlls[] = {"kernel32.dll", "ntdll.dll", "ucrtbase.dll", "msvcp140.dll"};
+		std::mt19937 random(5);
+		std::vector<std::u16string> paths;
+		paths.reserve(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			const std::string module = modules[random() % std::size(modules)];
+			const std::string file = "file" + std::to_string(random() % 2000);
+			std::string path;
+			switch (random() % 8)
+			{
+			case 0:
+				path = "C:\\Users\\dev\\AppData\\Local\\Temp\\_CL_" + std::to_string(random()) + ".tmp";
+				break;
+			case 1:
+			case 2:
+				path = "\\??\\C:\\build\\out\\" + module + "\\obj\\" + file + ".obj";
+				break;
+			case 3:
+				path = "\\??\\C:\\build\\out\\" + module + "\\bin\\" + module + ".dll";
+				break;
+			case 4:
+				path = "\\??\\C:\\build\\out\\" + module + "\\bin\\" + module + ".pdb";
+				break;
+			case 5:
+				path = "C:\\Program Files\\Microsoft Visual Studio\\2022\\Community\\VC\\Tools\\MSVC\\14.38.33130\\include\\" +
+					std::string(headers[random() % std::size(headers)]);
+				break;
+			case 6:
+				path = "\\Device\\HarddiskVolume3\\Windows\\System32\\" + std::string(dlls[random() % std::size(dlls)]);
+				break;
+			default:
+				path = "\\??\\C:\\src\\" + module + "\\" + file + ".cpp.tlog";
+				break;
+			}
+			paths.push_back(Widen(path));
+		}
+		return paths;
+	}
+
+	void BenchRules(const char* name, const std::string& rules, const std::vector<std::u16string>& paths)
+	{
+		ProcessTracer::PathFilter filter;
+		const ProcessTracer::Bench::Stopwatch compile;
+		if (!filter.Compile(rules.data(), rules.size()))
+		{
+			printf("%s: rules do not compile\n", name);
+			return;
+		}
+		const double compile_seconds = compile.Seconds();
+		size_t bytes = 0;
+		for (const auto& path : paths)
+			bytes += path.size() * sizeof(char16_t);
+		size_t passed = 0;
+		const double seconds = ProcessTracer::Bench::Measure(paths.size(), [&](size_t)
+		{
+			for (const auto& path : paths)
+				passed += filter.Matches(path.data(), path.size());
+		});
+		const std::string label = std::string(name) + " (" +
+			std::to_string(passed * 100 / paths.size()) + "% pass)";
+		ProcessTracer::Bench::Report(label.c_str(), paths.size(), seconds, bytes);
+		printf("%-48s %10.1f us\n", (std::string(name) + " compile").c_str(), compile_seconds * 1e6);
+	}
+}
+
+// The path filter over a million paths of the kind a build opens and writes, for the rule sets
+// the tracer is typically started with.
+int main(int argc, char** argv)
+{
+	ProcessTracer::Bench::Init(argc, argv);
+	const auto paths = BuildPaths(ProcessTracer::Bench::Iterations(1000000));
+	BenchRules("output tree", "+C:/build/out/**\n-**/*.pdb\n-**/obj/**\n", paths);
+	BenchRules("excludes only", "-**/*.tmp\n-**/*.tlog\n-C:/Program Files/**\n-**/Windows/**\n", paths);
+	std::string modules;
+	for (const char* module : {"core", "net", "ui", "storage", "render", "audio", "tools", "tests"})
+		modules += std::string("+C:/build/out/") + module + "/bin/*.dll\n";
+	BenchRules("eight binary directories", modules, paths);
+	BenchRules("extensions anywhere", "+**.obj\n+**.dll\n+**.exe\n+**.lib\n", paths);
+	return 0;
+}
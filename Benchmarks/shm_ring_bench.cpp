@@ -0,0 +1,93 @@
+#include <cerrno>
+#include <csignal>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "shared_memory_transport.h"
+
+using namespace ProcessTracer::SharedMemoryRing;
+
+namespace
+{
+	bool IsAlive(uint32_t pid)
+	{
+		return kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM;
+	}
+
+	// processes producer processes map the ring and write frames of payload bytes as fast as it takes
+	// them, blocking when it is full; this process reads them until all producers exited.
+	void BenchProcesses(size_t processes, size_t payload)
+	{
+		const size_t per_process = ProcessTracer::Bench::Iterations(2000000) / processes;
+		const size_t frames = per_process * processes;
+		ProcessTracer::SharedMemoryRingOwner owner;
+		if (!owner.Create(getpid(), 1 << 20))
+		{
+			fprintf(stderr, "shm_ring_bench: cannot create the ring\n");
+			return;
+		}
+		const int tracer_pid = getpid();
+		const std::string message(payload, 's');
+
+		const ProcessTracer::Bench::Stopwatch stopwatch;
+		std::vector<pid_t> children;
+		for (size_t process = 0; process < processes; ++process)
+		{
+			const pid_t child = fork();
+			if (child == 0)
+			{
+				ProcessTracer::SharedMemoryTransport transport(true);
+				if (!transport.Map(tracer_pid))
+					_exit(2);
+				for (size_t i = 0; i < per_process; ++i)
+					transport.Write(message.data(), message.size());
+				_exit(0);
+			}
+			children.push_back(child);
+		}
+
+		ReaderState state;
+		size_t read = 0;
+		size_t running = children.size();
+		uint64_t now_ms = 0;
+		const auto count = [&read](const char*, size_t length)
+		{
+			ProcessTracer::Bench::DoNotOptimize(length);
+			++read;
+		};
+		while (running > 0)
+		{
+			now_ms = static_cast<uint64_t>(stopwatch.Seconds() * 1000);
+			if (ReadFrames(owner.Ring(), state, now_ms, count, IsAlive) == 0)
+				usleep(50);
+			for (auto& child : children)
+			{
+				if (child != 0 && waitpid(child, nullptr, WNOHANG) == child)
+				{
+					child = 0;
+					--running;
+				}
+			}
+		}
+		ReadFrames(owner.Ring(), state, now_ms, count, IsAlive);
+		const double seconds = stopwatch.Seconds();
+
+		if (read + owner.Ring()->dropped_frames.load() != frames)
+			fprintf(stderr, "shm_ring_bench: %zu of %zu frames arrived\n", read, frames);
+		const std::string name = "SharedMemoryRing " + std::to_string(processes) + " processes " +
+			std::to_string(payload) + "B";
+		ProcessTracer::Bench::Report(name.c_str(), read, seconds, read * payload);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	ProcessTracer::Bench::Init(argc, argv);
+	for (const size_t processes : {1, 2, 4})
+		BenchProcesses(processes, 128);
+	BenchProcesses(2, 1024);
+	return 0;
+}
@@ -0,0 +1,316 @@
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "bench.h"
+#include "bounded_queue.h"
+#include "event_formatter.h"
+#include "socket_collector.h"
+#include "unix_socket_transport.h"
+
+using namespace ProcessTracer::EventRecord;
+
+namespace
+{
+	constexpr size_t records_per_write = 64;
+
+	// the batches one producer ships: NtWriteFile records of the size the hooks send, each with its
+	// thread's sequence number
+	std::vector<std::string> RecordBatches(uint32_t pid, size_t records)
+	{
+		std::vector<std::string> batches;
+		const std::u16string path = u"\\??\\C:\\build\\obj\\x64\\Release\\ProcessTracerCore\\hook_func.obj";
+		char data[512];
+		for (size_t record = 0; record < records; ++record)
+		{
+			if (record % records_per_write == 0)
+				batches.emplace_back();
+			RecordWriter writer(data, sizeof(data));
+			writer.Begin(RecordType::HookInfo, HookId::NtWriteFile, pid, pid, record * 1000, 0);
+			writer.AddU32(FieldId::Length, 4096);
+			writer.AddU32(FieldId::Sequence, static_cast<uint32_t>(record));
+			writer.AddUtf16(FieldId::Path, path.data(), path.size());
+			batches.back().append(data, writer.Finish());
+		}
+		return batches;
+	}
+
+	// the same events as the text lines hooks used to send
+	std::vector<std::string> LineBatches(uint32_t pid, size_t records)
+	{
+		std::vector<std::string> batches;
+		for (const auto& batch : RecordBatches(pid, records))
+		{
+			std::string lines;
+			size_t offset = 0;
+			while (offset < batch.size())
+			{
+				const size_t size = PeekRecordSize(batch.data() + offset, batch.size() - offset);
+				FormatRecord(batch.data() + offset, size, lines);
+				lines += '\n';
+				offset += size;
+			}
+			batches.push_back(std::move(lines));
+		}
+		return batches;
+	}
+
+	// Runs producers threads, each sending its batches over a connection of its own, and returns once
+	// they all closed their connections.
+	void Produce(const std::string& path, const std::vector<std::vector<std::string>>& batches)
+	{
+		std::vector<std::thread> threads;
+		for (const auto& producer_batches : batches)
+		{
+			threads.emplace_back([&path, &producer_batches]
+			{
+				ProcessTracer::UnixSocketTransport transport(path);
+				for (const auto& batch : producer_batches)
+					transport.Write(batch.data(), batch.size());
+				transport.Close();
+			});
+		}
+		for (auto& thread : threads)
+			thread.join();
+	}
+
+	size_t Bytes(const std::vector<std::vector<std::string>>& batches)
+	{
+		size_t bytes = 0;
+		for (const auto& producer_batches : batches)
+		{
+			for (const auto& batch : producer_batches)
+				bytes += batch.size();
+		}
+		return bytes;
+	}
+
+	void CountBytes(void* context, const char*, size_t length)
+	{
+		*static_cast<size_t*>(context) += length;
+	}
+
+	// From the first byte sent to the last line handed to the sink, which DestroySocketCollector
+	// waits for.
+	void BenchSocketCollector(size_t producers)
+	{
+		const size_t records = ProcessTracer::Bench::Iterations(2000000) / producers;
+		std::vector<std::vector<std::string>> batches;
+		for (size_t producer = 0; producer < producers; ++producer)
+			batches.push_back(RecordBatches(static_cast<uint32_t>(producer + 1), records));
+		const std::string path = ProcessTracer::UnixSocketTransport::Path(getpid());
+		size_t delivered = 0;
+		const double seconds = ProcessTracer::Bench::Measure(records * producers, [&](size_t)
+		{
+			void* collector = CreateSocketCollector(path.c_str(), CountBytes, &delivered);
+			Produce(path, batches);
+			DestroySocketCollector(collector);
+		});
+		ProcessTracer::Bench::DoNotOptimize(delivered);
+		const std::string name = "epoll collector, " + std::to_string(producers) + " producers";
+		ProcessTracer::Bench::Report(name.c_str(), records * producers, seconds, Bytes(batches));
+	}
+
+	// The receive path the collector replaced, in C++: a server instance per connection reads it in
+	// 4 KB pieces and splits it into a new string per line with a "Received: " prefix, the lines go
+	// through a locked queue to a worker that writes them under a lock of its own.
+	class LinePump
+	{
+		int m_listen;
+		std::mutex m_queue_lock;
+		std::condition_variable m_queued;
+		std::deque<std::string> m_queue;
+		bool m_done = false;
+		std::mutex m_writer_lock;
+		size_t m_written = 0;
+		std::vector<std::thread> m_readers;
+		std::thread m_worker;
+
+		void Serve(int connection)
+		{
+			char buffer[4096];
+			std::string pending;
+			ssize_t received;
+			while ((received = read(connection, buffer, sizeof(buffer))) > 0)
+			{
+				pending.append(buffer, static_cast<size_t>(received));
+				size_t start = 0;
+				size_t end;
+				while ((end = pending.find('\n', start)) != std::string::npos)
+				{
+					std::string line = "Received: " + pending.substr(start, end - start);
+					{
+						std::lock_guard<std::mutex> guard(m_queue_lock);
+						m_queue.push_back(std::move(line));
+					}
+					m_queued.notify_one();
+					start = end + 1;
+				}
+				pending.erase(0, start);
+			}
+			close(connection);
+		}
+
+		void Work()
+		{
+			for (;;)
+			{
+				std::string line;
+				{
+					std::unique_lock<std::mutex> lock(m_queue_lock);
+					m_queued.wait(lock, [this] { return m_done || !m_queue.empty(); });
+					if (m_queue.empty())
+						return;
+					line = std::move(m_queue.front());
+					m_queue.pop_front();
+				}
+				std::lock_guard<std::mutex> guard(m_writer_lock);
+				m_written += line.size() + 1;
+			}
+		}
+
+	public:
+		LinePump(const std::string& path, size_t connections)
+		{
+			unlink(path.c_str());
+			m_listen = socket(AF_UNIX, SOCK_STREAM, 0);
+			sockaddr_un address = {};
+			address.sun_family = AF_UNIX;
+			path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+			bind(m_listen, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+			listen(m_listen, SOMAXCONN);
+			for (size_t i = 0; i < connections; ++i)
+			{
+				m_readers.emplace_back([this]
+				{
+					const int connection = accept(m_listen, nullptr, nullptr);
+					if (connection >= 0)
+						Serve(connection);
+				});
+			}
+			m_worker = std::thread([this] { Work(); });
+		}
+
+		// waits for every connection to end and the worker to write what they sent
+		size_t Finish()
+		{
+			for (auto& reader : m_readers)
+				reader.join();
+			{
+				std::lock_guard<std::mutex> guard(m_queue_lock);
+				m_done = true;
+			}
+			m_queued.notify_one();
+			m_worker.join();
+			close(m_listen);
+			return m_written;
+		}
+	};
+
+	void BenchLinePump(size_t producers)
+	{
+		const size_t records = ProcessTracer::Bench::Iterations(2000000) / producers;
+		std::vector<std::vector<std::string>> batches;
+		for (size_t producer = 0; producer < producers; ++producer)
+			batches.push_back(LineBatches(static_cast<uint32_t>(producer + 1), records));
+		const std::string path = ProcessTracer::UnixSocketTransport::Path(getpid());
+		size_t written = 0;
+		const double seconds = ProcessTracer::Bench::Measure(records * producers, [&](size_t)
+		{
+			LinePump pump(path, producers);
+			Produce(path, batches);
+			written = pump.Finish();
+		});
+		unlink(path.c_str());
+		ProcessTracer::Bench::DoNotOptimize(written);
+		const std::string name = "line pump, " + std::to_string(producers) + " producers";
+		ProcessTracer::Bench::Report(name.c_str(), records * producers, seconds, Bytes(batches));
+	}
+
+	// producers threads hand 4 KB batches to one consumer, through the lock-free queue or a locked deque
+	template <typename Push, typename Pop>
+	double HandOff(size_t producers, size_t per_producer, Push&& push, Pop&& pop)
+	{
+		return ProcessTracer::Bench::Measure(producers * per_producer, [&](size_t)
+		{
+			std::vector<std::thread> threads;
+			for (size_t producer = 0; producer < producers; ++producer)
+			{
+				threads.emplace_back([&]
+				{
+					for (size_t i = 0; i < per_producer; ++i)
+					{
+						std::string batch(4096, 'b');
+						while (!push(batch))
+							std::this_thread::yield();
+					}
+				});
+			}
+			std::string batch;
+			for (size_t popped = 0; popped < producers * per_producer;)
+			{
+				if (pop(batch))
+					++popped;
+				else
+					std::this_thread::yield();
+			}
+			for (auto& thread : threads)
+				thread.join();
+		});
+	}
+
+	void BenchQueues(size_t producers)
+	{
+		const size_t per_producer = ProcessTracer::Bench::Iterations(1000000) / producers;
+		ProcessTracer::BoundedQueue<std::string> queue(64);
+		double seconds = HandOff(producers, per_producer,
+		                         [&queue](std::string& batch) { return queue.TryPush(batch); },
+		                         [&queue](std::string& batch) { return queue.TryPop(batch); });
+		std::string name = "BoundedQueue hand-off, " + std::to_string(producers) + " producers";
+		ProcessTracer::Bench::Report(name.c_str(), producers * per_producer, seconds);
+
+		std::mutex lock;
+		std::deque<std::string> deque;
+		seconds = HandOff(producers, per_producer, [&](std::string& batch)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			if (deque.size() >= 64)
+				return false;
+			deque.push_back(std::move(batch));
+			return true;
+		}, [&](std::string& batch)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			if (deque.empty())
+				return false;
+			batch = std::move(deque.front());
+			deque.pop_front();
+			return true;
+		});
+		name = "locked deque hand-off, " + std::to_string(producers) + " producers";
+		ProcessTracer::Bench::Report(name.c_str(), producers * per_producer, seconds);
+	}
+}
+
+// The epoll collector against the line pump it replaces, for a growing number of traced processes
+// each writing batches of 64 records over its own connection, then the queue that carries the
+// rendered lines to the sink against a locked one. The line pump is sent the events as text lines.
+int main(int argc, char** argv)
+{
+	ProcessTracer::Bench::Init(argc, argv);
+	for (const size_t producers : {1, 4, 16})
+	{
+		BenchSocketCollector(producers);
+		BenchLinePump(producers);
+	}
+	for (const size_t producers : {1, 4})
+		BenchQueues(producers);
+	return 0;
+}
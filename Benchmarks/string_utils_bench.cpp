@@ -0,0 +1,51 @@
+#include <string>
+
+#include "bench.h"
+#include "string_utils.h"
+
+namespace
+{
+	void BenchSplitBySpace(const char* name, const std::string& payload)
+	{
+		const size_t iterations = ProcessTracer::Bench::Iterations(5000000);
+		size_t parts = 0;
+		const double seconds = ProcessTracer::Bench::Measure(iterations, [&](size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				const auto split = SplitBySpace(payload);
+				parts += split.size();
+				ProcessTracer::Bench::DoNotOptimize(split);
+			}
+		});
+		ProcessTracer::Bench::DoNotOptimize(parts);
+		ProcessTracer::Bench::Report(name, iterations, seconds, iterations * payload.size());
+	}
+
+	void BenchAffixes()
+	{
+		const size_t iterations = ProcessTracer::Bench::Iterations(20000000);
+		const std::string path = "\\Device\\NamedPipe\\ProcessTracerPipe:1234";
+		const std::string suffix = "ProcessTracerPipe:1234";
+		size_t matches = 0;
+		const double seconds = ProcessTracer::Bench::Measure(iterations, [&](size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				matches += EndsWith(path, suffix);
+				ProcessTracer::Bench::DoNotOptimize(matches);
+			}
+		});
+		ProcessTracer::Bench::Report("EndsWith pipe name", iterations, seconds);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	ProcessTracer::Bench::Init(argc, argv);
+	// the "pid canElevate" payload ConnectToPipe used to parse
+	BenchSplitBySpace("SplitBySpace 2-part payload", "1234 1");
+	BenchSplitBySpace("SplitBySpace 16-part payload", "1234 1 0 65536 0 0 4194304 1 5 16384 0 1 0 2 3 4");
+	BenchAffixes();
+	return 0;
+}
@@ -0,0 +1,53 @@
+#include <chrono>
+#include <ctime>
+
+#include "fake_win32.h"
+#include "bench.h"
+#include "trace_clock.h"
+
+using namespace ProcessTracer::TraceClock;
+
+namespace
+{
+	template <typename Stamp>
+	void BenchStamp(const char* name, Stamp&& stamp)
+	{
+		const size_t iterations = ProcessTracer::Bench::Iterations(20000000);
+		uint64_t sum = 0;
+		const double seconds = ProcessTracer::Bench::Measure(iterations, [&](size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+				sum += stamp();
+		});
+		ProcessTracer::Bench::DoNotOptimize(sum);
+		ProcessTracer::Bench::Report(name, iterations, seconds);
+	}
+}
+
+// What stamping an event costs the hook: the calibrated clock on each source, against the clocks
+// the host offers directly.
+int main(int argc, char** argv)
+{
+	ProcessTracer::Bench::Init(argc, argv);
+	const Calibration calibration = Calibrate();
+	if (calibration.source == Source::Tsc)
+	{
+		const Converter tsc(calibration);
+		BenchStamp("TraceClock TSC stamp", [&tsc] { return tsc.Now(); });
+	}
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	const Converter qpc({Source::Qpc, ReadCounter(Source::Qpc), static_cast<uint64_t>(frequency.QuadPart)});
+	BenchStamp("TraceClock QPC stamp", [&qpc] { return qpc.Now(); });
+	BenchStamp("clock_gettime CLOCK_MONOTONIC", []
+	{
+		timespec now{};
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		return static_cast<uint64_t>(now.tv_nsec);
+	});
+	BenchStamp("std::chrono::steady_clock", []
+	{
+		return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+	});
+	return 0;
+}
@@ -0,0 +1,144 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include <windows.h>
+
+#include "bench.h"
+#include "trace_file.h"
+#include "trace_file_writer.h"
+
+namespace
+{
+	// what the managed logger packs lines into before it passes them on
+	constexpr size_t buffer_bytes = 256 * 1024;
+	// and how often it completes a block
+	constexpr auto flush_interval = std::chrono::milliseconds(100);
+
+	std::string FilePath()
+	{
+		const char* directory = getenv("TMPDIR");
+		return std::string(directory && *directory ? directory : "/tmp") + "/trace_file_writer_bench." +
+			std::to_string(getpid()) + ".log";
+	}
+
+	std::wstring WidePath(const std::string& path)
+	{
+		return std::wstring(path.begin(), path.end());
+	}
+
+	// output lines of about event_bytes each, newline included
+	std::vector<std::string> Events(size_t event_bytes)
+	{
+		std::vector<std::string> events;
+		for (size_t i = 0; i < 64; ++i)
+		{
+			std::string line = "pid:4242 [Hook] NtWriteFile C:\\build\\obj\\x64\\Release\\unit" + std::to_string(i) + ".obj ";
+			while (line.size() + 1 < event_bytes)
+				line += static_cast<char>('a' + (line.size() + i) % 26);
+			line += '\n';
+			events.push_back(line);
+		}
+		return events;
+	}
+
+	// The lines through a buffered FILE, flushed as often as the logger completes a block.
+	void BenchFputs(const std::vector<std::string>& events, size_t total_bytes, const char* name)
+	{
+		const std::string path = FilePath();
+		FILE* file = fopen(path.c_str(), "wb");
+		if (!file)
+			return;
+		size_t lines = 0;
+		const double seconds = ProcessTracer::Bench::Measure(total_bytes, [&](size_t bytes)
+		{
+			auto next_flush = std::chrono::steady_clock::now() + flush_interval;
+			for (size_t written = 0; written < bytes; ++lines)
+			{
+				const std::string& line = events[lines % events.size()];
+				fputs(line.c_str(), file);
+				written += line.size();
+				if ((lines & 255) == 0 && std::chrono::steady_clock::now() >= next_flush)
+				{
+					fflush(file);
+					next_flush += flush_interval;
+				}
+			}
+			fflush(file);
+		});
+		fclose(file);
+		remove(path.c_str());
+		ProcessTracer::Bench::Report(name, lines, seconds, total_bytes);
+	}
+
+	// The lines packed into buffers as the managed logger does, each full buffer written to the mapped file.
+	void BenchWriter(const std::vector<std::string>& events, size_t total_bytes, const char* name)
+	{
+		const std::string path = FilePath();
+		ProcessTracer::TraceFile::TraceFileWriter writer;
+		if (!writer.Open(WidePath(path).c_str()))
+			return;
+		std::vector<char> buffer(buffer_bytes);
+		size_t lines = 0;
+		const double seconds = ProcessTracer::Bench::Measure(total_bytes, [&](size_t bytes)
+		{
+			auto next_flush = std::chrono::steady_clock::now() + flush_interval;
+			size_t used = 0;
+			for (size_t written = 0; written < bytes; ++lines)
+			{
+				const std::string& line = events[lines % events.size()];
+				if (used + line.size() > buffer.size())
+				{
+					writer.Write(buffer.data(), used);
+					used = 0;
+					if (std::chrono::steady_clock::now() >= next_flush)
+					{
+						writer.Flush();
+						next_flush += flush_interval;
+					}
+				}
+				memcpy(buffer.data() + used, line.data(), line.size());
+				used += line.size();
+				written += line.size();
+			}
+			writer.Write(buffer.data(), used);
+			writer.Flush();
+		});
+		writer.Close();
+		remove(path.c_str());
+		ProcessTracer::Bench::Report(name, lines, seconds, total_bytes);
+	}
+
+	void BenchCrc(size_t length)
+	{
+		std::vector<char> data(length, 'x');
+		const size_t iterations = ProcessTracer::Bench::Iterations(256 * 1024 * 1024 / length);
+		const double seconds = ProcessTracer::Bench::Measure(iterations, [&](size_t count)
+		{
+			uint32_t crc = 0;
+			for (size_t i = 0; i < count; ++i)
+				crc = ProcessTracer::TraceFile::Crc32(data.data(), data.size(), crc);
+			ProcessTracer::Bench::DoNotOptimize(crc);
+		});
+		ProcessTracer::Bench::Report("Crc32, 256 KB", iterations, seconds, iterations * length);
+	}
+}
+
+// 256 MB of output lines of 64 B to 4 KB, written with fputs and through the trace file writer, then
+// the block checksum alone.
+int main(int argc, char** argv)
+{
+	ProcessTracer::Bench::Init(argc, argv);
+	const size_t total_bytes = ProcessTracer::Bench::Iterations(256 * 1024 * 1024);
+	for (const size_t event_bytes : {64, 256, 1024, 4096})
+	{
+		const std::vector<std::string> events = Events(event_bytes);
+		const std::string size = std::to_string(event_bytes) + " B lines";
+		BenchFputs(events, total_bytes, ("fputs, " + size).c_str());
+		BenchWriter(events, total_bytes, ("TraceFileWriter, " + size).c_str());
+	}
+	BenchCrc(buffer_bytes);
+	return 0;
+}
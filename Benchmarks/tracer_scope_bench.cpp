@@ -0,0 +1,68 @@
+#include <string>
+
+#include "hook_host.h"
+#include "bench.h"
+#include "hook_func.h"
+#include "string_utils.h"
+#include "tracer_scope.h"
+#include "utils.h"
+
+namespace
+{
+	std::u16string g_path = u"\\Device\\NamedPipe\\ProcessTracerPipe:1234";
+	UNICODE_STRING g_name;
+	OBJECT_ATTRIBUTES g_attributes;
+	IO_STATUS_BLOCK g_io;
+
+	HANDLE CreateDirect()
+	{
+		HANDLE handle = nullptr;
+		NtCreateFile(&handle, GENERIC_WRITE, &g_attributes, &g_io, nullptr, FILE_ATTRIBUTE_NORMAL, 0, FILE_OPEN, 0,
+		             nullptr, 0);
+		return handle;
+	}
+
+	template <typename Create>
+	void BenchCreate(const char* name, Create&& create)
+	{
+		const size_t iterations = ProcessTracer::Bench::Iterations(1000000);
+		const double seconds = ProcessTracer::Bench::Measure(iterations, [&create](size_t count)
+		{
+			ProcessTracer::TracerScope scope;
+			for (size_t i = 0; i < count; ++i)
+				NtClose(create());
+		});
+		ProcessTracer::Bench::Report(name, iterations, seconds);
+	}
+}
+
+// The tracer opening its own pipe: the plain call, the hook entered from tracer code, and the
+// file name conversion and pipe name comparison every create paid before the reentrancy scope.
+int main(int argc, char** argv)
+{
+	ProcessTracer::Bench::Init(argc, argv);
+	ProcessTracer::HookHarness::Session session;
+	g_name.Length = static_cast<USHORT>(g_path.size() * sizeof(WCHAR));
+	g_name.MaximumLength = g_name.Length;
+	g_name.Buffer = reinterpret_cast<PWSTR>(g_path.data());
+	InitializeObjectAttributes(&g_attributes, &g_name, OBJ_CASE_INSENSITIVE, nullptr, nullptr);
+	const std::string pid_string = "1234";
+
+	BenchCreate("NtCreateFile", CreateDirect);
+	BenchCreate("HookNtCreateFile inside TracerScope", []
+	{
+		HANDLE handle = nullptr;
+		HookNtCreateFile(&handle, GENERIC_WRITE, &g_attributes, &g_io, nullptr, FILE_ATTRIBUTE_NORMAL, 0, FILE_OPEN, 0,
+		                 nullptr, 0);
+		return handle;
+	});
+	BenchCreate("NtCreateFile with pipe name check (before)", [&pid_string]
+	{
+		const HANDLE handle = CreateDirect();
+		const bool own_pipe = EndsWith(ConvertWStringToString(g_name.Buffer), "ProcessTracerPipe:" + pid_string);
+		ProcessTracer::Bench::DoNotOptimize(own_pipe);
+		return handle;
+	});
+	ProcessTracer::HookHarness::DetachThread();
+	return 0;
+}
@@ -0,0 +1,142 @@
+#include <atomic>
+#include <memory>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+#include "bench.h"
+#include "spsc_ring.h"
+#include "unix_socket_transport.h"
+
+namespace
+{
+	// One hook thread pushes messages of message_size bytes, one sender thread pops them in batches,
+	// the way EventPipeline moves events from a hooked thread to the transport.
+	void BenchRing(size_t message_size)
+	{
+		const size_t messages = ProcessTracer::Bench::Iterations(20000000) / (message_size / 64 + 1);
+		ProcessTracer::SpscRing ring(64 * 1024);
+		const std::string message(message_size, 'm');
+		const auto batch = std::make_unique<char[]>(64 * 1024);
+		std::atomic<bool> done{false};
+
+		const double seconds = ProcessTracer::Bench::Measure(messages, [&](size_t count)
+		{
+			std::thread sender([&]
+			{
+				size_t received = 0;
+				while (!done.load(std::memory_order_acquire) || !ring.Empty())
+				{
+					const size_t popped = ring.Pop(batch.get(), 64 * 1024);
+					if (popped == 0)
+						std::this_thread::yield();
+					received += popped;
+					ProcessTracer::Bench::DoNotOptimize(batch);
+				}
+				ProcessTracer::Bench::DoNotOptimize(received);
+			});
+			for (size_t i = 0; i < count; ++i)
+			{
+				while (!ring.TryPush(message.data(), message.size()))
+					std::this_thread::yield();
+			}
+			done.store(true, std::memory_order_release);
+			sender.join();
+		});
+		const std::string name = "SpscRing push/pop " + std::to_string(message_size) + " byte messages";
+		ProcessTracer::Bench::Report(name.c_str(), messages, seconds, messages * message_size);
+	}
+
+	// The collector end of the socket: accepts one connection after the other and reads each to its end.
+	class SocketCollector
+	{
+		std::string m_path;
+		int m_listen;
+		std::atomic<uint64_t> m_bytes{0};
+		std::thread m_thread;
+
+		void Run()
+		{
+			const auto buffer = std::make_unique<char[]>(64 * 1024);
+			for (;;)
+			{
+				const int connection = accept(m_listen, nullptr, nullptr);
+				if (connection < 0)
+					return;
+				ssize_t received;
+				while ((received = read(connection, buffer.get(), 64 * 1024)) > 0)
+					m_bytes.fetch_add(static_cast<uint64_t>(received), std::memory_order_relaxed);
+				close(connection);
+			}
+		}
+
+	public:
+		explicit SocketCollector(std::string path) : m_path(std::move(path))
+		{
+			unlink(m_path.c_str());
+			m_listen = socket(AF_UNIX, SOCK_STREAM, 0);
+			sockaddr_un address = {};
+			address.sun_family = AF_UNIX;
+			m_path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+			bind(m_listen, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+			listen(m_listen, SOMAXCONN);
+			m_thread = std::thread([this] { Run(); });
+		}
+
+		~SocketCollector()
+		{
+			// wakes the accept, every client has closed its connection by now
+			shutdown(m_listen, SHUT_RDWR);
+			m_thread.join();
+			close(m_listen);
+			unlink(m_path.c_str());
+		}
+
+		void WaitFor(uint64_t bytes) const
+		{
+			while (m_bytes.load(std::memory_order_relaxed) < bytes)
+				std::this_thread::yield();
+		}
+	};
+
+	// Messages of message_size bytes to a collector socket, over one connection the transport keeps
+	// or, as the Logger did before, over a connection of its own each.
+	void BenchSocket(size_t message_size, bool per_message_connect)
+	{
+		const size_t messages = ProcessTracer::Bench::Iterations(per_message_connect ? 50000 : 1000000);
+		const std::string path = ProcessTracer::UnixSocketTransport::Path(getpid());
+		const std::string message(message_size, 'm');
+		SocketCollector collector(path);
+		ProcessTracer::UnixSocketTransport transport(path);
+		const double seconds = ProcessTracer::Bench::Measure(messages, [&](size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				if (per_message_connect)
+					ProcessTracer::UnixSocketTransport(path).Write(message.data(), message.size());
+				else
+					transport.Write(message.data(), message.size());
+			}
+			transport.Close();
+			collector.WaitFor(count * message_size);
+		});
+		const std::string name = (per_message_connect ? "socket connect per message " : "UnixSocketTransport ") +
+			std::to_string(message_size) + " byte messages";
+		ProcessTracer::Bench::Report(name.c_str(), messages, seconds, messages * message_size);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	ProcessTracer::Bench::Init(argc, argv);
+	for (const size_t message_size : {64, 256, 1024, 4096})
+		BenchRing(message_size);
+	for (const size_t message_size : {64, 1024})
+	{
+		BenchSocket(message_size, false);
+		BenchSocket(message_size, true);
+	}
+	return 0;
+}
@@ -0,0 +1,118 @@
+#include <string>
+#include <utility>
+
+#include "bench.h"
+#include "utf16_to_utf8.h"
+
+namespace
+{
+	const std::u16string short_path = u"C:\\build\\obj\\x64\\Release\\ProcessTracerCore\\hook_func.obj";
+	const std::u16string long_path(240, u'a');
+	const std::u16string non_ascii_path = u"C:\\Users\\J\u00fcrgen\\\u6587\u4ef6\\r\u00e9sum\u00e9\\\U0001F600.txt";
+
+	template <typename Convert>
+	void Bench(const std::string& name, const std::u16string& input, Convert&& convert)
+	{
+		const size_t iterations = ProcessTracer::Bench::Iterations(10000000);
+		const double seconds = ProcessTracer::Bench::Measure(iterations, [&](size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+				convert(input);
+		});
+		ProcessTracer::Bench::Report(name.c_str(), iterations, seconds, iterations * input.size() * sizeof(char16_t));
+	}
+
+	void BenchFromUtf16(const std::string& name, const std::u16string& input)
+	{
+		std::string output(ProcessTracer::Utf8::MaxLength(input.size()), '\0');
+		Bench("FromUtf16 " + name, input, [&output](const std::u16string& text)
+		{
+			const auto result = ProcessTracer::Utf8::FromUtf16(text.data(), text.size(), output.data(), output.size());
+			ProcessTracer::Bench::DoNotOptimize(result);
+		});
+	}
+
+	// What the conversion sites did before: WideCharToMultiByte once to size the string and once to
+	// fill it, into a new std::string every time. Both passes are done here by a plain loop.
+	size_t EncodeScalar(const char16_t* input, size_t count, char* output)
+	{
+		size_t written = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			uint32_t code_point = input[i];
+			if (code_point >= 0xD800 && code_point <= 0xDBFF && i + 1 < count)
+				code_point = 0x10000 + ((code_point - 0xD800) << 10) + (input[++i] - 0xDC00);
+			const size_t length = code_point < 0x80 ? 1 : code_point < 0x800 ? 2 : code_point < 0x10000 ? 3 : 4;
+			if (output)
+			{
+				if (length == 1)
+					output[written] = static_cast<char>(code_point);
+				else
+				{
+					static constexpr uint8_t lead[] = {0, 0, 0xC0, 0xE0, 0xF0};
+					for (size_t j = length - 1; j > 0; --j, code_point >>= 6)
+						output[written + j] = static_cast<char>(0x80 | (code_point & 0x3F));
+					output[written] = static_cast<char>(lead[length] | code_point);
+				}
+			}
+			written += length;
+		}
+		return written;
+	}
+
+	void BenchTwoPass(const std::string& name, const std::u16string& input)
+	{
+		Bench("two passes into a new string " + name, input, [](const std::u16string& text)
+		{
+			std::string converted(EncodeScalar(text.data(), text.size(), nullptr), '\0');
+			EncodeScalar(text.data(), text.size(), converted.data());
+			ProcessTracer::Bench::DoNotOptimize(converted.data());
+		});
+	}
+
+	// std::string(w.begin(), w.end()), which also mangled every non-ASCII character
+	void BenchTruncating(const std::string& name, const std::u16string& input)
+	{
+		Bench("truncating copy " + name, input, [](const std::u16string& text)
+		{
+			const std::string converted(text.begin(), text.end());
+			ProcessTracer::Bench::DoNotOptimize(converted.data());
+		});
+	}
+
+	template <typename Copy>
+	void BenchCopy(const char* name, Copy&& copy)
+	{
+		std::string output(long_path.size(), '\0');
+		Bench(name, long_path, [&](const std::u16string& text)
+		{
+			ProcessTracer::Bench::DoNotOptimize(copy(text.data(), text.size(), output.data(), 0));
+		});
+	}
+}
+
+// The transcoder against the conversions it replaced, for paths of the usual length, long paths and
+// paths with non-ASCII characters, then the ASCII copy it starts with on each instruction set.
+int main(int argc, char** argv)
+{
+	ProcessTracer::Bench::Init(argc, argv);
+	const std::pair<std::string, const std::u16string*> inputs[] = {
+		{"short ASCII path", &short_path}, {"240-unit ASCII path", &long_path}, {"non-ASCII path", &non_ascii_path}
+	};
+	for (const auto& [name, input] : inputs)
+	{
+		BenchFromUtf16(name, *input);
+		BenchTwoPass(name, *input);
+		BenchTruncating(name, *input);
+	}
+
+	BenchCopy("ASCII copy scalar, 240 units", ProcessTracer::Utf8::Detail::CopyAsciiScalar);
+#ifdef PROCESS_TRACER_SSE2
+	BenchCopy("ASCII copy SSE2, 240 units", ProcessTracer::Utf8::Detail::CopyAsciiSse2);
+#endif
+#ifdef PROCESS_TRACER_AVX2
+	if (ProcessTracer::Simd::avx2_supported)
+		BenchCopy("ASCII copy AVX2, 240 units", ProcessTracer::Utf8::Detail::CopyAsciiAvx2);
+#endif
+	return 0;
+}
@@ -0,0 +1,80 @@
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "call_stream.h"
+#include "hook_host.h"
+
+using ProcessTracer::EventRecord::HookId;
+using ProcessTracer::EventRecord::RecordType;
+using namespace ProcessTracer::HookHarness;
+
+namespace
+{
+	// what a write to the page cache costs the traced program, roughly
+	constexpr uint64_t call_cost_ns = 1000;
+	constexpr size_t total_writes = 400000;
+
+	void Print(const std::string& name, double value, const char* unit)
+	{
+		printf("%-48s %10.1f %s\n", name.c_str(), value, unit);
+		fflush(stdout);
+	}
+
+	// A synthetic writer: four threads each create their files, write them in 4 KB chunks and close
+	// them. Reports how much slower the writer runs through the hooks and what reaches the collector.
+	void BenchWriter(size_t writes_per_file, bool aggregate_writes)
+	{
+		WorkloadOptions workload;
+		workload.threads = 4;
+		workload.writes_per_file = writes_per_file;
+		workload.files_per_thread = ProcessTracer::Bench::Iterations(total_writes) / workload.threads / writes_per_file;
+		if (workload.files_per_thread == 0)
+			workload.files_per_thread = 1;
+		workload.rename_every = 0;
+		const CallStream stream = GenerateCallStream(workload);
+		const size_t writes = stream.Calls(CallType::Write);
+		ProcessTracer::FakeWin32::SetCallCost(call_cost_ns);
+
+		const double direct = Replay(stream, ReplayMode::Direct);
+		SessionOptions options;
+		options.aggregate_writes = aggregate_writes;
+		Session session(options);
+		const double hooked = Replay(stream, ReplayMode::Hooked);
+		session.Flush();
+
+		const std::string name = std::to_string(writes_per_file) + " writes/file" +
+			(aggregate_writes ? ", aggregated" : ", per event");
+		ProcessTracer::Bench::Report((name + " writer").c_str(), writes, hooked, writes * workload.write_bytes);
+		Print(name + " slowdown", (hooked / direct - 1) * 100, "%");
+		const auto& bulk = session.Bulk();
+		// a summary is an NtWriteFile record too, one per handle
+		Print(name + " write events", static_cast<double>(bulk.Records(RecordType::HookInfo, HookId::NtWriteFile)),
+		      "records");
+		Print(name + " shipped", static_cast<double>(bulk.Bytes()) / static_cast<double>(writes), "bytes/write");
+	}
+}
+
+// Per-handle aggregation against one event per NtWriteFile, for files written in one chunk up to
+// files written in hundreds. Every configuration runs in a process of its own, so each gets the
+// pipeline's sender thread and a fresh aggregator.
+int main(int argc, char** argv)
+{
+	ProcessTracer::Bench::Init(argc, argv);
+	for (const size_t writes_per_file : {1, 16, 256})
+	{
+		for (const bool aggregate_writes : {false, true})
+		{
+			const pid_t child = fork();
+			if (child == 0)
+			{
+				BenchWriter(writes_per_file, aggregate_writes);
+				DetachThread();
+				_exit(0);
+			}
+			waitpid(child, nullptr, 0);
+		}
+	}
+	return 0;
+}
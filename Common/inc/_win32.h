@@ -351,3 +351,28 @@ EXTERN_C NTSTATUS NTAPI NtSetInformationFile(
 	_In_ ULONG Length,
 	_In_ FILE_INFORMATION_CLASS FileInformationClass
 );
+
+EXTERN_C NTSTATUS NTAPI NtDuplicateObject(
+	_In_ HANDLE SourceProcessHandle,
+	_In_ HANDLE SourceHandle,
+	_In_opt_ HANDLE TargetProcessHandle,
+	_Out_opt_ PHANDLE TargetHandle,
+	_In_ ACCESS_MASK DesiredAccess,
+	_In_ ULONG HandleAttributes,
+	_In_ ULONG Options
+);
+
+// FilePipeLocalInformation, seen from the end the handle belongs to
+typedef struct _FILE_PIPE_LOCAL_INFORMATION
+{
+	ULONG NamedPipeType;
+	ULONG NamedPipeConfiguration;
+	ULONG MaximumInstances;
+	ULONG CurrentInstances;
+	ULONG InboundQuota;
+	ULONG ReadDataAvailable;
+	ULONG OutboundQuota;
+	ULONG WriteQuotaAvailable;
+	ULONG NamedPipeState;
+	ULONG NamedPipeEnd;
+} FILE_PIPE_LOCAL_INFORMATION, *PFILE_PIPE_LOCAL_INFORMATION;
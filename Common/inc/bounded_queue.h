@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace ProcessTracer
+{
+	// Lock-free bounded queue for any number of producers and consumers. Every slot carries a turn
+	// number that says whether it waits for a push or a pop of the current lap, so a push or pop
+	// claims its slot with one compare-and-swap and never waits for another thread to finish. T is
+	// moved in and out; a slot keeps its moved-from value until it is reused.
+	template <typename T>
+	class BoundedQueue
+	{
+		struct Slot
+		{
+			std::atomic<size_t> turn;
+			T value;
+		};
+
+		std::unique_ptr<Slot[]> m_slots;
+		size_t m_mask;
+		alignas(64) std::atomic<size_t> m_push{0};
+		alignas(64) std::atomic<size_t> m_pop{0};
+
+	public:
+		// capacity is rounded up to a power of two
+		explicit BoundedQueue(size_t capacity)
+		{
+			size_t slots = 2;
+			while (slots < capacity)
+				slots <<= 1;
+			m_mask = slots - 1;
+			m_slots = std::make_unique<Slot[]>(slots);
+			for (size_t i = 0; i < slots; ++i)
+				m_slots[i].turn.store(i, std::memory_order_relaxed);
+		}
+
+		BoundedQueue(const BoundedQueue&) = delete;
+		BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+		size_t Capacity() const
+		{
+			return m_mask + 1;
+		}
+
+		// moves value in, false and value untouched when the queue is full
+		bool TryPush(T& value)
+		{
+			size_t position = m_push.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				Slot& slot = m_slots[position & m_mask];
+				const size_t turn = slot.turn.load(std::memory_order_acquire);
+				if (turn == position)
+				{
+					if (m_push.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					{
+						slot.value = std::move(value);
+						slot.turn.store(position + 1, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (turn < position)
+					return false; // the slot still holds the value of the previous lap
+				else
+					position = m_push.load(std::memory_order_relaxed);
+			}
+		}
+
+		// moves the oldest value out, false when the queue is empty
+		bool TryPop(T& value)
+		{
+			size_t position = m_pop.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				Slot& slot = m_slots[position & m_mask];
+				const size_t turn = slot.turn.load(std::memory_order_acquire);
+				if (turn == position + 1)
+				{
+					if (m_pop.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					{
+						value = std::move(slot.value);
+						slot.turn.store(position + m_mask + 1, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (turn < position + 1)
+					return false;
+				else
+					position = m_pop.load(std::memory_order_relaxed);
+			}
+		}
+	};
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "event_record.h"
+
+// Layout of the control block "ProcessTracerControl:<tracer pid>". The tracer owns and writes it,
+// every injected process maps it read-only and consults it on each hooked call, so hooks can be
+// switched off or sampled while the traced processes keep running.
+// The layout is mirrored by HookControlBlock.cs, keep both in sync.
+namespace ProcessTracer::Control
+{
+	constexpr uint32_t control_magic = 0x42435450; // "PTCB"
+	constexpr uint32_t control_version = 1;
+	constexpr size_t max_hooks = 32;
+
+	// One word per hook, read with a single relaxed load: the enable bit and a 1-in-N sampling rate,
+	// where a rate of 0 or 1 logs every call.
+	constexpr uint32_t hook_enabled = 0x80000000;
+	constexpr uint32_t sample_rate_mask = 0x7FFFFFFF;
+
+	struct ControlBlock
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t hook_count;
+		std::atomic<uint32_t> report_request; // bumped by the tracer to ask every process for a timing report
+		std::atomic<uint32_t> hooks[max_hooks];
+	};
+
+	static_assert(static_cast<size_t>(EventRecord::HookId::Count) <= max_hooks, "every hook needs a word");
+	static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "layout is shared with the tracer");
+	static_assert(offsetof(ControlBlock, hooks) == 16, "layout is shared with the tracer");
+
+	// What a hook does when no tracer block could be mapped, matches the tracer's defaults.
+	inline uint32_t DefaultHookWord(EventRecord::HookId hook_id)
+	{
+		switch (hook_id)
+		{
+		case EventRecord::HookId::NtCreateSection:
+		case EventRecord::HookId::ZwCreateSection:
+		case EventRecord::HookId::NtCreateSectionEx:
+		case EventRecord::HookId::NtMapViewOfSection:
+			return 1;
+		default:
+			return hook_enabled | 1;
+		}
+	}
+}
@@ -0,0 +1,203 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "event_formatter.h"
+#include "line_classifier.h"
+
+// Collector side of a client stream: splits the bytes received from one producer into messages and
+// renders them, binary records and text lines alike, into one buffer of '\n' terminated UTF-8 lines.
+// Each line is classified as it is written, so the tracer gets its bounds and kind without scanning
+// it again. A whole receive buffer is handled per call, nothing is allocated per message.
+namespace ProcessTracer::EventRecord
+{
+	// anything larger is not a record a producer could have written, resynchronize instead of waiting
+	constexpr size_t max_record_size = 1024 * 1024;
+
+	// The next sequence number expected from every thread, shared by the collectors of all connections
+	// since the bulk events of a process move to a new connection when its pipe reconnects. A thread
+	// delivers its bulk records in order, so a smaller number than expected means a new thread got
+	// the same id.
+	class SequenceTracker
+	{
+		static constexpr size_t max_threads = 64 * 1024; // later threads are not checked
+
+		std::mutex m_lock;
+		std::unordered_map<uint64_t, uint32_t> m_next;
+
+	public:
+		// the number of records of the thread lost right before this one
+		uint32_t Check(uint32_t pid, uint32_t tid, uint32_t sequence)
+		{
+			const uint64_t key = static_cast<uint64_t>(pid) << 32 | tid;
+			std::lock_guard<std::mutex> lock(m_lock);
+			auto next = m_next.find(key);
+			if (next == m_next.end())
+			{
+				if (m_next.size() >= max_threads)
+					return 0;
+				next = m_next.emplace(key, 0).first;
+			}
+			const uint32_t lost = sequence >= next->second ? sequence - next->second : sequence;
+			next->second = sequence + 1;
+			return lost;
+		}
+	};
+
+	// The u32 field id of a record, the Sequence number of a bulk record for instance. False when it
+	// has none.
+	inline bool FindU32(const char* data, size_t length, FieldId id, uint32_t& value)
+	{
+		RecordReader reader;
+		if (!reader.Open(data, length))
+			return false;
+		Field field;
+		while (reader.Next(field))
+		{
+			if (field.id == id && field.type == FieldType::U32)
+			{
+				value = field.AsU32();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	class EventCollector
+	{
+		SequenceTracker* m_sequences;
+		std::string m_lines;
+		std::vector<LineInfo> m_infos;
+
+		// terminates the line written since start, record is the header of the record it was rendered from
+		void EndLine(size_t start, const RecordHeader* record = nullptr, uint32_t sequence = 0, uint16_t flags = 0)
+		{
+			const uint32_t length = static_cast<uint32_t>(m_lines.size() - start);
+			uint32_t pid;
+			const LineKind kind = ClassifyLine(m_lines.data() + start, length, pid);
+			LineInfo info = {static_cast<uint32_t>(start), length, kind, pid, 0, HookId::None, flags, 0, sequence, 0};
+			if (record)
+			{
+				info.sender_pid = record->pid;
+				info.hook_id = record->hook_id;
+				info.tid = record->tid;
+				info.timestamp = record->timestamp;
+			}
+			m_infos.push_back(info);
+			m_lines += '\n';
+		}
+
+		void CheckSequence(const RecordHeader& header, uint32_t sequence)
+		{
+			if (!m_sequences)
+				return;
+			const uint32_t lost = m_sequences->Check(header.pid, header.tid, sequence);
+			if (lost == 0)
+				return;
+			const size_t start = m_lines.size();
+			FormatLoss(m_lines, header.pid, HookId::None, static_cast<uint32_t>(LossStage::Sequence), lost);
+			m_lines += ", [Thread] ";
+			Detail::AppendDecimal(m_lines, header.tid);
+			// the gap is not one hook's, but it goes in the thread's place in the trace
+			RecordHeader gap = header;
+			gap.hook_id = HookId::None;
+			EndLine(start, &gap, sequence);
+		}
+
+		void AppendTextLine(const char* line, size_t length)
+		{
+			if (length != 0 && line[length - 1] == '\r')
+				--length;
+			const size_t start = m_lines.size();
+			m_lines.append(line, length);
+			EndLine(start);
+		}
+
+	public:
+		// sequences, when given, checks the bulk records for gaps and reports them as loss lines
+		explicit EventCollector(SequenceTracker* sequences = nullptr) : m_sequences(sequences)
+		{
+		}
+
+		// Renders the complete messages at the start of data into Lines() and Infos(), which are cleared
+		// first, and returns how many bytes they took. With final set the data ends the stream: a trailing text
+		// fragment counts as a line and an incomplete record is dropped.
+		size_t Collect(const char* data, size_t length, bool final)
+		{
+			m_lines.clear();
+			m_infos.clear();
+			size_t consumed = 0;
+			while (consumed < length)
+			{
+				const char* message = data + consumed;
+				const size_t available = length - consumed;
+				if (static_cast<uint8_t>(message[0]) != record_magic)
+				{
+					const char* line_end = FindByte(message, message + available, '\n');
+					if (line_end == message + available)
+					{
+						if (final)
+						{
+							AppendTextLine(message, available);
+							consumed = length;
+						}
+						break;
+					}
+					AppendTextLine(message, line_end - message);
+					consumed += line_end - message + 1;
+					continue;
+				}
+
+				if (available < sizeof(RecordHeader))
+				{
+					consumed = final ? length : consumed;
+					break;
+				}
+				const size_t size = PeekRecordSize(message, available);
+				if (size < sizeof(RecordHeader) || size > max_record_size)
+				{
+					// not a record after all, drop the byte and look for the next message
+					++consumed;
+					continue;
+				}
+				if (available < size)
+				{
+					consumed = final ? length : consumed;
+					break;
+				}
+				RecordHeader header;
+				memcpy(&header, message, sizeof(header));
+				uint32_t sequence = 0;
+				uint16_t flags = 0;
+				if (FindU32(message, size, FieldId::Sequence, sequence))
+				{
+					CheckSequence(header, sequence);
+					flags = line_flag_bulk;
+				}
+				else if (header.hook_id == HookId::ExitProcess)
+					FindU32(message, size, FieldId::BulkCount, sequence);
+				const size_t start = m_lines.size();
+				if (FormatRecord(message, size, m_lines))
+					EndLine(start, &header, sequence, flags);
+				consumed += size;
+			}
+			return consumed;
+		}
+
+		const std::string& Lines() const
+		{
+			return m_lines;
+		}
+
+		// one entry per line of Lines(), in order
+		const std::vector<LineInfo>& Infos() const
+		{
+			return m_infos;
+		}
+	};
+}
@@ -0,0 +1,305 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <utility>
+
+#include "event_record.h"
+#include "utf16_to_utf8.h"
+
+// Renders event records as the text lines the collector has always written. Hooks only capture raw
+// arguments, every bit of string work happens here, on the collector's side.
+namespace ProcessTracer::EventRecord
+{
+	namespace Detail
+	{
+		inline void AppendDecimal(std::string& line, uint64_t value)
+		{
+			char digits[20];
+			size_t count = 0;
+			do
+			{
+				digits[count++] = static_cast<char>('0' + value % 10);
+				value /= 10;
+			}
+			while (value != 0);
+			while (count != 0)
+				line += digits[--count];
+		}
+
+		inline void AppendText(std::string& line, const Field* field)
+		{
+			if (!field)
+				return;
+			if (field->type == FieldType::Utf16)
+			{
+				// values are unaligned, convert through an aligned copy a chunk at a time
+				char16_t units[256];
+				const size_t count = field->length / sizeof(char16_t);
+				for (size_t offset = 0; offset < count;)
+				{
+					size_t chunk = count - offset < std::size(units) ? count - offset : std::size(units);
+					memcpy(units, field->value + offset * sizeof(char16_t), chunk * sizeof(char16_t));
+					// keep a surrogate pair together
+					if (chunk > 1 && offset + chunk < count && units[chunk - 1] >= 0xD800 && units[chunk - 1] <= 0xDBFF)
+						--chunk;
+					Utf8::AppendFromUtf16(line, units, chunk);
+					offset += chunk;
+				}
+			}
+			else
+				line.append(field->value, field->length);
+		}
+
+		inline void AppendHookName(std::string& line, HookId hook_id)
+		{
+			if (static_cast<size_t>(hook_id) < static_cast<size_t>(HookId::Count))
+				line += HookName(hook_id);
+			else
+				AppendDecimal(line, static_cast<uint16_t>(hook_id));
+		}
+
+		inline const char* LossStageName(uint32_t stage)
+		{
+			switch (static_cast<LossStage>(stage))
+			{
+			case LossStage::Buffer: return "buffer";
+			case LossStage::Transport: return "transport";
+			case LossStage::Sequence: return "sequence";
+			case LossStage::Collector: return "collector";
+			}
+			return "unknown";
+		}
+	}
+
+	// Appends the line of a loss report, also used by the collector for the gaps it finds.
+	inline void FormatLoss(std::string& line, uint32_t pid, HookId hook_id, uint32_t stage, uint64_t lost)
+	{
+		line += "pid:";
+		Detail::AppendDecimal(line, pid);
+		line += " [Loss] ";
+		if (hook_id != HookId::None)
+		{
+			Detail::AppendHookName(line, hook_id);
+			line += ' ';
+		}
+		line += "[Stage] ";
+		line += Detail::LossStageName(stage);
+		line += ", [Lost] ";
+		Detail::AppendDecimal(line, lost);
+	}
+
+	// Appends the line of one record, without line break. False when data does not hold a record of
+	// this version, nothing is appended then.
+	inline bool FormatRecord(const char* data, size_t length, std::string& line)
+	{
+		RecordReader reader;
+		if (!reader.Open(data, length))
+			return false;
+		const RecordHeader& header = reader.Header();
+
+		const Field* message = nullptr;
+		const Field* path = nullptr;
+		const Field* application_name = nullptr;
+		const Field* command_line = nullptr;
+		const Field* verb = nullptr;
+		const Field* access_mask = nullptr;
+		const Field* process_id = nullptr;
+		const Field* write_count = nullptr;
+		const Field* first_offset = nullptr;
+		uint64_t total_bytes = 0;
+		uint64_t last_offset = 0;
+		uint64_t first_timestamp = 0;
+		uint64_t last_timestamp = 0;
+		uint64_t lost_count = 0;
+		uint32_t loss_stage = 0;
+		// the u64 fields from CallCount on, by field id
+		uint64_t counters[static_cast<size_t>(FieldId::FileCount) - static_cast<size_t>(FieldId::CallCount) + 1] = {};
+		auto counter = [&counters](FieldId id) -> uint64_t&
+		{
+			return counters[static_cast<size_t>(id) - static_cast<size_t>(FieldId::CallCount)];
+		};
+		Field fields[UINT8_MAX];
+		size_t field_count = 0;
+		while (field_count < UINT8_MAX && reader.Next(fields[field_count]))
+		{
+			const Field* field = &fields[field_count++];
+			const bool is_u32 = field->type == FieldType::U32;
+			const bool is_u64 = field->type == FieldType::U64;
+			switch (field->id)
+			{
+			case FieldId::Message: message = field;
+				break;
+			case FieldId::Path: path = field;
+				break;
+			case FieldId::ApplicationName: application_name = field;
+				break;
+			case FieldId::CommandLine: command_line = field;
+				break;
+			case FieldId::Verb: verb = field;
+				break;
+			case FieldId::AccessMask: access_mask = is_u32 ? field : access_mask;
+				break;
+			case FieldId::ProcessId: process_id = is_u32 ? field : process_id;
+				break;
+			case FieldId::WriteCount: write_count = is_u64 ? field : write_count;
+				break;
+			case FieldId::TotalBytes: total_bytes = is_u64 ? field->AsU64() : total_bytes;
+				break;
+			case FieldId::FirstOffset: first_offset = is_u64 ? field : first_offset;
+				break;
+			case FieldId::LastOffset: last_offset = is_u64 ? field->AsU64() : last_offset;
+				break;
+			case FieldId::FirstTimestamp: first_timestamp = is_u64 ? field->AsU64() : first_timestamp;
+				break;
+			case FieldId::LastTimestamp: last_timestamp = is_u64 ? field->AsU64() : last_timestamp;
+				break;
+			case FieldId::LostCount: lost_count = field->AsU64();
+				break;
+			case FieldId::LossStage: loss_stage = field->AsU32();
+				break;
+			default:
+				if (is_u64 && field->id >= FieldId::CallCount && field->id <= FieldId::FileCount)
+					counter(field->id) = field->AsU64();
+				break;
+			}
+		}
+
+		if (header.type == RecordType::Loss)
+		{
+			FormatLoss(line, header.pid, header.hook_id, loss_stage, lost_count);
+			return true;
+		}
+
+		line += "pid:";
+		Detail::AppendDecimal(line, header.pid);
+		switch (header.type)
+		{
+		case RecordType::Info:
+			line += " [Info] ";
+			break;
+		case RecordType::Error:
+			line += " [Error] ";
+			break;
+		case RecordType::HookError:
+			line += " [Hook Error] ";
+			Detail::AppendHookName(line, header.hook_id);
+			line += ' ';
+			break;
+		case RecordType::HookTiming:
+			{
+				static constexpr const char* labels[] = {
+					" [Calls] ", ", [Tracer] p50 ", ", p99 ", ", max ", ", [Real] p50 ", ", p99 ", ", max "
+				};
+				line += " [Timing] ";
+				Detail::AppendHookName(line, header.hook_id);
+				for (size_t i = 0; i < std::size(labels); ++i)
+				{
+					line += labels[i];
+					Detail::AppendDecimal(line, counters[i]);
+				}
+				return true;
+			}
+		case RecordType::SlowCall:
+			line += " [Slow] ";
+			Detail::AppendHookName(line, header.hook_id);
+			line += " [Duration] ";
+			Detail::AppendDecimal(line, counter(FieldId::Duration));
+			line += ", [Status] 0x";
+			for (int shift = 28; shift >= 0; shift -= 4)
+				line += "0123456789ABCDEF"[static_cast<uint32_t>(header.status) >> shift & 0xF];
+			line += ", [FileName] ";
+			Detail::AppendText(line, path);
+			return true;
+		case RecordType::LatencyProfile:
+			{
+				static constexpr std::pair<const char*, FieldId> columns[] = {
+					{" [Latency] [Calls] ", FieldId::CallCount}, {", [Failed] ", FieldId::FailedCount},
+					{", [Total] ", FieldId::LatencyTotal}, {", p50 ", FieldId::LatencyP50},
+					{", p99 ", FieldId::LatencyP99}, {", p999 ", FieldId::LatencyP999}, {", max ", FieldId::LatencyMax}
+				};
+				for (const auto& [label, id] : columns)
+				{
+					line += label;
+					Detail::AppendDecimal(line, counter(id));
+				}
+				if (path)
+				{
+					line += ", [FileName] ";
+					Detail::AppendText(line, path);
+				}
+				else
+				{
+					line += ", [Files] ";
+					Detail::AppendDecimal(line, counter(FieldId::FileCount));
+				}
+				return true;
+			}
+		default:
+			line += " [Hook] ";
+			Detail::AppendHookName(line, header.hook_id);
+			line += ' ';
+			break;
+		}
+
+		if (message)
+			Detail::AppendText(line, message);
+		else if (header.hook_id == HookId::NtCreateFile && access_mask)
+		{
+			line += "[DesiredAccess] ";
+			const uint32_t mask = access_mask->AsU32();
+			for (int bit = 31; bit >= 0; --bit)
+				line += (mask >> bit & 1) ? '1' : '0';
+			line += ", [FileName] ";
+			Detail::AppendText(line, path);
+		}
+		else if (header.hook_id == HookId::CreateProcessInternalW && process_id)
+		{
+			line += "Process created successfully with PID: ";
+			Detail::AppendDecimal(line, process_id->AsU32());
+		}
+		else if (header.hook_id == HookId::CreateProcessInternalW)
+		{
+			line += "[ApplicationName] ";
+			Detail::AppendText(line, application_name);
+			line += ", [CommandLine] ";
+			Detail::AppendText(line, command_line);
+		}
+		else if (header.hook_id == HookId::ExitProcess)
+		{
+			Detail::AppendDecimal(line, header.pid);
+			line += " Exited";
+		}
+		else if (header.hook_id == HookId::NtWriteFile && write_count)
+		{
+			Detail::AppendText(line, path);
+			line += " [Writes] ";
+			Detail::AppendDecimal(line, write_count->AsU64());
+			line += ", [Bytes] ";
+			Detail::AppendDecimal(line, total_bytes);
+			if (first_offset)
+			{
+				line += ", [Offsets] ";
+				Detail::AppendDecimal(line, first_offset->AsU64());
+				line += '-';
+				Detail::AppendDecimal(line, last_offset);
+			}
+			line += ", [Time] ";
+			Detail::AppendDecimal(line, first_timestamp);
+			line += '-';
+			Detail::AppendDecimal(line, last_timestamp);
+		}
+		else if (header.hook_id == HookId::ShellExecuteExW && verb)
+		{
+			line += "verb:";
+			Detail::AppendText(line, verb);
+		}
+		else if (path)
+			Detail::AppendText(line, path);
+		else
+			line += "called";
+		return true;
+	}
+}
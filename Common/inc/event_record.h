@@ -0,0 +1,382 @@
+#pragma once
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+// Binary event records sent from the injected processes to the collector.
+// A record starts with record_magic, a byte that never starts a UTF-8 text line, so the collector
+// can tell records apart from the text lines other writers still send over the same channel.
+// Records are rendered by event_formatter.h, the hook names are mirrored by HookNames.cs.
+//
+// record := RecordHeader, field_count * (FieldHeader, value)
+// Values are little-endian and unaligned, strings are not null terminated.
+namespace ProcessTracer::EventRecord
+{
+	constexpr uint8_t record_magic = 0xFE;
+	constexpr uint8_t record_version = 1;
+	constexpr uint16_t record_flag_truncated = 0x0001; // a field did not fit into the writer's buffer
+
+	enum class RecordType : uint8_t
+	{
+		Info = 1,
+		Error = 2,
+		HookInfo = 3,
+		HookError = 4,
+		HookTiming = 5, // the hook's call count and latency percentiles, in nanoseconds
+		SlowCall = 6, // a real call that took longer than the latency threshold, status in the header
+		LatencyProfile = 7, // call latencies of one file, or of the whole process when there is no Path
+		Loss = 8 // events of the hook the process could not deliver, LostCount at LossStage
+	};
+
+	enum class HookId : uint16_t
+	{
+		None = 0,
+		CreateProcessInternalW,
+		ExitProcess,
+		CreateFileMappingW,
+		ZwWriteFile,
+		NtWriteFile,
+		NtCreateFile,
+		NtCreateUserProcess,
+		ShellExecuteExW,
+		NtSetInformationFile,
+		NtCreateSection,
+		ZwCreateSection,
+		NtCreateSectionEx,
+		NtMapViewOfSection,
+		NtClose, // keeps the handle table current, never logs
+		NtDuplicateObject, // keeps the handle table current, never logs
+		Count
+	};
+
+	enum class FieldId : uint8_t
+	{
+		Message = 1, // utf8, free text
+		Path, // utf16
+		AccessMask, // u32
+		Disposition, // u32
+		Length, // u32
+		ProcessId, // u32
+		ExitCode, // u32
+		ApplicationName, // utf16
+		CommandLine, // utf16
+		InformationClass, // u32
+		WriteCount, // u64, the fields below describe a per-handle write summary
+		TotalBytes, // u64
+		FirstOffset, // u64, left out when the file pointer was used
+		LastOffset, // u64
+		FirstTimestamp, // u64, nanoseconds since the trace epoch
+		LastTimestamp, // u64
+		Verb, // utf16
+		CallCount, // u64, with the fields up to RealMax it describes a HookTiming record
+		TracerP50, // u64
+		TracerP99, // u64
+		TracerMax, // u64
+		RealP50, // u64
+		RealP99, // u64
+		RealMax, // u64
+		Duration, // u64, nanoseconds the real call took
+		FailedCount, // u64, with CallCount and the fields below it describes a LatencyProfile record
+		LatencyTotal, // u64
+		LatencyP50, // u64
+		LatencyP99, // u64
+		LatencyP999, // u64
+		LatencyMax, // u64
+		FileCount, // u64
+		Sequence, // u32, number of a bulk record among those of its thread, gaps are lost records
+		LostCount, // u64
+		LossStage, // u32, see LossStage
+		BulkCount // u32, on an ExitProcess record: the bulk records the process shipped before it
+	};
+
+	// Where events were lost. The tracer adds Collector for its own queue.
+	enum class LossStage : uint32_t
+	{
+		Buffer = 1, // the injected process's event buffer was full
+		Transport = 2, // the event ring was full or the pipe failed
+		Sequence = 3, // the collector found a gap in the sequence numbers of a thread
+		Collector = 4
+	};
+
+	enum class FieldType : uint8_t
+	{
+		U32 = 1,
+		U64 = 2,
+		Utf8 = 3,
+		Utf16 = 4
+	};
+
+	struct RecordHeader
+	{
+		uint8_t magic;
+		uint8_t version;
+		RecordType type;
+		uint8_t field_count;
+		HookId hook_id;
+		uint16_t flags;
+		uint32_t size; // whole record including this header
+		uint32_t pid;
+		uint32_t tid;
+		int32_t status; // NTSTATUS or Win32 error of the hooked call, 0 when it does not apply
+		uint64_t timestamp; // nanoseconds since the trace epoch, see trace_clock.h
+	};
+
+	struct FieldHeader
+	{
+		FieldId id;
+		FieldType type;
+		uint16_t length; // value bytes
+	};
+
+	static_assert(sizeof(RecordHeader) == 32, "layout is shared with the collector");
+	static_assert(offsetof(RecordHeader, size) == 8, "layout is shared with the collector");
+	static_assert(offsetof(RecordHeader, timestamp) == 24, "layout is shared with the collector");
+	static_assert(sizeof(FieldHeader) == 4, "layout is shared with the collector");
+
+	inline const char* HookName(HookId hook_id)
+	{
+		static constexpr const char* names[] = {
+			"",
+			"CreateProcessInternalW",
+			"ExitProcess",
+			"CreateFileMappingW",
+			"ZwWriteFile",
+			"NtWriteFile",
+			"NtCreateFile",
+			"NtCreateUserProcess",
+			"ShellExecuteExW",
+			"NtSetInformationFile",
+			"NtCreateSection",
+			"ZwCreateSection",
+			"NtCreateSectionEx",
+			"NtMapViewOfSection",
+			"NtClose",
+			"NtDuplicateObject"
+		};
+		static_assert(sizeof(names) / sizeof(names[0]) == static_cast<size_t>(HookId::Count),
+		              "every hook needs a name");
+		const auto index = static_cast<size_t>(hook_id);
+		return index < static_cast<size_t>(HookId::Count) ? names[index] : "";
+	}
+
+	// Encodes one record into a caller supplied buffer, never allocates.
+	// Fields that do not fit are cut (strings) or left out (numbers) and the record is flagged truncated.
+	class RecordWriter
+	{
+		char* m_buffer;
+		size_t m_capacity;
+		size_t m_size = 0;
+		RecordHeader m_header = {};
+
+		bool AddField(FieldId id, FieldType type, const void* value, size_t length)
+		{
+			if (m_header.field_count == UINT8_MAX || length > UINT16_MAX ||
+				m_capacity - m_size < sizeof(FieldHeader) + length)
+			{
+				m_header.flags |= record_flag_truncated;
+				return false;
+			}
+			if (length != 0)
+				memcpy(m_buffer + m_size + sizeof(FieldHeader), value, length);
+			CommitField(id, type, length);
+			return true;
+		}
+
+		void CommitField(FieldId id, FieldType type, size_t length)
+		{
+			const FieldHeader field = {id, type, static_cast<uint16_t>(length)};
+			memcpy(m_buffer + m_size, &field, sizeof(field));
+			m_size += sizeof(field) + length;
+			++m_header.field_count;
+		}
+
+		void AddText(FieldId id, FieldType type, const void* text, size_t length, size_t unit)
+		{
+			const size_t free_bytes = m_capacity - m_size;
+			const size_t available = free_bytes < sizeof(FieldHeader) ? 0 : free_bytes - sizeof(FieldHeader);
+			size_t fitted = length;
+			if (fitted > available)
+				fitted = available;
+			if (fitted > UINT16_MAX)
+				fitted = UINT16_MAX;
+			fitted -= fitted % unit;
+			if (fitted != length)
+				m_header.flags |= record_flag_truncated;
+			AddField(id, type, text, fitted);
+		}
+
+	public:
+		// capacity has to hold at least a RecordHeader
+		RecordWriter(char* buffer, size_t capacity) : m_buffer(buffer), m_capacity(capacity)
+		{
+		}
+
+		void Begin(RecordType type, HookId hook_id, uint32_t pid, uint32_t tid, uint64_t timestamp, int32_t status)
+		{
+			m_header = {record_magic, record_version, type, 0, hook_id, 0, 0, pid, tid, status, timestamp};
+			m_size = sizeof(RecordHeader);
+		}
+
+		bool AddU32(FieldId id, uint32_t value)
+		{
+			return AddField(id, FieldType::U32, &value, sizeof(value));
+		}
+
+		void AddU64(FieldId id, uint64_t value)
+		{
+			AddField(id, FieldType::U64, &value, sizeof(value));
+		}
+
+		void AddUtf8(FieldId id, const char* text, size_t length)
+		{
+			AddText(id, FieldType::Utf8, text, length, sizeof(char));
+		}
+
+		void AddUtf8(FieldId id, const char* text)
+		{
+			AddUtf8(id, text, text ? strlen(text) : 0);
+		}
+
+		void AddUtf16(FieldId id, const char16_t* text, size_t count)
+		{
+			AddText(id, FieldType::Utf16, text, count * sizeof(char16_t), sizeof(char16_t));
+		}
+
+		// Formats straight into the record instead of going through an intermediate buffer.
+		void AddUtf8V(FieldId id, const char* format, va_list args)
+		{
+			if (m_header.field_count == UINT8_MAX || m_capacity - m_size <= sizeof(FieldHeader))
+			{
+				m_header.flags |= record_flag_truncated;
+				return;
+			}
+			size_t available = m_capacity - m_size - sizeof(FieldHeader);
+			if (available > UINT16_MAX + 1u)
+				available = UINT16_MAX + 1u;
+			// vsnprintf needs room for its terminator, which the next field or Finish overwrites
+#if defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wformat-nonliteral"
+#endif
+			const int written = vsnprintf(m_buffer + m_size + sizeof(FieldHeader), available, format, args);
+#if defined(__clang__)
+#pragma clang diagnostic pop
+#endif
+			if (written < 0)
+				return;
+			size_t length = static_cast<size_t>(written);
+			if (length >= available)
+			{
+				length = available - 1;
+				m_header.flags |= record_flag_truncated;
+			}
+			CommitField(id, FieldType::Utf8, length);
+		}
+
+		// Keeps bytes free for a field added right before Finish, Release() gives them back.
+		void Reserve(size_t bytes)
+		{
+			m_capacity -= bytes;
+		}
+
+		void Release(size_t bytes)
+		{
+			m_capacity += bytes;
+		}
+
+		// Completes the header, the record occupies Data()[0, size) afterwards.
+		size_t Finish()
+		{
+			m_header.size = static_cast<uint32_t>(m_size);
+			memcpy(m_buffer, &m_header, sizeof(m_header));
+			return m_size;
+		}
+
+		const char* Data() const
+		{
+			return m_buffer;
+		}
+	};
+
+	struct Field
+	{
+		FieldId id;
+		FieldType type;
+		const char* value;
+		uint16_t length;
+
+		uint32_t AsU32() const
+		{
+			uint32_t result = 0;
+			if (type == FieldType::U32)
+				memcpy(&result, value, sizeof(result));
+			return result;
+		}
+
+		uint64_t AsU64() const
+		{
+			if (type == FieldType::U32)
+				return AsU32();
+			uint64_t result = 0;
+			if (type == FieldType::U64)
+				memcpy(&result, value, sizeof(result));
+			return result;
+		}
+	};
+
+	// Size of the record starting at data, 0 while fewer than sizeof(RecordHeader) bytes are available.
+	inline size_t PeekRecordSize(const char* data, size_t available)
+	{
+		if (available < sizeof(RecordHeader))
+			return 0;
+		uint32_t size;
+		memcpy(&size, data + offsetof(RecordHeader, size), sizeof(size));
+		return size;
+	}
+
+	// Validates one complete record and walks its fields.
+	class RecordReader
+	{
+		RecordHeader m_header = {};
+		const char* m_next = nullptr;
+		const char* m_end = nullptr;
+		uint8_t m_remaining = 0;
+
+	public:
+		bool Open(const char* data, size_t length)
+		{
+			if (length < sizeof(RecordHeader))
+				return false;
+			memcpy(&m_header, data, sizeof(m_header));
+			if (m_header.magic != record_magic || m_header.version != record_version ||
+				m_header.size < sizeof(RecordHeader) || m_header.size > length)
+				return false;
+			m_next = data + sizeof(RecordHeader);
+			m_end = data + m_header.size;
+			m_remaining = m_header.field_count;
+			return true;
+		}
+
+		const RecordHeader& Header() const
+		{
+			return m_header;
+		}
+
+		// false once all fields are read or the next one is malformed
+		bool Next(Field& field)
+		{
+			if (m_remaining == 0 || static_cast<size_t>(m_end - m_next) < sizeof(FieldHeader))
+				return false;
+			FieldHeader field_header;
+			memcpy(&field_header, m_next, sizeof(field_header));
+			if (static_cast<size_t>(m_end - m_next) - sizeof(FieldHeader) < field_header.length)
+				return false;
+			field = {field_header.id, field_header.type, m_next + sizeof(FieldHeader), field_header.length};
+			m_next += sizeof(FieldHeader) + field_header.length;
+			--m_remaining;
+			return true;
+		}
+	};
+}
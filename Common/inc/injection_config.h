@@ -0,0 +1,107 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "event_record.h"
+
+// The GUID_PIPE_HANDLE payload the tracer hands to every injected process. Injected processes
+// forward it verbatim to their children, so the whole process tree runs with the same settings.
+// The layout is mirrored by InjectionConfig.cs, keep both in sync.
+//
+// payload := ConfigHeader, path_filter_length bytes of path filter rules
+// A newer writer may grow the header, readers find the filter rules at header_size.
+namespace ProcessTracer::Injection
+{
+	constexpr uint32_t config_magic = 0x43495450; // "PTIC"
+	constexpr uint16_t config_version = 1;
+
+	constexpr uint32_t config_flag_can_elevate = 0x0001;
+	constexpr uint32_t config_flag_aggregate_writes = 0x0002;
+	constexpr uint32_t config_flag_hook_timing = 0x0004;
+	constexpr uint32_t config_flag_latency_profile = 0x0008;
+
+	// What a full stage does with an event, mirrored by OverflowPolicy.cs
+	enum class OverflowPolicy : uint8_t
+	{
+		Block, // waits for room, the event ring only for a bounded time
+		DropOldest, // discards queued events until the new one fits, where the stage allows it
+		DropNewest // discards the new event
+	};
+
+	struct ConfigHeader
+	{
+		uint32_t magic;
+		uint16_t version;
+		uint16_t header_size;
+		uint32_t tracer_pid;
+		uint32_t flags;
+		uint64_t hook_mask; // bit per EventRecord::HookId, the functions to detour
+		uint32_t batch_bytes; // 0 keeps the default
+		uint32_t batch_latency_ms; // 0 keeps the default
+		uint32_t clock_source;
+		uint32_t path_filter_length;
+		uint64_t clock_epoch;
+		uint64_t clock_frequency;
+		uint32_t latency_threshold_us; // 0 keeps the default
+		uint32_t latency_top_files; // 0 keeps the default
+		uint32_t buffer_bytes; // event buffer of each thread, 0 keeps the default
+		OverflowPolicy buffer_policy;
+		OverflowPolicy transport_policy; // the event ring cannot drop oldest, it drops newest instead
+		uint16_t reserved;
+	};
+
+	static_assert(sizeof(ConfigHeader) == 72, "layout is shared with the tracer");
+	static_assert(offsetof(ConfigHeader, hook_mask) == 16, "layout is shared with the tracer");
+	static_assert(offsetof(ConfigHeader, clock_epoch) == 40, "layout is shared with the tracer");
+	static_assert(static_cast<size_t>(EventRecord::HookId::Count) <= 64, "hook_mask has one bit per hook");
+
+	constexpr uint64_t HookBit(EventRecord::HookId hook_id)
+	{
+		return uint64_t{1} << static_cast<unsigned>(hook_id);
+	}
+
+	constexpr uint64_t all_hooks = (uint64_t{1} << static_cast<unsigned>(EventRecord::HookId::Count)) - 2;
+
+	struct Config
+	{
+		ConfigHeader header;
+		const char* path_filter; // points into the payload
+		size_t path_filter_length;
+	};
+
+	// Validates a payload, false when it is not one this reader understands.
+	inline bool Decode(const void* payload, size_t size, Config& config)
+	{
+		if (!payload || size < sizeof(ConfigHeader))
+			return false;
+		memcpy(&config.header, payload, sizeof(ConfigHeader));
+		const ConfigHeader& header = config.header;
+		if (header.magic != config_magic || header.version < config_version ||
+			header.header_size < sizeof(ConfigHeader) || header.header_size > size ||
+			size - header.header_size < header.path_filter_length)
+			return false;
+		config.path_filter = static_cast<const char*>(payload) + header.header_size;
+		config.path_filter_length = header.path_filter_length;
+		return true;
+	}
+
+	// The functions that actually get detoured for a requested mask. Process lifecycle hooks are
+	// always needed to follow children and flush at exit, and every hook that names files through
+	// the handle table needs NtClose and NtDuplicateObject to keep that table correct.
+	inline uint64_t SelectHooks(uint64_t requested, uint32_t flags)
+	{
+		using EventRecord::HookId;
+		uint64_t selected = (requested & all_hooks) | HookBit(HookId::CreateProcessInternalW) |
+			HookBit(HookId::ExitProcess) | HookBit(HookId::ShellExecuteExW);
+		if (flags & config_flag_aggregate_writes)
+			selected |= HookBit(HookId::NtWriteFile);
+
+		constexpr uint64_t handle_table_users = HookBit(HookId::CreateFileMappingW) | HookBit(HookId::NtWriteFile) |
+			HookBit(HookId::NtCreateFile) | HookBit(HookId::NtSetInformationFile) | HookBit(HookId::NtCreateSection) |
+			HookBit(HookId::ZwCreateSection) | HookBit(HookId::NtCreateSectionEx);
+		if (selected & handle_table_users)
+			selected |= HookBit(HookId::NtClose) | HookBit(HookId::NtDuplicateObject);
+		return selected;
+	}
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Log-linear latency histograms. Values below 2^sub_bucket_bits get a bucket each, every power of two
+// above that is split into 2^sub_bucket_bits buckets, so a bucket never spans more than 1/8 of its
+// values. Recording is a shift and two loads and stores, no division and no locked instruction.
+namespace ProcessTracer::Timing
+{
+	constexpr unsigned sub_bucket_bits = 3;
+	constexpr unsigned max_value_bits = 36; // ~68 s in nanoseconds, larger values share the last bucket
+	constexpr size_t bucket_count = size_t{max_value_bits - sub_bucket_bits + 1} << sub_bucket_bits;
+
+	inline unsigned HighestBit(uint64_t value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32)))
+			return index + 32;
+		_BitScanReverse(&index, static_cast<unsigned long>(value));
+		return index;
+#else
+		return 63 - static_cast<unsigned>(__builtin_clzll(value));
+#endif
+	}
+
+	inline size_t BucketOf(uint64_t value)
+	{
+		if (value < (uint64_t{1} << sub_bucket_bits))
+			return static_cast<size_t>(value);
+		if (value >= (uint64_t{1} << max_value_bits))
+			return bucket_count - 1;
+		const unsigned shift = HighestBit(value) - sub_bucket_bits;
+		return (size_t{shift + 1} << sub_bucket_bits) + static_cast<size_t>((value >> shift) -
+			(uint64_t{1} << sub_bucket_bits));
+	}
+
+	// Largest value that lands in bucket.
+	inline uint64_t BucketUpperBound(size_t bucket)
+	{
+		const size_t group = bucket >> sub_bucket_bits;
+		if (group == 0)
+			return bucket;
+		const unsigned shift = static_cast<unsigned>(group - 1);
+		const uint64_t lower = ((uint64_t{1} << sub_bucket_bits) + (bucket & ((size_t{1} << sub_bucket_bits) - 1)))
+			<< shift;
+		return lower + (uint64_t{1} << shift) - 1;
+	}
+
+	// Plain counts, what the per-thread histograms are merged into.
+	struct LatencyCounts
+	{
+		uint64_t buckets[bucket_count] = {};
+		uint64_t count = 0;
+		uint64_t sum = 0;
+		uint64_t max = 0;
+
+		void Add(uint64_t value)
+		{
+			++buckets[BucketOf(value)];
+			++count;
+			sum += value;
+			if (value > max)
+				max = value;
+		}
+
+		void Merge(const LatencyCounts& other)
+		{
+			for (size_t i = 0; i < bucket_count; ++i)
+				buckets[i] += other.buckets[i];
+			count += other.count;
+			sum += other.sum;
+			if (other.max > max)
+				max = other.max;
+		}
+
+		// Upper bound of the bucket holding the value at fraction of the count, 0 when empty.
+		uint64_t Percentile(double fraction) const
+		{
+			if (count == 0)
+				return 0;
+			auto rank = static_cast<uint64_t>(fraction * static_cast<double>(count) + 0.5);
+			if (rank == 0)
+				rank = 1;
+			uint64_t seen = 0;
+			for (size_t i = 0; i < bucket_count; ++i)
+			{
+				seen += buckets[i];
+				if (seen >= rank)
+					return BucketUpperBound(i) < max ? BucketUpperBound(i) : max;
+			}
+			return max;
+		}
+	};
+
+	// Written by one thread only and read by any: the owner updates with relaxed loads and stores
+	// instead of read-modify-writes, readers see every count that was stored before they looked.
+	class ThreadLatencyHistogram
+	{
+		std::atomic<uint32_t> m_buckets[bucket_count] = {};
+		std::atomic<uint64_t> m_sum{0};
+		std::atomic<uint64_t> m_max{0};
+
+		template <typename T>
+		static void Bump(std::atomic<T>& value, T amount)
+		{
+			value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+		}
+
+	public:
+		void Record(uint64_t value)
+		{
+			Bump(m_buckets[BucketOf(value)], 1u);
+			Bump(m_sum, value);
+			if (value > m_max.load(std::memory_order_relaxed))
+				m_max.store(value, std::memory_order_relaxed);
+		}
+
+		void MergeInto(LatencyCounts& counts) const
+		{
+			for (size_t i = 0; i < bucket_count; ++i)
+			{
+				const uint32_t bucket = m_buckets[i].load(std::memory_order_relaxed);
+				counts.buckets[i] += bucket;
+				counts.count += bucket;
+			}
+			counts.sum += m_sum.load(std::memory_order_relaxed);
+			const uint64_t max = m_max.load(std::memory_order_relaxed);
+			if (max > counts.max)
+				counts.max = max;
+		}
+	};
+}
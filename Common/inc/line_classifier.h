@@ -0,0 +1,342 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "event_record.h"
+#include "simd.h"
+
+// Recognizes the lines the collector acts on, so the tracer does not compare every received line
+// against each control message. Mirrored by LineKind in ReceivedLine.cs.
+namespace ProcessTracer::EventRecord
+{
+	enum class LineKind : uint32_t
+	{
+		Other,
+		CloseApp, // [CloseApp]
+		ChildProcess, // [ChildProcess] <pid>
+		ShellExecuteStart, // pid:N [Hook] ShellExecuteExW Start HookShellExecuteW
+		ShellExecuteError, // pid:N [Hook] ShellExecuteExW Error HookShellExecuteW
+		PermissionRequest, // pid:N [Info] Permission Request
+		ProcessCreated, // pid:N [Hook] CreateProcessInternalW Process created successfully with PID: <pid>
+		ProcessExited, // pid:N [Hook] ExitProcess <pid> ...
+		Loss, // pid:N [Loss] ..., events were lost on the way
+	};
+
+	// set on a line rendered from a numbered bulk record, the ones an ExitProcess record counts
+	constexpr uint16_t line_flag_bulk = 1;
+
+	// One line of the collector's output. pid is the process a ChildProcess, ProcessCreated or
+	// ProcessExited line names, 0 when it is missing or malformed. sender_pid, hook_id, tid and
+	// timestamp come from the record the line was rendered from, sequence from its Sequence field,
+	// or on a ProcessExited line from its BulkCount field; they are 0 for text lines.
+	struct LineInfo
+	{
+		uint32_t offset;
+		uint32_t length;
+		LineKind kind;
+		uint32_t pid;
+		uint32_t sender_pid;
+		HookId hook_id;
+		uint16_t flags;
+		uint32_t tid;
+		uint32_t sequence;
+		uint64_t timestamp;
+	};
+
+	static_assert(sizeof(LineInfo) == 40, "LineInfo is shared with the tracer");
+	static_assert(offsetof(LineInfo, timestamp) == 32, "LineInfo is shared with the tracer");
+
+	// the messages the hooks send these lines with, the rules below match them as FormatRecord renders them
+	constexpr char shell_execute_start_message[] = "Start HookShellExecuteW";
+	constexpr char shell_execute_error_message[] = "Error HookShellExecuteW";
+	constexpr char permission_request_message[] = "Permission Request";
+
+	namespace Detail
+	{
+		constexpr char child_process_prefix[] = "[ChildProcess] ";
+		constexpr char process_created_prefix[] = "[Hook] CreateProcessInternalW Process created successfully with PID: ";
+		constexpr char process_exited_prefix[] = "[Hook] ExitProcess ";
+
+		// Each of the scans below looks for byte in [begin, end) and returns where it is, end when it
+		// is not there. The vector ones leave a tail shorter than their block to the scalar one.
+		inline const char* FindByteScalar(const char* begin, const char* end, char byte)
+		{
+			for (; begin != end; ++begin)
+			{
+				if (*begin == byte)
+					return begin;
+			}
+			return end;
+		}
+
+#ifdef PROCESS_TRACER_SSE2
+		inline const char* FindByteSse2(const char* begin, const char* end, char byte)
+		{
+			const __m128i wanted = _mm_set1_epi8(byte);
+			for (; end - begin >= 16; begin += 16)
+			{
+				const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+				const auto found = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, wanted)));
+				if (found)
+					return begin + Simd::LowestBit(found);
+			}
+			return FindByteScalar(begin, end, byte);
+		}
+#endif
+
+#ifdef PROCESS_TRACER_AVX2
+		PROCESS_TRACER_AVX2_TARGET inline const char* FindByteAvx2(const char* begin, const char* end, char byte)
+		{
+			const __m256i wanted = _mm256_set1_epi8(byte);
+			for (; end - begin >= 32; begin += 32)
+			{
+				const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+				const auto found = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, wanted)));
+				if (found)
+					return begin + Simd::LowestBit(found);
+			}
+			return FindByteSse2(begin, end, byte);
+		}
+#endif
+
+		// Calls found with every byte in [begin, end) equal to byte, in order. A block is compared once
+		// however many matches it holds, the bits of its mask are walked instead.
+		template <typename Found>
+		void ForEachByteScalar(const char* begin, const char* end, char byte, Found&& found)
+		{
+			for (; begin != end; ++begin)
+			{
+				if (*begin == byte)
+					found(begin);
+			}
+		}
+
+#ifdef PROCESS_TRACER_SSE2
+		template <typename Found>
+		void ForEachByteSse2(const char* begin, const char* end, char byte, Found&& found)
+		{
+			const __m128i wanted = _mm_set1_epi8(byte);
+			for (; end - begin >= 16; begin += 16)
+			{
+				const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+				for (auto mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, wanted))); mask;
+				     mask &= mask - 1)
+					found(begin + Simd::LowestBit(mask));
+			}
+			ForEachByteScalar(begin, end, byte, found);
+		}
+#endif
+
+#ifdef PROCESS_TRACER_AVX2
+		template <typename Found>
+		PROCESS_TRACER_AVX2_TARGET void ForEachByteAvx2(const char* begin, const char* end, char byte, Found&& found)
+		{
+			const __m256i wanted = _mm256_set1_epi8(byte);
+			for (; end - begin >= 32; begin += 32)
+			{
+				const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+				for (auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, wanted))); mask;
+				     mask &= mask - 1)
+					found(begin + Simd::LowestBit(mask));
+			}
+			ForEachByteSse2(begin, end, byte, found);
+		}
+#endif
+
+		template <typename Found>
+		void ForEachByte(const char* begin, const char* end, char byte, Found&& found)
+		{
+#ifdef PROCESS_TRACER_AVX2
+			if (Simd::avx2_supported)
+				return ForEachByteAvx2(begin, end, byte, found);
+#endif
+#ifdef PROCESS_TRACER_SSE2
+			ForEachByteSse2(begin, end, byte, found);
+#else
+			ForEachByteScalar(begin, end, byte, found);
+#endif
+		}
+
+		// Decimal process id at the start of text, ending at the end of text or, with stop set, at the
+		// first stop character. 0 when there is none or it does not fit an int.
+		inline uint32_t ParsePid(const char* text, size_t length, char stop)
+		{
+			uint64_t pid = 0;
+			size_t i = 0;
+			for (; i < length && text[i] >= '0' && text[i] <= '9' && i < 10; ++i)
+				pid = pid * 10 + static_cast<uint32_t>(text[i] - '0');
+			const bool ended = stop ? i < length && text[i] == stop : i == length;
+			return i != 0 && ended && pid <= INT32_MAX ? static_cast<uint32_t>(pid) : 0;
+		}
+
+		// The first eight bytes of text as one word, zero filled when it is shorter. The key of a rule
+		// is built the same way at compile time, little-endian like every host the tracer runs on.
+		inline uint64_t LoadKey(const char* text, size_t length)
+		{
+			uint64_t key = 0;
+			if (length >= 8)
+				memcpy(&key, text, 8);
+			else
+				memcpy(&key, text, length);
+			return key;
+		}
+
+		constexpr uint64_t Key(const char* text, size_t length)
+		{
+			uint64_t key = 0;
+			for (size_t i = 0; i < length && i < 8; ++i)
+				key |= static_cast<uint64_t>(static_cast<uint8_t>(text[i])) << (8 * i);
+			return key;
+		}
+
+		constexpr uint64_t KeyMask(size_t length)
+		{
+			return length >= 8 ? ~uint64_t{0} : (uint64_t{1} << (8 * length)) - 1;
+		}
+
+		enum class PidAt : uint8_t
+		{
+			None,
+			End, // the rest of the line is the pid
+			Space // the pid ends at the next space
+		};
+
+		// A line the tracer acts on: the whole line, or its start with exact unset. The key and mask
+		// decide with one comparison whether the rest is worth comparing.
+		struct PrefixRule
+		{
+			const char* text;
+			size_t length;
+			bool exact;
+			LineKind kind;
+			PidAt pid;
+			uint64_t key;
+			uint64_t mask;
+		};
+
+		template <size_t N>
+		constexpr PrefixRule Rule(const char (&text)[N], bool exact, LineKind kind, PidAt pid = PidAt::None)
+		{
+			return {text, N - 1, exact, kind, pid, Key(text, N - 1), KeyMask(N - 1)};
+		}
+
+		// compared against the whole line
+		constexpr PrefixRule line_rules[] = {
+			Rule("[CloseApp]", true, LineKind::CloseApp),
+			Rule(child_process_prefix, false, LineKind::ChildProcess, PidAt::End),
+		};
+
+		// compared against what follows the sender's "pid:N "
+		constexpr PrefixRule sender_rules[] = {
+			Rule(process_created_prefix, false, LineKind::ProcessCreated, PidAt::End),
+			Rule(process_exited_prefix, false, LineKind::ProcessExited, PidAt::Space),
+			Rule("[Hook] ShellExecuteExW Start HookShellExecuteW", true, LineKind::ShellExecuteStart),
+			Rule("[Hook] ShellExecuteExW Error HookShellExecuteW", true, LineKind::ShellExecuteError),
+			Rule("[Info] Permission Request", true, LineKind::PermissionRequest),
+			Rule("[Loss] ", false, LineKind::Loss),
+		};
+
+		// which bytes a text of rules can start with, most lines are turned away by this lookup alone
+		struct FirstBytes
+		{
+			bool bytes[256];
+		};
+
+		template <size_t N>
+		constexpr FirstBytes FirstBytesOf(const PrefixRule (&rules)[N])
+		{
+			FirstBytes first = {};
+			for (const PrefixRule& rule : rules)
+				first.bytes[static_cast<uint8_t>(rule.text[0])] = true;
+			return first;
+		}
+
+		constexpr FirstBytes line_first_bytes = FirstBytesOf(line_rules);
+		constexpr FirstBytes sender_first_bytes = FirstBytesOf(sender_rules);
+
+		template <size_t N>
+		bool Classify(const PrefixRule (&rules)[N], const FirstBytes& first, const char* text, size_t length,
+		              LineKind& kind, uint32_t& pid)
+		{
+			if (length == 0 || !first.bytes[static_cast<uint8_t>(text[0])])
+				return false;
+			const uint64_t key = LoadKey(text, length);
+			for (const PrefixRule& rule : rules)
+			{
+				if ((key & rule.mask) != rule.key || length < rule.length || (rule.exact && length != rule.length) ||
+					memcmp(text, rule.text, rule.length) != 0)
+					continue;
+				kind = rule.kind;
+				if (rule.pid != PidAt::None)
+					pid = ParsePid(text + rule.length, length - rule.length, rule.pid == PidAt::Space ? ' ' : 0);
+				return true;
+			}
+			return false;
+		}
+	}
+
+	// The first byte of [begin, end) equal to byte, end when there is none. Receive buffers are split
+	// into lines with it.
+	inline const char* FindByte(const char* begin, const char* end, char byte)
+	{
+#ifdef PROCESS_TRACER_AVX2
+		if (end - begin >= 32 && Simd::avx2_supported)
+			return Detail::FindByteAvx2(begin, end, byte);
+#endif
+#ifdef PROCESS_TRACER_SSE2
+		return Detail::FindByteSse2(begin, end, byte);
+#else
+		return Detail::FindByteScalar(begin, end, byte);
+#endif
+	}
+
+	inline LineKind ClassifyLine(const char* line, size_t length, uint32_t& pid)
+	{
+		pid = 0;
+		LineKind kind = LineKind::Other;
+		if (Detail::Classify(Detail::line_rules, Detail::line_first_bytes, line, length, kind, pid))
+			return kind;
+		// everything else is checked after the sender's "pid:N ", which is short enough that a wider
+		// scan would not pay for its call
+#ifdef PROCESS_TRACER_SSE2
+		const char* space = Detail::FindByteSse2(line, line + length, ' ');
+#else
+		const char* space = Detail::FindByteScalar(line, line + length, ' ');
+#endif
+		if (space == line + length)
+			return LineKind::Other;
+		const char* text = space + 1;
+		Detail::Classify(Detail::sender_rules, Detail::sender_first_bytes, text, length - (text - line), kind, pid);
+		return kind;
+	}
+
+	// A line of a text buffer, pointing into it.
+	struct LineView
+	{
+		const char* text;
+		size_t length; // without the line end
+		LineKind kind;
+		uint32_t pid; // as ClassifyLine parses it
+	};
+
+	// Splits the '\n' terminated lines at the start of data, classifies each and calls visit with its
+	// view, a "\r\n" end is not part of the line. Returns the bytes of the complete lines, an
+	// unterminated rest is left for the next call.
+	template <typename Visit>
+	size_t ScanLines(const char* data, size_t length, Visit&& visit)
+	{
+		const char* line = data;
+		Detail::ForEachByte(data, data + length, '\n', [&line, &visit](const char* line_end)
+		{
+			size_t line_length = line_end - line;
+			if (line_length != 0 && line[line_length - 1] == '\r')
+				--line_length;
+			LineView view = {line, line_length, LineKind::Other, 0};
+			view.kind = ClassifyLine(line, line_length, view.pid);
+			visit(view);
+			line = line_end + 1;
+		});
+		return line - data;
+	}
+}
@@ -0,0 +1,233 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Layout and both sides of the shared-memory event ring "ProcessTracerEvents:<tracer pid>".
+// The tracer creates and owns the region; every injected process maps it and appends frames.
+// The layout is mirrored by SharedMemoryEventReader.cs, keep both in sync.
+//
+// Positions are monotonically increasing byte counters, the data offset is position & (capacity - 1).
+// Every frame starts with one 64-bit header word, which is in one of three states:
+//   free       size 0, the second half is FreeTag of the position it is free for
+//   claimed    size, the pid of the producer writing the frame
+//   committed  size | frame_committed_flag, the payload length
+// A producer claims the frame at reserve_position with a CAS from its free word, so the size is
+// known from the moment the space is taken, then advances reserve_position past it. A producer that
+// finds the frame at reserve_position already claimed advances it for the claimer, so a claimer that
+// dies in between cannot block the others. The tag keeps a producer that read an old reserve_position
+// from claiming the same offset a lap later. The consumer reads committed frames in order, turns
+// every header word of the frame back into a free word for the next lap and advances read_position.
+// A claimed frame is skipped only once its producer has exited.
+namespace ProcessTracer::SharedMemoryRing
+{
+	constexpr uint32_t ring_magic = 0x52545450; // "PTTR"
+	constexpr uint32_t ring_version = 2;
+	constexpr uint32_t frame_committed_flag = 0x80000000u;
+	constexpr uint32_t padding_frame_length = 0xFFFFFFFFu;
+	constexpr size_t frame_alignment = 8;
+
+	struct RingHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t capacity; // bytes of frame data after the header, a power of two
+		alignas(64) std::atomic<uint64_t> reserve_position;
+		alignas(64) std::atomic<uint64_t> read_position;
+		alignas(64) std::atomic<uint64_t> dropped_frames;
+		std::atomic<uint64_t> dropped_bytes;
+	};
+
+	struct FrameHeader
+	{
+		// size in the low half, the pid, payload length or free tag in the high half
+		std::atomic<uint64_t> word;
+	};
+
+	constexpr size_t header_size = 256;
+
+	static_assert(sizeof(RingHeader) <= header_size, "RingHeader must fit into the reserved header area");
+	static_assert(offsetof(RingHeader, reserve_position) == 64, "layout is shared with the collector");
+	static_assert(offsetof(RingHeader, read_position) == 128, "layout is shared with the collector");
+	static_assert(offsetof(RingHeader, dropped_frames) == 192, "layout is shared with the collector");
+	static_assert(offsetof(RingHeader, dropped_bytes) == 200, "layout is shared with the collector");
+	static_assert(sizeof(FrameHeader) == frame_alignment, "frames are 8 byte aligned");
+
+	constexpr uint64_t Pack(uint32_t size, uint32_t high)
+	{
+		return size | static_cast<uint64_t>(high) << 32;
+	}
+
+	constexpr uint32_t SizeOf(uint64_t word)
+	{
+		return static_cast<uint32_t>(word) & ~frame_committed_flag;
+	}
+
+	constexpr uint32_t HighOf(uint64_t word)
+	{
+		return static_cast<uint32_t>(word >> 32);
+	}
+
+	constexpr bool IsCommitted(uint64_t word)
+	{
+		return (word & frame_committed_flag) != 0;
+	}
+
+	constexpr uint32_t FreeTag(uint64_t position)
+	{
+		return static_cast<uint32_t>(position / frame_alignment);
+	}
+
+	inline bool IsValid(const RingHeader* header, size_t mapped_size)
+	{
+		return header->magic == ring_magic &&
+			header->version == ring_version &&
+			header->capacity != 0 &&
+			(header->capacity & (header->capacity - 1)) == 0 &&
+			header->capacity <= mapped_size - header_size;
+	}
+
+	inline FrameHeader* FrameAt(RingHeader* header, uint64_t position)
+	{
+		const auto data = reinterpret_cast<char*>(header) + header_size;
+		return reinterpret_cast<FrameHeader*>(data + (position & (header->capacity - 1)));
+	}
+
+	// Turns the frames in [position, position + length) into free space for the next lap.
+	inline void Release(RingHeader* header, uint64_t position, uint64_t length)
+	{
+		const uint64_t capacity = header->capacity;
+		for (uint64_t offset = 0; offset < length; offset += frame_alignment)
+			FrameAt(header, position + offset)->word.store(Pack(0, FreeTag(position + offset + capacity)),
+			                                               std::memory_order_relaxed);
+	}
+
+	// Sets up a ring in header_size + capacity bytes of zeroed memory, magic last.
+	inline void Initialize(RingHeader* header, uint64_t capacity)
+	{
+		header->version = ring_version;
+		header->capacity = capacity;
+		for (uint64_t position = 0; position < capacity; position += frame_alignment)
+			FrameAt(header, position)->word.store(Pack(0, FreeTag(position)), std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		reinterpret_cast<std::atomic<uint32_t>*>(&header->magic)->store(ring_magic, std::memory_order_release);
+	}
+
+	inline void AccountLoss(RingHeader* header, size_t length)
+	{
+		header->dropped_frames.fetch_add(1, std::memory_order_relaxed);
+		header->dropped_bytes.fetch_add(length, std::memory_order_relaxed);
+	}
+
+	// Claims frame_size bytes at position, whose header is expected to hold free. Whoever wins the
+	// claim, reserve_position is moved past it: by the claimer or by the producer that lost.
+	inline bool Claim(RingHeader* header, uint64_t position, uint64_t free, uint64_t claimed)
+	{
+		const auto frame = FrameAt(header, position);
+		uint64_t found = free;
+		const bool won = frame->word.compare_exchange_strong(found, claimed, std::memory_order_acq_rel,
+		                                                     std::memory_order_acquire);
+		const uint32_t size = SizeOf(won ? claimed : found);
+		if (size != 0)
+		{
+			uint64_t expected = position;
+			header->reserve_position.compare_exchange_strong(expected, position + size, std::memory_order_acq_rel,
+			                                                 std::memory_order_relaxed);
+		}
+		return won;
+	}
+
+	// Appends one frame. Returns false when the ring is full and, with account_loss set, counts the
+	// frame as lost in the header.
+	inline bool TryWrite(RingHeader* header, const char* payload, size_t length, uint32_t pid,
+	                     bool account_loss = true)
+	{
+		const uint64_t capacity = header->capacity;
+		const uint64_t frame_size = (sizeof(FrameHeader) + length + frame_alignment - 1) & ~(frame_alignment - 1);
+		if (frame_size > capacity / 2)
+		{
+			AccountLoss(header, length);
+			return false;
+		}
+
+		uint64_t position;
+		for (;;)
+		{
+			position = header->reserve_position.load(std::memory_order_acquire);
+			const uint64_t read_position = header->read_position.load(std::memory_order_acquire);
+			const uint64_t space_to_end = capacity - (position & (capacity - 1));
+			// a frame never wraps, the rest of the lap becomes a committed filler
+			const uint64_t size = space_to_end < frame_size ? space_to_end : frame_size;
+			if (position + size - read_position > capacity)
+			{
+				if (account_loss)
+					AccountLoss(header, length);
+				return false;
+			}
+			const uint64_t free = Pack(0, FreeTag(position));
+			if (size != frame_size)
+				Claim(header, position, free,
+				      Pack(static_cast<uint32_t>(size) | frame_committed_flag, padding_frame_length));
+			else if (Claim(header, position, free, Pack(static_cast<uint32_t>(frame_size), pid)))
+				break;
+		}
+
+		const auto frame = FrameAt(header, position);
+		memcpy(reinterpret_cast<char*>(frame) + sizeof(FrameHeader), payload, length);
+		frame->word.store(Pack(static_cast<uint32_t>(frame_size) | frame_committed_flag, static_cast<uint32_t>(length)),
+		                  std::memory_order_release);
+		return true;
+	}
+
+	// What the consumer needs between two ReadFrames calls.
+	struct ReaderState
+	{
+		uint64_t stalled_since_ms = 0; // 0 while the next frame is not overdue
+		uint64_t skipped_frames = 0; // claimed by a producer that exited before it committed them
+	};
+
+	constexpr uint64_t stalled_frame_timeout_ms = 1000;
+
+	// Hands every committed frame's payload to visit(const char*, size_t) in order and frees it, stops
+	// at the first frame that is not committed yet. A frame claimed by a process is_alive(pid) says has
+	// exited is skipped once it was overdue for stalled_frame_timeout_ms. Returns the frames consumed.
+	template <typename Visit, typename IsAlive>
+	size_t ReadFrames(RingHeader* header, ReaderState& state, uint64_t now_ms, Visit&& visit, IsAlive&& is_alive)
+	{
+		uint64_t read_position = header->read_position.load(std::memory_order_relaxed);
+		size_t frames = 0;
+		for (;;)
+		{
+			const auto frame = FrameAt(header, read_position);
+			const uint64_t word = frame->word.load(std::memory_order_acquire);
+			const uint32_t size = SizeOf(word);
+			if (size == 0)
+				break;
+			if (IsCommitted(word))
+			{
+				// a length that does not fit the frame is not trusted, the frame is dropped
+				if (HighOf(word) != padding_frame_length && HighOf(word) <= size - sizeof(FrameHeader))
+					visit(reinterpret_cast<const char*>(frame) + sizeof(FrameHeader), static_cast<size_t>(HighOf(word)));
+			}
+			else
+			{
+				if (state.stalled_since_ms == 0)
+					state.stalled_since_ms = now_ms;
+				if (now_ms - state.stalled_since_ms < stalled_frame_timeout_ms || is_alive(HighOf(word)))
+					break;
+				// the claimer may have died before it advanced the reservation
+				uint64_t expected = read_position;
+				header->reserve_position.compare_exchange_strong(expected, read_position + size,
+				                                                 std::memory_order_acq_rel, std::memory_order_relaxed);
+				++state.skipped_frames;
+			}
+			Release(header, read_position, size);
+			read_position += size;
+			header->read_position.store(read_position, std::memory_order_release);
+			state.stalled_since_ms = 0;
+			++frames;
+		}
+		return frames;
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+
+// The vector instruction sets the scanning and conversion code may use. SSE2 is part of every x64
+// build; AVX2 and the carry-less multiply are used where the CPU has them, the binaries themselves
+// only assume SSE2.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PROCESS_TRACER_SSE2 1
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define PROCESS_TRACER_AVX2 1
+#define PROCESS_TRACER_PCLMUL 1
+#if defined(__GNUC__) || defined(__clang__)
+#define PROCESS_TRACER_AVX2_TARGET __attribute__((target("avx2")))
+#define PROCESS_TRACER_PCLMUL_TARGET __attribute__((target("pclmul")))
+#else
+#include <intrin.h>
+#define PROCESS_TRACER_AVX2_TARGET
+#define PROCESS_TRACER_PCLMUL_TARGET
+#endif
+#endif
+
+namespace ProcessTracer::Simd
+{
+	// index of the lowest set bit, mask must not be 0
+	inline unsigned LowestBit(uint32_t mask)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return static_cast<unsigned>(__builtin_ctz(mask));
+#else
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return static_cast<unsigned>(index);
+#endif
+	}
+
+#ifdef PROCESS_TRACER_AVX2
+	inline bool DetectAvx2()
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		// also checks that the OS saves the YMM registers
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2");
+#else
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+		__cpuid(info, 1);
+		const bool os_saves_ymm = (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6;
+		__cpuidex(info, 7, 0);
+		return os_saves_ymm && (info[1] & (1 << 5));
+#endif
+	}
+
+	inline const bool avx2_supported = DetectAvx2();
+#endif
+
+#ifdef PROCESS_TRACER_PCLMUL
+	inline bool DetectPclmul()
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("pclmul");
+#else
+		int info[4];
+		__cpuid(info, 1);
+		return info[2] & (1 << 1);
+#endif
+	}
+
+	inline const bool pclmul_supported = DetectPclmul();
+#endif
+}
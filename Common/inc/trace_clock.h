@@ -0,0 +1,103 @@
+#pragma once
+#include <cstdint>
+#include <intrin.h>
+
+// Timestamps shared by every process of one trace. The tracer calibrates once and hands the
+// calibration to each injected process through the payload, so every event is stamped in
+// nanoseconds since the same epoch and events of different processes compare directly.
+namespace ProcessTracer::TraceClock
+{
+	enum class Source : uint32_t
+	{
+		Qpc = 0,
+		Tsc = 1
+	};
+
+	struct Calibration
+	{
+		Source source = Source::Qpc;
+		uint64_t epoch = 0; // counter value at time zero
+		uint64_t frequency = 0; // counter ticks per second
+	};
+
+	constexpr DWORD calibration_interval_ms = 20;
+
+	inline uint64_t ReadCounter(Source source)
+	{
+		if (source == Source::Tsc)
+			return __rdtsc();
+		LARGE_INTEGER counter;
+		QueryPerformanceCounter(&counter);
+		return static_cast<uint64_t>(counter.QuadPart);
+	}
+
+	// Measures the TSC against QPC. Without an invariant TSC, QPC itself is the clock; it is
+	// system wide as well, just slower to read.
+	inline Calibration Calibrate()
+	{
+		LARGE_INTEGER qpc_frequency;
+		QueryPerformanceFrequency(&qpc_frequency);
+
+		int cpu_info[4];
+		__cpuid(cpu_info, 0x80000000);
+		bool invariant_tsc = false;
+		if (static_cast<unsigned int>(cpu_info[0]) >= 0x80000007)
+		{
+			__cpuid(cpu_info, 0x80000007);
+			invariant_tsc = (cpu_info[3] & (1 << 8)) != 0;
+		}
+		if (!invariant_tsc)
+			return {Source::Qpc, ReadCounter(Source::Qpc), static_cast<uint64_t>(qpc_frequency.QuadPart)};
+
+		const uint64_t qpc_start = ReadCounter(Source::Qpc);
+		const uint64_t tsc_start = __rdtsc();
+		Sleep(calibration_interval_ms);
+		const uint64_t qpc_end = ReadCounter(Source::Qpc);
+		const uint64_t tsc_end = __rdtsc();
+		const uint64_t frequency = (tsc_end - tsc_start) * static_cast<uint64_t>(qpc_frequency.QuadPart) /
+			(qpc_end - qpc_start);
+		return {Source::Tsc, tsc_start, frequency};
+	}
+
+	// Turns counter values into nanoseconds since the epoch with a fixed-point multiplier.
+	// The split multiply avoids 128-bit arithmetic, which the x86 build does not have.
+	class Converter
+	{
+		Source m_source = Source::Qpc;
+		uint64_t m_epoch = 0;
+		uint64_t m_multiplier = 0;
+		uint32_t m_shift = 0;
+
+	public:
+		Converter() = default;
+
+		explicit Converter(const Calibration& calibration) : m_source(calibration.source), m_epoch(calibration.epoch)
+		{
+			if (calibration.frequency == 0)
+				return;
+			// the largest shift that keeps the multiplier below 2^32, so low * multiplier cannot overflow
+			constexpr uint64_t nanoseconds_per_second = 1000000000;
+			for (m_shift = 32; m_shift > 0; --m_shift)
+			{
+				m_multiplier = (nanoseconds_per_second << m_shift) / calibration.frequency;
+				if (m_multiplier <= UINT32_MAX)
+					break;
+			}
+		}
+
+		uint64_t ToNanoseconds(uint64_t counter) const
+		{
+			if (counter < m_epoch)
+				return 0;
+			const uint64_t delta = counter - m_epoch;
+			const uint64_t high = delta >> 32;
+			const uint64_t low = delta & UINT32_MAX;
+			return ((high * m_multiplier) << (32 - m_shift)) + ((low * m_multiplier) >> m_shift);
+		}
+
+		uint64_t Now() const
+		{
+			return ToNanoseconds(ReadCounter(m_source));
+		}
+	};
+}
@@ -0,0 +1,178 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "simd.h"
+
+// Block layout of trace files written with --mapped-output. The file stays a text file: every block
+// is a fixed-width header line followed by the bytes of the lines it holds,
+//   "#PTBLOCK1 <sequence> <payload length> <crc32 of the payload>\n", each number 8 hex digits.
+// The writer reserves the header, copies the payload and stamps the header last, so a block only counts
+// once its header parses and the CRC matches. After a crash everything up to the last complete block
+// reads back. Mirrored by TraceFileReader.cs, keep both in sync.
+namespace ProcessTracer::TraceFile
+{
+	constexpr char block_tag[] = "#PTBLOCK1 ";
+	constexpr size_t header_size = sizeof(block_tag) - 1 + 3 * 9;
+
+	namespace Detail
+	{
+		constexpr uint32_t crc_polynomial = 0xEDB88320u;
+
+		// slicing-by-8 tables of the reflected CRC-32 also used by zip, Crc32 reads words little-endian
+		constexpr std::array<std::array<uint32_t, 256>, 8> MakeCrcTables()
+		{
+			std::array<std::array<uint32_t, 256>, 8> tables = {};
+			for (uint32_t i = 0; i < 256; ++i)
+			{
+				uint32_t crc = i;
+				for (int bit = 0; bit < 8; ++bit)
+					crc = crc & 1 ? crc >> 1 ^ crc_polynomial : crc >> 1;
+				tables[0][i] = crc;
+			}
+			for (uint32_t i = 0; i < 256; ++i)
+			{
+				for (size_t table = 1; table < 8; ++table)
+					tables[table][i] = tables[table - 1][i] >> 8 ^ tables[0][tables[table - 1][i] & 0xFF];
+			}
+			return tables;
+		}
+
+		inline constexpr auto crc_tables = MakeCrcTables();
+
+		// the CRC register, not inverted, carried over length bytes eight at a time
+		inline uint32_t Crc32Table(const uint8_t* bytes, size_t length, uint32_t crc)
+		{
+			const auto& tables = crc_tables;
+			for (; length >= 8; length -= 8, bytes += 8)
+			{
+				uint32_t low;
+				uint32_t high;
+				memcpy(&low, bytes, sizeof(low));
+				memcpy(&high, bytes + 4, sizeof(high));
+				low ^= crc;
+				crc = tables[7][low & 0xFF] ^ tables[6][low >> 8 & 0xFF] ^ tables[5][low >> 16 & 0xFF] ^
+					tables[4][low >> 24] ^ tables[3][high & 0xFF] ^ tables[2][high >> 8 & 0xFF] ^
+					tables[1][high >> 16 & 0xFF] ^ tables[0][high >> 24];
+			}
+			for (; length != 0; --length, ++bytes)
+				crc = crc >> 8 ^ tables[0][(crc ^ *bytes) & 0xFF];
+			return crc;
+		}
+
+#ifdef PROCESS_TRACER_PCLMUL
+		// a.lo * k.lo ^ a.hi * k.hi ^ next: moves the 128 bits of a forward onto next
+		PROCESS_TRACER_PCLMUL_TARGET inline __m128i Fold(__m128i a, __m128i k, __m128i next)
+		{
+			return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(a, k, 0x00), _mm_clmulepi64_si128(a, k, 0x11)),
+			                     next);
+		}
+
+		PROCESS_TRACER_PCLMUL_TARGET inline __m128i Load(const uint8_t* bytes)
+		{
+			return _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+		}
+
+		// Crc32Table by folding four 16-byte lanes with the carry-less multiply, then one lane and a
+		// Barrett reduction to 32 bits, as in Intel's "Fast CRC Computation Using PCLMULQDQ". length is at
+		// least 64 and a multiple of 16. The constants are x^n mod P, bit-reflected.
+		PROCESS_TRACER_PCLMUL_TARGET inline uint32_t Crc32Pclmul(const uint8_t* bytes, size_t length, uint32_t crc)
+		{
+			const __m128i k1k2 = _mm_set_epi64x(0x1c6e41596, 0x154442bd4); // x^(4*128+32), x^(4*128-32)
+			const __m128i k3k4 = _mm_set_epi64x(0x0ccaa009e, 0x1751997d0); // x^(128+32), x^(128-32)
+			const __m128i k5 = _mm_set_epi64x(0, 0x163cd6124); // x^64
+			const __m128i poly_mu = _mm_set_epi64x(0x1f7011641, 0x1db710641); // floor(x^64 / P), P
+			const __m128i low32 = _mm_set_epi32(0, 0, 0, -1);
+
+			__m128i x1 = _mm_xor_si128(Load(bytes), _mm_cvtsi32_si128(static_cast<int>(crc)));
+			__m128i x2 = Load(bytes + 16);
+			__m128i x3 = Load(bytes + 32);
+			__m128i x4 = Load(bytes + 48);
+			for (bytes += 64, length -= 64; length >= 64; bytes += 64, length -= 64)
+			{
+				x1 = Fold(x1, k1k2, Load(bytes));
+				x2 = Fold(x2, k1k2, Load(bytes + 16));
+				x3 = Fold(x3, k1k2, Load(bytes + 32));
+				x4 = Fold(x4, k1k2, Load(bytes + 48));
+			}
+			x1 = Fold(x1, k3k4, x2);
+			x1 = Fold(x1, k3k4, x3);
+			x1 = Fold(x1, k3k4, x4);
+			for (; length >= 16; bytes += 16, length -= 16)
+				x1 = Fold(x1, k3k4, Load(bytes));
+
+			// 128 bits to 64, then to 32 with 32 zero bits appended
+			x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), _mm_clmulepi64_si128(x1, k3k4, 0x10));
+			x1 = _mm_xor_si128(_mm_srli_si128(x1, 4), _mm_clmulepi64_si128(_mm_and_si128(x1, low32), k5, 0x00));
+			__m128i quotient = _mm_clmulepi64_si128(_mm_and_si128(x1, low32), poly_mu, 0x10);
+			quotient = _mm_clmulepi64_si128(_mm_and_si128(quotient, low32), poly_mu, 0x00);
+			return static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(_mm_xor_si128(x1, quotient), 4)));
+		}
+#endif
+
+		inline bool ParseHex(const char* text, uint32_t& value)
+		{
+			value = 0;
+			for (int i = 0; i < 8; ++i)
+			{
+				const char c = text[i];
+				uint32_t digit;
+				if (c >= '0' && c <= '9')
+					digit = c - '0';
+				else if (c >= 'a' && c <= 'f')
+					digit = c - 'a' + 10;
+				else
+					return false;
+				value = value << 4 | digit;
+			}
+			return true;
+		}
+	}
+
+	inline uint32_t Crc32(const void* data, size_t length, uint32_t crc = 0)
+	{
+		auto bytes = static_cast<const uint8_t*>(data);
+		crc = ~crc;
+#ifdef PROCESS_TRACER_PCLMUL
+		if (length >= 64 && Simd::pclmul_supported)
+		{
+			const size_t folded = length & ~size_t{15};
+			crc = Detail::Crc32Pclmul(bytes, folded, crc);
+			bytes += folded;
+			length -= folded;
+		}
+#endif
+		return ~Detail::Crc32Table(bytes, length, crc);
+	}
+
+	// writes the header_size bytes of a block header, without terminator
+	inline void FormatHeader(char* out, uint32_t sequence, uint32_t length, uint32_t crc)
+	{
+		char header[header_size + 1];
+		snprintf(header, sizeof(header), "%s%08x %08x %08x\n", block_tag, static_cast<unsigned>(sequence),
+		         static_cast<unsigned>(length), static_cast<unsigned>(crc));
+		memcpy(out, header, header_size);
+	}
+
+	// False when data does not start with a block header.
+	inline bool ParseHeader(const char* data, size_t available, uint32_t& sequence, uint32_t& length, uint32_t& crc)
+	{
+		constexpr size_t tag = sizeof(block_tag) - 1;
+		return available >= header_size && memcmp(data, block_tag, tag) == 0 &&
+			Detail::ParseHex(data + tag, sequence) && data[tag + 8] == ' ' &&
+			Detail::ParseHex(data + tag + 9, length) && data[tag + 17] == ' ' &&
+			Detail::ParseHex(data + tag + 18, crc) && data[header_size - 1] == '\n';
+	}
+
+	// The payload length of the complete block at the start of data, false when there is none.
+	inline bool CheckBlock(const char* data, size_t available, uint32_t& length)
+	{
+		uint32_t sequence;
+		uint32_t crc;
+		return ParseHeader(data, available, sequence, length, crc) && available - header_size >= length &&
+			Crc32(data + header_size, length) == crc;
+	}
+}
@@ -0,0 +1,170 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "simd.h"
+
+// UTF-16 to UTF-8 conversion into caller provided buffers. Takes char16_t rather than wchar_t,
+// which is four bytes wide outside Windows, so it behaves the same on every platform.
+namespace ProcessTracer::Utf8
+{
+	// A surrogate pair is two units and four bytes, every other unit at most three bytes.
+	constexpr size_t max_bytes_per_unit = 3;
+
+	constexpr size_t MaxLength(size_t units)
+	{
+		return units * max_bytes_per_unit;
+	}
+
+	struct TranscodeResult
+	{
+		size_t read; // UTF-16 units consumed
+		size_t written; // bytes produced
+		bool valid; // false when unpaired surrogates were replaced by U+FFFD
+	};
+
+	namespace Detail
+	{
+		// Each of the copies below takes the ASCII units from start on and returns where the run ends,
+		// the vector ones stop at the first block that is not all ASCII and leave it to the next.
+		inline size_t CopyAsciiScalar(const char16_t* input, size_t count, char* output, size_t start)
+		{
+			size_t i = start;
+			for (; i < count && input[i] < 0x80; ++i)
+				output[i] = static_cast<char>(input[i]);
+			return i;
+		}
+
+#ifdef PROCESS_TRACER_SSE2
+		inline size_t CopyAsciiSse2(const char16_t* input, size_t count, char* output, size_t start)
+		{
+			size_t i = start;
+			const __m128i non_ascii = _mm_set1_epi16(static_cast<short>(0xFF80));
+			for (; i + 16 <= count; i += 16)
+			{
+				const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+				const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i + 8));
+				const __m128i bits = _mm_and_si128(_mm_or_si128(low, high), non_ascii);
+				if (_mm_movemask_epi8(_mm_cmpeq_epi16(bits, _mm_setzero_si128())) != 0xFFFF)
+					break;
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_packus_epi16(low, high));
+			}
+			return i;
+		}
+#endif
+
+#ifdef PROCESS_TRACER_AVX2
+		PROCESS_TRACER_AVX2_TARGET inline size_t CopyAsciiAvx2(const char16_t* input, size_t count, char* output,
+		                                                         size_t start)
+		{
+			size_t i = start;
+			const __m256i non_ascii = _mm256_set1_epi16(static_cast<short>(0xFF80));
+			for (; i + 32 <= count; i += 32)
+			{
+				const __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+				const __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i + 16));
+				const __m256i bits = _mm256_and_si256(_mm256_or_si256(low, high), non_ascii);
+				if (!_mm256_testz_si256(bits, bits))
+					break;
+				// packus works per 128-bit lane, the permute puts the four quarters back in order
+				const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xD8);
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), packed);
+			}
+			return i;
+		}
+#endif
+
+		// Copies the leading run of ASCII units, which is most of every path, and returns its length.
+		inline size_t CopyAscii(const char16_t* input, size_t count, char* output)
+		{
+			size_t i = 0;
+#ifdef PROCESS_TRACER_AVX2
+			if (count >= 32 && Simd::avx2_supported)
+				i = CopyAsciiAvx2(input, count, output, i);
+#endif
+#ifdef PROCESS_TRACER_SSE2
+			i = CopyAsciiSse2(input, count, output, i);
+#endif
+			return CopyAsciiScalar(input, count, output, i);
+		}
+	}
+
+	// Converts as many whole characters as fit into capacity bytes, MaxLength(count) always fits all
+	// of them. A high surrogate that ends the input counts as unpaired.
+	inline TranscodeResult FromUtf16(const char16_t* input, size_t count, char* output, size_t capacity)
+	{
+		size_t read = 0;
+		size_t written = 0;
+		bool valid = true;
+		while (read < count)
+		{
+			const size_t ascii_limit = count - read < capacity - written ? count - read : capacity - written;
+			const size_t ascii = Detail::CopyAscii(input + read, ascii_limit, output + written);
+			read += ascii;
+			written += ascii;
+			// either everything is converted or the output is full
+			if (ascii == ascii_limit)
+				break;
+
+			uint32_t code_point = input[read];
+			size_t units = 1;
+			if (code_point >= 0xD800 && code_point <= 0xDFFF)
+			{
+				if (code_point <= 0xDBFF && read + 1 < count && input[read + 1] >= 0xDC00 && input[read + 1] <= 0xDFFF)
+				{
+					code_point = 0x10000 + ((code_point - 0xD800) << 10) + (input[read + 1] - 0xDC00);
+					units = 2;
+				}
+				else
+				{
+					code_point = 0xFFFD;
+					valid = false;
+				}
+			}
+
+			char* out = output + written;
+			size_t length;
+			if (code_point < 0x800)
+			{
+				length = 2;
+				if (capacity - written < length)
+					break;
+				out[0] = static_cast<char>(0xC0 | code_point >> 6);
+				out[1] = static_cast<char>(0x80 | (code_point & 0x3F));
+			}
+			else if (code_point < 0x10000)
+			{
+				length = 3;
+				if (capacity - written < length)
+					break;
+				out[0] = static_cast<char>(0xE0 | code_point >> 12);
+				out[1] = static_cast<char>(0x80 | (code_point >> 6 & 0x3F));
+				out[2] = static_cast<char>(0x80 | (code_point & 0x3F));
+			}
+			else
+			{
+				length = 4;
+				if (capacity - written < length)
+					break;
+				out[0] = static_cast<char>(0xF0 | code_point >> 18);
+				out[1] = static_cast<char>(0x80 | (code_point >> 12 & 0x3F));
+				out[2] = static_cast<char>(0x80 | (code_point >> 6 & 0x3F));
+				out[3] = static_cast<char>(0x80 | (code_point & 0x3F));
+			}
+			read += units;
+			written += length;
+		}
+		return {read, written, valid};
+	}
+
+	// Appends the conversion of input to text, false when unpaired surrogates were replaced.
+	inline bool AppendFromUtf16(std::string& text, const char16_t* input, size_t count)
+	{
+		const size_t start = text.size();
+		text.resize(start + MaxLength(count));
+		const TranscodeResult result = FromUtf16(input, count, text.data() + start, MaxLength(count));
+		text.resize(start + result.written);
+		return result.valid;
+	}
+}
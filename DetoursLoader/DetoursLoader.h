@@ -1,6 +1,7 @@
 #pragma once
 #include "pch.h"
 #include "detours.h"
+#include "line_classifier.h"
 
 #define EXPORT __declspec(dllexport)
 
@@ -17,6 +18,18 @@ BOOL EXPORT WINAPI DetourCreateProcessWithDllWWrap(_In_opt_ LPCWSTR lpApplicatio
                                                    _Out_ LPPROCESS_INFORMATION lpProcessInformation,
                                                    _In_ DWORD nDlls,
                                                    _In_ LPCSTR* lpDllName,
-                                                   _In_ LPCSTR pipeHandle);
+                                                   _In_reads_bytes_(payloadSize) const VOID* payload,
+                                                   _In_ DWORD payloadSize);
 DWORD EXPORT WINAPI GetDetourCreateProcessError();
+VOID EXPORT WINAPI GetTraceClockCalibration(_Out_ DWORD* source, _Out_ ULONGLONG* epoch, _Out_ ULONGLONG* frequency);
+PVOID EXPORT WINAPI CreateEventCollector();
+DWORD EXPORT WINAPI CollectEvents(_In_ PVOID collector, _In_reads_bytes_(length) const BYTE* data, _In_ DWORD length,
+                                  _In_ BOOL final, _Outptr_ const char** lines,
+                                  _Outptr_ const ProcessTracer::EventRecord::LineInfo** infos,
+                                  _Out_ DWORD* line_count);
+VOID EXPORT WINAPI DestroyEventCollector(_In_ PVOID collector);
+PVOID EXPORT WINAPI CreateTraceFileWriter(_In_ LPCWSTR path);
+BOOL EXPORT WINAPI WriteTraceFile(_In_ PVOID writer, _In_reads_bytes_(length) const BYTE* data, _In_ DWORD length);
+VOID EXPORT WINAPI FlushTraceFile(_In_ PVOID writer);
+BOOL EXPORT WINAPI DestroyTraceFileWriter(_In_ PVOID writer);
 }
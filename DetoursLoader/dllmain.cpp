@@ -1,13 +1,25 @@
 ﻿#include "pch.h"
 
+#include <new>
 #include <string>
 
 #include "DetoursLoader.h"
 #include "constants.h"
+#include "event_collector.h"
+#include "trace_clock.h"
+#include "trace_file_writer.h"
 
 namespace
 {
 	DWORD create_error;
+	// shared by all collectors, see SequenceTracker
+	ProcessTracer::EventRecord::SequenceTracker g_sequences;
+
+	BOOL CALLBACK CalibrateTraceClock(PINIT_ONCE, PVOID parameter, PVOID*)
+	{
+		*static_cast<ProcessTracer::TraceClock::Calibration*>(parameter) = ProcessTracer::TraceClock::Calibrate();
+		return TRUE;
+	}
 }
 
 DWORD EXPORT WINAPI GetDetourCreateProcessError()
@@ -15,6 +27,83 @@ DWORD EXPORT WINAPI GetDetourCreateProcessError()
 	return create_error;
 }
 
+// Calibrated once per tracer, every process it injects shares the same epoch.
+VOID EXPORT WINAPI GetTraceClockCalibration(_Out_ DWORD* source, _Out_ ULONGLONG* epoch, _Out_ ULONGLONG* frequency)
+{
+	static INIT_ONCE calibration_once = INIT_ONCE_STATIC_INIT;
+	static ProcessTracer::TraceClock::Calibration calibration;
+	InitOnceExecuteOnce(&calibration_once, CalibrateTraceClock, &calibration, nullptr);
+	*source = static_cast<DWORD>(calibration.source);
+	*epoch = calibration.epoch;
+	*frequency = calibration.frequency;
+}
+
+// One collector per client stream, used by one thread at a time.
+PVOID EXPORT WINAPI CreateEventCollector()
+{
+	return new(std::nothrow) ProcessTracer::EventRecord::EventCollector(&g_sequences);
+}
+
+// Renders the complete messages at the start of data as '\n' terminated UTF-8 lines and returns the
+// bytes consumed. infos holds the bounds and kind of each line. Both stay valid until the next call on
+// the same collector.
+DWORD EXPORT WINAPI CollectEvents(_In_ PVOID collector, _In_reads_bytes_(length) const BYTE* data, _In_ DWORD length,
+                                  _In_ BOOL final, _Outptr_ const char** lines,
+                                  _Outptr_ const ProcessTracer::EventRecord::LineInfo** infos,
+                                  _Out_ DWORD* line_count)
+{
+	const auto event_collector = static_cast<ProcessTracer::EventRecord::EventCollector*>(collector);
+	const auto consumed = event_collector->Collect(reinterpret_cast<const char*>(data), length, final != FALSE);
+	*lines = event_collector->Lines().data();
+	*infos = event_collector->Infos().data();
+	*line_count = static_cast<DWORD>(event_collector->Infos().size());
+	return static_cast<DWORD>(consumed);
+}
+
+VOID EXPORT WINAPI DestroyEventCollector(_In_ PVOID collector)
+{
+	delete static_cast<ProcessTracer::EventRecord::EventCollector*>(collector);
+}
+
+// Trace file sink for --mapped-output, see trace_file_writer.h. nullptr when path cannot be opened,
+// GetLastError tells why.
+PVOID EXPORT WINAPI CreateTraceFileWriter(_In_ LPCWSTR path)
+{
+	const auto writer = new(std::nothrow) ProcessTracer::TraceFile::TraceFileWriter();
+	if (!writer)
+	{
+		SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+		return nullptr;
+	}
+	if (!writer->Open(path))
+	{
+		const DWORD error = GetLastError();
+		delete writer;
+		SetLastError(error);
+		return nullptr;
+	}
+	return writer;
+}
+
+BOOL EXPORT WINAPI WriteTraceFile(_In_ PVOID writer, _In_reads_bytes_(length) const BYTE* data, _In_ DWORD length)
+{
+	return static_cast<ProcessTracer::TraceFile::TraceFileWriter*>(writer)->Write(
+		reinterpret_cast<const char*>(data), length);
+}
+
+VOID EXPORT WINAPI FlushTraceFile(_In_ PVOID writer)
+{
+	static_cast<ProcessTracer::TraceFile::TraceFileWriter*>(writer)->Flush();
+}
+
+// closes the file, cutting off its preallocated tail, and frees the writer
+BOOL EXPORT WINAPI DestroyTraceFileWriter(_In_ PVOID writer)
+{
+	const auto trace_file_writer = static_cast<ProcessTracer::TraceFile::TraceFileWriter*>(writer);
+	const BOOL closed = trace_file_writer->Close();
+	delete trace_file_writer;
+	return closed;
+}
 
 BOOL WINAPI DetourCreateProcessWithDllWWrap(_In_opt_ LPCWSTR lpApplicationName,
                                             _Inout_opt_ LPWSTR lpCommandLine,
@@ -28,7 +117,8 @@ BOOL WINAPI DetourCreateProcessWithDllWWrap(_In_opt_ LPCWSTR lpApplicationName,
                                             _Out_ LPPROCESS_INFORMATION lpProcessInformation,
                                             _In_ DWORD nDlls,
                                             _In_ LPCSTR* lpDllName,
-                                            _In_ LPCSTR pipeHandle)
+                                            _In_reads_bytes_(payloadSize) const VOID* payload,
+                                            _In_ DWORD payloadSize)
 {
 	DWORD dwNewCreationFlag = dwCreationFlags | CREATE_SUSPENDED;
 	create_error = 0;
@@ -52,7 +142,7 @@ BOOL WINAPI DetourCreateProcessWithDllWWrap(_In_opt_ LPCWSTR lpApplicationName,
 		create_error = err;
 		return FALSE;
 	}
-	if (DetourCopyPayloadToProcess(lpProcessInformation->hProcess, GUID_PIPE_HANDLE, pipeHandle, strlen(pipeHandle) + 1)
+	if (DetourCopyPayloadToProcess(lpProcessInformation->hProcess, GUID_PIPE_HANDLE, payload, payloadSize)
 		== FALSE)
 	{
 		auto err = GetLastError();
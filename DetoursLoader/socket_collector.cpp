@@ -0,0 +1,293 @@
+#include "pch.h"
+#include "socket_collector.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+	// one read takes this much, a connection's buffer only grows for a record that does not fit
+	constexpr size_t chunk_bytes = 256 * 1024;
+	constexpr int max_events = 64;
+	// how long the sink thread sleeps when nothing arrives and no reader wakes it
+	constexpr auto idle_wait = std::chrono::milliseconds(1);
+	// how long the reader waits for the sink when the queue is full
+	constexpr auto full_wait = std::chrono::microseconds(20);
+
+	bool Watch(int epoll, int socket)
+	{
+		epoll_event event = {};
+		event.events = EPOLLIN;
+		event.data.fd = socket;
+		return epoll_ctl(epoll, EPOLL_CTL_ADD, socket, &event) == 0;
+	}
+}
+
+struct ProcessTracer::Collector::SocketCollector::Connection
+{
+	int socket;
+	std::vector<char> buffer;
+	size_t used = 0;
+	EventRecord::EventCollector collector;
+
+	Connection(int socket_fd, EventRecord::SequenceTracker* sequences)
+		: socket(socket_fd), buffer(chunk_bytes), collector(sequences)
+	{
+	}
+};
+
+ProcessTracer::Collector::SocketCollector::SocketCollector(std::string path, Sink sink, void* context)
+	: m_path(std::move(path)), m_sink(sink), m_context(context)
+{
+}
+
+ProcessTracer::Collector::SocketCollector::~SocketCollector()
+{
+	Stop();
+}
+
+bool ProcessTracer::Collector::SocketCollector::Start()
+{
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if (m_path.size() >= sizeof(address.sun_path))
+	{
+		errno = ENAMETOOLONG;
+		return false;
+	}
+	memcpy(address.sun_path, m_path.c_str(), m_path.size() + 1);
+	// a collector that did not stop cleanly leaves its socket behind
+	unlink(m_path.c_str());
+	m_listen = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	m_epoll = epoll_create1(EPOLL_CLOEXEC);
+	m_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (m_listen < 0 || m_epoll < 0 || m_wake < 0 ||
+		bind(m_listen, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+		listen(m_listen, SOMAXCONN) != 0 || !Watch(m_epoll, m_listen) || !Watch(m_epoll, m_wake))
+	{
+		const int error = errno;
+		for (const int descriptor : {m_listen, m_epoll, m_wake})
+		{
+			if (descriptor >= 0)
+				close(descriptor);
+		}
+		m_listen = m_epoll = m_wake = -1;
+		errno = error;
+		return false;
+	}
+	m_writer = std::thread([this] { Deliver(); });
+	m_reader = std::thread([this] { Read(); });
+	return true;
+}
+
+void ProcessTracer::Collector::SocketCollector::Stop()
+{
+	if (!m_reader.joinable())
+		return;
+	m_stopping.store(true, std::memory_order_relaxed);
+	const uint64_t one = 1;
+	[[maybe_unused]] const ssize_t written = write(m_wake, &one, sizeof(one));
+	m_reader.join();
+	m_writer.join();
+	close(m_listen);
+	close(m_epoll);
+	close(m_wake);
+	m_listen = m_epoll = m_wake = -1;
+	unlink(m_path.c_str());
+}
+
+ProcessTracer::Collector::SocketCollectorStats ProcessTracer::Collector::SocketCollector::Stats() const
+{
+	return {
+		m_connections.load(std::memory_order_relaxed), m_closed.load(std::memory_order_relaxed),
+		m_bytes.load(std::memory_order_relaxed), m_lines.load(std::memory_order_relaxed)
+	};
+}
+
+void ProcessTracer::Collector::SocketCollector::Read()
+{
+	epoll_event events[max_events];
+	while (!m_stopping.load(std::memory_order_relaxed))
+	{
+		const int ready = epoll_wait(m_epoll, events, max_events, -1);
+		if (ready < 0 && errno != EINTR)
+			break;
+		for (int i = 0; i < ready; ++i)
+		{
+			const int socket = events[i].data.fd;
+			if (socket == m_listen)
+				Accept();
+			else if (socket != m_wake)
+			{
+				// one read per wakeup, so a busy connection does not keep the others waiting
+				const auto connection = m_open.find(socket);
+				if (connection != m_open.end() && Receive(*connection->second) == ReadResult::End)
+					Close(socket);
+			}
+		}
+	}
+
+	// everything sent before Stop is in the socket buffers, connections still waiting to be
+	// accepted included
+	Accept();
+	while (!m_open.empty())
+	{
+		Connection& connection = *m_open.begin()->second;
+		ReadResult result;
+		while ((result = Receive(connection)) == ReadResult::Data)
+		{
+		}
+		if (result == ReadResult::Empty)
+			Collect(connection, true);
+		Close(connection.socket);
+	}
+	m_reader_done.store(true, std::memory_order_release);
+	m_idle.notify_one();
+}
+
+void ProcessTracer::Collector::SocketCollector::Accept()
+{
+	for (;;)
+	{
+		const int socket = accept4(m_listen, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (socket < 0)
+		{
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			return;
+		}
+		if (!Watch(m_epoll, socket))
+		{
+			close(socket);
+			continue;
+		}
+		m_open.emplace(socket, std::make_unique<Connection>(socket, &m_sequences));
+		m_connections.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+ProcessTracer::Collector::SocketCollector::ReadResult ProcessTracer::Collector::SocketCollector::Receive(
+	Connection& connection)
+{
+	ssize_t received;
+	do
+	{
+		received = read(connection.socket, connection.buffer.data() + connection.used,
+		                connection.buffer.size() - connection.used);
+	}
+	while (received < 0 && errno == EINTR);
+	if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		return ReadResult::Empty;
+	if (received <= 0)
+	{
+		// the producer is gone, what it left is rendered as it is
+		Collect(connection, true);
+		return ReadResult::End;
+	}
+	connection.used += static_cast<size_t>(received);
+	m_bytes.fetch_add(static_cast<uint64_t>(received), std::memory_order_relaxed);
+	Collect(connection, false);
+	return ReadResult::Data;
+}
+
+void ProcessTracer::Collector::SocketCollector::Collect(Connection& connection, bool final)
+{
+	if (connection.used == 0)
+		return;
+	size_t consumed = connection.collector.Collect(connection.buffer.data(), connection.used, final);
+	Queue(connection.collector);
+	if (consumed == 0 && connection.used == connection.buffer.size())
+	{
+		// a record larger than the buffer waits for the rest, anything else has to go now
+		if (connection.buffer.size() < EventRecord::max_record_size)
+		{
+			connection.buffer.resize(EventRecord::max_record_size);
+			return;
+		}
+		consumed = connection.collector.Collect(connection.buffer.data(), connection.used, true);
+		Queue(connection.collector);
+	}
+	connection.used -= consumed;
+	memmove(connection.buffer.data(), connection.buffer.data() + consumed, connection.used);
+}
+
+void ProcessTracer::Collector::SocketCollector::Close(int socket)
+{
+	close(socket);
+	m_open.erase(socket);
+	m_closed.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ProcessTracer::Collector::SocketCollector::Queue(const EventRecord::EventCollector& collector)
+{
+	if (collector.Infos().empty())
+		return;
+	std::string batch;
+	m_free.TryPop(batch);
+	batch.assign(collector.Lines());
+	m_lines.fetch_add(collector.Infos().size(), std::memory_order_relaxed);
+	while (!m_batches.TryPush(batch))
+	{
+		m_idle.notify_one();
+		std::this_thread::sleep_for(full_wait);
+	}
+	m_idle.notify_one();
+}
+
+void ProcessTracer::Collector::SocketCollector::Deliver()
+{
+	std::string batch;
+	for (;;)
+	{
+		// the reader queued its last batch before it was done
+		const bool done = m_reader_done.load(std::memory_order_acquire);
+		if (m_batches.TryPop(batch))
+		{
+			m_sink(m_context, batch.data(), batch.size());
+			batch.clear();
+			// the buffer is reused for a later batch, or freed when enough are waiting
+			m_free.TryPush(batch);
+			continue;
+		}
+		if (done)
+			return;
+		std::unique_lock<std::mutex> lock(m_idle_lock);
+		m_idle.wait_for(lock, idle_wait);
+	}
+}
+
+void* CreateSocketCollector(const char* path, ProcessTracer::Collector::Sink sink, void* context)
+{
+	const auto collector = new(std::nothrow) ProcessTracer::Collector::SocketCollector(path, sink, context);
+	if (!collector)
+	{
+		errno = ENOMEM;
+		return nullptr;
+	}
+	if (!collector->Start())
+	{
+		const int error = errno;
+		delete collector;
+		errno = error;
+		return nullptr;
+	}
+	return collector;
+}
+
+void GetSocketCollectorStats(void* collector, ProcessTracer::Collector::SocketCollectorStats* stats)
+{
+	*stats = static_cast<ProcessTracer::Collector::SocketCollector*>(collector)->Stats();
+}
+
+void DestroySocketCollector(void* collector)
+{
+	delete static_cast<ProcessTracer::Collector::SocketCollector*>(collector);
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "bounded_queue.h"
+#include "event_collector.h"
+
+// Receive side of UnixSocketTransport for POSIX hosts, the counterpart of the named pipe servers of
+// ProcessTracer.exe. One epoll thread accepts the connections of every traced process and reads each
+// in large chunks; an EventCollector per connection renders the complete messages of a chunk at once.
+// The rendered lines of a chunk go through a lock-free queue to a sink thread, which hands them to
+// the sink in the order they arrived on their connection. When the queue is full the reader stops
+// reading, and the producers block on their sockets instead of losing events.
+namespace ProcessTracer::Collector
+{
+	// called on the sink thread with whole '\n' terminated lines
+	using Sink = void (*)(void* context, const char* lines, size_t length);
+
+	struct SocketCollectorStats
+	{
+		uint64_t connections; // accepted so far
+		uint64_t closed; // of them, read to their end
+		uint64_t bytes; // received
+		uint64_t lines; // handed to the sink
+	};
+
+	class SocketCollector
+	{
+		static constexpr size_t queue_batches = 64;
+
+		std::string m_path;
+		Sink m_sink;
+		void* m_context;
+		int m_listen = -1;
+		int m_epoll = -1;
+		int m_wake = -1;
+		EventRecord::SequenceTracker m_sequences;
+		// rendered lines on their way to the sink, and emptied batches on their way back
+		BoundedQueue<std::string> m_batches{queue_batches};
+		BoundedQueue<std::string> m_free{queue_batches};
+		std::atomic<bool> m_stopping{false};
+		std::atomic<bool> m_reader_done{false};
+		std::atomic<uint64_t> m_connections{0};
+		std::atomic<uint64_t> m_closed{0};
+		std::atomic<uint64_t> m_bytes{0};
+		std::atomic<uint64_t> m_lines{0};
+		// the sink thread sleeps here while the queue is empty
+		std::mutex m_idle_lock;
+		std::condition_variable m_idle;
+		std::thread m_reader;
+		std::thread m_writer;
+
+		struct Connection;
+		std::unordered_map<int, std::unique_ptr<Connection>> m_open; // by socket, reader thread only
+
+		enum class ReadResult
+		{
+			Data,
+			Empty,
+			End
+		};
+
+		void Read();
+		void Deliver();
+		void Accept();
+		ReadResult Receive(Connection& connection);
+		// renders the complete messages in the buffer of connection, final renders the rest too
+		void Collect(Connection& connection, bool final);
+		void Close(int socket);
+		void Queue(const EventRecord::EventCollector& collector);
+
+	public:
+		SocketCollector(std::string path, Sink sink, void* context);
+		~SocketCollector();
+
+		SocketCollector(const SocketCollector&) = delete;
+		SocketCollector& operator=(const SocketCollector&) = delete;
+
+		// listens on the path, false with errno set when it cannot
+		bool Start();
+		// Reads what the open connections have sent so far, hands it to the sink and stops.
+		void Stop();
+		SocketCollectorStats Stats() const;
+	};
+}
+
+extern "C" {
+// nullptr with errno set when path cannot be listened on
+void* CreateSocketCollector(const char* path, ProcessTracer::Collector::Sink sink, void* context);
+void GetSocketCollectorStats(void* collector, ProcessTracer::Collector::SocketCollectorStats* stats);
+// delivers everything received so far before it returns
+void DestroySocketCollector(void* collector);
+}
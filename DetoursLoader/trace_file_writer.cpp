@@ -0,0 +1,237 @@
+#include "pch.h"
+#include "trace_file_writer.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+	// the mapped view slides over the file in steps of this size
+	constexpr uint64_t window_bytes = 16 * 1024 * 1024;
+	// the file grows by whole extents, so it is rarely remapped and stays contiguous on disk
+	constexpr uint64_t extent_bytes = 64 * 1024 * 1024;
+	// a block is completed once it holds this much, less is lost when the last one is torn
+	constexpr uint32_t max_block_bytes = 1024 * 1024;
+	// Open reads the file back from its end this much at a time
+	constexpr uint64_t scan_bytes = 1024 * 1024;
+
+	LARGE_INTEGER ToLargeInteger(uint64_t value)
+	{
+		LARGE_INTEGER result;
+		result.QuadPart = static_cast<LONGLONG>(value);
+		return result;
+	}
+
+	BOOL ReadAt(HANDLE file, uint64_t offset, char* buffer, size_t length)
+	{
+		if (!SetFilePointerEx(file, ToLargeInteger(offset), nullptr, FILE_BEGIN))
+			return FALSE;
+		while (length != 0)
+		{
+			DWORD read;
+			if (!ReadFile(file, buffer, static_cast<DWORD>(length), &read, nullptr) || read == 0)
+				return FALSE;
+			buffer += read;
+			length -= read;
+		}
+		return TRUE;
+	}
+}
+
+ProcessTracer::TraceFile::TraceFileWriter::~TraceFileWriter()
+{
+	Close();
+}
+
+BOOL ProcessTracer::TraceFile::TraceFileWriter::Open(const wchar_t* path)
+{
+	m_file = CreateFileW(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+	                     FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE)
+		return FALSE;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size) || !FindEnd(static_cast<uint64_t>(size.QuadPart)))
+	{
+		const DWORD error = GetLastError();
+		CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+		SetLastError(error);
+		return FALSE;
+	}
+	m_allocated = static_cast<uint64_t>(size.QuadPart);
+	m_flushed = m_end;
+	SYSTEM_INFO system_info;
+	GetSystemInfo(&system_info);
+	m_granularity = system_info.dwAllocationGranularity;
+	return TRUE;
+}
+
+// Sets m_end after the last intact block of the file, so the torn block and the zeroed tail a killed
+// tracer leaves behind are written over and cut off on Close. The file is read from its end, a block
+// further back is only checked when everything after it is not one. A file without blocks keeps its
+// text, without a zeroed tail.
+BOOL ProcessTracer::TraceFile::TraceFileWriter::FindEnd(uint64_t size)
+{
+	// each chunk is read with the start of the next, so a header across the boundary is seen whole
+	std::vector<char> chunk(scan_bytes + header_size);
+	std::vector<char> block;
+	bool in_zero_tail = true;
+	uint64_t text_end = 0;
+	for (uint64_t chunk_end = size; chunk_end != 0;)
+	{
+		const uint64_t chunk_start = chunk_end > scan_bytes ? chunk_end - scan_bytes : 0;
+		const size_t length = static_cast<size_t>(std::min(size, chunk_end + header_size) - chunk_start);
+		if (!ReadAt(m_file, chunk_start, chunk.data(), length))
+			return FALSE;
+		for (size_t at = static_cast<size_t>(chunk_end - chunk_start); at-- != 0;)
+		{
+			if (in_zero_tail)
+			{
+				if (chunk[at] == 0)
+					continue;
+				in_zero_tail = false;
+				text_end = chunk_start + at + 1;
+			}
+			uint32_t sequence;
+			uint32_t block_length;
+			uint32_t crc;
+			if (chunk[at] != block_tag[0] ||
+				!ParseHeader(chunk.data() + at, length - at, sequence, block_length, crc))
+				continue;
+			const uint64_t block_start = chunk_start + at;
+			if (block_length > size - block_start - header_size)
+				continue;
+			block.resize(header_size + block_length);
+			if (!ReadAt(m_file, block_start, block.data(), block.size()))
+				return FALSE;
+			if (!CheckBlock(block.data(), block.size(), block_length))
+				continue;
+			m_end = block_start + header_size + block_length;
+			m_sequence = sequence + 1;
+			return TRUE;
+		}
+		chunk_end = chunk_start;
+	}
+	m_end = text_end;
+	return TRUE;
+}
+
+// Makes [offset, offset + length) writable through m_view, growing the file when it is too short.
+BOOL ProcessTracer::TraceFile::TraceFileWriter::MapRange(uint64_t offset, uint64_t length)
+{
+	if (m_view && offset >= m_view_offset && offset + length <= m_view_offset + window_bytes)
+		return TRUE;
+	Unmap();
+	m_view_offset = offset & ~(m_granularity - 1);
+	const uint64_t view_end = m_view_offset + window_bytes;
+	if (view_end > m_allocated)
+	{
+		// a mapping cannot outgrow its size, the file is extended without one
+		if (m_mapping)
+		{
+			CloseHandle(m_mapping);
+			m_mapping = nullptr;
+		}
+		const uint64_t allocated = (view_end + extent_bytes - 1) / extent_bytes * extent_bytes;
+		if (!SetFilePointerEx(m_file, ToLargeInteger(allocated), nullptr, FILE_BEGIN) || !SetEndOfFile(m_file))
+			return FALSE;
+		m_allocated = allocated;
+	}
+	if (!m_mapping)
+	{
+		m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READWRITE, static_cast<DWORD>(m_allocated >> 32),
+		                               static_cast<DWORD>(m_allocated), nullptr);
+		if (!m_mapping)
+			return FALSE;
+	}
+	m_view = static_cast<char*>(MapViewOfFile(m_mapping, FILE_MAP_WRITE, static_cast<DWORD>(m_view_offset >> 32),
+	                                          static_cast<DWORD>(m_view_offset), window_bytes));
+	return m_view != nullptr;
+}
+
+BOOL ProcessTracer::TraceFile::TraceFileWriter::Write(const char* data, size_t length)
+{
+	if (m_file == INVALID_HANDLE_VALUE)
+		return FALSE;
+	while (length != 0)
+	{
+		if (!m_block_open)
+		{
+			// a block never crosses the view, its header is stamped through it
+			if (!MapRange(m_end, header_size + 1))
+				return FALSE;
+			m_block_open = true;
+			m_block_start = m_end;
+			m_block_length = 0;
+			m_block_crc = 0;
+			m_end += header_size;
+		}
+
+		uint64_t chunk = m_view_offset + window_bytes - m_end;
+		if (chunk > max_block_bytes - m_block_length)
+			chunk = max_block_bytes - m_block_length;
+		if (chunk > length)
+			chunk = length;
+		memcpy(m_view + (m_end - m_view_offset), data, chunk);
+		m_block_crc = Crc32(data, chunk, m_block_crc);
+		m_block_length += static_cast<uint32_t>(chunk);
+		m_end += chunk;
+		data += chunk;
+		length -= chunk;
+		if (m_block_length == max_block_bytes || m_end == m_view_offset + window_bytes)
+			CloseBlock();
+	}
+	return TRUE;
+}
+
+VOID ProcessTracer::TraceFile::TraceFileWriter::CloseBlock()
+{
+	if (!m_block_open)
+		return;
+	m_block_open = false;
+	if (m_block_length == 0)
+	{
+		// nothing to keep, give the reserved header back
+		m_end = m_block_start;
+		return;
+	}
+	FormatHeader(m_view + (m_block_start - m_view_offset), m_sequence++, m_block_length, m_block_crc);
+}
+
+VOID ProcessTracer::TraceFile::TraceFileWriter::Flush()
+{
+	CloseBlock();
+	if (!m_view || m_end <= m_flushed)
+		return;
+	// what earlier views held was written back when they were unmapped
+	const uint64_t start = std::max(m_flushed, m_view_offset);
+	if (FlushViewOfFile(m_view + (start - m_view_offset), static_cast<SIZE_T>(m_end - start)))
+		m_flushed = m_end;
+}
+
+VOID ProcessTracer::TraceFile::TraceFileWriter::Unmap()
+{
+	if (!m_view)
+		return;
+	Flush();
+	UnmapViewOfFile(m_view);
+	m_view = nullptr;
+}
+
+BOOL ProcessTracer::TraceFile::TraceFileWriter::Close()
+{
+	if (m_file == INVALID_HANDLE_VALUE)
+		return TRUE;
+	Unmap();
+	if (m_mapping)
+	{
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+	}
+	// cut off the preallocated tail
+	const BOOL truncated = SetFilePointerEx(m_file, ToLargeInteger(m_end), nullptr, FILE_BEGIN) &&
+		SetEndOfFile(m_file) && FlushFileBuffers(m_file);
+	CloseHandle(m_file);
+	m_file = INVALID_HANDLE_VALUE;
+	return truncated;
+}
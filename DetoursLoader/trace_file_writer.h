@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "trace_file.h"
+
+namespace ProcessTracer::TraceFile
+{
+	// Appends lines to a trace file through a sliding view of a file mapping. The file grows in large
+	// preallocated extents, the bytes are framed into blocks as described in trace_file.h and the unused
+	// tail is cut off on Close. Used by one thread at a time.
+	class TraceFileWriter
+	{
+		HANDLE m_file = INVALID_HANDLE_VALUE;
+		HANDLE m_mapping = nullptr;
+		char* m_view = nullptr;
+		uint64_t m_view_offset = 0;
+		uint64_t m_allocated = 0; // size of the file on disk, preallocated tail included
+		uint64_t m_end = 0; // where the next byte goes
+		uint64_t m_flushed = 0; // bytes before this are written to the file
+		uint64_t m_granularity = 64 * 1024;
+
+		bool m_block_open = false;
+		uint64_t m_block_start = 0;
+		uint32_t m_block_length = 0;
+		uint32_t m_block_crc = 0;
+		uint32_t m_sequence = 0;
+
+		BOOL FindEnd(uint64_t size);
+		BOOL MapRange(uint64_t offset, uint64_t length);
+		VOID CloseBlock();
+		VOID Unmap();
+
+	public:
+		TraceFileWriter() = default;
+		~TraceFileWriter();
+
+		TraceFileWriter(const TraceFileWriter&) = delete;
+		TraceFileWriter& operator=(const TraceFileWriter&) = delete;
+
+		// opens or creates path and appends after its last intact block, or after its text when it has none
+		BOOL Open(const wchar_t* path);
+		BOOL Write(const char* data, size_t length);
+		// completes the open block and writes the view back to the file, everything written so far
+		// survives the tracer being killed
+		VOID Flush();
+		BOOL Close();
+	};
+}
@@ -24,10 +24,58 @@ namespace ProcessTracer
             out PROCESS_INFORMATION lpProcessInformation,
             [In] uint nDlls,
             [In] IntPtr lpDllName,
-            [In] byte[] pipeHandle
+            [In] byte[] payload,
+            [In] uint payloadSize
         );
 
         [DllImport("DetoursLoader.dll", CallingConvention = CallingConvention.StdCall, CharSet = CharSet.Ansi)]
         public static extern uint GetDetourCreateProcessError();
+
+        [DllImport("DetoursLoader.dll", CallingConvention = CallingConvention.StdCall)]
+        public static extern void GetTraceClockCalibration(out uint source, out ulong epoch, out ulong frequency);
+
+        [DllImport("DetoursLoader.dll", CallingConvention = CallingConvention.StdCall)]
+        public static extern nint CreateEventCollector();
+
+        [DllImport("DetoursLoader.dll", CallingConvention = CallingConvention.StdCall)]
+        public static extern unsafe uint CollectEvents(nint collector, byte* data, uint length, bool final,
+            out byte* lines, out LineInfo* infos, out uint lineCount);
+
+        [DllImport("DetoursLoader.dll", CallingConvention = CallingConvention.StdCall)]
+        public static extern void DestroyEventCollector(nint collector);
+
+        [DllImport("DetoursLoader.dll", CallingConvention = CallingConvention.StdCall, CharSet = CharSet.Unicode,
+            SetLastError = true)]
+        public static extern nint CreateTraceFileWriter(string path);
+
+        [DllImport("DetoursLoader.dll", CallingConvention = CallingConvention.StdCall, SetLastError = true)]
+        public static extern unsafe bool WriteTraceFile(nint writer, byte* data, uint length);
+
+        [DllImport("DetoursLoader.dll", CallingConvention = CallingConvention.StdCall)]
+        public static extern void FlushTraceFile(nint writer);
+
+        [DllImport("DetoursLoader.dll", CallingConvention = CallingConvention.StdCall)]
+        public static extern bool DestroyTraceFileWriter(nint writer);
+
+        /// <summary>
+        /// Bounds and kind of one collected line, see LineInfo in Common/inc/line_classifier.h.
+        /// </summary>
+        [StructLayout(LayoutKind.Sequential)]
+        public struct LineInfo
+        {
+            // a line rendered from a numbered bulk record
+            public const ushort FLAG_BULK = 1;
+
+            public uint Offset;
+            public uint Length;
+            public LineKind Kind;
+            public uint Pid;
+            public uint SenderPid;
+            public ushort HookId;
+            public ushort Flags;
+            public uint ThreadId;
+            public uint Sequence;
+            public ulong Timestamp;
+        }
     }
 }
\ No newline at end of file
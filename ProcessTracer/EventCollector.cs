@@ -0,0 +1,47 @@
+﻿using System.Text;
+
+namespace ProcessTracer
+{
+    /// <summary>
+    /// Managed handle of the native collector in Common/inc/event_collector.h. It splits a whole receive buffer
+    /// into binary event records and text lines and renders and classifies all of them in one call, so no managed
+    /// code runs per message until the finished lines are turned into strings.
+    /// </summary>
+    public sealed class EventCollector : IDisposable
+    {
+        private nint _collector = DetoursLoader.CreateEventCollector();
+
+        public void Dispose()
+        {
+            if (_collector == 0)
+                return;
+            DetoursLoader.DestroyEventCollector(_collector);
+            _collector = 0;
+        }
+
+        /// <summary>
+        /// Adds the classified lines of the complete messages at the start of <paramref name="data" /> to
+        /// <paramref name="lines" /> and returns how many bytes they took. With <paramref name="final" /> set the
+        /// data ends the stream: a trailing text fragment counts as a line and an incomplete record is dropped.
+        /// </summary>
+        public unsafe int Collect(ReadOnlySpan<byte> data, bool final, List<ReceivedLine> lines)
+        {
+            ObjectDisposedException.ThrowIf(_collector == 0, this);
+            fixed (byte* pointer = data)
+            {
+                uint consumed = DetoursLoader.CollectEvents(_collector, pointer, (uint)data.Length, final,
+                    out byte* rendered, out DetoursLoader.LineInfo* infos, out uint lineCount);
+                for (uint i = 0; i < lineCount; i++)
+                {
+                    DetoursLoader.LineInfo info = infos[i];
+                    string text = Encoding.UTF8.GetString(rendered + info.Offset, (int)info.Length);
+                    lines.Add(new ReceivedLine(text, info.Kind, (int)info.Pid, (int)info.SenderPid, info.HookId,
+                        (int)info.ThreadId, info.Sequence, info.Timestamp,
+                        (info.Flags & DetoursLoader.LineInfo.FLAG_BULK) != 0));
+                }
+
+                return (int)consumed;
+            }
+        }
+    }
+}
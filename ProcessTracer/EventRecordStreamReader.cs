@@ -0,0 +1,57 @@
+﻿namespace ProcessTracer
+{
+    /// <summary>
+    /// Reads a client connection that carries binary event records and text lines, one rendered line at a time.
+    /// Every chunk read from the stream is rendered at once by the native collector.
+    /// </summary>
+    public sealed class EventRecordStreamReader(Stream stream) : IDisposable
+    {
+        private const int INITIAL_BUFFER_SIZE = 64 * 1024;
+
+        private readonly EventCollector _collector = new();
+        private readonly List<ReceivedLine> _lines = [];
+        private byte[] _buffer = new byte[INITIAL_BUFFER_SIZE];
+        private int _end;
+        private bool _ended;
+        private int _nextLine;
+        private int _start;
+
+        public void Dispose()
+        {
+            _collector.Dispose();
+        }
+
+        public async ValueTask<ReceivedLine?> ReadLineAsync(CancellationToken cancellationToken)
+        {
+            while (true)
+            {
+                if (_nextLine < _lines.Count)
+                    return _lines[_nextLine++];
+                if (_ended)
+                    return null;
+
+                _lines.Clear();
+                _nextLine = 0;
+                MakeRoom();
+                int read = await stream.ReadAsync(_buffer.AsMemory(_end), cancellationToken);
+                if (read == 0)
+                    _ended = true;
+                _end += read;
+                _start += _collector.Collect(_buffer.AsSpan(_start, _end - _start), _ended, _lines);
+            }
+        }
+
+        private void MakeRoom()
+        {
+            if (_start > 0)
+            {
+                _buffer.AsSpan(_start, _end - _start).CopyTo(_buffer);
+                _end -= _start;
+                _start = 0;
+            }
+
+            if (_end == _buffer.Length)
+                Array.Resize(ref _buffer, _buffer.Length * 2);
+        }
+    }
+}
@@ -0,0 +1,52 @@
+﻿using System.Collections.Concurrent;
+using System.Diagnostics;
+
+namespace ProcessTracer
+{
+    /// <summary>
+    /// Holds the exit line of a process back until the bulk lines it shipped before exiting are written. The exit
+    /// travels on a connection of its own, read on another task than the bulk lines and written by other workers, so
+    /// it would overtake them otherwise. A process that lost lines on the way gives up after <c>timeout</c>.
+    /// </summary>
+    public sealed class ExitLineGate(TimeSpan timeout)
+    {
+        private const int POLL_MS = 1;
+
+        private readonly ConcurrentDictionary<int, Sender> _senders = new();
+        private readonly long _timeoutTicks = (long)(timeout.TotalSeconds * Stopwatch.Frequency);
+
+        /// <summary>
+        /// Counts a bulk line of <paramref name="senderPid" /> as written, or as dropped for good.
+        /// </summary>
+        public void Handled(int senderPid)
+        {
+            _senders.GetOrAdd(senderPid, _ => new Sender()).Increment();
+        }
+
+        /// <summary>
+        /// Waits until <paramref name="bulkLines" /> bulk lines of <paramref name="senderPid" /> are handled, then
+        /// forgets the process, whose id may be reused.
+        /// </summary>
+        public async Task WaitAsync(int senderPid, uint bulkLines)
+        {
+            Sender sender = _senders.GetOrAdd(senderPid, _ => new Sender());
+            long deadline = Stopwatch.GetTimestamp() + _timeoutTicks;
+            // the counts wrap around together
+            while ((int)(bulkLines - sender.Handled) > 0 && Stopwatch.GetTimestamp() < deadline)
+                await Task.Delay(POLL_MS);
+            _senders.TryRemove(senderPid, out _);
+        }
+
+        private sealed class Sender
+        {
+            private int _handled;
+
+            public uint Handled => (uint)Volatile.Read(ref _handled);
+
+            public void Increment()
+            {
+                Interlocked.Increment(ref _handled);
+            }
+        }
+    }
+}
@@ -0,0 +1,111 @@
+﻿using System.IO.MemoryMappedFiles;
+
+namespace ProcessTracer
+{
+    /// <summary>
+    /// Tracer side of the control block described in Common/inc/control_block.h.
+    /// Every injected process maps it read-only and checks its hook's word on each call, so changes apply live.
+    /// </summary>
+    public sealed class HookControlBlock : IDisposable
+    {
+        private HookControlBlock(MemoryMappedFile mappedFile)
+        {
+            _mappedFile = mappedFile;
+            _accessor = mappedFile.CreateViewAccessor(0, BLOCK_SIZE);
+        }
+
+        private const uint CONTROL_MAGIC = 0x42435450;
+        private const uint CONTROL_VERSION = 1;
+        private const int MAX_HOOKS = 32;
+        private const int REPORT_REQUEST_OFFSET = 12;
+        private const int HOOKS_OFFSET = 16;
+        private const int BLOCK_SIZE = HOOKS_OFFSET + MAX_HOOKS * sizeof(uint);
+        private const uint HOOK_ENABLED = 0x80000000;
+        private const uint SAMPLE_RATE_MASK = 0x7FFFFFFF;
+
+        // section hooks are noisy and rarely needed, they start disabled
+        private static readonly string[] DisabledByDefault =
+            ["NtCreateSection", "ZwCreateSection", "NtCreateSectionEx", "NtMapViewOfSection"];
+
+        private readonly MemoryMappedViewAccessor _accessor;
+        private readonly MemoryMappedFile _mappedFile;
+
+        public void Dispose()
+        {
+            _accessor.Dispose();
+            _mappedFile.Dispose();
+        }
+
+        /// <summary>
+        /// Creates the block of the tracer with the given pid, it has to exist before any injected process starts.
+        /// </summary>
+        public static HookControlBlock Create(string tracerProcessId)
+        {
+            var block = new HookControlBlock(MemoryMappedFile.CreateNew(MapName(tracerProcessId), BLOCK_SIZE,
+                MemoryMappedFileAccess.ReadWrite));
+            block._accessor.Write(4, CONTROL_VERSION);
+            block._accessor.Write(8, (uint)HookNames.Count);
+            for (int hookId = 1; hookId < HookNames.Count; hookId++)
+            {
+                bool enabled = !DisabledByDefault.Contains(HookNames.GetName(hookId));
+                block.SetWord(hookId, enabled ? HOOK_ENABLED | 1 : 1);
+            }
+
+            // the magic goes last, a process that sees it also sees the defaults
+            block._accessor.Write(0, CONTROL_MAGIC);
+            return block;
+        }
+
+        /// <summary>
+        /// Opens the block of an already running tracer.
+        /// </summary>
+        public static HookControlBlock Open(int tracerProcessId)
+        {
+            var block = new HookControlBlock(MemoryMappedFile.OpenExisting(MapName(tracerProcessId.ToString()),
+                MemoryMappedFileRights.ReadWrite));
+            if (block._accessor.ReadUInt32(0) != CONTROL_MAGIC || block._accessor.ReadUInt32(4) != CONTROL_VERSION)
+            {
+                block.Dispose();
+                throw new InvalidDataException($"Process {tracerProcessId} has no compatible control block");
+            }
+
+            return block;
+        }
+
+        /// <summary>
+        /// Applies a spec like "NtWriteFile=0,NtCreateFile=10": 0 disables a hook, N logs one call in N.
+        /// </summary>
+        public void Apply(string spec)
+        {
+            foreach (string entry in spec.Split(',', StringSplitOptions.RemoveEmptyEntries | StringSplitOptions.TrimEntries))
+            {
+                string[] parts = entry.Split('=', 2, StringSplitOptions.TrimEntries);
+                if (parts.Length != 2 || !uint.TryParse(parts[1], out uint rate) || rate > SAMPLE_RATE_MASK)
+                    throw new ArgumentException($"Invalid hook setting '{entry}', expected <hook>=<rate>");
+                int hookId = HookNames.GetId(parts[0]);
+                if (hookId <= 0)
+                    throw new ArgumentException($"Unknown hook '{parts[0]}'");
+                SetWord(hookId, rate == 0 ? 1 : HOOK_ENABLED | rate);
+            }
+        }
+
+        /// <summary>
+        /// Asks every process traced with --hook-timing to report its hook timings, each does on its next hooked call.
+        /// </summary>
+        public void RequestReport()
+        {
+            _accessor.Write(REPORT_REQUEST_OFFSET, _accessor.ReadUInt32(REPORT_REQUEST_OFFSET) + 1);
+        }
+
+        private static string MapName(string tracerProcessId)
+        {
+            return "ProcessTracerControl:" + tracerProcessId;
+        }
+
+        private void SetWord(int hookId, uint word)
+        {
+            // aligned 32-bit stores, a hook never reads a torn word
+            _accessor.Write(HOOKS_OFFSET + hookId * sizeof(uint), word);
+        }
+    }
+}
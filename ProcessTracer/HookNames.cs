@@ -0,0 +1,43 @@
+﻿namespace ProcessTracer
+{
+    /// <summary>
+    /// Names of the hooks by EventRecord::HookId, see Common/inc/event_record.h. Keep the order in sync.
+    /// </summary>
+    public static class HookNames
+    {
+        private static readonly string[] Names =
+        [
+            "",
+            "CreateProcessInternalW",
+            "ExitProcess",
+            "CreateFileMappingW",
+            "ZwWriteFile",
+            "NtWriteFile",
+            "NtCreateFile",
+            "NtCreateUserProcess",
+            "ShellExecuteExW",
+            "NtSetInformationFile",
+            "NtCreateSection",
+            "ZwCreateSection",
+            "NtCreateSectionEx",
+            "NtMapViewOfSection",
+            "NtClose",
+            "NtDuplicateObject"
+        ];
+
+        public static int Count => Names.Length;
+
+        public static string GetName(int hookId)
+        {
+            return hookId < Names.Length ? Names[hookId] : hookId.ToString();
+        }
+
+        /// <summary>
+        /// Id of the hook with the given name, -1 when there is none.
+        /// </summary>
+        public static int GetId(string name)
+        {
+            return name.Length == 0 ? -1 : Array.IndexOf(Names, name);
+        }
+    }
+}
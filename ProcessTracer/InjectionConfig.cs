@@ -0,0 +1,102 @@
+﻿using System.Buffers.Binary;
+using System.Text;
+
+namespace ProcessTracer
+{
+    /// <summary>
+    /// Writer side of the injection payload described in Common/inc/injection_config.h.
+    /// Injected processes forward the encoded bytes unchanged to their children.
+    /// </summary>
+    public sealed class InjectionConfig
+    {
+        private const uint CONFIG_MAGIC = 0x43495450;
+        private const ushort CONFIG_VERSION = 1;
+        private const int HEADER_SIZE = 72;
+        private const uint FLAG_CAN_ELEVATE = 0x0001;
+        private const uint FLAG_AGGREGATE_WRITES = 0x0002;
+        private const uint FLAG_HOOK_TIMING = 0x0004;
+        private const uint FLAG_LATENCY_PROFILE = 0x0008;
+
+        public uint TracerProcessId { get; init; }
+        public bool CanElevate { get; init; }
+        public bool AggregateWrites { get; init; }
+        public bool HookTiming { get; init; }
+        public bool LatencyProfile { get; init; }
+        public uint LatencyThresholdUs { get; init; }
+        public uint LatencyTopFiles { get; init; }
+        public ulong HookMask { get; init; } = AllHooks;
+        public uint BatchBytes { get; init; }
+        public uint BatchLatencyMs { get; init; }
+        public uint BufferBytes { get; init; }
+        public OverflowPolicy BufferPolicy { get; init; }
+        public OverflowPolicy TransportPolicy { get; init; }
+        public uint ClockSource { get; init; }
+        public ulong ClockEpoch { get; init; }
+        public ulong ClockFrequency { get; init; }
+        public string PathFilter { get; init; } = string.Empty;
+
+        public static ulong AllHooks => (1UL << HookNames.Count) - 2;
+
+        /// <summary>
+        /// Mask of a comma separated hook list such as "NtCreateFile,NtWriteFile", every hook when the list is empty.
+        /// The injected process adds the hooks it cannot work without.
+        /// </summary>
+        public static ulong ParseHookMask(string hooks)
+        {
+            ulong mask = 0;
+            foreach (string name in hooks.Split(',',
+                         StringSplitOptions.RemoveEmptyEntries | StringSplitOptions.TrimEntries))
+            {
+                int hookId = HookNames.GetId(name);
+                if (hookId <= 0)
+                    throw new ArgumentException($"Unknown hook '{name}'");
+                mask |= 1UL << hookId;
+            }
+
+            return mask == 0 ? AllHooks : mask;
+        }
+
+        /// <summary>
+        /// Path filter rules for semicolon separated include and exclude glob lists, see ProcessTracerCore/path_filter.h for the glob syntax.
+        /// </summary>
+        public static string BuildPathFilter(string includes, string excludes)
+        {
+            StringBuilder rules = new();
+            foreach (string glob in includes.Split(';',
+                         StringSplitOptions.RemoveEmptyEntries | StringSplitOptions.TrimEntries))
+                rules.Append('+').Append(glob).Append('\n');
+            foreach (string glob in excludes.Split(';',
+                         StringSplitOptions.RemoveEmptyEntries | StringSplitOptions.TrimEntries))
+                rules.Append('-').Append(glob).Append('\n');
+            return rules.ToString();
+        }
+
+        public byte[] Encode()
+        {
+            byte[] pathFilter = Encoding.UTF8.GetBytes(PathFilter);
+            byte[] payload = new byte[HEADER_SIZE + pathFilter.Length];
+            Span<byte> header = payload;
+            uint flags = (CanElevate ? FLAG_CAN_ELEVATE : 0) | (AggregateWrites ? FLAG_AGGREGATE_WRITES : 0) |
+                         (HookTiming ? FLAG_HOOK_TIMING : 0) | (LatencyProfile ? FLAG_LATENCY_PROFILE : 0);
+            BinaryPrimitives.WriteUInt32LittleEndian(header, CONFIG_MAGIC);
+            BinaryPrimitives.WriteUInt16LittleEndian(header[4..], CONFIG_VERSION);
+            BinaryPrimitives.WriteUInt16LittleEndian(header[6..], HEADER_SIZE);
+            BinaryPrimitives.WriteUInt32LittleEndian(header[8..], TracerProcessId);
+            BinaryPrimitives.WriteUInt32LittleEndian(header[12..], flags);
+            BinaryPrimitives.WriteUInt64LittleEndian(header[16..], HookMask);
+            BinaryPrimitives.WriteUInt32LittleEndian(header[24..], BatchBytes);
+            BinaryPrimitives.WriteUInt32LittleEndian(header[28..], BatchLatencyMs);
+            BinaryPrimitives.WriteUInt32LittleEndian(header[32..], ClockSource);
+            BinaryPrimitives.WriteUInt32LittleEndian(header[36..], (uint)pathFilter.Length);
+            BinaryPrimitives.WriteUInt64LittleEndian(header[40..], ClockEpoch);
+            BinaryPrimitives.WriteUInt64LittleEndian(header[48..], ClockFrequency);
+            BinaryPrimitives.WriteUInt32LittleEndian(header[56..], LatencyThresholdUs);
+            BinaryPrimitives.WriteUInt32LittleEndian(header[60..], LatencyTopFiles);
+            BinaryPrimitives.WriteUInt32LittleEndian(header[64..], BufferBytes);
+            header[68] = (byte)BufferPolicy;
+            header[69] = (byte)TransportPolicy;
+            pathFilter.CopyTo(payload, HEADER_SIZE);
+            return payload;
+        }
+    }
+}
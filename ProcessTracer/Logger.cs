@@ -17,6 +17,13 @@ namespace ProcessTracer
             {
                 if (string.IsNullOrEmpty(output))
                     LogDelegate = LogToConsole;
+                else if (options.MappedOutput)
+                {
+                    _traceFileWriter = new TraceFileWriter(output);
+                    _traceFileFlushTimer = new Timer(_ => FlushTraceFile(), null, TRACE_FILE_FLUSH_INTERVAL_MS,
+                        TRACE_FILE_FLUSH_INTERVAL_MS);
+                    LogDelegate = LogToTraceFile;
+                }
                 else
                 {
                     _outStreamWriter = new StreamWriter(output, true);
@@ -33,7 +40,12 @@ namespace ProcessTracer
             }
         }
 
+        // longest time a line written to a mapped output waits before it survives the tracer being killed
+        private const int TRACE_FILE_FLUSH_INTERVAL_MS = 100;
+
         private readonly StreamWriter? _errorStreamWriter;
+        private readonly Timer? _traceFileFlushTimer;
+        private readonly TraceFileWriter? _traceFileWriter;
 
         private readonly StreamWriter? _outStreamWriter;
         private readonly SemaphoreSlim _writeErrorSemaphore = new(1, 1);
@@ -46,6 +58,13 @@ namespace ProcessTracer
         public async ValueTask DisposeAsync()
         {
             if (_outStreamWriter != null) await _outStreamWriter.DisposeAsync();
+            if (_traceFileFlushTimer != null) await _traceFileFlushTimer.DisposeAsync();
+            if (_traceFileWriter != null)
+            {
+                await _writeOutputSemaphore.WaitAsync(CancellationToken.None);
+                _traceFileWriter.Dispose();
+                _writeOutputSemaphore.Release();
+            }
             if (_errorStreamWriter != null) await _errorStreamWriter.DisposeAsync();
             await CastAndDispose(_writeOutputSemaphore);
             await CastAndDispose(_writeErrorSemaphore);
@@ -112,6 +131,35 @@ namespace ProcessTracer
             }
         }
 
+        private async Task LogToTraceFile(string message, CancellationToken cancellationToken)
+        {
+            await _writeOutputSemaphore.WaitAsync(CancellationToken.None);
+            try
+            {
+                _traceFileWriter!.WriteLine(message);
+            }
+            finally
+            {
+                _writeOutputSemaphore.Release();
+            }
+        }
+
+        private void FlushTraceFile()
+        {
+            _writeOutputSemaphore.Wait();
+            try
+            {
+                _traceFileWriter!.Flush();
+            }
+            catch (ObjectDisposedException)
+            {
+            }
+            finally
+            {
+                _writeOutputSemaphore.Release();
+            }
+        }
+
         private async Task ErrorToFile(string message, CancellationToken cancellationToken)
         {
             await _writeErrorSemaphore.WaitAsync(CancellationToken.None);
@@ -0,0 +1,29 @@
+﻿namespace ProcessTracer
+{
+    /// <summary>
+    /// What a full stage does with an event, see OverflowPolicy in Common/inc/injection_config.h. Keep the values in sync.
+    /// </summary>
+    public enum OverflowPolicy : byte
+    {
+        Block,
+        DropOldest,
+        DropNewest
+    }
+
+    public static class OverflowPolicies
+    {
+        /// <summary>
+        /// Policy named "block", "drop-oldest" or "drop-newest", block when the name is empty.
+        /// </summary>
+        public static OverflowPolicy Parse(string name)
+        {
+            return name.Trim().ToLowerInvariant() switch
+            {
+                "" or "block" => OverflowPolicy.Block,
+                "drop-oldest" => OverflowPolicy.DropOldest,
+                "drop-newest" => OverflowPolicy.DropNewest,
+                _ => throw new ArgumentException($"Unknown overflow policy '{name}'")
+            };
+        }
+    }
+}
@@ -17,9 +17,18 @@ namespace ProcessTracer
             _currentProcessIdString = Process.GetCurrentProcess().Id.ToString();
             _hookInfoListenPipeName = "ProcessTracerPipe:" + _currentProcessIdString;
             _stopRequestMappedFileName = $"Local\\ProcessTracerMapFile:{_currentProcessIdString}";
+            // injected processes map the event ring when they attach, so it has to exist before any of them starts
+            _eventReader = new SharedMemoryEventReader("ProcessTracerEvents:" + _currentProcessIdString,
+                SharedMemoryEventReader.CapacityFor(options.TransportBudget));
+            _hookControl = HookControlBlock.Create(_currentProcessIdString);
+            _hookControl.Apply(options.HookSettings);
         }
 
+        private const int DEFAULT_REORDER_LINES = 65536;
+
         private readonly string _currentProcessIdString;
+        private readonly SharedMemoryEventReader _eventReader;
+        private readonly HookControlBlock _hookControl;
         private readonly string _hookInfoListenPipeName;
         private readonly Logger _logger;
         private readonly RunOptions _options;
@@ -29,6 +38,8 @@ namespace ProcessTracer
 
         public async ValueTask DisposeAsync()
         {
+            _eventReader.Dispose();
+            _hookControl.Dispose();
             await _logger.DisposeAsync();
         }
 
@@ -71,6 +82,16 @@ namespace ProcessTracer
             };
         }
 
+        private ReorderWindow? CreateReorderWindow()
+        {
+            if (_options.ReorderWindow == 0)
+                return null;
+            int capacity = _options.ReorderLines == 0
+                ? DEFAULT_REORDER_LINES
+                : (int)Math.Min(_options.ReorderLines, int.MaxValue);
+            return new ReorderWindow(TimeSpan.FromMilliseconds(_options.ReorderWindow), capacity);
+        }
+
         private Task<MonitoringTasks> StartMonitoringTasks(MonitoringContext context)
         {
             var messageProcessor = new MessageProcessor(this, context);
@@ -79,7 +100,10 @@ namespace ProcessTracer
                 _hookInfoListenPipeName,
                 _logger,
                 messageProcessor.ProcessMessage,
-                context.CancellationTokenSource.Token);
+                context.CancellationTokenSource.Token,
+                _eventReader,
+                new QueueBudget(_options.QueueBudget, OverflowPolicies.Parse(_options.QueuePolicy)),
+                CreateReorderWindow());
 
             var memoryMonitor = new MemoryMappedFileMonitor(_stopRequestMappedFileName, _logger, context);
             Task stopSignalTask = memoryMonitor.StartMonitoring();
@@ -236,32 +260,38 @@ namespace ProcessTracer
             }
         }
 
+        /// <summary>
+        /// Acts on the control lines. The native collector has already classified every line and parsed the process id
+        /// it names, see Common/inc/line_classifier.h.
+        /// </summary>
         private sealed class MessageProcessor(ProcessMonitor monitor, MonitoringContext context)
         {
-            private const string SHELL_EXECUTE_START_HOOK = "[Hook] ShellExecuteExW [Info] Start HookShellExecuteW";
-            private const string SHELL_EXECUTE_ERROR_HOOK = "[Hook] ShellExecuteExW [Info] Error HookShellExecuteW";
-            private const string PERMISSION_REQUEST = "[Info] Permission Request";
-
-            private const string CREATE_PROCESS_HOOK_PREFIX =
-                "[Hook] CreateProcessInternalW Process created successfully with PID: ";
-
-            private const string EXIT_PROCESS_HOOK_PREFIX = "[Hook] ExitProcess ";
-            private const string CHILD_PROCESS_PREFIX = "[ChildProcess] ";
-
-            public async Task<bool> ProcessMessage(string line)
+            public async Task<bool> ProcessMessage(ReceivedLine line)
             {
-                if (line == "[CloseApp]")
-                    return await HandleCloseApp();
-
-                if (line.StartsWith(CHILD_PROCESS_PREFIX))
-                    return HandleChildProcess(line);
-
-                int firstSpaceIndex = line.IndexOf(' ');
-                if (firstSpaceIndex == -1)
-                    return true;
+                switch (line.Kind)
+                {
+                    case LineKind.CloseApp:
+                        return await HandleCloseApp();
+                    case LineKind.ChildProcess:
+                        return HandleChildProcess(line.Pid);
+                    case LineKind.ShellExecuteStart:
+                        context.WaitChild = true;
+                        break;
+                    case LineKind.ShellExecuteError:
+                        context.WaitChild = false;
+                        break;
+                    case LineKind.PermissionRequest:
+                        await context.NeedAdminCancellationTokenSource.CancelAsync();
+                        break;
+                    case LineKind.ProcessCreated when line.Pid != 0:
+                        monitor.AddProcessToMonitor(line.Pid);
+                        break;
+                    case LineKind.ProcessExited when line.Pid != 0:
+                        monitor.RemoveProcessFromMonitor(line.Pid);
+                        break;
+                }
 
-                string checkLine = line.Substring(firstSpaceIndex + 1);
-                return await ProcessLogMessage(checkLine);
+                return true;
             }
 
             private async Task<bool> HandleCloseApp()
@@ -271,11 +301,10 @@ namespace ProcessTracer
                 return true;
             }
 
-            private bool HandleChildProcess(string line)
+            private bool HandleChildProcess(int childPid)
             {
                 context.WaitChild = false;
-                string childPidString = line.Substring(CHILD_PROCESS_PREFIX.Length);
-                if (int.TryParse(childPidString, out int childPid))
+                if (childPid != 0)
                 {
                     Program.ChildPid = childPid;
                     monitor.AddProcessToMonitor(childPid);
@@ -283,55 +312,6 @@ namespace ProcessTracer
 
                 return true;
             }
-
-            private async Task<bool> ProcessLogMessage(string checkLine)
-            {
-                if (checkLine == SHELL_EXECUTE_START_HOOK)
-                {
-                    context.WaitChild = true;
-                }
-                else if (checkLine == SHELL_EXECUTE_ERROR_HOOK)
-                {
-                    context.WaitChild = false;
-                }
-                else if (checkLine == PERMISSION_REQUEST)
-                {
-                    await context.NeedAdminCancellationTokenSource.CancelAsync();
-                }
-                else if (checkLine.StartsWith(CREATE_PROCESS_HOOK_PREFIX))
-                {
-                    HandleCreateProcess(checkLine);
-                }
-                else if (checkLine.StartsWith(EXIT_PROCESS_HOOK_PREFIX))
-                {
-                    HandleExitProcess(checkLine);
-                }
-
-                return true;
-            }
-
-            private void HandleCreateProcess(string checkLine)
-            {
-                string pidString = checkLine.Substring(CREATE_PROCESS_HOOK_PREFIX.Length);
-                if (int.TryParse(pidString, out int newProcId))
-                {
-                    monitor.AddProcessToMonitor(newProcId);
-                }
-            }
-
-            private void HandleExitProcess(string checkLine)
-            {
-                string exitInfoString = checkLine.Substring(EXIT_PROCESS_HOOK_PREFIX.Length);
-                int spaceIndex = exitInfoString.IndexOf(' ');
-                if (spaceIndex > 0)
-                {
-                    string pidString = exitInfoString.Substring(0, spaceIndex);
-                    if (int.TryParse(pidString, out int pid))
-                    {
-                        monitor.RemoveProcessFromMonitor(pid);
-                    }
-                }
-            }
         }
 
         private sealed class MemoryMappedFileMonitor(string fileName, Logger logger, MonitoringContext context)
@@ -403,8 +383,29 @@ namespace ProcessTracer
         {
             public bool CreateProcess(out PROCESS_INFORMATION processInfo)
             {
-                byte[] pipeHandle =
-                    Encoding.Default.GetBytes(currentProcessId + " " + (Program.CanElevate() ? 0 : 1) + "\0");
+                // every injected process stamps its events against the same calibrated clock
+                DetoursLoader.GetTraceClockCalibration(out uint clockSource, out ulong clockEpoch,
+                    out ulong clockFrequency);
+                byte[] payload = new InjectionConfig
+                {
+                    TracerProcessId = uint.Parse(currentProcessId),
+                    CanElevate = Program.CanElevate(),
+                    AggregateWrites = options.AggregateWrites,
+                    HookTiming = options.HookTiming,
+                    LatencyProfile = options.LatencyProfile,
+                    LatencyThresholdUs = options.SlowThreshold,
+                    LatencyTopFiles = options.TopFiles,
+                    HookMask = InjectionConfig.ParseHookMask(options.AttachHooks),
+                    PathFilter = InjectionConfig.BuildPathFilter(options.IncludePaths, options.ExcludePaths),
+                    BatchBytes = options.BatchSize,
+                    BatchLatencyMs = options.BatchLatency,
+                    BufferBytes = options.BufferBudget * 1024,
+                    BufferPolicy = OverflowPolicies.Parse(options.BufferPolicy),
+                    TransportPolicy = OverflowPolicies.Parse(options.TransportPolicy),
+                    ClockSource = clockSource,
+                    ClockEpoch = clockEpoch,
+                    ClockFrequency = clockFrequency
+                }.Encode();
 
                 var si = new STARTUPINFOW
                 {
@@ -425,12 +426,12 @@ namespace ProcessTracer
                     Win32.CreationFlag.CREATE_SUSPENDED | Win32.CreationFlag.CREATE_DEFAULT_ERROR_MODE;
 
                 return ExecuteProcessCreation(appNameBytes, commandLineBytes, dllPath, creationFlags, ref si,
-                    out processInfo, pipeHandle);
+                    out processInfo, payload);
             }
 
             private static bool ExecuteProcessCreation(byte[] appNameBytes, byte[] commandLineBytes, string dllPath,
                 Win32.CreationFlag creationFlags, ref STARTUPINFOW si, out PROCESS_INFORMATION processInfo,
-                byte[] pipeHandle)
+                byte[] payload)
             {
                 IntPtr strPtr = IntPtr.Zero;
                 IntPtr dllArray = IntPtr.Zero;
@@ -447,7 +448,7 @@ namespace ProcessTracer
                     return DetoursLoader.DetourCreateProcessWithDllWWrap(
                         appNameBytes, commandLineBytes, IntPtr.Zero, IntPtr.Zero,
                         true, (uint)creationFlags, IntPtr.Zero, null,
-                        ref si, out processInfo, 1, dllArray, pipeHandle);
+                        ref si, out processInfo, 1, dllArray, payload, (uint)payload.Length);
                 }
                 finally
                 {
@@ -67,6 +67,18 @@ namespace ProcessTracer
 
         private static void StartMonitor(RunOptions options)
         {
+            if (options.Control != 0)
+            {
+                ApplyHookSettings(options);
+                return;
+            }
+
+            if (!string.IsNullOrEmpty(options.RecoverFile))
+            {
+                RecoverTraceFile(options);
+                return;
+            }
+
             var validator = new OptionsValidator();
             if (!validator.ValidateOptions(options))
                 return;
@@ -92,6 +104,25 @@ namespace ProcessTracer
             }
         }
 
+        private static void ApplyHookSettings(RunOptions options)
+        {
+            using HookControlBlock controlBlock = HookControlBlock.Open(options.Control);
+            controlBlock.Apply(options.HookSettings);
+            if (options.ReportTiming)
+                controlBlock.RequestReport();
+            Console.WriteLine($@"Hook settings applied to process {options.Control}");
+        }
+
+        private static void RecoverTraceFile(RunOptions options)
+        {
+            using Stream output = string.IsNullOrEmpty(options.OutputFile)
+                ? Console.OpenStandardOutput()
+                : new FileStream(options.OutputFile, FileMode.CreateNew, FileAccess.Write);
+            TraceFileReader.RecoveryResult result = TraceFileReader.Recover(options.RecoverFile, output);
+            Console.Error.WriteLine(
+                $@"Recovered {result.Bytes} bytes in {result.Blocks} blocks, skipped {result.SkippedBytes} bytes");
+        }
+
         private static void ExecuteElevatedWorkflow(ApplicationContext context)
         {
             var elevationHandler = new ElevationHandler(context, _OriginalArgs);
@@ -272,15 +303,15 @@ namespace ProcessTracer
                     cts.Token);
             }
 
-            private Task<bool> ProcessPipeMessage(string line)
+            private Task<bool> ProcessPipeMessage(ReceivedLine line)
             {
-                if (line == "[CloseApp]")
+                if (line.Kind == LineKind.CloseApp)
                 {
                     HandleCloseAppMessage();
                 }
-                else if (line.StartsWith("[ChildProcess] "))
+                else if (line.Kind == LineKind.ChildProcess && line.Pid != 0)
                 {
-                    HandleChildProcessMessage(line);
+                    ChildPid = line.Pid;
                 }
 
                 return Task.FromResult(true);
@@ -292,16 +323,6 @@ namespace ProcessTracer
                 stopSignalWriter.WriteStopSignal(ChildPid);
             }
 
-            private static void HandleChildProcessMessage(string line)
-            {
-                const string prefix = "[ChildProcess] ";
-                string childPidString = line.Substring(prefix.Length);
-                if (int.TryParse(childPidString, out int childPid))
-                {
-                    ChildPid = childPid;
-                }
-            }
-
             private static void RunElevated(string[] args)
             {
                 var processStarter = new ElevatedProcessStarter();
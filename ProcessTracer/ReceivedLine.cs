@@ -0,0 +1,37 @@
+﻿namespace ProcessTracer
+{
+    /// <summary>
+    /// Kind of a received line, see Common/inc/line_classifier.h. Keep the values in sync.
+    /// </summary>
+    public enum LineKind : uint
+    {
+        Other,
+        CloseApp,
+        ChildProcess,
+        ShellExecuteStart,
+        ShellExecuteError,
+        PermissionRequest,
+        ProcessCreated,
+        ProcessExited,
+        Loss
+    }
+
+    /// <summary>
+    /// A line rendered by the native collector. <see cref="Pid" /> is the process a ChildProcess, ProcessCreated or
+    /// ProcessExited line names, 0 when it is missing or malformed. <see cref="SenderPid" />, <see cref="HookId" />,
+    /// <see cref="ThreadId" /> and <see cref="Timestamp" /> come from the record the line was rendered from,
+    /// <see cref="Sequence" /> is the thread's number for it; all are 0 for text lines. <see cref="Bulk" /> marks the
+    /// lines of numbered bulk records, and <see cref="Sequence" /> of a ProcessExited line is how many of them the
+    /// process shipped before it exited.
+    /// </summary>
+    public readonly record struct ReceivedLine(
+        string Text,
+        LineKind Kind,
+        int Pid,
+        int SenderPid = 0,
+        int HookId = 0,
+        int ThreadId = 0,
+        uint Sequence = 0,
+        ulong Timestamp = 0,
+        bool Bulk = false);
+}
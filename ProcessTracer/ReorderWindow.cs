@@ -0,0 +1,98 @@
+﻿using System.Diagnostics;
+
+namespace ProcessTracer
+{
+    /// <summary>
+    /// Holds received lines for a bounded time and hands them out ordered by the trace clock, merging the streams of
+    /// every traced thread. A line waits at most <c>latency</c>, or less once <c>capacity</c> lines are held; a line
+    /// that arrives after lines with a later timestamp went out is written next and counted as late, so the output
+    /// stays in order.
+    /// </summary>
+    public sealed class ReorderWindow(TimeSpan latency, int capacity)
+    {
+        // lines in merge order, the head is the next one to write
+        private readonly PriorityQueue<Entry, MergeKey> _lines = new();
+        private readonly object _lock = new();
+        // the same lines in arrival order, to find the one that waited longest
+        private readonly Queue<Entry> _arrivals = new();
+        private readonly long _latencyTicks = (long)(latency.TotalSeconds * Stopwatch.Frequency);
+        private long _arrivalCount;
+        private ulong _newestTimestamp;
+        private ulong _writtenTimestamp;
+
+        public long LateLines { get; private set; }
+
+        public void Add(ReceivedLine line)
+        {
+            lock (_lock)
+            {
+                // text lines carry no timestamp, they go where the trace is now
+                ulong timestamp = line.Timestamp != 0 ? line.Timestamp : _newestTimestamp;
+                if (timestamp < _writtenTimestamp)
+                {
+                    timestamp = _writtenTimestamp;
+                    LateLines++;
+                }
+
+                if (timestamp > _newestTimestamp)
+                    _newestTimestamp = timestamp;
+
+                var entry = new Entry(line.Text, Stopwatch.GetTimestamp() + _latencyTicks);
+                _lines.Enqueue(entry, new MergeKey(timestamp, line.SenderPid, line.ThreadId, line.Sequence,
+                    _arrivalCount++));
+                _arrivals.Enqueue(entry);
+            }
+        }
+
+        /// <summary>
+        /// Appends the lines due now to <paramref name="output" /> in order, every line when <paramref name="all" />
+        /// is set.
+        /// </summary>
+        public void TakeDue(List<string> output, bool all = false)
+        {
+            lock (_lock)
+            {
+                long now = Stopwatch.GetTimestamp();
+                while (_lines.Count > 0 && (all || _lines.Count > capacity || OldestDueTicks() <= now))
+                {
+                    _lines.TryDequeue(out Entry? entry, out MergeKey key);
+                    entry!.Taken = true;
+                    _writtenTimestamp = key.Timestamp;
+                    output.Add(entry.Text);
+                }
+            }
+        }
+
+        private long OldestDueTicks()
+        {
+            while (_arrivals.Peek().Taken)
+                _arrivals.Dequeue();
+            return _arrivals.Peek().DueTicks;
+        }
+
+        private sealed class Entry(string text, long dueTicks)
+        {
+            public string Text { get; } = text;
+            public long DueTicks { get; } = dueTicks;
+            public bool Taken { get; set; }
+        }
+
+        // A total order, which the heap needs: timestamp first, then the thread, so that its own numbering orders
+        // its lines of the same timestamp, and arrival order last, which also keeps lines without a number in order.
+        private readonly record struct MergeKey(ulong Timestamp, int SenderPid, int ThreadId, uint Sequence, long Arrival)
+            : IComparable<MergeKey>
+        {
+            public int CompareTo(MergeKey other)
+            {
+                int result = Timestamp.CompareTo(other.Timestamp);
+                if (result == 0)
+                    result = SenderPid.CompareTo(other.SenderPid);
+                if (result == 0)
+                    result = ThreadId.CompareTo(other.ThreadId);
+                if (result == 0)
+                    result = Sequence.CompareTo(other.Sequence);
+                return result != 0 ? result : Arrival.CompareTo(other.Arrival);
+            }
+        }
+    }
+}
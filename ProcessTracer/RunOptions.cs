@@ -25,6 +25,16 @@ namespace ProcessTracer
         [UsedImplicitly]
         public string OutputErrorFilePath { get; set; } = string.Empty;
 
+        [Option("mapped-output", Required = false,
+            HelpText = "Write --output through a preallocated, memory-mapped file framed into checksummed blocks, readable with --recover after a crash")]
+        [UsedImplicitly]
+        public bool MappedOutput { get; set; }
+
+        [Option("recover", Required = false,
+            HelpText = "Print the intact lines of a trace file written with --mapped-output, or write them to --output, and exit")]
+        [UsedImplicitly]
+        public string RecoverFile { get; set; } = string.Empty;
+
         [Option("hide", Required = false, HelpText = "Hide console window")]
         [UsedImplicitly]
         public bool HideConsole { get; set; }
@@ -36,5 +46,110 @@ namespace ProcessTracer
         [Option("parent", Required = false, HelpText = "The parent ProcessTracer process (PID) will receive messages, which will then be forwarded to the parent process.")]
         [UsedImplicitly]
         public int Parent { get; set; }
+
+        [Option("batch-size", Required = false, Default = 0u,
+            HelpText = "Bytes of queued events after which a traced process ships them, 0 uses the default (16384)")]
+        [UsedImplicitly]
+        public uint BatchSize { get; set; }
+
+        [Option("batch-latency", Required = false, Default = 0u,
+            HelpText = "Longest time in milliseconds an event waits in a traced process, 0 uses the default (5); process start, exit and elevation events never wait")]
+        [UsedImplicitly]
+        public uint BatchLatency { get; set; }
+
+        [Option("buffer-budget", Required = false, Default = 0u,
+            HelpText = "Kilobytes of events each thread of a traced process may queue, 0 uses the default (64)")]
+        [UsedImplicitly]
+        public uint BufferBudget { get; set; }
+
+        [Option("buffer-policy", Required = false,
+            HelpText = "What a thread does when its queue is full: block (default), drop-oldest or drop-newest")]
+        [UsedImplicitly]
+        public string BufferPolicy { get; set; } = string.Empty;
+
+        [Option("transport-budget", Required = false, Default = 0u,
+            HelpText = "Kilobytes of the event ring shared with traced processes, rounded up to a power of two, at least 256; 0 uses the default (8192)")]
+        [UsedImplicitly]
+        public uint TransportBudget { get; set; }
+
+        [Option("transport-policy", Required = false,
+            HelpText = "What a traced process does when the event ring is full: block (default, at most one second) or drop-newest; drop-oldest drops newest as well")]
+        [UsedImplicitly]
+        public string TransportPolicy { get; set; } = string.Empty;
+
+        [Option("queue-budget", Required = false, Default = 0u,
+            HelpText = "Received lines the tracer may hold before they are written, 0 means unbounded; process start, exit and error lines are never dropped")]
+        [UsedImplicitly]
+        public uint QueueBudget { get; set; }
+
+        [Option("queue-policy", Required = false,
+            HelpText = "What the tracer does when --queue-budget lines are waiting: block (default), drop-oldest or drop-newest")]
+        [UsedImplicitly]
+        public string QueuePolicy { get; set; } = string.Empty;
+
+        [Option("reorder-window", Required = false, Default = 0u,
+            HelpText = "Milliseconds received events are held to write them in timestamp order across processes and threads, 0 writes them as they arrive")]
+        [UsedImplicitly]
+        public uint ReorderWindow { get; set; }
+
+        [Option("reorder-lines", Required = false, Default = 0u,
+            HelpText = "With --reorder-window, lines held at most before the oldest go out early, 0 uses the default (65536)")]
+        [UsedImplicitly]
+        public uint ReorderLines { get; set; }
+
+        [Option("aggregate-writes", Required = false,
+            HelpText = "Report one summary per file handle when it is closed instead of every write")]
+        [UsedImplicitly]
+        public bool AggregateWrites { get; set; }
+
+        [Option("hook-timing", Required = false,
+            HelpText = "Measure the time every hook spends in tracer code and in the real function, reported when a process exits")]
+        [UsedImplicitly]
+        public bool HookTiming { get; set; }
+
+        [Option("latency-profile", Required = false,
+            HelpText = "Report only file calls slower than --slow-threshold, plus per-file latency percentiles when a process exits")]
+        [UsedImplicitly]
+        public bool LatencyProfile { get; set; }
+
+        [Option("slow-threshold", Required = false, Default = 0u,
+            HelpText = "With --latency-profile, microseconds after which a call is reported on its own, 0 uses the default (10000)")]
+        [UsedImplicitly]
+        public uint SlowThreshold { get; set; }
+
+        [Option("top-files", Required = false, Default = 0u,
+            HelpText = "With --latency-profile, number of slowest files reported per process, 0 uses the default (10)")]
+        [UsedImplicitly]
+        public uint TopFiles { get; set; }
+
+        [Option("attach", Required = false,
+            HelpText = "Comma separated functions to detour, e.g. \"NtCreateFile,NtWriteFile\"; all when not set")]
+        [UsedImplicitly]
+        public string AttachHooks { get; set; } = string.Empty;
+
+        [Option("include", Required = false,
+            HelpText = "Semicolon separated path globs to report, e.g. \"C:/out/**\"; every path when not set")]
+        [UsedImplicitly]
+        public string IncludePaths { get; set; } = string.Empty;
+
+        [Option("exclude", Required = false,
+            HelpText = "Semicolon separated path globs never to report, e.g. \"**/*.tmp;**/obj/**\"")]
+        [UsedImplicitly]
+        public string ExcludePaths { get; set; } = string.Empty;
+
+        [Option("hooks", Required = false,
+            HelpText = "Hook logging settings such as \"NtWriteFile=0,NtCreateFile=10\": 0 disables a hook, N logs one call in N")]
+        [UsedImplicitly]
+        public string HookSettings { get; set; } = string.Empty;
+
+        [Option("control", Required = false,
+            HelpText = "Apply --hooks to the already running ProcessTracer with this PID and exit")]
+        [UsedImplicitly]
+        public int Control { get; set; }
+
+        [Option("report-timing", Required = false,
+            HelpText = "With --control, ask every process traced with --hook-timing for its timing report now")]
+        [UsedImplicitly]
+        public bool ReportTiming { get; set; }
     }
 }
\ No newline at end of file
@@ -0,0 +1,233 @@
+﻿using System.ComponentModel;
+using System.Diagnostics;
+using System.IO.MemoryMappedFiles;
+
+namespace ProcessTracer
+{
+    /// <summary>
+    /// Collector side of the shared-memory event ring described in Common/inc/shm_ring.h.
+    /// Injected processes claim frames with one CAS each, this reader consumes them in order without a
+    /// syscall per event.
+    /// </summary>
+    public sealed class SharedMemoryEventReader : IDisposable
+    {
+        public SharedMemoryEventReader(string name, long capacity = DEFAULT_CAPACITY)
+        {
+            _capacity = capacity;
+            _mappedFile = MemoryMappedFile.CreateNew(name, HEADER_SIZE + capacity, MemoryMappedFileAccess.ReadWrite);
+            _accessor = _mappedFile.CreateViewAccessor();
+            _base = AcquireBasePointer(_accessor);
+            InitializeHeader();
+        }
+
+        private const uint RING_MAGIC = 0x52545450;
+        private const uint RING_VERSION = 2;
+        private const int HEADER_SIZE = 256;
+        private const int VERSION_OFFSET = 4;
+        private const int CAPACITY_OFFSET = 8;
+        private const int RESERVE_POSITION_OFFSET = 64;
+        private const int READ_POSITION_OFFSET = 128;
+        private const int DROPPED_FRAMES_OFFSET = 192;
+        private const int DROPPED_BYTES_OFFSET = 200;
+        private const int FRAME_HEADER_SIZE = 8;
+        private const uint FRAME_COMMITTED_FLAG = 0x80000000;
+        private const uint PADDING_FRAME_LENGTH = 0xFFFFFFFF;
+        private const long DEFAULT_CAPACITY = 8 * 1024 * 1024;
+        private const long MIN_CAPACITY = 256 * 1024;
+        private const int IDLE_DELAY_MS = 1;
+
+        // A producer killed between claiming and committing a frame must not block the ring forever.
+        private static readonly long StalledFrameTimeoutTicks = TimeSpan.FromSeconds(1).Ticks;
+
+        private readonly MemoryMappedViewAccessor _accessor;
+        private readonly EventCollector _collector = new();
+        private readonly nint _base;
+        private readonly long _capacity;
+        private readonly MemoryMappedFile _mappedFile;
+        private ulong _reportedDroppedFrames;
+        private ulong _skippedFrames;
+
+        public void Dispose()
+        {
+            _accessor.SafeMemoryMappedViewHandle.ReleasePointer();
+            _accessor.Dispose();
+            _mappedFile.Dispose();
+            _collector.Dispose();
+        }
+
+        /// <summary>
+        /// Ring capacity for a budget in kilobytes: the default for 0, otherwise rounded up to a power of two of at
+        /// least 256 KB.
+        /// </summary>
+        public static long CapacityFor(uint budgetKilobytes)
+        {
+            if (budgetKilobytes == 0)
+                return DEFAULT_CAPACITY;
+            long capacity = MIN_CAPACITY;
+            while (capacity < budgetKilobytes * 1024L)
+                capacity <<= 1;
+            return capacity;
+        }
+
+        private static unsafe nint AcquireBasePointer(MemoryMappedViewAccessor accessor)
+        {
+            byte* pointer = null;
+            accessor.SafeMemoryMappedViewHandle.AcquirePointer(ref pointer);
+            return (nint)(pointer + accessor.PointerOffset);
+        }
+
+        private unsafe void InitializeHeader()
+        {
+            byte* header = (byte*)_base;
+            *(uint*)(header + VERSION_OFFSET) = RING_VERSION;
+            *(ulong*)(header + CAPACITY_OFFSET) = (ulong)_capacity;
+            Release(0, (ulong)_capacity, 0);
+            // injected processes only map a ring whose magic is set, publish it last
+            Volatile.Write(ref *(uint*)header, RING_MAGIC);
+        }
+
+        public async Task RunAsync(Func<ReceivedLine, Task<bool>> receiveLineCallback, Action<string> reportError,
+            CancellationToken cancellationToken)
+        {
+            var lines = new List<ReceivedLine>();
+            long stalledSinceTicks = 0;
+            while (!cancellationToken.IsCancellationRequested)
+            {
+                lines.Clear();
+                int frameCount = ReadFrames(lines, ref stalledSinceTicks);
+                foreach (ReceivedLine line in lines)
+                {
+                    if (!await receiveLineCallback(line))
+                        return;
+                }
+
+                ReportLostFrames(reportError);
+                if (frameCount > 0)
+                    continue;
+
+                try
+                {
+                    await Task.Delay(IDLE_DELAY_MS, cancellationToken);
+                }
+                catch (OperationCanceledException)
+                {
+                    break;
+                }
+            }
+
+            // frames committed before the processes exited are still owed to the output
+            lines.Clear();
+            ReadFrames(lines, ref stalledSinceTicks);
+            foreach (ReceivedLine line in lines)
+            {
+                if (!await receiveLineCallback(line))
+                    return;
+            }
+
+            ReportLostFrames(reportError);
+        }
+
+        private unsafe int ReadFrames(List<ReceivedLine> lines, ref long stalledSinceTicks)
+        {
+            byte* header = (byte*)_base;
+            byte* data = header + HEADER_SIZE;
+            ref ulong reservePositionRef = ref *(ulong*)(header + RESERVE_POSITION_OFFSET);
+            ref ulong readPositionRef = ref *(ulong*)(header + READ_POSITION_OFFSET);
+            ulong readPosition = Volatile.Read(ref readPositionRef);
+            int frameCount = 0;
+            while (true)
+            {
+                byte* frame = data + (long)(readPosition & (ulong)(_capacity - 1));
+                ulong word = Volatile.Read(ref *(ulong*)frame);
+                uint frameSize = (uint)word & ~FRAME_COMMITTED_FLAG;
+                uint high = (uint)(word >> 32);
+                if (frameSize == 0)
+                    break;
+                if (((uint)word & FRAME_COMMITTED_FLAG) == 0)
+                {
+                    // claimed, high is the producer; a live one may just be slow
+                    if (!IsStalled(ref stalledSinceTicks) || IsProcessAlive((int)high))
+                        break;
+                    // the claimer may have died before it advanced the reservation
+                    Interlocked.CompareExchange(ref reservePositionRef, readPosition + frameSize, readPosition);
+                    _skippedFrames++;
+                }
+                else if (high != PADDING_FRAME_LENGTH && high <= frameSize - FRAME_HEADER_SIZE)
+                {
+                    _collector.Collect(new ReadOnlySpan<byte>(frame + FRAME_HEADER_SIZE, (int)high), true, lines);
+                }
+
+                Release(readPosition, frameSize, (ulong)_capacity);
+                readPosition += frameSize;
+                Volatile.Write(ref readPositionRef, readPosition);
+                stalledSinceTicks = 0;
+                frameCount++;
+            }
+
+            return frameCount;
+        }
+
+        /// <summary>
+        /// Turns every header word in [position, position + length) into a free word, tagged with the position lap
+        /// bytes on that it is free for.
+        /// </summary>
+        private unsafe void Release(ulong position, ulong length, ulong lap)
+        {
+            byte* data = (byte*)_base + HEADER_SIZE;
+            ulong mask = (ulong)(_capacity - 1);
+            for (ulong offset = 0; offset < length; offset += FRAME_HEADER_SIZE)
+            {
+                ulong freeFor = position + offset + lap;
+                *(ulong*)(data + (long)((position + offset) & mask)) = (ulong)(uint)(freeFor / FRAME_HEADER_SIZE) << 32;
+            }
+        }
+
+        private static bool IsProcessAlive(int processId)
+        {
+            try
+            {
+                using var process = Process.GetProcessById(processId);
+                return !process.HasExited;
+            }
+            catch (ArgumentException)
+            {
+                return false;
+            }
+            catch (InvalidOperationException)
+            {
+                return false;
+            }
+            catch (Win32Exception)
+            {
+                // not ours to inspect, assume it is still writing
+                return true;
+            }
+        }
+
+        private static bool IsStalled(ref long stalledSinceTicks)
+        {
+            long now = DateTime.UtcNow.Ticks;
+            if (stalledSinceTicks == 0)
+            {
+                stalledSinceTicks = now;
+                return false;
+            }
+
+            return now - stalledSinceTicks > StalledFrameTimeoutTicks;
+        }
+
+        private unsafe void ReportLostFrames(Action<string> reportError)
+        {
+            byte* header = (byte*)_base;
+            ulong droppedFrames = Volatile.Read(ref *(ulong*)(header + DROPPED_FRAMES_OFFSET)) + _skippedFrames;
+            if (droppedFrames == _reportedDroppedFrames)
+                return;
+
+            ulong droppedBytes = Volatile.Read(ref *(ulong*)(header + DROPPED_BYTES_OFFSET));
+            reportError(
+                $"Shared memory event ring overflow: {droppedFrames - _reportedDroppedFrames} frames lost " +
+                $"({droppedFrames} frames, {droppedBytes} bytes in total)");
+            _reportedDroppedFrames = droppedFrames;
+        }
+    }
+}
@@ -4,14 +4,21 @@ namespace ProcessTracer
 {
     public static class TaskExecutor
     {
+        private const int REORDER_POLL_MS = 1;
+        // as long as an exiting process waits for its bulk lines to be read
+        private const int EXIT_LINE_TIMEOUT_MS = 1000;
+
         private static async Task RunPipeServerInstanceAsync(string pipeName, TaskManager taskManager,
-            Func<string, Task<bool>> receiveLineCallback, CancellationToken cancellationToken)
+            Func<ReceivedLine, Task<bool>> receiveLineCallback, ReorderWindow? reorderWindow,
+            ExitLineGate exitLineGate, CancellationToken cancellationToken)
         {
+            var clientTasks = new List<Task>();
             while (!cancellationToken.IsCancellationRequested)
             {
+                NamedPipeServerStream? pipeServer = null;
                 try
                 {
-                    await using var pipeServer = new NamedPipeServerStream(
+                    pipeServer = new NamedPipeServerStream(
                         pipeName,
                         PipeDirection.In,
                         NamedPipeServerStream.MaxAllowedServerInstances,
@@ -21,11 +28,44 @@ namespace ProcessTracer
 
                     await pipeServer.WaitForConnectionAsync(cancellationToken);
 
-                    using var reader = new StreamReader(pipeServer);
+                    // Injected processes keep their connection open until they exit, so serve each client
+                    // on its own task and go straight back to listening for the next one.
+                    clientTasks.RemoveAll(task => task.IsCompleted);
+                    clientTasks.Add(ReceiveFromClientAsync(pipeServer, taskManager, receiveLineCallback,
+                        reorderWindow, exitLineGate, cancellationToken));
+                    pipeServer = null;
+                }
+                catch (OperationCanceledException)
+                {
+                    break;
+                }
+                catch (Exception)
+                {
+                    await Task.Delay(100, CancellationToken.None);
+                }
+                finally
+                {
+                    if (pipeServer != null)
+                        await pipeServer.DisposeAsync();
+                }
+            }
+
+            await Task.WhenAll(clientTasks);
+        }
+
+        private static async Task ReceiveFromClientAsync(NamedPipeServerStream pipeServer, TaskManager taskManager,
+            Func<ReceivedLine, Task<bool>> receiveLineCallback, ReorderWindow? reorderWindow,
+            ExitLineGate exitLineGate, CancellationToken cancellationToken)
+        {
+            await using (pipeServer)
+            {
+                try
+                {
+                    using var reader = new EventRecordStreamReader(pipeServer);
                     while (await reader.ReadLineAsync(cancellationToken) is { } line)
                     {
-                        taskManager.EnqueueTask("Log", "Received: " + line);
-                        if (!await receiveLineCallback(line))
+                        if (!await ReceiveLineAsync(line, taskManager, receiveLineCallback, reorderWindow,
+                                exitLineGate))
                         {
                             return;
                         }
@@ -33,21 +73,91 @@ namespace ProcessTracer
                 }
                 catch (OperationCanceledException)
                 {
-                    break;
                 }
-                catch (Exception)
+                catch (IOException)
+                {
+                }
+            }
+        }
+
+        private static async Task<bool> ReceiveLineAsync(ReceivedLine line, TaskManager taskManager,
+            Func<ReceivedLine, Task<bool>> receiveLineCallback, ReorderWindow? reorderWindow,
+            ExitLineGate exitLineGate)
+        {
+            // neither written nor acted on before the lines the process sent ahead of it
+            if (line.Kind == LineKind.ProcessExited && line.SenderPid != 0)
+                await exitLineGate.WaitAsync(line.SenderPid, line.Sequence);
+
+            var taskMessage = new TaskMessage
+            {
+                TaskName = "Log",
+                LogMessage = "Received: " + line.Text,
+                SenderPid = line.SenderPid,
+                HookId = line.HookId,
+                Bulk = line.Bulk
+            };
+            if (reorderWindow != null)
+            {
+                reorderWindow.Add(line);
+                // the window orders the exit after every line added before it
+                if (line.Bulk)
+                    exitLineGate.Handled(line.SenderPid);
+            }
+            // the lines the tracer acts on are never dropped
+            else if (line.Kind == LineKind.Other)
+            {
+                await taskManager.EnqueueDroppableTaskAsync(taskMessage);
+            }
+            else
+            {
+                taskManager.EnqueueTask(taskMessage);
+            }
+
+            return await receiveLineCallback(line);
+        }
+
+        // the only writer of received lines while a reorder window is used, so they stay in its order
+        private static async Task WriteOrderedLinesAsync(ReorderWindow reorderWindow, Logger logger,
+            CancellationToken stopToken)
+        {
+            var lines = new List<string>();
+            while (true)
+            {
+                bool stopping = stopToken.IsCancellationRequested;
+                lines.Clear();
+                reorderWindow.TakeDue(lines, stopping);
+                foreach (string line in lines)
+                    await logger.LogAsync("Received: " + line, CancellationToken.None);
+                if (stopping)
+                    return;
+
+                try
+                {
+                    await Task.Delay(REORDER_POLL_MS, stopToken);
+                }
+                catch (OperationCanceledException)
                 {
-                    await Task.Delay(100, CancellationToken.None);
                 }
             }
         }
 
         public static async Task StartNamedPipeReceiveTaskAsync(string pipeName, Logger logger,
-            Func<string, Task<bool>> receiveLineCallback, CancellationToken cancellationToken)
+            Func<ReceivedLine, Task<bool>> receiveLineCallback, CancellationToken cancellationToken,
+            SharedMemoryEventReader? eventReader = null, QueueBudget queueBudget = default,
+            ReorderWindow? reorderWindow = null)
         {
             int threadCount = Environment.ProcessorCount;
             var tasks = new List<Task>(threadCount);
-            TaskManager taskManager = new();
+            var exitLineGate = new ExitLineGate(TimeSpan.FromMilliseconds(EXIT_LINE_TIMEOUT_MS));
+            TaskManager taskManager = new(queueBudget, msg =>
+            {
+                if (msg.Bulk)
+                    exitLineGate.Handled(msg.SenderPid);
+            });
+            using var writerStop = new CancellationTokenSource();
+            Task orderedWriterTask = reorderWindow != null
+                ? WriteOrderedLinesAsync(reorderWindow, logger, writerStop.Token)
+                : Task.CompletedTask;
             taskManager.StartTaskExecutor(threadCount, (msg, token) =>
             {
                 return msg.TaskName switch
@@ -61,7 +171,20 @@ namespace ProcessTracer
             {
                 tasks.Add(Task.Factory
                     .StartNew(
-                        () => RunPipeServerInstanceAsync(pipeName, taskManager, receiveLineCallback, cancellationToken),
+                        () => RunPipeServerInstanceAsync(pipeName, taskManager, receiveLineCallback, reorderWindow,
+                            exitLineGate, cancellationToken),
+                        TaskCreationOptions.LongRunning).Unwrap());
+            }
+
+            if (eventReader != null)
+            {
+                tasks.Add(Task.Factory
+                    .StartNew(
+                        () => eventReader.RunAsync(
+                            line => ReceiveLineAsync(line, taskManager, receiveLineCallback, reorderWindow,
+                                exitLineGate),
+                            message => taskManager.EnqueueTask("Error", message),
+                            cancellationToken),
                         TaskCreationOptions.LongRunning).Unwrap());
             }
 
@@ -74,7 +197,19 @@ namespace ProcessTracer
             }
             finally
             {
+                // every reader is done, whatever the window still holds goes out now
+                await writerStop.CancelAsync();
+                await orderedWriterTask;
+                if (reorderWindow?.LateLines > 0)
+                {
+                    await logger.LogErrorAsync(
+                        $"Reorder window: {reorderWindow.LateLines} lines arrived after later ones were written " +
+                        "and were written late", CancellationToken.None);
+                }
+
                 await taskManager.StopTaskExecutor(true);
+                foreach (string lossReport in taskManager.GetLossReport())
+                    await logger.LogErrorAsync(lossReport, CancellationToken.None);
             }
         }
     }
@@ -7,11 +7,46 @@ namespace ProcessTracer
         public string TaskName { get; init; } = string.Empty;
         public string LogMessage { get; init; } = string.Empty;
         public int RetryCount { get; init; }
+
+        /// <summary>
+        /// Counts against the queue budget and may be dropped once it is used up.
+        /// </summary>
+        public bool Droppable { get; init; }
+
+        public int SenderPid { get; init; }
+        public int HookId { get; init; }
+
+        /// <summary>
+        /// The line of a numbered bulk record, see <see cref="ExitLineGate" />.
+        /// </summary>
+        public bool Bulk { get; init; }
     }
 
+    /// <summary>
+    /// How many droppable messages may wait for a worker, 0 for no limit, and what happens to the next one.
+    /// </summary>
+    public readonly record struct QueueBudget(uint Lines, OverflowPolicy Policy);
+
     public class TaskManager : IAsyncDisposable
     {
-        private readonly BlockingCollection<TaskMessage> _taskQueue = new(new ConcurrentQueue<TaskMessage>());
+        /// <param name="budget">the queue budget of droppable messages</param>
+        /// <param name="handled">called once per message that was executed or lost for good, on the worker or the
+        /// thread that dropped it</param>
+        public TaskManager(QueueBudget budget = default, Action<TaskMessage>? handled = null)
+        {
+            _budget = budget;
+            _handled = handled;
+            if (budget.Lines != 0)
+                _budgetSlots = new SemaphoreSlim((int)Math.Min(budget.Lines, int.MaxValue));
+        }
+
+        private readonly QueueBudget _budget;
+        private readonly SemaphoreSlim? _budgetSlots;
+        private readonly Action<TaskMessage>? _handled;
+        // droppable messages oldest first, only kept for OverflowPolicy.DropOldest
+        private readonly ConcurrentQueue<QueuedTask> _droppableTasks = new();
+        private readonly ConcurrentDictionary<(int SenderPid, int HookId), long> _lostTasks = new();
+        private readonly BlockingCollection<QueuedTask> _taskQueue = new(new ConcurrentQueue<QueuedTask>());
         private CancellationTokenSource _cancellationTokenSource = new();
 
         private Task? _executorTask;
@@ -30,11 +65,18 @@ namespace ProcessTracer
             {
                 tasks.Add(Task.Factory.StartNew(async () =>
                 {
-                    foreach (TaskMessage taskMessage in _taskQueue.GetConsumingEnumerable(cancellationToken))
+                    foreach (QueuedTask queuedTask in _taskQueue.GetConsumingEnumerable(cancellationToken))
                     {
+                        // dropped to make room for a newer message
+                        if (!queuedTask.TryTake())
+                            continue;
+                        TaskMessage taskMessage = queuedTask.Message;
+                        if (taskMessage.Droppable)
+                            ReleaseBudgetSlot();
                         try
                         {
                             await task(taskMessage, cancellationToken);
+                            _handled?.Invoke(taskMessage);
                         }
                         catch (OperationCanceledException)
                         {
@@ -45,11 +87,16 @@ namespace ProcessTracer
                             int retryCount = taskMessage.RetryCount;
                             if (retryCount < 3)
                             {
-                                EnqueueTask(taskMessage with
+                                // a worker must never wait for its own queue
+                                RetryTask(taskMessage with
                                 {
                                     RetryCount = retryCount + 1
                                 });
                             }
+                            else
+                            {
+                                CountLoss(taskMessage);
+                            }
                         }
                     }
                 }, TaskCreationOptions.LongRunning).Unwrap());
@@ -81,11 +128,25 @@ namespace ProcessTracer
             _cancellationTokenSource.Dispose();
         }
 
-        private void EnqueueTask(TaskMessage taskMessage)
+        public void EnqueueTask(TaskMessage taskMessage)
         {
             if (_taskQueue.IsAddingCompleted)
                 return;
-            _taskQueue.Add(taskMessage);
+            var queuedTask = new QueuedTask(taskMessage);
+            if (taskMessage.Droppable && _budget.Policy == OverflowPolicy.DropOldest && _budgetSlots != null)
+                _droppableTasks.Enqueue(queuedTask);
+            _taskQueue.Add(queuedTask);
+        }
+
+        private void RetryTask(TaskMessage taskMessage)
+        {
+            if (taskMessage.Droppable && _budgetSlots?.Wait(0) == false)
+            {
+                CountLoss(taskMessage);
+                return;
+            }
+
+            EnqueueTask(taskMessage);
         }
 
         public void EnqueueTask(string taskName, string logMessage)
@@ -97,10 +158,87 @@ namespace ProcessTracer
             });
         }
 
+        /// <summary>
+        /// Queues a droppable message within the queue budget. Under <see cref="OverflowPolicy.Block" /> this waits
+        /// until a worker makes room, which in turn holds back the traced processes.
+        /// </summary>
+        public async Task EnqueueDroppableTaskAsync(TaskMessage taskMessage)
+        {
+            taskMessage = taskMessage with { Droppable = true };
+            if (_budgetSlots != null && !_budgetSlots.Wait(0))
+            {
+                switch (_budget.Policy)
+                {
+                    case OverflowPolicy.Block:
+                        try
+                        {
+                            await _budgetSlots.WaitAsync(_cancellationTokenSource.Token);
+                        }
+                        catch (OperationCanceledException)
+                        {
+                            CountLoss(taskMessage);
+                            return;
+                        }
+
+                        break;
+                    // the dropped message hands its slot over
+                    case OverflowPolicy.DropOldest when DropOldestTask():
+                        break;
+                    default:
+                        CountLoss(taskMessage);
+                        return;
+                }
+            }
+
+            EnqueueTask(taskMessage);
+        }
+
+        private bool DropOldestTask()
+        {
+            while (_droppableTasks.TryDequeue(out QueuedTask? oldest))
+            {
+                if (!oldest.TryTake())
+                    continue;
+                CountLoss(oldest.Message);
+                return true;
+            }
+
+            return false;
+        }
+
+        private void ReleaseBudgetSlot()
+        {
+            _budgetSlots!.Release();
+            // forget the messages workers already took, so the list stays about as long as the queue
+            while (_droppableTasks.TryPeek(out QueuedTask? oldest) && oldest.Taken)
+                _droppableTasks.TryDequeue(out _);
+        }
+
+        private void CountLoss(TaskMessage taskMessage)
+        {
+            _lostTasks.AddOrUpdate((taskMessage.SenderPid, taskMessage.HookId), 1, (_, lost) => lost + 1);
+            _handled?.Invoke(taskMessage);
+        }
+
+        /// <summary>
+        /// One line per process and hook whose messages were dropped, in the format of the injected processes' loss
+        /// reports. Meant for after <see cref="StopTaskExecutor" />.
+        /// </summary>
+        public IEnumerable<string> GetLossReport()
+        {
+            foreach (((int senderPid, int hookId), long lost) in _lostTasks)
+            {
+                string hook = hookId == 0 ? string.Empty : HookNames.GetName(hookId) + " ";
+                yield return $"pid:{senderPid} [Loss] {hook}[Stage] collector, [Lost] {lost}";
+            }
+        }
+
         public async ValueTask DisposeAsync()
         {
             await CastAndDispose(_taskQueue);
             await CastAndDispose(_cancellationTokenSource);
+            if (_budgetSlots != null)
+                await CastAndDispose(_budgetSlots);
             if (_executorTask != null)
                 await CastAndDispose(_executorTask);
 
@@ -114,5 +252,20 @@ namespace ProcessTracer
                     resource.Dispose();
             }
         }
+
+        private sealed class QueuedTask(TaskMessage message)
+        {
+            private int _taken;
+
+            public TaskMessage Message { get; } = message;
+
+            public bool Taken => Volatile.Read(ref _taken) != 0;
+
+            // a worker and a drop may race for the message, only the first one gets it
+            public bool TryTake()
+            {
+                return Interlocked.Exchange(ref _taken, 1) == 0;
+            }
+        }
     }
 }
\ No newline at end of file
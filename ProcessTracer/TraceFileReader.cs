@@ -0,0 +1,140 @@
+﻿using System.IO.MemoryMappedFiles;
+
+namespace ProcessTracer
+{
+    /// <summary>
+    /// Reads back a trace file written with --mapped-output, see Common/inc/trace_file.h for the block layout. Only
+    /// blocks whose header parses and whose checksum matches are copied; torn blocks, the zeroed tail a killed tracer
+    /// leaves behind and text that is not framed at all are skipped up to the next block header.
+    /// </summary>
+    public static class TraceFileReader
+    {
+        private const int HEADER_SIZE = 37;
+        private const uint CRC_POLYNOMIAL = 0xEDB88320;
+        private static readonly byte[] BlockTag = "#PTBLOCK1 "u8.ToArray();
+        private static readonly uint[] CrcTable = CreateCrcTable();
+
+        public readonly record struct RecoveryResult(long Blocks, long Bytes, long SkippedBytes);
+
+        /// <summary>
+        /// Copies the payload of every intact block of <paramref name="path" /> to <paramref name="output" />.
+        /// </summary>
+        public static unsafe RecoveryResult Recover(string path, Stream output)
+        {
+            long length = new FileInfo(path).Length;
+            if (length == 0)
+                return new RecoveryResult(0, 0, 0);
+
+            using var mappedFile = MemoryMappedFile.CreateFromFile(path, FileMode.Open, null, 0,
+                MemoryMappedFileAccess.Read);
+            using MemoryMappedViewAccessor accessor = mappedFile.CreateViewAccessor(0, 0, MemoryMappedFileAccess.Read);
+            byte* data = null;
+            accessor.SafeMemoryMappedViewHandle.AcquirePointer(ref data);
+            try
+            {
+                data += accessor.PointerOffset;
+                long blocks = 0;
+                long bytes = 0;
+                long skipped = 0;
+                long position = 0;
+                while (position < length)
+                {
+                    if (TryReadBlock(data + position, length - position, out int payloadLength))
+                    {
+                        output.Write(new ReadOnlySpan<byte>(data + position + HEADER_SIZE, payloadLength));
+                        blocks++;
+                        bytes += payloadLength;
+                        position += HEADER_SIZE + payloadLength;
+                        continue;
+                    }
+
+                    long next = FindNextTag(data, position + 1, length);
+                    skipped += next - position;
+                    position = next;
+                }
+
+                return new RecoveryResult(blocks, bytes, skipped);
+            }
+            finally
+            {
+                accessor.SafeMemoryMappedViewHandle.ReleasePointer();
+            }
+        }
+
+        private static unsafe bool TryReadBlock(byte* data, long available, out int payloadLength)
+        {
+            payloadLength = 0;
+            if (available < HEADER_SIZE)
+                return false;
+            var header = new ReadOnlySpan<byte>(data, HEADER_SIZE);
+            int tag = BlockTag.Length;
+            if (!header.StartsWith(BlockTag) || header[tag + 8] != ' ' || header[tag + 17] != ' ' ||
+                header[HEADER_SIZE - 1] != '\n' ||
+                !TryParseHex(header.Slice(tag + 9, 8), out uint length) ||
+                !TryParseHex(header.Slice(tag + 18, 8), out uint crc) ||
+                !TryParseHex(header.Slice(tag, 8), out _) ||
+                length > available - HEADER_SIZE || length > int.MaxValue)
+                return false;
+            if (Crc32(new ReadOnlySpan<byte>(data + HEADER_SIZE, (int)length)) != crc)
+                return false;
+            payloadLength = (int)length;
+            return true;
+        }
+
+        private static unsafe long FindNextTag(byte* data, long position, long length)
+        {
+            const int searchChunk = 1024 * 1024;
+            while (position < length)
+            {
+                int chunk = (int)Math.Min(searchChunk + BlockTag.Length, length - position);
+                int index = new ReadOnlySpan<byte>(data + position, chunk).IndexOf(BlockTag);
+                if (index >= 0)
+                    return position + index;
+                position += Math.Max(chunk - BlockTag.Length + 1, 1);
+            }
+
+            return length;
+        }
+
+        // lowercase hex only, as the writer formats it
+        private static bool TryParseHex(ReadOnlySpan<byte> text, out uint value)
+        {
+            value = 0;
+            foreach (byte c in text)
+            {
+                uint digit;
+                if (c is >= (byte)'0' and <= (byte)'9')
+                    digit = (uint)(c - '0');
+                else if (c is >= (byte)'a' and <= (byte)'f')
+                    digit = (uint)(c - 'a' + 10);
+                else
+                    return false;
+                value = value << 4 | digit;
+            }
+
+            return true;
+        }
+
+        private static uint[] CreateCrcTable()
+        {
+            var table = new uint[256];
+            for (uint i = 0; i < table.Length; i++)
+            {
+                uint crc = i;
+                for (int bit = 0; bit < 8; bit++)
+                    crc = (crc & 1) != 0 ? crc >> 1 ^ CRC_POLYNOMIAL : crc >> 1;
+                table[i] = crc;
+            }
+
+            return table;
+        }
+
+        private static uint Crc32(ReadOnlySpan<byte> data)
+        {
+            uint crc = ~0u;
+            foreach (byte b in data)
+                crc = crc >> 8 ^ CrcTable[(crc ^ b) & 0xFF];
+            return ~crc;
+        }
+    }
+}
@@ -0,0 +1,83 @@
+﻿using System.ComponentModel;
+using System.Runtime.InteropServices;
+using System.Text;
+
+namespace ProcessTracer
+{
+    /// <summary>
+    /// Managed handle of the native trace file sink in DetoursLoader/trace_file_writer.h. Lines are encoded into a
+    /// buffer and handed over in large writes; the native side copies them into a mapped, preallocated file framed
+    /// into checksummed blocks (Common/inc/trace_file.h). Not thread-safe.
+    /// </summary>
+    public sealed class TraceFileWriter : IDisposable
+    {
+        public TraceFileWriter(string path)
+        {
+            _writer = DetoursLoader.CreateTraceFileWriter(Path.GetFullPath(path));
+            if (_writer == 0)
+                throw new Win32Exception(Marshal.GetLastWin32Error(), $"Can't open trace file {path}");
+        }
+
+        private const int BUFFER_SIZE = 256 * 1024;
+
+        private readonly byte[] _buffer = new byte[BUFFER_SIZE];
+        private int _buffered;
+        private nint _writer;
+
+        public void Dispose()
+        {
+            if (_writer == 0)
+                return;
+            WriteBuffer();
+            DetoursLoader.DestroyTraceFileWriter(_writer);
+            _writer = 0;
+        }
+
+        public void WriteLine(string line)
+        {
+            ObjectDisposedException.ThrowIf(_writer == 0, this);
+            int length = Encoding.UTF8.GetMaxByteCount(line.Length) + 1;
+            if (length > _buffer.Length - _buffered)
+            {
+                WriteBuffer();
+                // only a line longer than the buffer is sized exactly
+                if (length > _buffer.Length)
+                {
+                    byte[] bytes = Encoding.UTF8.GetBytes(line + "\n");
+                    Write(bytes, bytes.Length);
+                    return;
+                }
+            }
+
+            _buffered += Encoding.UTF8.GetBytes(line, _buffer.AsSpan(_buffered));
+            _buffer[_buffered++] = (byte)'\n';
+        }
+
+        /// <summary>
+        /// Completes the current block, the lines written so far survive the tracer being killed.
+        /// </summary>
+        public void Flush()
+        {
+            ObjectDisposedException.ThrowIf(_writer == 0, this);
+            WriteBuffer();
+            DetoursLoader.FlushTraceFile(_writer);
+        }
+
+        private void WriteBuffer()
+        {
+            Write(_buffer, _buffered);
+            _buffered = 0;
+        }
+
+        private unsafe void Write(byte[] bytes, int length)
+        {
+            if (length == 0)
+                return;
+            fixed (byte* pointer = bytes)
+            {
+                if (!DetoursLoader.WriteTraceFile(_writer, pointer, (uint)length))
+                    throw new Win32Exception(Marshal.GetLastWin32Error(), "Can't write trace file");
+            }
+        }
+    }
+}
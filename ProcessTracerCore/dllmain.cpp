@@ -3,10 +3,17 @@
 #include "detours.h"
 #include <strsafe.h>
 #include "constants.h"
+#include "event_pipeline.h"
+#include "hook_control.h"
 #include "hook_func.h"
 #include "hook_info.h"
+#include "hook_timing.h"
+#include "injection_config.h"
+#include "latency_profile.h"
 #include "logger.h"
 #include "origin.h"
+#include "path_filter.h"
+#include "tracer_scope.h"
 #include "utils.h"
 
 
@@ -19,11 +26,42 @@ EXTERN_C extern PVOID __imp_NtCreateSectionEx;
 EXTERN_C extern PVOID __imp_NtMapViewOfSection;
 EXTERN_C extern PVOID __imp_NtCreateUserProcess;
 EXTERN_C extern PVOID __imp_NtSetInformationFile;
+EXTERN_C extern PVOID __imp_NtClose;
+EXTERN_C extern PVOID __imp_NtDuplicateObject;
 
 namespace
 {
 	DWORD oldProtect = 0;
 
+	using ProcessTracer::EventRecord::HookId;
+
+	struct DetouredFunction
+	{
+		HookId hook_id;
+		PVOID* target;
+		PVOID detour;
+	};
+
+	// Every function the DLL can detour, DetoursAttach patches the ones the payload selected.
+	// NOLINTBEGIN
+	const DetouredFunction detoured_functions[] = {
+		{HookId::CreateProcessInternalW, &(PVOID&)RealCreateProcessInternalW, HookCreateProcessInternalW},
+		{HookId::ExitProcess, &(PVOID&)RealExitProcess, HookExitProcess},
+		{HookId::ShellExecuteExW, &(PVOID&)RealShellExecuteExW, HookShellExecuteExW},
+		{HookId::NtWriteFile, &__imp_NtWriteFile, HookNtWriteFile},
+		{HookId::ZwWriteFile, &__imp_ZwWriteFile, HookZwWriteFile},
+		{HookId::NtCreateSection, &__imp_NtCreateSection, HookNtCreateSection},
+		{HookId::NtCreateFile, &__imp_NtCreateFile, HookNtCreateFile},
+		{HookId::ZwCreateSection, &__imp_ZwCreateSection, HookZwCreateSection},
+		{HookId::NtCreateSectionEx, &__imp_NtCreateSectionEx, HookNtCreateSectionEx},
+		{HookId::NtMapViewOfSection, &__imp_NtMapViewOfSection, HookNtMapViewOfSection},
+		{HookId::NtCreateUserProcess, &__imp_NtCreateUserProcess, HookNtCreateUserProcess},
+		{HookId::NtSetInformationFile, &__imp_NtSetInformationFile, HookNtSetInformationFile},
+		{HookId::NtClose, &__imp_NtClose, HookNtClose},
+		{HookId::NtDuplicateObject, &__imp_NtDuplicateObject, HookNtDuplicateObject}
+	};
+	// NOLINTEND
+
 	LONG DetoursAttach()
 	{
 		LogInfo("Attaching functions...");
@@ -39,25 +77,15 @@ namespace
 		LogInfoF("NtMapViewOfSection Ptr : %p", __imp_NtMapViewOfSection);
 		LogInfoF("NtCreateUserProcess Ptr : %p", __imp_NtCreateUserProcess);
 		LogInfoF("NtSetInformationFile Ptr : %p", __imp_NtSetInformationFile);
+		LogInfoF("NtClose Ptr : %p", __imp_NtClose);
+		LogInfoF("NtDuplicateObject Ptr : %p", __imp_NtDuplicateObject);
 
-		// NOLINTBEGIN 
-		DetourAttach(&(PVOID&)RealCreateProcessInternalW, HookCreateProcessInternalW);
-		DetourAttach(&(PVOID&)RealExitProcess, HookExitProcess);
-		DetourAttach(&(PVOID&)RealShellExecuteExW, HookShellExecuteExW);
-		// DetourAttach(&(PVOID&)RealWriteFile, HookWriteFile);
-		// DetourAttach(&(PVOID&)RealWriteFileEx, HookWriteFileEx);
-		// DetourAttach(&(PVOID&)RealNtWriteFile, HookNtWriteFile);
-		DetourAttach(&__imp_NtWriteFile, HookNtWriteFile);
-		DetourAttach(&__imp_ZwWriteFile, HookZwWriteFile);
-		DetourAttach(&__imp_NtCreateSection, HookNtCreateSection);
-		DetourAttach(&__imp_NtCreateFile, HookNtCreateFile);
-		DetourAttach(&__imp_ZwCreateSection, HookZwCreateSection);
-		DetourAttach(&__imp_NtCreateSectionEx, HookNtCreateSectionEx);
-		DetourAttach(&__imp_NtMapViewOfSection, HookNtMapViewOfSection);
-		DetourAttach(&__imp_NtCreateUserProcess, HookNtCreateUserProcess);
-		DetourAttach(&__imp_NtSetInformationFile, HookNtSetInformationFile);
-
-		// NOLINTEND
+		const auto hook_mask = GetHookInfoInstance()->hook_mask;
+		for (const auto& function : detoured_functions)
+		{
+			if (hook_mask & ProcessTracer::Injection::HookBit(function.hook_id))
+				DetourAttach(function.target, function.detour);
+		}
 
 		PVOID* ppbFailedPointer = nullptr;
 		LONG error = DetourTransactionCommitEx(&ppbFailedPointer);
@@ -70,6 +98,8 @@ namespace
 		VirtualProtect(&__imp_NtMapViewOfSection, sizeof(PVOID), oldProtect, nullptr);
 		VirtualProtect(&__imp_NtCreateUserProcess, sizeof(PVOID), oldProtect, nullptr);
 		VirtualProtect(&__imp_NtSetInformationFile, sizeof(PVOID), oldProtect, nullptr);
+		VirtualProtect(&__imp_NtClose, sizeof(PVOID), oldProtect, nullptr);
+		VirtualProtect(&__imp_NtDuplicateObject, sizeof(PVOID), oldProtect, nullptr);
 		if (error != 0)
 		{
 			LogError(("DetourTransactionCommitEx failed with error code: " + std::to_string(error)).c_str());
@@ -84,24 +114,12 @@ namespace
 		LogInfo("Detaching functions...");
 		DetourTransactionBegin();
 		DetourUpdateThread(GetCurrentThread());
-		// NOLINTBEGIN 
-		DetourDetach(&(PVOID&)RealCreateProcessInternalW, HookCreateProcessInternalW);
-		DetourDetach(&(PVOID&)RealExitProcess, HookExitProcess);
-		DetourDetach(&(PVOID&)RealShellExecuteExW, HookShellExecuteExW);
-		// DetourDetach(&(PVOID&)RealWriteFile, HookWriteFile);
-		// DetourDetach(&(PVOID&)RealWriteFileEx, HookWriteFileEx);
-		// DetourDetach(&(PVOID&)RealNtWriteFile, HookNtWriteFile);
-		DetourDetach(&__imp_NtWriteFile, HookNtWriteFile);
-		DetourDetach(&__imp_ZwWriteFile, HookZwWriteFile);
-		DetourDetach(&__imp_NtCreateSection, HookNtCreateSection);
-		DetourDetach(&__imp_NtCreateFile, HookNtCreateFile);
-		DetourDetach(&__imp_ZwCreateSection, HookZwCreateSection);
-		DetourDetach(&__imp_NtCreateSectionEx, HookNtCreateSectionEx);
-		DetourDetach(&__imp_NtMapViewOfSection, HookNtMapViewOfSection);
-		DetourDetach(&__imp_NtCreateUserProcess, HookNtCreateUserProcess);
-		DetourDetach(&__imp_NtSetInformationFile, HookNtSetInformationFile);
-
-		// NOLINTEND
+		const auto hook_mask = GetHookInfoInstance()->hook_mask;
+		for (const auto& function : detoured_functions)
+		{
+			if (hook_mask & ProcessTracer::Injection::HookBit(function.hook_id))
+				DetourDetach(function.target, function.detour);
+		}
 		auto error = DetourTransactionCommit();
 		if (error != 0)
 		{
@@ -119,30 +137,59 @@ namespace
 		if (hook_info->process_tracer_pid)
 			return TRUE;
 		DWORD cb_data = 0;
-		const char* payload = static_cast<const char*>(DetourFindPayloadEx(GUID_PIPE_HANDLE, &cb_data));
-		if (cb_data == 0)
+		const auto payload = DetourFindPayloadEx(GUID_PIPE_HANDLE, &cb_data);
+		ProcessTracer::Injection::Config config;
+		if (cb_data == 0 || !ProcessTracer::Injection::Decode(payload, cb_data, config))
 		{
 			return FALSE;
 		}
+		const auto& header = config.header;
 
-		const std::string payload_string(payload, cb_data);
-		auto splits = SplitBySpace(payload_string);
-		memset(hook_info->process_tracer_pid_string_buffer, 0, sizeof(hook_info->process_tracer_pid_string_buffer));
-		memcpy(hook_info->process_tracer_pid_string_buffer, splits[0].c_str(), cb_data);
-		hook_info->process_tracer_pid_string_buffer[cb_data] = 0;
-
-		const auto pid_value = std::stoi(splits[0]);
+		const auto pid_value = static_cast<int>(header.tracer_pid);
 		hook_info->process_tracer_pid = pid_value;
+		hook_info->can_elevate = (header.flags & ProcessTracer::Injection::config_flag_can_elevate) != 0;
+		hook_info->aggregate_writes = (header.flags & ProcessTracer::Injection::config_flag_aggregate_writes) != 0;
+		hook_info->hook_mask = ProcessTracer::Injection::SelectHooks(header.hook_mask, header.flags);
+		hook_info->config_payload.assign(static_cast<const char*>(payload), cb_data);
+		GetHookControl()->Map(pid_value);
+
+		ProcessTracer::BatchPolicy batch_policy;
+		if (header.batch_bytes)
+			batch_policy.flush_bytes = header.batch_bytes;
+		if (header.batch_latency_ms)
+			batch_policy.max_latency_ms = header.batch_latency_ms;
+		const ProcessTracer::TraceClock::Calibration clock = {
+			static_cast<ProcessTracer::TraceClock::Source>(header.clock_source), header.clock_epoch,
+			header.clock_frequency
+		};
 
 		DWORD current_pid = GetCurrentProcessId();
-		ProcessTracer::Logger::g_logger = ProcessTracer::Logger(pid_value, current_pid);
+		ProcessTracer::BufferBudget buffer_budget;
+		if (header.buffer_bytes)
+			buffer_budget.thread_buffer_bytes = header.buffer_bytes;
+		buffer_budget.buffer_policy = header.buffer_policy;
+		const bool block_on_transport = header.transport_policy == ProcessTracer::Injection::OverflowPolicy::Block;
+		GetEventPipeline()->Open(ProcessTracer::CreateTransport(pid_value, block_on_transport),
+		                         std::make_unique<ProcessTracer::PipeTransport>(pid_value), batch_policy,
+		                         buffer_budget,
+		                         [](ProcessTracer::EventRecord::LossStage stage, ProcessTracer::EventRecord::HookId hook_id,
+		                            uint64_t lost)
+		                         {
+			                         ProcessTracer::Logger::g_logger.Loss(stage, hook_id, lost);
+		                         });
+		ProcessTracer::Logger::g_logger = ProcessTracer::Logger(pid_value, current_pid, clock);
 		std::string msg = "ProcessTracerCore attached to process: " + std::to_string(current_pid) +
 			", Process Tracer PID: " + std::to_string(hook_info->process_tracer_pid);
 		LogInfo(msg.c_str());
 		LogInfo(msg.c_str());
-		hook_info->can_elevate = splits[1][0] == '0';
 		msg = "ProcessTracerCore can elevate: " + std::to_string(hook_info->can_elevate);
 		LogInfo(msg.c_str());
+		if (!GetPathFilter()->Compile(config.path_filter, config.path_filter_length))
+			LogError("Invalid path filter rules, every path is reported");
+		if (header.flags & ProcessTracer::Injection::config_flag_hook_timing)
+			GetHookTiming()->Enable();
+		if (header.flags & ProcessTracer::Injection::config_flag_latency_profile)
+			GetLatencyProfile()->Enable(uint64_t{header.latency_threshold_us} * 1000, header.latency_top_files);
 
 		return TRUE;
 	}
@@ -164,6 +211,8 @@ namespace
 		VirtualProtect(&__imp_NtMapViewOfSection, sizeof(PVOID), PAGE_EXECUTE_READWRITE, nullptr);
 		VirtualProtect(&__imp_NtCreateUserProcess, sizeof(PVOID), PAGE_EXECUTE_READWRITE, nullptr);
 		VirtualProtect(&__imp_NtSetInformationFile, sizeof(PVOID), PAGE_EXECUTE_READWRITE, nullptr);
+		VirtualProtect(&__imp_NtClose, sizeof(PVOID), PAGE_EXECUTE_READWRITE, nullptr);
+		VirtualProtect(&__imp_NtDuplicateObject, sizeof(PVOID), PAGE_EXECUTE_READWRITE, nullptr);
 
 		return TRUE;
 	}
@@ -171,11 +220,14 @@ namespace
 	BOOL ThreadAttach()
 	{
 		ConnectToPipe();
+		GetEventPipeline()->AttachThread();
 		return TRUE;
 	}
 
 	BOOL ThreadDetach()
 	{
+		GetHookTiming()->DetachThread();
+		GetEventPipeline()->DetachThread();
 		return TRUE;
 	}
 
@@ -193,8 +245,14 @@ namespace
 	BOOL ProcessDetach(HMODULE hDll)
 	{
 		DetoursDetach();
+		SendWriteSummaries();
+		if (GetHookTiming()->Disable())
+			SendHookTimings();
+		if (GetLatencyProfile()->Disable())
+			SendLatencyProfile();
 		auto hook_info = GetHookInfoInstance();
 		hook_info->process_tracer_pid = 0;
+		GetEventPipeline()->Close();
 		ProcessTracer::Logger::g_logger = ProcessTracer::Logger(0, 0);
 		return TRUE;
 	}
@@ -208,6 +266,9 @@ BOOL APIENTRY DllMain(HINSTANCE hModule, DWORD dwReason, PVOID lpReserved) // NO
 		return TRUE;
 	}
 
+	ProcessTracer::LoaderLockScope loader_lock_scope;
+	// nothing the DLL does while attaching or detaching is traced
+	ProcessTracer::TracerScope tracer_scope;
 	switch (dwReason)
 	{
 	case DLL_PROCESS_ATTACH:
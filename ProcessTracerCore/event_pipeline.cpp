@@ -0,0 +1,378 @@
+#include "pch.h"
+#include "event_pipeline.h"
+
+#include "tracer_scope.h"
+
+namespace
+{
+	constexpr size_t batch_capacity = 64 * 1024;
+	constexpr size_t min_thread_buffer_bytes = 4 * 1024;
+	constexpr size_t max_thread_buffer_bytes = 16 * 1024 * 1024;
+
+	thread_local int t_loader_lock_depth = 0;
+
+	// Fills in the Sequence field the logger left in a bulk record. False when the record has none.
+	bool SetSequence(char* record, size_t length, uint32_t sequence)
+	{
+		using namespace ProcessTracer::EventRecord;
+		RecordHeader header;
+		if (length < sizeof(header))
+			return false;
+		memcpy(&header, record, sizeof(header));
+		size_t offset = sizeof(header);
+		for (uint8_t field = 0; field < header.field_count && length - offset >= sizeof(FieldHeader); ++field)
+		{
+			FieldHeader field_header;
+			memcpy(&field_header, record + offset, sizeof(field_header));
+			offset += sizeof(field_header);
+			if (field_header.length > length - offset)
+				return false;
+			if (field_header.id == FieldId::Sequence && field_header.type == FieldType::U32 &&
+				field_header.length == sizeof(sequence))
+			{
+				memcpy(record + offset, &sequence, sizeof(sequence));
+				return true;
+			}
+			offset += field_header.length;
+		}
+		return false;
+	}
+
+	// Numbers the records a ring pop concatenated, from sequence on, and returns the next number.
+	uint32_t SetSequences(char* records, size_t length, uint32_t sequence)
+	{
+		using namespace ProcessTracer::EventRecord;
+		RecordHeader header;
+		for (size_t offset = 0; length - offset >= sizeof(header); offset += header.size)
+		{
+			memcpy(&header, records + offset, sizeof(header));
+			if (header.size < sizeof(header) || header.size > length - offset)
+				break;
+			if (SetSequence(records + offset, header.size, sequence))
+				++sequence;
+		}
+		return sequence;
+	}
+
+	ProcessTracer::EventPipeline g_event_pipeline;
+}
+
+thread_local ProcessTracer::EventPipeline::ThreadRing* ProcessTracer::EventPipeline::t_ring = nullptr;
+
+ProcessTracer::EventPipeline* GetEventPipeline()
+{
+	return &g_event_pipeline;
+}
+
+ProcessTracer::LoaderLockScope::LoaderLockScope()
+{
+	++t_loader_lock_depth;
+}
+
+ProcessTracer::LoaderLockScope::~LoaderLockScope()
+{
+	--t_loader_lock_depth;
+}
+
+VOID ProcessTracer::EventPipeline::Open(std::unique_ptr<Transport> transport,
+                                        std::unique_ptr<Transport> lifecycle_transport, const BatchPolicy& policy,
+                                        const BufferBudget& budget, LossReporter loss_reporter)
+{
+	m_batch = std::make_unique<char[]>(batch_capacity);
+	m_transport = std::move(transport);
+	m_lifecycle_transport = std::move(lifecycle_transport);
+	m_policy = policy;
+	if (m_policy.flush_bytes == 0 || m_policy.flush_bytes > batch_capacity)
+		m_policy.flush_bytes = batch_capacity;
+	if (m_policy.max_latency_ms == 0)
+		m_policy.max_latency_ms = 1;
+	m_budget = budget;
+	if (m_budget.thread_buffer_bytes < min_thread_buffer_bytes)
+		m_budget.thread_buffer_bytes = min_thread_buffer_bytes;
+	if (m_budget.thread_buffer_bytes > max_thread_buffer_bytes)
+		m_budget.thread_buffer_bytes = max_thread_buffer_bytes;
+	// a message has to fit into an empty ring and into an empty batch
+	m_max_queued_message_size = (m_budget.thread_buffer_bytes < batch_capacity
+		                             ? m_budget.thread_buffer_bytes
+		                             : batch_capacity) / 2;
+	m_loss_reporter = loss_reporter;
+	m_shipped_records = 0;
+	m_stopping.store(false, std::memory_order_relaxed);
+	m_open.store(true, std::memory_order_release);
+}
+
+VOID ProcessTracer::EventPipeline::Close()
+{
+	if (!m_open.exchange(false, std::memory_order_acq_rel))
+		return;
+	TracerScope tracer_scope;
+	m_stopping.store(true, std::memory_order_release);
+	if (m_wake_event)
+		SetEvent(m_wake_event);
+	// Called from DLL_PROCESS_DETACH: the sender can neither be joined under the loader lock nor
+	// be trusted to still run, so drain whatever is left here unless it died holding the lock.
+	if (TryAcquireSRWLockExclusive(&m_drain_lock))
+	{
+		DrainLocked();
+		ReleaseSRWLockExclusive(&m_drain_lock);
+	}
+	ReportLosses();
+	m_transport->Close();
+	if (m_lifecycle_transport)
+		m_lifecycle_transport->Close();
+}
+
+BOOL CALLBACK ProcessTracer::EventPipeline::StartSender(PINIT_ONCE, PVOID parameter, PVOID*)
+{
+	const auto pipeline = static_cast<EventPipeline*>(parameter);
+	pipeline->m_wake_event = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+	if (!pipeline->m_wake_event)
+		return FALSE;
+	pipeline->m_sender_thread = CreateThread(nullptr, 0, SenderThreadProc, pipeline, 0, nullptr);
+	return pipeline->m_sender_thread != nullptr;
+}
+
+DWORD WINAPI ProcessTracer::EventPipeline::SenderThreadProc(LPVOID parameter)
+{
+	const auto pipeline = static_cast<EventPipeline*>(parameter);
+	TracerScope tracer_scope;
+	while (!pipeline->m_stopping.load(std::memory_order_acquire))
+	{
+		WaitForSingleObject(pipeline->m_wake_event, pipeline->m_policy.max_latency_ms);
+		pipeline->Flush();
+		pipeline->ReportLosses();
+	}
+	return 0;
+}
+
+ProcessTracer::EventPipeline::ThreadRing* ProcessTracer::EventPipeline::CurrentThreadRing()
+{
+	if (!t_ring)
+		AttachThread();
+	return t_ring;
+}
+
+BOOL ProcessTracer::EventPipeline::Write(const char* data, size_t length, Lane lane)
+{
+	if (!m_open.load(std::memory_order_acquire))
+		return FALSE;
+	TracerScope tracer_scope;
+	if (lane == Lane::Lifecycle)
+	{
+		if (m_lifecycle_transport && m_lifecycle_transport->Write(data, length))
+			return TRUE;
+		// the lifecycle connection is gone, late is still better than lost
+		Flush();
+		return Ship(data, length);
+	}
+	if (t_loader_lock_depth == 0)
+		InitOnceExecuteOnce(&m_sender_once, StartSender, this, nullptr);
+
+	if (length <= m_max_queued_message_size)
+	{
+		const auto thread_ring = CurrentThreadRing();
+		if (thread_ring->ring.TryPush(data, length) || DropOldest(thread_ring, data, length))
+		{
+			// wake the sender once per crossing of the threshold, not for every event above it
+			const size_t pending = m_pending_bytes.fetch_add(length, std::memory_order_relaxed) + length;
+			if (pending >= m_policy.flush_bytes && pending - length < m_policy.flush_bytes && m_wake_event)
+				SetEvent(m_wake_event);
+			return TRUE;
+		}
+		if (m_budget.buffer_policy == Injection::OverflowPolicy::DropNewest)
+		{
+			m_losses.AddRecords(EventRecord::LossStage::Buffer, data, length);
+			return FALSE;
+		}
+	}
+
+	// The ring is full or the message is too large for it. Drain synchronously first so this
+	// thread's earlier messages still arrive before this one.
+	Flush();
+	return ShipNumbered(CurrentThreadRing(), data, length);
+}
+
+// Makes room for data under the drop-oldest policy by discarding the thread's oldest messages. The
+// ring's pop lock keeps the sender from popping it meanwhile; the sender only holds it while it
+// copies a message out, not while the batch is written.
+BOOL ProcessTracer::EventPipeline::DropOldest(ThreadRing* thread_ring, const char* data, size_t length)
+{
+	if (m_budget.buffer_policy != Injection::OverflowPolicy::DropOldest)
+		return FALSE;
+	AcquireSRWLockExclusive(&thread_ring->pop_lock);
+	char head[sizeof(EventRecord::RecordHeader)];
+	size_t dropped_length;
+	BOOL pushed;
+	while (!(pushed = thread_ring->ring.TryPush(data, length)) &&
+		thread_ring->ring.DropFront(head, sizeof(head), dropped_length))
+	{
+		m_losses.AddHeader(EventRecord::LossStage::Buffer, head,
+		                   dropped_length < sizeof(head) ? dropped_length : sizeof(head));
+		m_pending_bytes.fetch_sub(dropped_length, std::memory_order_relaxed);
+	}
+	ReleaseSRWLockExclusive(&thread_ring->pop_lock);
+	return pushed;
+}
+
+BOOL ProcessTracer::EventPipeline::Ship(const char* data, size_t length)
+{
+	if (m_transport->Write(data, length))
+		return TRUE;
+	m_losses.AddRecords(EventRecord::LossStage::Transport, data, length);
+	return FALSE;
+}
+
+// Ships a message that bypasses the thread's ring, numbered like the ones that went through it.
+BOOL ProcessTracer::EventPipeline::ShipNumbered(ThreadRing* thread_ring, const char* data, size_t length)
+{
+	// the logger's records are far smaller than a batch, anything larger is shipped as it is
+	if (length > batch_capacity)
+		return Ship(data, length);
+	AcquireSRWLockExclusive(&m_drain_lock);
+	memcpy(m_batch.get(), data, length);
+	const bool numbered = SetSequence(m_batch.get(), length, thread_ring->next_sequence);
+	const BOOL shipped = Ship(m_batch.get(), length);
+	if (numbered && shipped)
+	{
+		++thread_ring->next_sequence;
+		++m_shipped_records;
+	}
+	ReleaseSRWLockExclusive(&m_drain_lock);
+	return shipped;
+}
+
+// Ships the batch. When it is lost, the rings its records came from take their numbers back: the
+// loss is counted here already and must not show up as a gap too.
+VOID ProcessTracer::EventPipeline::ShipBatch(size_t length, ThreadRing* batch_rings)
+{
+	const BOOL shipped = Ship(m_batch.get(), length);
+	for (auto thread_ring = batch_rings; thread_ring; thread_ring = thread_ring->previous_in_batch)
+	{
+		if (shipped)
+			m_shipped_records += thread_ring->next_sequence - thread_ring->batch_sequence;
+		else
+			thread_ring->next_sequence = thread_ring->batch_sequence;
+	}
+}
+
+VOID ProcessTracer::EventPipeline::Flush()
+{
+	if (!m_open.load(std::memory_order_acquire))
+		return;
+	TracerScope tracer_scope;
+	AcquireSRWLockExclusive(&m_drain_lock);
+	DrainLocked();
+	ReleaseSRWLockExclusive(&m_drain_lock);
+	RemoveRetiredRings();
+}
+
+BOOL ProcessTracer::EventPipeline::Drain(DWORD timeout_ms)
+{
+	if (!m_open.load(std::memory_order_acquire))
+		return FALSE;
+	Flush();
+	TracerScope tracer_scope;
+	return m_transport->Drain(timeout_ms);
+}
+
+uint32_t ProcessTracer::EventPipeline::ShippedRecords()
+{
+	AcquireSRWLockShared(&m_drain_lock);
+	const uint32_t shipped = m_shipped_records;
+	ReleaseSRWLockShared(&m_drain_lock);
+	return shipped;
+}
+
+VOID ProcessTracer::EventPipeline::ReportLosses()
+{
+	if (!m_loss_reporter || !m_losses.Pending())
+		return;
+	TracerScope tracer_scope;
+	AcquireSRWLockExclusive(&m_report_lock);
+	m_losses.Report(m_loss_reporter);
+	ReleaseSRWLockExclusive(&m_report_lock);
+}
+
+VOID ProcessTracer::EventPipeline::DrainLocked()
+{
+	size_t used = 0;
+	size_t drained = 0;
+	// the rings with records in the batch, the last one added first
+	ThreadRing* batch_rings = nullptr;
+	AcquireSRWLockShared(&m_rings_lock);
+	for (auto thread_ring = m_rings; thread_ring; thread_ring = thread_ring->next)
+	{
+		while (!thread_ring->ring.Empty())
+		{
+			AcquireSRWLockExclusive(&thread_ring->pop_lock);
+			const size_t popped = thread_ring->ring.Pop(m_batch.get() + used, batch_capacity - used);
+			ReleaseSRWLockExclusive(&thread_ring->pop_lock);
+			if (popped != 0)
+			{
+				// a ring's records sit together in a batch, it only has to be added once
+				if (batch_rings != thread_ring)
+				{
+					thread_ring->batch_sequence = thread_ring->next_sequence;
+					thread_ring->previous_in_batch = batch_rings;
+					batch_rings = thread_ring;
+				}
+				thread_ring->next_sequence = SetSequences(m_batch.get() + used, popped, thread_ring->next_sequence);
+			}
+			used += popped;
+			drained += popped;
+			if (popped == 0 || used == batch_capacity)
+			{
+				// the next message does not fit, ship what we have
+				ShipBatch(used, batch_rings);
+				used = 0;
+				batch_rings = nullptr;
+			}
+		}
+	}
+	ReleaseSRWLockShared(&m_rings_lock);
+	if (used > 0)
+		ShipBatch(used, batch_rings);
+	m_pending_bytes.fetch_sub(drained, std::memory_order_relaxed);
+}
+
+VOID ProcessTracer::EventPipeline::RemoveRetiredRings()
+{
+	AcquireSRWLockExclusive(&m_rings_lock);
+	auto link = &m_rings;
+	while (*link)
+	{
+		const auto thread_ring = *link;
+		// retired is set after the thread's last push, so an empty retired ring stays empty
+		if (thread_ring->retired.load(std::memory_order_acquire) && thread_ring->ring.Empty())
+		{
+			*link = thread_ring->next;
+			delete thread_ring;
+		}
+		else
+		{
+			link = &thread_ring->next;
+		}
+	}
+	ReleaseSRWLockExclusive(&m_rings_lock);
+}
+
+VOID ProcessTracer::EventPipeline::AttachThread()
+{
+	if (t_ring)
+		return;
+	const auto thread_ring = new ThreadRing(m_budget.thread_buffer_bytes);
+	AcquireSRWLockExclusive(&m_rings_lock);
+	thread_ring->next = m_rings;
+	m_rings = thread_ring;
+	ReleaseSRWLockExclusive(&m_rings_lock);
+	t_ring = thread_ring;
+}
+
+VOID ProcessTracer::EventPipeline::DetachThread()
+{
+	if (!t_ring)
+		return;
+	// the ring is freed by the next drain once it is empty
+	t_ring->retired.store(true, std::memory_order_release);
+	t_ring = nullptr;
+}
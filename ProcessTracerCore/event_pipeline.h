@@ -0,0 +1,144 @@
+#pragma once
+#include <atomic>
+#include <memory>
+
+#include "injection_config.h"
+#include "loss_counter.h"
+#include "spsc_ring.h"
+#include "transport.h"
+
+namespace ProcessTracer
+{
+	// When queued events are shipped. The sender wakes up once flush_bytes are pending or after
+	// max_latency_ms, whichever comes first; lifecycle events are not batched at all.
+	struct BatchPolicy
+	{
+		size_t flush_bytes = 16 * 1024;
+		DWORD max_latency_ms = 5;
+	};
+
+	// How much the pipeline may hold and what it does when that is full. The transport policy is
+	// applied by the transport itself, see CreateTransport.
+	struct BufferBudget
+	{
+		size_t thread_buffer_bytes = 64 * 1024;
+		Injection::OverflowPolicy buffer_policy = Injection::OverflowPolicy::Block;
+	};
+
+	// Sends the loss of events as a record, see EventPipeline::ReportLosses.
+	using LossReporter = void (*)(EventRecord::LossStage stage, EventRecord::HookId hook_id, uint64_t lost);
+
+	// Bulk events are queued and batched. Lifecycle events, the ones the collector tracks processes
+	// by, are written at once on a connection of their own, so they never wait behind bulk events
+	// and are never dropped by a full event ring.
+	enum class Lane
+	{
+		Bulk,
+		Lifecycle,
+	};
+
+	// Decouples hook threads from the transport. Every thread pushes its messages
+	// into its own SpscRing; one sender thread drains all rings and ships the
+	// messages in batches.
+	class EventPipeline
+	{
+		struct ThreadRing
+		{
+			SpscRing ring;
+			// Serializes Pop and DropFront. Held for one pop at a time and never across a transport
+			// write, so a producer dropping its oldest messages does not wait for the sender.
+			SRWLOCK pop_lock = SRWLOCK_INIT;
+			std::atomic<bool> retired{false};
+			ThreadRing* next = nullptr;
+			// The thread's bulk records are numbered as they are shipped, so a record dropped before
+			// leaves no gap for the collector to count a second time. Only used under the drain lock.
+			uint32_t next_sequence = 0;
+			// next_sequence before the batch being filled, and the ring added to it before this one
+			uint32_t batch_sequence = 0;
+			ThreadRing* previous_in_batch = nullptr;
+
+			explicit ThreadRing(size_t capacity) : ring(capacity)
+			{
+			}
+		};
+
+		static thread_local ThreadRing* t_ring;
+
+		std::unique_ptr<Transport> m_transport;
+		std::unique_ptr<Transport> m_lifecycle_transport;
+		std::atomic<bool> m_open{false};
+		BatchPolicy m_policy;
+		BufferBudget m_budget;
+		size_t m_max_queued_message_size = 0;
+		std::atomic<size_t> m_pending_bytes{0};
+
+		LossCounter m_losses;
+		LossReporter m_loss_reporter = nullptr;
+		SRWLOCK m_report_lock = SRWLOCK_INIT;
+
+		// guards the m_rings list, the rings themselves are lock-free
+		SRWLOCK m_rings_lock = SRWLOCK_INIT;
+		ThreadRing* m_rings = nullptr;
+
+		// only one thread drains at a time, either the sender or a forced flush
+		SRWLOCK m_drain_lock = SRWLOCK_INIT;
+		std::unique_ptr<char[]> m_batch;
+		// numbered bulk records the transport took, under the drain lock
+		uint32_t m_shipped_records = 0;
+
+		INIT_ONCE m_sender_once = INIT_ONCE_STATIC_INIT;
+		HANDLE m_sender_thread = nullptr;
+		HANDLE m_wake_event = nullptr;
+		std::atomic<bool> m_stopping{false};
+
+		static BOOL CALLBACK StartSender(PINIT_ONCE init_once, PVOID parameter, PVOID* context);
+		static DWORD WINAPI SenderThreadProc(LPVOID parameter);
+
+		ThreadRing* CurrentThreadRing();
+		BOOL DropOldest(ThreadRing* thread_ring, const char* data, size_t length);
+		BOOL Ship(const char* data, size_t length);
+		BOOL ShipNumbered(ThreadRing* thread_ring, const char* data, size_t length);
+		VOID ShipBatch(size_t length, ThreadRing* batch_rings);
+		VOID DrainLocked();
+		VOID RemoveRetiredRings();
+
+	public:
+		EventPipeline() = default;
+		EventPipeline(const EventPipeline&) = delete;
+		EventPipeline& operator=(const EventPipeline&) = delete;
+
+		VOID Open(std::unique_ptr<Transport> transport, std::unique_ptr<Transport> lifecycle_transport,
+		          const BatchPolicy& policy, const BufferBudget& budget, LossReporter loss_reporter);
+		VOID Close();
+
+		BOOL Write(const char* data, size_t length, Lane lane = Lane::Bulk);
+		// drains every ring on the calling thread
+		VOID Flush();
+		// Flushes, then waits up to timeout_ms for the collector to read everything the bulk lane
+		// shipped. A lifecycle event sent afterwards cannot overtake bulk events sent before.
+		BOOL Drain(DWORD timeout_ms);
+		// The numbered bulk records shipped so far. The collector holds the exit line back until it has
+		// handled that many lines of the process.
+		uint32_t ShippedRecords();
+		// Hands the events lost since the previous report to the loss reporter, one call per hook and
+		// stage. Cheap when nothing was lost.
+		VOID ReportLosses();
+
+		VOID AttachThread();
+		VOID DetachThread();
+	};
+
+	// Marks the current thread as running inside DllMain. The sender thread is
+	// never started while the loader lock is held.
+	class LoaderLockScope
+	{
+	public:
+		LoaderLockScope();
+		~LoaderLockScope();
+
+		LoaderLockScope(const LoaderLockScope&) = delete;
+		LoaderLockScope& operator=(const LoaderLockScope&) = delete;
+	};
+}
+
+ProcessTracer::EventPipeline* GetEventPipeline();
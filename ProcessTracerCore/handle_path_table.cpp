@@ -0,0 +1,148 @@
+#include "pch.h"
+#include "handle_path_table.h"
+
+namespace
+{
+	ProcessTracer::HandlePathTable g_handle_path_table;
+}
+
+ProcessTracer::HandlePathTable* GetHandlePathTable()
+{
+	return &g_handle_path_table;
+}
+
+// Gives up instead of spinning forever, a writer that was killed mid-update must not hang the process.
+bool ProcessTracer::HandlePathTable::Lock(Slot& slot, uint32_t& sequence)
+{
+	for (int attempt = 0; attempt < lock_attempts; ++attempt)
+	{
+		sequence = slot.sequence.load(std::memory_order_relaxed);
+		if ((sequence & 1) == 0 &&
+			slot.sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire,
+			                                    std::memory_order_relaxed))
+		{
+			// the slot contents must not become visible before the odd sequence
+			std::atomic_thread_fence(std::memory_order_release);
+			return true;
+		}
+	}
+	return false;
+}
+
+void ProcessTracer::HandlePathTable::Unlock(Slot& slot, uint32_t sequence)
+{
+	slot.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool ProcessTracer::HandlePathTable::Insert(uintptr_t key, const char16_t* path, size_t length)
+{
+	if (key == empty_key || key == erased_key)
+		return false;
+	if (length == 0 || length > max_path_length)
+	{
+		Erase(key);
+		return false;
+	}
+
+	// reuse the entry of key if there is one, otherwise take the first free slot of the chain
+	const size_t home = Hash(key);
+	Slot* target = nullptr;
+	Slot* free_slot = nullptr;
+	for (size_t probe = 0; probe < max_probe; ++probe)
+	{
+		Slot& slot = m_slots[(home + probe) & (slot_count - 1)];
+		const uintptr_t current = slot.key.load(std::memory_order_relaxed);
+		if (current == key)
+		{
+			target = &slot;
+			break;
+		}
+		if (current == erased_key && !free_slot)
+			free_slot = &slot;
+		if (current == empty_key)
+		{
+			if (!free_slot)
+				free_slot = &slot;
+			break;
+		}
+	}
+	if (!target)
+		target = free_slot;
+	if (!target)
+		return false;
+
+	uint32_t sequence;
+	if (!Lock(*target, sequence))
+		return false;
+	const uintptr_t current = target->key.load(std::memory_order_relaxed);
+	if (current != key && current != empty_key && current != erased_key)
+	{
+		// another handle took the slot in the meantime
+		Unlock(*target, sequence);
+		return false;
+	}
+	target->key.store(key, std::memory_order_relaxed);
+	target->length.store(static_cast<uint32_t>(length), std::memory_order_relaxed);
+	for (size_t i = 0; i < length; i += 2)
+	{
+		const uint32_t high = i + 1 < length ? path[i + 1] : 0;
+		target->words[i / 2].store(path[i] | high << 16, std::memory_order_relaxed);
+	}
+	Unlock(*target, sequence);
+	return true;
+}
+
+void ProcessTracer::HandlePathTable::Erase(uintptr_t key)
+{
+	const size_t home = Hash(key);
+	for (size_t probe = 0; probe < max_probe; ++probe)
+	{
+		Slot& slot = m_slots[(home + probe) & (slot_count - 1)];
+		const uintptr_t current = slot.key.load(std::memory_order_relaxed);
+		if (current == empty_key)
+			return;
+		if (current != key)
+			continue;
+		uint32_t sequence;
+		if (!Lock(slot, sequence))
+			return;
+		if (slot.key.load(std::memory_order_relaxed) == key)
+			slot.key.store(erased_key, std::memory_order_relaxed);
+		Unlock(slot, sequence);
+		return;
+	}
+}
+
+size_t ProcessTracer::HandlePathTable::Lookup(uintptr_t key, char16_t* buffer, size_t capacity) const
+{
+	const size_t home = Hash(key);
+	for (size_t probe = 0; probe < max_probe; ++probe)
+	{
+		const Slot& slot = m_slots[(home + probe) & (slot_count - 1)];
+		const uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+		const uintptr_t current = slot.key.load(std::memory_order_relaxed);
+		if (current == empty_key)
+			return 0;
+		if (current != key)
+			continue;
+		if (sequence & 1)
+			return 0;
+
+		const size_t length = slot.length.load(std::memory_order_relaxed);
+		if (length > capacity || length > max_path_length)
+			return 0;
+		for (size_t i = 0; i < length; i += 2)
+		{
+			const uint32_t word = slot.words[i / 2].load(std::memory_order_relaxed);
+			buffer[i] = static_cast<char16_t>(word);
+			if (i + 1 < length)
+				buffer[i + 1] = static_cast<char16_t>(word >> 16);
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		// a writer touched the slot while it was copied, the copy may be torn
+		if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+			return 0;
+		return length;
+	}
+	return 0;
+}
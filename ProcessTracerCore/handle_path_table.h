@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace ProcessTracer
+{
+	// Remembers the path every file handle was opened with, so the write hooks do not have to ask
+	// the kernel for the name on each call. Open addressing over a fixed slot array, each slot is
+	// guarded by a sequence lock: readers never block and never write, writers claim a slot with
+	// one compare-exchange. A lookup that races with a writer simply misses, the caller then falls
+	// back to querying the name.
+	//
+	// Handle values are opaque keys, the table knows nothing about the platform that issued them.
+	class HandlePathTable
+	{
+	public:
+		static constexpr size_t slot_bits = 10;
+		static constexpr size_t slot_count = size_t{1} << slot_bits;
+		static constexpr size_t max_path_length = 264; // UTF-16 units, longer paths are not cached
+		static constexpr size_t max_probe = 16;
+
+	private:
+		static constexpr uintptr_t empty_key = 0;
+		static constexpr uintptr_t erased_key = 1;
+		static constexpr int lock_attempts = 64;
+
+		struct Slot
+		{
+			std::atomic<uintptr_t> key{empty_key};
+			std::atomic<uint32_t> sequence{0}; // odd while a writer owns the slot
+			std::atomic<uint32_t> length{0};
+			std::atomic<uint32_t> words[max_path_length / 2] = {}; // two UTF-16 units each
+		};
+
+		Slot m_slots[slot_count];
+
+		static size_t Hash(uintptr_t key)
+		{
+			// handles are multiples of four, drop the constant bits before mixing
+			const uint64_t mixed = static_cast<uint64_t>(key >> 2) * 0x9E3779B97F4A7C15ull;
+			return static_cast<size_t>(mixed >> (64 - slot_bits));
+		}
+
+		static bool Lock(Slot& slot, uint32_t& sequence);
+		static void Unlock(Slot& slot, uint32_t sequence);
+
+	public:
+		HandlePathTable() = default;
+		HandlePathTable(const HandlePathTable&) = delete;
+		HandlePathTable& operator=(const HandlePathTable&) = delete;
+
+		// Replaces the path of key. Returns false when the path was not cached, either because it
+		// is too long or because no slot was free; any older entry for key is gone in both cases.
+		bool Insert(uintptr_t key, const char16_t* path, size_t length);
+		void Erase(uintptr_t key);
+		// Copies the path of key into buffer and returns its length, 0 on a miss.
+		size_t Lookup(uintptr_t key, char16_t* buffer, size_t capacity) const;
+	};
+}
+
+ProcessTracer::HandlePathTable* GetHandlePathTable();
@@ -0,0 +1,55 @@
+#include "pch.h"
+#include "hook_control.h"
+
+#include <string>
+
+namespace
+{
+	ProcessTracer::HookControl g_hook_control;
+}
+
+ProcessTracer::HookControl* GetHookControl()
+{
+	return &g_hook_control;
+}
+
+ProcessTracer::HookControl::HookControl()
+{
+	m_defaults.magic = Control::control_magic;
+	m_defaults.version = Control::control_version;
+	m_defaults.hook_count = static_cast<uint32_t>(EventRecord::HookId::Count);
+	for (size_t i = 0; i < Control::max_hooks; ++i)
+		m_defaults.hooks[i].store(Control::DefaultHookWord(static_cast<EventRecord::HookId>(i)),
+		                          std::memory_order_relaxed);
+}
+
+void ProcessTracer::HookControl::Attach(const Control::ControlBlock* block)
+{
+	// requests made before this process started are not meant for it
+	m_reported.store(block->report_request.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	m_block = block;
+}
+
+#ifdef _WIN32
+BOOL ProcessTracer::HookControl::Map(int process_tracer_pid)
+{
+	const auto map_name = L"ProcessTracerControl:" + std::to_wstring(process_tracer_pid);
+	const HANDLE mapping = OpenFileMappingW(FILE_MAP_READ, FALSE, map_name.c_str());
+	if (!mapping)
+		return FALSE;
+
+	// The view stays mapped until the process exits, hooks on other threads may be reading it.
+	const auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, sizeof(Control::ControlBlock));
+	CloseHandle(mapping);
+	if (!view)
+		return FALSE;
+	const auto block = static_cast<const Control::ControlBlock*>(view);
+	if (block->magic != Control::control_magic || block->version != Control::control_version)
+	{
+		UnmapViewOfFile(view);
+		return FALSE;
+	}
+	Attach(block);
+	return TRUE;
+}
+#endif
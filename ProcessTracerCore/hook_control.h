@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+
+#include "control_block.h"
+
+namespace ProcessTracer
+{
+	// Per-hook switches and sampling rates. Reads the tracer's control block once it is mapped,
+	// until then, or when the tracer has none, the built-in defaults apply.
+	//
+	// The words cannot live inline, the tracer flips them in its shared mapping while the process
+	// runs. The block pointer is chosen once before the hooks are installed and never changes after,
+	// so it is a plain member: a hook reads the pointer from memory no one writes and then does the
+	// one relaxed load of its word. The sampling counters are thread local, a shared counter would
+	// be a contended read-modify-write on every call of a sampled hook.
+	class HookControl
+	{
+		static inline thread_local uint32_t t_calls[Control::max_hooks] = {};
+
+		Control::ControlBlock m_defaults = {};
+		const Control::ControlBlock* m_block = &m_defaults;
+		std::atomic<uint32_t> m_reported{0};
+
+	public:
+		HookControl();
+		HookControl(const HookControl&) = delete;
+		HookControl& operator=(const HookControl&) = delete;
+
+		// Reads the switches from block from now on. Has to be called before any hook is installed,
+		// and block has to stay valid as long as hooks run.
+		void Attach(const Control::ControlBlock* block);
+#ifdef _WIN32
+		// maps the block created by the tracer, keeps the defaults when there is none
+		BOOL Map(int process_tracer_pid);
+#endif
+
+		// Whether the current call of hook_id is logged. Lifecycle hooks the collector depends on
+		// do not ask, they always log.
+		bool ShouldLog(EventRecord::HookId hook_id) const
+		{
+			const auto index = static_cast<size_t>(hook_id);
+			const uint32_t word = m_block->hooks[index].load(std::memory_order_relaxed);
+			if (!(word & Control::hook_enabled))
+				return false;
+			const uint32_t sample_rate = word & Control::sample_rate_mask;
+			return sample_rate <= 1 || t_calls[index]++ % sample_rate == 0;
+		}
+
+		// True for exactly one caller after the tracer asked for a timing report.
+		bool TakeReportRequest()
+		{
+			const uint32_t requested = m_block->report_request.load(std::memory_order_relaxed);
+			uint32_t reported = m_reported.load(std::memory_order_relaxed);
+			return requested != reported &&
+				m_reported.compare_exchange_strong(reported, requested, std::memory_order_relaxed);
+		}
+	};
+}
+
+ProcessTracer::HookControl* GetHookControl();
@@ -2,19 +2,34 @@
 #include "origin.h"
 #include "hook_func.h"
 
-#include <bitset>
 #include <detours.h>
 #include <ios>
 #include <Psapi.h>
 
 #include "constants.h"
+#include "event_pipeline.h"
+#include "handle_path_table.h"
+#include "hook_control.h"
 #include "hook_info.h"
+#include "hook_timing.h"
+#include "latency_profile.h"
+#include "line_classifier.h"
 #include "logger.h"
+#include "path_filter.h"
+#include "tracer_scope.h"
 #include "utils.h"
+#include "write_aggregator.h"
+
+using ProcessTracer::EventRecord::FieldId;
+using ProcessTracer::EventRecord::HookId;
 
 namespace
 {
-	const char* permission_request_str = "Permission Request";
+	// FILE_INFORMATION_CLASS values winternl.h does not name
+	constexpr auto file_rename_information = static_cast<FILE_INFORMATION_CLASS>(10);
+	constexpr auto file_rename_information_ex = static_cast<FILE_INFORMATION_CLASS>(65);
+	// how long an exiting process waits for the collector to read its last bulk events
+	constexpr DWORD exit_drain_timeout_ms = 1000;
 
 	BOOL WINAPI MineCreateProcessInternalW(
 		LPCWSTR lpApplicationName,
@@ -35,7 +50,17 @@ namespace
 		                                  lpStartupInfo, lpProcessInformation, nullptr);
 	}
 
-	VOID TryLogFileName(const char* func_name, HANDLE handle)
+	const char16_t* AsUtf16(const wchar_t* text)
+	{
+		return reinterpret_cast<const char16_t*>(text);
+	}
+
+	size_t Utf16Length(const wchar_t* text)
+	{
+		return text ? wcslen(text) : 0;
+	}
+
+	VOID TryLogFileName(HookId hook_id, HANDLE handle)
 	{
 		wchar_t buffer[MAX_PATH];
 		DWORD result = GetFinalPathNameByHandle(
@@ -44,38 +69,283 @@ namespace
 			MAX_PATH,
 			FILE_NAME_NORMALIZED
 		);
-		if (result > 0)
+		if (result > 0 && result < MAX_PATH)
 		{
-			std::wstring file_path(buffer, result);
-			LogHookInfo(func_name, (std::string("Target:") + std::string(file_path.begin(), file_path.end())).c_str());
+			ProcessTracer::HookRecord record(hook_id);
+			record->AddUtf16(FieldId::Path, AsUtf16(buffer), result);
+			record.Send();
 		}
 	}
 
-	std::wstring GetFileNameFromHandle(HANDLE hFile)
+	struct ObjectNameBuffer
+	{
+		alignas(OBJECT_NAME_INFORMATION) BYTE data[sizeof(OBJECT_NAME_INFORMATION) + 1024 * sizeof(WCHAR)];
+	};
+
+	// The returned name points into buffer, it is empty when the query fails.
+	UNICODE_STRING GetFileNameFromHandle(HANDLE hFile, ObjectNameBuffer& buffer)
 	{
-		BYTE buffer[300] = {0};
 		ULONG returnLength = 0;
 
 		NTSTATUS status = NtQueryObject(
 			hFile,
 			(OBJECT_INFORMATION_CLASS)ObjectNameInformation,
-			buffer,
-			sizeof(buffer),
+			buffer.data,
+			sizeof(buffer.data),
 			&returnLength
 		);
 
 		if (status != 0)
 		{
-			return L"";
+			return {};
+		}
+
+		return reinterpret_cast<POBJECT_NAME_INFORMATION>(buffer.data)->Name;
+	}
+
+	VOID AddUnicodeString(ProcessTracer::HookRecord& record, FieldId field_id, const UNICODE_STRING& text)
+	{
+		record->AddUtf16(field_id, AsUtf16(text.Buffer), text.Buffer ? text.Length / sizeof(WCHAR) : 0);
+	}
+
+	uintptr_t HandleKey(HANDLE handle)
+	{
+		return reinterpret_cast<uintptr_t>(handle);
+	}
+
+	// Like GetFileNameFromHandle, but answers from the handle table and only queries the kernel on a miss.
+	// Queried names are cached, so handles opened before the hooks were attached pay the query once.
+	UNICODE_STRING ResolveFileName(HANDLE hFile, ObjectNameBuffer& buffer)
+	{
+		const auto handle_path_table = GetHandlePathTable();
+		auto* cached = reinterpret_cast<char16_t*>(buffer.data);
+		const size_t length = handle_path_table->Lookup(HandleKey(hFile), cached,
+		                                                sizeof(buffer.data) / sizeof(char16_t));
+		if (length != 0)
+		{
+			const auto bytes = static_cast<USHORT>(length * sizeof(WCHAR));
+			return {bytes, bytes, reinterpret_cast<PWSTR>(cached)};
 		}
 
-		POBJECT_NAME_INFORMATION pNameInfo = (POBJECT_NAME_INFORMATION)buffer;
-		if (pNameInfo->Name.Buffer && pNameInfo->Name.Length > 0)
+		const auto file_name = GetFileNameFromHandle(hFile, buffer);
+		if (file_name.Buffer)
+			handle_path_table->Insert(HandleKey(hFile), AsUtf16(file_name.Buffer), file_name.Length / sizeof(WCHAR));
+		return file_name;
+	}
+
+	// Paths the tracer did not ask for are dropped here, before anything is formatted.
+	bool PassesPathFilter(const UNICODE_STRING& path)
+	{
+		const auto path_filter = GetPathFilter();
+		return path_filter->Empty() || path_filter->Matches(AsUtf16(path.Buffer),
+		                                                    path.Buffer ? path.Length / sizeof(WCHAR) : 0);
+	}
+
+	// The full name a file was opened with, a relative name is taken from the handle table.
+	UNICODE_STRING OpenedFileName(HANDLE hFile, const OBJECT_ATTRIBUTES& attributes, ObjectNameBuffer& buffer)
+	{
+		if (!attributes.RootDirectory)
+			return *attributes.ObjectName;
+		auto* cached = reinterpret_cast<char16_t*>(buffer.data);
+		const size_t length = GetHandlePathTable()->Lookup(HandleKey(hFile), cached,
+		                                                   sizeof(buffer.data) / sizeof(char16_t));
+		if (length == 0)
+			return *attributes.ObjectName;
+		const auto bytes = static_cast<USHORT>(length * sizeof(WCHAR));
+		return {bytes, bytes, reinterpret_cast<PWSTR>(cached)};
+	}
+
+	// Caches the name a file was opened with, a relative name is joined to the path of its root directory.
+	VOID RememberFileName(HANDLE hFile, const OBJECT_ATTRIBUTES& attributes)
+	{
+		const auto handle_path_table = GetHandlePathTable();
+		const UNICODE_STRING& name = *attributes.ObjectName;
+		const size_t name_length = name.Buffer ? name.Length / sizeof(WCHAR) : 0;
+		if (!attributes.RootDirectory)
+		{
+			handle_path_table->Insert(HandleKey(hFile), AsUtf16(name.Buffer), name_length);
+			return;
+		}
+
+		char16_t path[ProcessTracer::HandlePathTable::max_path_length];
+		size_t length = handle_path_table->Lookup(HandleKey(attributes.RootDirectory), path, std::size(path));
+		if (length == 0 || length + 1 + name_length > std::size(path))
+			return;
+		if (name_length != 0)
 		{
-			return std::wstring(pNameInfo->Name.Buffer, pNameInfo->Name.Length / sizeof(WCHAR));
+			path[length++] = u'\\';
+			memcpy(path + length, name.Buffer, name_length * sizeof(char16_t));
+			length += name_length;
 		}
+		handle_path_table->Insert(HandleKey(hFile), path, length);
+	}
+
+	VOID SendWriteSummary(HANDLE hFile, const ProcessTracer::WriteSummary& summary)
+	{
+		ObjectNameBuffer name_buffer;
+		const auto file_name = ResolveFileName(hFile, name_buffer);
+		if (!PassesPathFilter(file_name))
+			return;
+		ProcessTracer::HookRecord record(HookId::NtWriteFile);
+		record->AddU64(FieldId::WriteCount, summary.count);
+		record->AddU64(FieldId::TotalBytes, summary.bytes);
+		if (summary.first_offset != ProcessTracer::WriteSummary::no_offset)
+			record->AddU64(FieldId::FirstOffset, summary.first_offset);
+		if (summary.last_offset != ProcessTracer::WriteSummary::no_offset)
+			record->AddU64(FieldId::LastOffset, summary.last_offset);
+		record->AddU64(FieldId::FirstTimestamp, summary.first_timestamp);
+		record->AddU64(FieldId::LastTimestamp, summary.last_timestamp);
+		AddUnicodeString(record, FieldId::Path, file_name);
+		record.Send();
+	}
 
-		return L"";
+	// Counts a write towards its handle's summary, false when it has to be reported on its own.
+	BOOL AggregateWrite(HANDLE hFile, ULONG length, const LARGE_INTEGER* byte_offset)
+	{
+		if (!GetHookInfoInstance()->aggregate_writes)
+			return FALSE;
+		// negative offsets are FILE_WRITE_TO_END_OF_FILE and FILE_USE_FILE_POINTER_POSITION
+		const uint64_t offset = byte_offset && byte_offset->QuadPart >= 0
+			                        ? static_cast<uint64_t>(byte_offset->QuadPart)
+			                        : ProcessTracer::WriteSummary::no_offset;
+		return GetWriteAggregator()->Add(HandleKey(hFile), length, offset, ProcessTracer::Logger::g_logger.Now());
+	}
+
+	BOOL IsCurrentProcess(HANDLE process)
+	{
+		return process == GetCurrentProcess() || GetProcessId(process) == GetCurrentProcessId();
+	}
+
+	// Calls made by the tracer itself are never logged, everything else as the control block says.
+	bool ShouldLog(HookId hook_id)
+	{
+		return !ProcessTracer::TracerScope::Active() && GetHookControl()->ShouldLog(hook_id);
+	}
+
+	// Splits the time of one hook call into tracer code and the real function, when timing or
+	// latency profiling is on.
+	class HookTimer
+	{
+#if PROCESS_TRACER_HOOK_TIMING
+		HookId m_hook_id;
+		bool m_timing;
+		bool m_active;
+		uint64_t m_enter = 0;
+		uint64_t m_real_start = 0;
+		uint64_t m_real_end = 0;
+
+		static uint64_t Now()
+		{
+			return ProcessTracer::Logger::g_logger.Now();
+		}
+
+	public:
+		explicit HookTimer(HookId hook_id)
+			: m_hook_id(hook_id), m_timing(GetHookTiming()->Enabled()),
+			  m_active((m_timing || (ProcessTracer::LatencyProfile::Profiles(hook_id) &&
+				  GetLatencyProfile()->Enabled())) && !ProcessTracer::TracerScope::Active())
+		{
+			if (m_active)
+				m_enter = m_real_start = m_real_end = Now();
+		}
+
+		~HookTimer()
+		{
+			if (!m_active || !m_timing)
+				return;
+			const uint64_t leave = Now();
+			GetHookTiming()->Record(m_hook_id, (m_real_start - m_enter) + (leave - m_real_end),
+			                        m_real_end - m_real_start);
+			if (GetHookControl()->TakeReportRequest())
+				SendHookTimings();
+		}
+
+		VOID BeginReal()
+		{
+			if (m_active)
+				m_real_start = Now();
+		}
+
+		VOID EndReal()
+		{
+			if (m_active)
+				m_real_end = Now();
+		}
+
+		// false for calls made by the tracer itself and while nothing is measured
+		bool Active() const
+		{
+			return m_active;
+		}
+
+		uint64_t RealDuration() const
+		{
+			return m_real_end - m_real_start;
+		}
+#else
+	public:
+		explicit HookTimer(HookId)
+		{
+		}
+
+		VOID BeginReal()
+		{
+		}
+
+		VOID EndReal()
+		{
+		}
+
+		bool Active() const
+		{
+			return false;
+		}
+
+		uint64_t RealDuration() const
+		{
+			return 0;
+		}
+#endif
+
+		HookTimer(const HookTimer&) = delete;
+		HookTimer& operator=(const HookTimer&) = delete;
+	};
+
+	// In latency profiling mode a file hook only reports calls slower than the threshold, every other
+	// call just counts towards its file. True when the call was handled here.
+	bool ProfileLatency(HookId hook_id, NTSTATUS status, const UNICODE_STRING& path, const HookTimer& timer)
+	{
+		if (!timer.Active() || !GetLatencyProfile()->Enabled())
+			return false;
+		if (!PassesPathFilter(path))
+			return true;
+		const uint64_t duration = timer.RealDuration();
+		if (GetLatencyProfile()->Add(AsUtf16(path.Buffer), path.Buffer ? path.Length / sizeof(WCHAR) : 0, duration,
+		                             !NT_SUCCESS(status)))
+		{
+			ProcessTracer::HookRecord record(hook_id, status, ProcessTracer::EventRecord::RecordType::SlowCall);
+			record->AddU64(FieldId::Duration, duration);
+			AddUnicodeString(record, FieldId::Path, path);
+			record.Send();
+		}
+		return true;
+	}
+
+	VOID LogSection(HookId hook_id, NTSTATUS status, HANDLE hFile)
+	{
+		ObjectNameBuffer name_buffer;
+		ProcessTracer::HookRecord record(hook_id, status);
+		if (hFile)
+			AddUnicodeString(record, FieldId::Path, ResolveFileName(hFile, name_buffer));
+		record.Send();
+	}
+
+	// a rename leaves the cached name stale, the next lookup queries the new one
+	VOID ForgetRenamedFile(HANDLE hFile, FILE_INFORMATION_CLASS information_class, NTSTATUS status)
+	{
+		if (NT_SUCCESS(status) && (information_class == file_rename_information ||
+			information_class == file_rename_information_ex))
+			GetHandlePathTable()->Erase(HandleKey(hFile));
 	}
 
 	bool IsSectionFileBacked(HANDLE sectionHandle)
@@ -136,11 +406,16 @@ BOOL WINAPI HookCreateProcessInternalW(
 	OPTIONAL PHANDLE hRestrictedUserToken
 )
 {
-	const std::string hook_func_name = "CreateProcessInternalW";
-	auto msg = "[ApplicationName] " + ConvertWStringToString(lpApplicationName) + ", [CommandLine] " +
-		ConvertWStringToString(lpCommandLine);
-	LogHookInfo(hook_func_name.c_str(), msg.c_str());
-	if (!RealCreateProcessInternalW(
+	constexpr auto hook_id = HookId::CreateProcessInternalW;
+	HookTimer timer(hook_id);
+	{
+		ProcessTracer::HookRecord record(hook_id);
+		record->AddUtf16(FieldId::ApplicationName, AsUtf16(lpApplicationName), Utf16Length(lpApplicationName));
+		record->AddUtf16(FieldId::CommandLine, AsUtf16(lpCommandLine), Utf16Length(lpCommandLine));
+		record.Send();
+	}
+	timer.BeginReal();
+	const BOOL created = RealCreateProcessInternalW(
 		hUserToken,
 		lpApplicationName,
 		lpCommandLine,
@@ -153,17 +428,19 @@ BOOL WINAPI HookCreateProcessInternalW(
 		lpStartupInfo,
 		lpProcessInformation,
 		hRestrictedUserToken
-	))
+	);
+	timer.EndReal();
+	if (!created)
 	{
 		// if 740, it means the process requires elevation
 		if (GetLastError() == 740)
 		{
-			LogInfo(permission_request_str);
+			// the collector restarts elevated on this message, do not let it wait for a batch
+			LogInfo(ProcessTracer::EventRecord::permission_request_message, ProcessTracer::Lane::Lifecycle);
 		}
 		else
 		{
-			LogHookError(hook_func_name.c_str(),
-			             ("RealCreateProcessInternalW failed with " + std::to_string(GetLastError())).c_str());
+			LogHookErrorF(hook_id, "RealCreateProcessInternalW failed with %lu", GetLastError());
 		}
 		return FALSE;
 	}
@@ -176,23 +453,25 @@ BOOL WINAPI HookCreateProcessInternalW(
 		                         sz,
 		                         MineCreateProcessInternalW))
 	{
-		LogHookError(hook_func_name.c_str(), "DetourUpdateProcessWithDll or DetourProcessViaHelperW failed");
+		LogHookError(hook_id, "DetourUpdateProcessWithDll or DetourProcessViaHelperW failed");
 		TerminateProcess(lpProcessInformation->hProcess, ~0u);
 		CloseHandle(lpProcessInformation->hProcess);
 		CloseHandle(lpProcessInformation->hThread);
 		return FALSE;
 	}
-	std::string payload = std::to_string(hook_info->process_tracer_pid) + " " +
-		(hook_info->can_elevate ? "0" : "1");
+	const auto& payload = hook_info->config_payload;
 	if (!DetourCopyPayloadToProcess(lpProcessInformation->hProcess, GUID_PIPE_HANDLE,
-	                                payload.c_str(),
-	                                payload.length()))
+	                                payload.data(),
+	                                static_cast<DWORD>(payload.size())))
+	{
+		LogHookError(hook_id, "DetourCopyPayloadToProcess failed to copy ProcessTracer pid payload to process");
+	}
 	{
-		LogHookError(hook_func_name.c_str(),
-		             "DetourCopyPayloadToProcess failed to copy ProcessTracer pid payload to process");
+		ProcessTracer::HookRecord record(hook_id);
+		record->AddU32(FieldId::ProcessId, lpProcessInformation->dwProcessId);
+		// the collector has to track the child before it can exit
+		record.Send(ProcessTracer::Lane::Lifecycle);
 	}
-	LogHookInfo(hook_func_name.c_str(), ("Process created successfully with PID: " +
-		            std::to_string(lpProcessInformation->dwProcessId)).c_str());
 	if (!(dwCreationFlags & CREATE_SUSPENDED))
 	{
 		ResumeThread(lpProcessInformation->hThread);
@@ -201,21 +480,112 @@ BOOL WINAPI HookCreateProcessInternalW(
 	return TRUE;
 }
 
+VOID SendWriteSummaries()
+{
+	GetWriteAggregator()->Drain([](uintptr_t key, const ProcessTracer::WriteSummary& summary)
+	{
+		SendWriteSummary(reinterpret_cast<HANDLE>(key), summary);
+	});
+}
+
+VOID SendHookTimings()
+{
+#if PROCESS_TRACER_HOOK_TIMING
+	const auto hook_timing = GetHookTiming();
+	for (size_t index = 1; index < static_cast<size_t>(HookId::Count); ++index)
+	{
+		const auto hook_id = static_cast<HookId>(index);
+		ProcessTracer::Timing::LatencyCounts tracer;
+		ProcessTracer::Timing::LatencyCounts real;
+		hook_timing->Merge(hook_id, tracer, real);
+		if (tracer.count == 0)
+			continue;
+		ProcessTracer::HookRecord record(hook_id, 0, ProcessTracer::EventRecord::RecordType::HookTiming);
+		record->AddU64(FieldId::CallCount, tracer.count);
+		record->AddU64(FieldId::TracerP50, tracer.Percentile(0.5));
+		record->AddU64(FieldId::TracerP99, tracer.Percentile(0.99));
+		record->AddU64(FieldId::TracerMax, tracer.max);
+		record->AddU64(FieldId::RealP50, real.Percentile(0.5));
+		record->AddU64(FieldId::RealP99, real.Percentile(0.99));
+		record->AddU64(FieldId::RealMax, real.max);
+		record.Send();
+	}
+#endif
+}
+
+VOID SendLatencyProfile()
+{
+	ProcessTracer::LatencyProfile::FileLatency process;
+	std::vector<ProcessTracer::LatencyProfile::FileReport> top_files;
+	const size_t file_count = GetLatencyProfile()->Report(process, top_files);
+	auto send = [](const ProcessTracer::LatencyProfile::FileLatency& latency, const std::u16string* path,
+	               size_t files)
+	{
+		ProcessTracer::HookRecord record(HookId::None, 0, ProcessTracer::EventRecord::RecordType::LatencyProfile);
+		record->AddU64(FieldId::CallCount, latency.counts.count);
+		record->AddU64(FieldId::FailedCount, latency.failures);
+		record->AddU64(FieldId::LatencyTotal, latency.counts.sum);
+		record->AddU64(FieldId::LatencyP50, latency.counts.Percentile(0.5));
+		record->AddU64(FieldId::LatencyP99, latency.counts.Percentile(0.99));
+		record->AddU64(FieldId::LatencyP999, latency.counts.Percentile(0.999));
+		record->AddU64(FieldId::LatencyMax, latency.counts.max);
+		if (path)
+			record->AddUtf16(FieldId::Path, path->data(), path->size());
+		else
+			record->AddU64(FieldId::FileCount, files);
+		record.Send();
+	};
+	if (process.counts.count == 0)
+		return;
+	send(process, nullptr, file_count);
+	for (const auto& file : top_files)
+		send(file.latency, &file.path, 0);
+}
+
 VOID WINAPI HookExitProcess(UINT exit_code)
 {
-	DWORD current_pid = GetCurrentProcessId();
-	LogHookInfo("ExitProcess", (std::to_string(current_pid) + " Exited").c_str());
+	SendWriteSummaries();
+	if (GetHookTiming()->Disable())
+		SendHookTimings();
+	if (GetLatencyProfile()->Disable())
+		SendLatencyProfile();
+	// other threads are about to be terminated, push out everything they queued and wait for the
+	// collector to read it: the exit travels on the lifecycle lane and would overtake it otherwise.
+	// The collector reads the lanes independently, so the exit also says how many bulk records it
+	// has to wait for.
+	GetEventPipeline()->Flush();
+	GetEventPipeline()->ReportLosses();
+	GetEventPipeline()->Drain(exit_drain_timeout_ms);
+	{
+		ProcessTracer::HookRecord record(HookId::ExitProcess);
+		record->AddU32(FieldId::ExitCode, exit_code);
+		record->AddU32(FieldId::BulkCount, GetEventPipeline()->ShippedRecords());
+		record.Send(ProcessTracer::Lane::Lifecycle);
+	}
 	RealExitProcess(exit_code);
 }
 
 HANDLE WINAPI HookCreateFileMappingW(HANDLE hFile, LPSECURITY_ATTRIBUTES lpFileMappingAttributes, DWORD flProtect,
                                      DWORD dwMaximumSizeHigh, DWORD dwMaximumSizeLow, LPCWSTR lpName)
 {
-	LogHookInfo("CreateFileMappingW", "called");
-	const auto file_name = GetFileNameFromHandle(hFile);
-	LogHookInfo("CreateFileMappingW", std::string(file_name.begin(), file_name.end()).c_str());
+	HookTimer timer(HookId::CreateFileMappingW);
+	if (ShouldLog(HookId::CreateFileMappingW))
+	{
+		ProcessTracer::HookRecord record(HookId::CreateFileMappingW);
+		// a mapping backed by the paging file has no file, and a handle whose name cannot be queried
+		// gets no Path rather than an empty one
+		if (hFile && hFile != INVALID_HANDLE_VALUE)
+		{
+			ObjectNameBuffer name_buffer;
+			const auto file_name = ResolveFileName(hFile, name_buffer);
+			if (file_name.Buffer)
+				AddUnicodeString(record, FieldId::Path, file_name);
+		}
+		record.Send();
+	}
 
-	return RealCreateFileMappingW(
+	timer.BeginReal();
+	const HANDLE mapping = RealCreateFileMappingW(
 		hFile,
 		lpFileMappingAttributes,
 		flProtect,
@@ -223,6 +593,8 @@ HANDLE WINAPI HookCreateFileMappingW(HANDLE hFile, LPSECURITY_ATTRIBUTES lpFileM
 		dwMaximumSizeLow,
 		lpName
 	);
+	timer.EndReal();
+	return mapping;
 }
 
 
@@ -237,9 +609,12 @@ NTSTATUS NTAPI HookZwWriteFile(
 	PLARGE_INTEGER ByteOffset,
 	PULONG Key)
 {
-	LogHookInfo("ZwWriteFile", "called");
+	HookTimer timer(HookId::ZwWriteFile);
+	if (ShouldLog(HookId::ZwWriteFile))
+		ProcessTracer::HookRecord(HookId::ZwWriteFile).Send();
 
-	return ZwWriteFile(
+	timer.BeginReal();
+	const auto status = ZwWriteFile(
 		FileHandle,
 		Event,
 		ApcRoutine,
@@ -250,6 +625,8 @@ NTSTATUS NTAPI HookZwWriteFile(
 		ByteOffset,
 		Key
 	);
+	timer.EndReal();
+	return status;
 }
 
 NTSTATUS NTAPI HookNtWriteFile(HANDLE FileHandle,
@@ -262,6 +639,8 @@ NTSTATUS NTAPI HookNtWriteFile(HANDLE FileHandle,
                                PLARGE_INTEGER ByteOffset,
                                PULONG Key)
 {
+	HookTimer timer(HookId::NtWriteFile);
+	timer.BeginReal();
 	const auto status = NtWriteFile(
 		FileHandle,
 		Event,
@@ -273,8 +652,29 @@ NTSTATUS NTAPI HookNtWriteFile(HANDLE FileHandle,
 		ByteOffset,
 		Key
 	);
-	const auto name = ConvertWStringToString(GetFileNameFromHandle(FileHandle).c_str());
-	LogHookInfo("NtWriteFile", name.c_str());
+	timer.EndReal();
+	if (ProcessTracer::TracerScope::Active())
+		return status;
+	// a summary counts every write, switching the hook off or sampling it only thins out the events;
+	// failed writes are still reported one by one
+	const BOOL aggregated = NT_SUCCESS(status) && AggregateWrite(FileHandle, Length, ByteOffset);
+	if (!GetHookControl()->ShouldLog(HookId::NtWriteFile))
+		return status;
+	ObjectNameBuffer name_buffer;
+	if (timer.Active() && GetLatencyProfile()->Enabled())
+	{
+		ProfileLatency(HookId::NtWriteFile, status, ResolveFileName(FileHandle, name_buffer), timer);
+		return status;
+	}
+	if (aggregated)
+		return status;
+	const auto file_name = ResolveFileName(FileHandle, name_buffer);
+	if (!PassesPathFilter(file_name))
+		return status;
+	ProcessTracer::HookRecord record(HookId::NtWriteFile, status);
+	record->AddU32(FieldId::Length, Length);
+	AddUnicodeString(record, FieldId::Path, file_name);
+	record.Send();
 	return status;
 }
 
@@ -283,8 +683,9 @@ NTSTATUS NTAPI HookNtCreateSection(PHANDLE SectionHandle, ACCESS_MASK DesiredAcc
                                    ULONG SectionPageProtection,
                                    ULONG AllocationAttributes, HANDLE FileHandle)
 {
-	// LogHookInfo("NtCreateSection", "called");
-	return NtCreateSection(
+	HookTimer timer(HookId::NtCreateSection);
+	timer.BeginReal();
+	const auto status = NtCreateSection(
 		SectionHandle,
 		DesiredAccess,
 		ObjectAttributes,
@@ -293,6 +694,10 @@ NTSTATUS NTAPI HookNtCreateSection(PHANDLE SectionHandle, ACCESS_MASK DesiredAcc
 		AllocationAttributes,
 		FileHandle
 	);
+	timer.EndReal();
+	if (ShouldLog(HookId::NtCreateSection))
+		LogSection(HookId::NtCreateSection, status, FileHandle);
+	return status;
 }
 
 NTSTATUS NTAPI HookZwCreateSection(
@@ -305,8 +710,9 @@ NTSTATUS NTAPI HookZwCreateSection(
 	HANDLE FileHandle
 )
 {
-	// LogHookInfo("ZwCreateSection", "called");
-	return ZwCreateSection(
+	HookTimer timer(HookId::ZwCreateSection);
+	timer.BeginReal();
+	const auto status = ZwCreateSection(
 		SectionHandle,
 		DesiredAccess,
 		ObjectAttributes,
@@ -315,6 +721,10 @@ NTSTATUS NTAPI HookZwCreateSection(
 		AllocationAttributes,
 		FileHandle
 	);
+	timer.EndReal();
+	if (ShouldLog(HookId::ZwCreateSection))
+		LogSection(HookId::ZwCreateSection, status, FileHandle);
+	return status;
 }
 
 NTSTATUS NTAPI HookNtCreateSectionEx(
@@ -329,8 +739,9 @@ NTSTATUS NTAPI HookNtCreateSectionEx(
 	_In_ ULONG ExtendedParameterCount
 )
 {
-	// LogHookInfo("NtCreateSectionEx", "called");
-	return NtCreateSectionEx(
+	HookTimer timer(HookId::NtCreateSectionEx);
+	timer.BeginReal();
+	const auto status = NtCreateSectionEx(
 		SectionHandle,
 		DesiredAccess,
 		ObjectAttributes,
@@ -341,6 +752,10 @@ NTSTATUS NTAPI HookNtCreateSectionEx(
 		ExtendedParameters,
 		ExtendedParameterCount
 	);
+	timer.EndReal();
+	if (ShouldLog(HookId::NtCreateSectionEx))
+		LogSection(HookId::NtCreateSectionEx, status, FileHandle);
+	return status;
 }
 
 
@@ -349,6 +764,8 @@ NTSTATUS __stdcall HookNtCreateFile(PHANDLE FileHandle, ACCESS_MASK DesiredAcces
                                     ULONG ShareAccess,
                                     ULONG CreateDisposition, ULONG CreateOptions, PVOID EaBuffer, ULONG EaLength)
 {
+	HookTimer timer(HookId::NtCreateFile);
+	timer.BeginReal();
 	auto status = NtCreateFile(
 		FileHandle,
 		DesiredAccess,
@@ -362,15 +779,25 @@ NTSTATUS __stdcall HookNtCreateFile(PHANDLE FileHandle, ACCESS_MASK DesiredAcces
 		EaBuffer,
 		EaLength
 	);
-	auto hook_info = GetHookInfoInstance();
-	if (*FileHandle && ObjectAttributes->ObjectName->Length > 0 &&
-		!EndsWith(ConvertWStringToString(ObjectAttributes->ObjectName->Buffer),
-		          "ProcessTracerPipe:" + std::string(hook_info->process_tracer_pid_string_buffer)))
+	timer.EndReal();
+	// the tracer's own files are never looked up by name
+	if (ProcessTracer::TracerScope::Active())
+		return status;
+	if (NT_SUCCESS(status) && ObjectAttributes && ObjectAttributes->ObjectName)
+		RememberFileName(*FileHandle, *ObjectAttributes);
+	ObjectNameBuffer name_buffer;
+	if (FileHandle && *FileHandle && ObjectAttributes && ObjectAttributes->ObjectName &&
+		ObjectAttributes->ObjectName->Length > 0 && ShouldLog(HookId::NtCreateFile))
 	{
-		auto file_name = ConvertWStringToString(ObjectAttributes->ObjectName->Buffer);
-		std::bitset<32> binary(DesiredAccess);
-		auto msg = "[DesiredAccess] " + binary.to_string() + ", [FileName] " + file_name;
-		LogHookNtCreateProcessInfo("NtCreateFile", msg.c_str());
+		const auto file_name = OpenedFileName(*FileHandle, *ObjectAttributes, name_buffer);
+		if (!ProfileLatency(HookId::NtCreateFile, status, file_name, timer) && PassesPathFilter(file_name))
+		{
+			ProcessTracer::HookRecord record(HookId::NtCreateFile, status);
+			record->AddU32(FieldId::AccessMask, DesiredAccess);
+			record->AddU32(FieldId::Disposition, CreateDisposition);
+			AddUnicodeString(record, FieldId::Path, file_name);
+			record.Send();
+		}
 	}
 	return status;
 }
@@ -380,6 +807,8 @@ NTSTATUS NTAPI HookNtMapViewOfSection(HANDLE SectionHandle, HANDLE ProcessHandle
                                       PSIZE_T ViewSize,
                                       SECTION_INHERIT InheritDisposition, ULONG AllocationType, ULONG PageProtection)
 {
+	HookTimer timer(HookId::NtMapViewOfSection);
+	timer.BeginReal();
 	auto status = NtMapViewOfSection(
 		SectionHandle,
 		ProcessHandle,
@@ -392,15 +821,20 @@ NTSTATUS NTAPI HookNtMapViewOfSection(HANDLE SectionHandle, HANDLE ProcessHandle
 		AllocationType,
 		PageProtection
 	);
-	// if (IsSectionFileBacked(SectionHandle) && IsWritableProtection(PageProtection))
-	// {
-	// 	TCHAR path[MAX_PATH];
-	// 	if (GetMappedFileNameW(GetCurrentProcess(), *BaseAddress, path, MAX_PATH))
-	// 	{
-	// 		auto file_name = ConvertWStringToString(path);
-	// 		LogHookInfo("NtMapViewOfSection", file_name.c_str());
-	// 	}
-	// }
+	timer.EndReal();
+	// writable views of files in this process, the checks cost syscalls so the hook has to be enabled first
+	if (NT_SUCCESS(status) && ShouldLog(HookId::NtMapViewOfSection) && IsWritableProtection(PageProtection) &&
+		IsCurrentProcess(ProcessHandle) && IsSectionFileBacked(SectionHandle))
+	{
+		wchar_t path[MAX_PATH];
+		const DWORD length = GetMappedFileNameW(GetCurrentProcess(), *BaseAddress, path, MAX_PATH);
+		if (length > 0)
+		{
+			ProcessTracer::HookRecord record(HookId::NtMapViewOfSection, status);
+			record->AddUtf16(FieldId::Path, AsUtf16(path), length);
+			record.Send();
+		}
+	}
 	return status;
 }
 
@@ -412,8 +846,11 @@ NTSTATUS NTAPI HookNtCreateUserProcess(PHANDLE ProcessHandle, PHANDLE ThreadHand
                                        PRTL_USER_PROCESS_PARAMETERS ProcessParameters, PPS_CREATE_INFO CreateInfo,
                                        PPS_ATTRIBUTE_LIST AttributeList)
 {
-	LogHookInfo("NtCreateUserProcess", "called");
-	return NtCreateUserProcess(
+	HookTimer timer(HookId::NtCreateUserProcess);
+	if (ShouldLog(HookId::NtCreateUserProcess))
+		ProcessTracer::HookRecord(HookId::NtCreateUserProcess).Send();
+	timer.BeginReal();
+	const auto status = NtCreateUserProcess(
 		ProcessHandle,
 		ThreadHandle,
 		ProcessDesiredAccess,
@@ -426,18 +863,23 @@ NTSTATUS NTAPI HookNtCreateUserProcess(PHANDLE ProcessHandle, PHANDLE ThreadHand
 		CreateInfo,
 		AttributeList
 	);
+	timer.EndReal();
+	return status;
 }
 
 BOOL WINAPI HookShellExecuteExW(SHELLEXECUTEINFOW* pExecInfo)
 {
-	auto verb = ConvertWStringToString(pExecInfo->lpVerb);
-	std::string msg = "verb:" + verb;
-	const char* hook_func_name = "ShellExecuteExW";
-	LogHookInfo(hook_func_name, msg.c_str());
+	constexpr auto hook_id = HookId::ShellExecuteExW;
+	HookTimer timer(hook_id);
+	{
+		ProcessTracer::HookRecord record(hook_id);
+		record->AddUtf16(FieldId::Verb, AsUtf16(pExecInfo->lpVerb), Utf16Length(pExecInfo->lpVerb));
+		record.Send();
+	}
 	auto hook_info = GetHookInfoInstance();
-	if (hook_info->can_elevate && StartsWith(verb, "runas"))
+	if (hook_info->can_elevate && pExecInfo->lpVerb && wcsncmp(pExecInfo->lpVerb, L"runas", 5) == 0)
 	{
-		LogHookInfo(hook_func_name, "Start HookShellExecuteW");
+		LogHookInfo(hook_id, ProcessTracer::EventRecord::shell_execute_start_message, ProcessTracer::Lane::Lifecycle);
 		auto map_name = std::string("ProcessTracerArgs:") + std::to_string(hook_info->process_tracer_pid);
 		constexpr DWORD capacity = 1024;
 
@@ -450,7 +892,7 @@ BOOL WINAPI HookShellExecuteExW(SHELLEXECUTEINFOW* pExecInfo)
 		);
 
 		if (h_map == nullptr) {
-			LogHookErrorF(hook_func_name, "Error opening file mapping: %d", GetLastError());
+			LogHookErrorF(hook_id, "Error opening file mapping: %d", GetLastError());
 			return FALSE;
 		}
 
@@ -463,20 +905,20 @@ BOOL WINAPI HookShellExecuteExW(SHELLEXECUTEINFOW* pExecInfo)
 		);
 
 		if (lp_base == nullptr) {
-			LogHookErrorF(hook_func_name,"Error mapping view of file: %d", GetLastError());
+			LogHookErrorF(hook_id,"Error mapping view of file: %d", GetLastError());
 			CloseHandle(h_map);
 			return FALSE;
 		}
 		char* data = static_cast<char*>(lp_base);
 		int messageLength = *reinterpret_cast<int*>(data);
 		if (messageLength < 0 || messageLength >(capacity - sizeof(int))) {
-			LogHookErrorF(hook_func_name, "Invalid message length read: %d", messageLength);
+			LogHookErrorF(hook_id, "Invalid message length read: %d", messageLength);
 			messageLength = 0;
 		}
 		std::string received_message(data + sizeof(int), messageLength);
 
 		std::wstring origin_dir = pExecInfo->lpDirectory;
-		LogHookInfo(hook_func_name, ConvertWStringToString((L"Origin Dir : " + origin_dir).c_str()).c_str());
+		LogHookInfo(hook_id, ConvertWStringToString((L"Origin Dir : " + origin_dir).c_str()).c_str());
 		std::wstring origin_file = pExecInfo->lpFile;
 		std::wstring origin_parameter = pExecInfo->lpParameters;
 		std::wstring new_args = ConvertStringToWString(received_message) + L" -a\"" + ReplaceWString(
@@ -486,36 +928,103 @@ BOOL WINAPI HookShellExecuteExW(SHELLEXECUTEINFOW* pExecInfo)
 		size_t last_slash_pos = dll_path.find_last_of("\\/");
 		dll_path = dll_path.substr(0, last_slash_pos + 1) + "Launcher.exe";
 		std::wstring module_name = ConvertStringToWString(dll_path);
-		LogHookInfo(hook_func_name, ConvertWStringToString((L"module name : " + module_name).c_str()).c_str());
+		LogHookInfo(hook_id, ConvertWStringToString((L"module name : " + module_name).c_str()).c_str());
 		pExecInfo->lpFile = module_name.c_str();
 		pExecInfo->lpParameters = new_args.c_str();
 
-		LogHookInfo(hook_func_name, ConvertWStringToString(new_args.c_str()).c_str());
+		LogHookInfo(hook_id, ConvertWStringToString(new_args.c_str()).c_str());
 
+		timer.BeginReal();
 		auto res = RealShellExecuteExW(pExecInfo);
-		LogHookInfo(hook_func_name, "HookShellExecuteW Finished");
+		timer.EndReal();
+		LogHookInfo(hook_id, "HookShellExecuteW Finished");
 		if (res == FALSE)
 		{
 			auto err = GetLastError();
-			LogHookInfo(hook_func_name, "Error HookShellExecuteW");
-			LogHookErrorF(hook_func_name, "Err : %d", err);
+			LogHookInfo(hook_id, ProcessTracer::EventRecord::shell_execute_error_message, ProcessTracer::Lane::Lifecycle);
+			LogHookErrorF(hook_id, "Err : %d", err);
 			return FALSE;
 		}
 		return TRUE;
 	}
-	return RealShellExecuteExW(pExecInfo);
+	timer.BeginReal();
+	const auto res = RealShellExecuteExW(pExecInfo);
+	timer.EndReal();
+	return res;
 }
 
 NTSTATUS __stdcall HookNtSetInformationFile(HANDLE FileHandle, PIO_STATUS_BLOCK IoStatusBlock, PVOID FileInformation,
                                             ULONG Length, FILE_INFORMATION_CLASS FileInformationClass)
 {
-	auto file_name = ConvertWStringToString(GetFileNameFromHandle(FileHandle).c_str());
-	LogHookInfo("NtSetInformationFile", file_name.c_str());
-	return NtSetInformationFile(
+	HookTimer timer(HookId::NtSetInformationFile);
+	if (!ShouldLog(HookId::NtSetInformationFile))
+	{
+		timer.BeginReal();
+		const auto status = NtSetInformationFile(FileHandle, IoStatusBlock, FileInformation, Length,
+		                                         FileInformationClass);
+		timer.EndReal();
+		ForgetRenamedFile(FileHandle, FileInformationClass, status);
+		return status;
+	}
+	ObjectNameBuffer name_buffer;
+	const auto file_name = ResolveFileName(FileHandle, name_buffer);
+	timer.BeginReal();
+	const auto status = NtSetInformationFile(
 		FileHandle,
 		IoStatusBlock,
 		FileInformation,
 		Length,
 		FileInformationClass
 	);
+	timer.EndReal();
+	ForgetRenamedFile(FileHandle, FileInformationClass, status);
+	if (ProfileLatency(HookId::NtSetInformationFile, status, file_name, timer) || !PassesPathFilter(file_name))
+		return status;
+	ProcessTracer::HookRecord record(HookId::NtSetInformationFile, status);
+	record->AddU32(FieldId::InformationClass, FileInformationClass);
+	AddUnicodeString(record, FieldId::Path, file_name);
+	record.Send();
+	return status;
+}
+
+NTSTATUS NTAPI HookNtClose(HANDLE Handle)
+{
+	HookTimer timer(HookId::NtClose);
+	if (GetHookInfoInstance()->aggregate_writes)
+	{
+		ProcessTracer::WriteSummary summary;
+		if (GetWriteAggregator()->Take(HandleKey(Handle), summary))
+			SendWriteSummary(Handle, summary);
+	}
+	// forget the handle before its value can be handed out again
+	GetHandlePathTable()->Erase(HandleKey(Handle));
+	timer.BeginReal();
+	const auto status = NtClose(Handle);
+	timer.EndReal();
+	return status;
+}
+
+NTSTATUS NTAPI HookNtDuplicateObject(HANDLE SourceProcessHandle, HANDLE SourceHandle, HANDLE TargetProcessHandle,
+                                     PHANDLE TargetHandle, ACCESS_MASK DesiredAccess, ULONG HandleAttributes,
+                                     ULONG Options)
+{
+	HookTimer timer(HookId::NtDuplicateObject);
+	const BOOL from_current_process = IsCurrentProcess(SourceProcessHandle);
+	char16_t path[ProcessTracer::HandlePathTable::max_path_length];
+	size_t length = 0;
+	if (from_current_process)
+	{
+		length = GetHandlePathTable()->Lookup(HandleKey(SourceHandle), path, std::size(path));
+		// the source is closed even when the duplication fails
+		if (Options & DUPLICATE_CLOSE_SOURCE)
+			GetHandlePathTable()->Erase(HandleKey(SourceHandle));
+	}
+	timer.BeginReal();
+	const auto status = NtDuplicateObject(SourceProcessHandle, SourceHandle, TargetProcessHandle, TargetHandle,
+	                                      DesiredAccess, HandleAttributes, Options);
+	timer.EndReal();
+	if (NT_SUCCESS(status) && length != 0 && TargetHandle && TargetProcessHandle &&
+		IsCurrentProcess(TargetProcessHandle))
+		GetHandlePathTable()->Insert(HandleKey(*TargetHandle), path, length);
+	return status;
 }
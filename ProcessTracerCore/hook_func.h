@@ -19,6 +19,15 @@ BOOL WINAPI HookCreateProcessInternalW(
 
 VOID WINAPI HookExitProcess(UINT exit_code);
 
+// reports the write summaries of every handle still open, see --aggregate-writes
+VOID SendWriteSummaries();
+
+// reports the call count and latency percentiles of every hook, see --hook-timing
+VOID SendHookTimings();
+
+// reports the process latency percentiles and the slowest files, see --latency-profile
+VOID SendLatencyProfile();
+
 HANDLE WINAPI HookCreateFileMappingW(
 	_In_ HANDLE hFile,
 	_In_opt_ LPSECURITY_ATTRIBUTES lpFileMappingAttributes,
@@ -133,3 +142,17 @@ NTSTATUS NTAPI HookNtSetInformationFile(
 	_In_ ULONG Length,
 	_In_ FILE_INFORMATION_CLASS FileInformationClass
 );
+
+NTSTATUS NTAPI HookNtClose(
+	_In_ HANDLE Handle
+);
+
+NTSTATUS NTAPI HookNtDuplicateObject(
+	_In_ HANDLE SourceProcessHandle,
+	_In_ HANDLE SourceHandle,
+	_In_opt_ HANDLE TargetProcessHandle,
+	_Out_opt_ PHANDLE TargetHandle,
+	_In_ ACCESS_MASK DesiredAccess,
+	_In_ ULONG HandleAttributes,
+	_In_ ULONG Options
+);
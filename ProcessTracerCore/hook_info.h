@@ -1,12 +1,19 @@
 #pragma once
+#include <cstdint>
+#include <string>
 
 struct HookInfo
 {
 	char dll_path[MAX_PATH];
 	char exe_name[MAX_PATH];
 	int process_tracer_pid;
-	char process_tracer_pid_string_buffer[10];
 	bool can_elevate = true;
+	// report one summary per handle instead of every NtWriteFile call
+	bool aggregate_writes = false;
+	// detoured functions, one bit per EventRecord::HookId
+	uint64_t hook_mask = 0;
+	// the payload this process was started with, forwarded verbatim to child processes
+	std::string config_payload;
 };
 
 HookInfo* GetHookInfoInstance();
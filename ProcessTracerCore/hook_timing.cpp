@@ -0,0 +1,65 @@
+#include "pch.h"
+#include "hook_timing.h"
+
+#include <new>
+
+namespace
+{
+	ProcessTracer::HookTiming g_hook_timing;
+}
+
+ProcessTracer::HookTiming* GetHookTiming()
+{
+	return &g_hook_timing;
+}
+
+ProcessTracer::HookTiming::ThreadHistograms* ProcessTracer::HookTiming::CurrentThreadHistograms()
+{
+	if (t_histograms)
+		return t_histograms;
+	for (auto histograms = m_threads.load(std::memory_order_acquire); histograms; histograms = histograms->next)
+	{
+		bool in_use = false;
+		if (histograms->in_use.compare_exchange_strong(in_use, true, std::memory_order_acquire))
+			return t_histograms = histograms;
+	}
+
+	const auto histograms = new(std::nothrow) ThreadHistograms;
+	if (!histograms)
+		return nullptr;
+	histograms->next = m_threads.load(std::memory_order_relaxed);
+	while (!m_threads.compare_exchange_weak(histograms->next, histograms, std::memory_order_release,
+	                                        std::memory_order_relaxed))
+	{
+	}
+	return t_histograms = histograms;
+}
+
+void ProcessTracer::HookTiming::Record(EventRecord::HookId hook_id, uint64_t tracer_ns, uint64_t real_ns)
+{
+	const auto histograms = CurrentThreadHistograms();
+	if (!histograms)
+		return;
+	const auto index = static_cast<size_t>(hook_id);
+	histograms->tracer[index].Record(tracer_ns);
+	histograms->real[index].Record(real_ns);
+}
+
+void ProcessTracer::HookTiming::DetachThread()
+{
+	if (!t_histograms)
+		return;
+	t_histograms->in_use.store(false, std::memory_order_release);
+	t_histograms = nullptr;
+}
+
+void ProcessTracer::HookTiming::Merge(EventRecord::HookId hook_id, Timing::LatencyCounts& tracer,
+                                      Timing::LatencyCounts& real) const
+{
+	const auto index = static_cast<size_t>(hook_id);
+	for (auto histograms = m_threads.load(std::memory_order_acquire); histograms; histograms = histograms->next)
+	{
+		histograms->tracer[index].MergeInto(tracer);
+		histograms->real[index].MergeInto(real);
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <atomic>
+
+#include "event_record.h"
+#include "latency_histogram.h"
+
+// 0 compiles the timing out of every hook, not even the enabled check remains.
+#ifndef PROCESS_TRACER_HOOK_TIMING
+#define PROCESS_TRACER_HOOK_TIMING 1
+#endif
+
+namespace ProcessTracer
+{
+	// Histograms of the time each hook spends in tracer code and in the real function. Every thread
+	// records into histograms of its own, a report merges all of them. The histograms of an exited
+	// thread go to the next new thread; their counts stay and keep adding up.
+	class HookTiming
+	{
+		static constexpr size_t hook_count = static_cast<size_t>(EventRecord::HookId::Count);
+
+		struct ThreadHistograms
+		{
+			Timing::ThreadLatencyHistogram tracer[hook_count];
+			Timing::ThreadLatencyHistogram real[hook_count];
+			std::atomic<bool> in_use{true};
+			ThreadHistograms* next = nullptr;
+		};
+
+		static inline thread_local ThreadHistograms* t_histograms = nullptr;
+
+		std::atomic<bool> m_enabled{false};
+		// only ever grows, readers walk it without a lock
+		std::atomic<ThreadHistograms*> m_threads{nullptr};
+
+		ThreadHistograms* CurrentThreadHistograms();
+
+	public:
+		HookTiming() = default;
+		HookTiming(const HookTiming&) = delete;
+		HookTiming& operator=(const HookTiming&) = delete;
+
+		void Enable()
+		{
+			m_enabled.store(true, std::memory_order_relaxed);
+		}
+
+		// stops recording, true when it was on; the final report is sent once
+		bool Disable()
+		{
+			return m_enabled.exchange(false, std::memory_order_relaxed);
+		}
+
+		bool Enabled() const
+		{
+			return m_enabled.load(std::memory_order_relaxed);
+		}
+
+		void Record(EventRecord::HookId hook_id, uint64_t tracer_ns, uint64_t real_ns);
+		void DetachThread();
+		// adds the histograms of hook_id from every thread
+		void Merge(EventRecord::HookId hook_id, Timing::LatencyCounts& tracer, Timing::LatencyCounts& real) const;
+	};
+}
+
+ProcessTracer::HookTiming* GetHookTiming();
@@ -0,0 +1,60 @@
+#include "pch.h"
+#include "latency_profile.h"
+
+#include <algorithm>
+
+namespace
+{
+	ProcessTracer::LatencyProfile g_latency_profile;
+}
+
+ProcessTracer::LatencyProfile* GetLatencyProfile()
+{
+	return &g_latency_profile;
+}
+
+void ProcessTracer::LatencyProfile::Enable(uint64_t threshold_ns, uint32_t top_files)
+{
+	m_threshold_ns = threshold_ns ? threshold_ns : default_threshold_ns;
+	m_top_files = top_files ? top_files : default_top_files;
+	m_enabled.store(true, std::memory_order_relaxed);
+}
+
+bool ProcessTracer::LatencyProfile::Add(const char16_t* path, size_t length, uint64_t duration_ns, bool failed)
+{
+	const std::u16string_view key(path, path ? length : 0);
+	m_lock.LockExclusive();
+	m_process.counts.Add(duration_ns);
+	m_process.failures += failed;
+	auto file = m_files.find(key);
+	if (file == m_files.end() && m_files.size() < max_files)
+		file = m_files.emplace(std::u16string(key), FileLatency()).first;
+	if (file != m_files.end())
+	{
+		file->second.counts.Add(duration_ns);
+		file->second.failures += failed;
+	}
+	m_lock.UnlockExclusive();
+	return duration_ns > m_threshold_ns;
+}
+
+size_t ProcessTracer::LatencyProfile::Report(FileLatency& process, std::vector<FileReport>& top_files)
+{
+	m_lock.LockShared();
+	process = m_process;
+	std::vector<const std::pair<const std::u16string, FileLatency>*> files;
+	files.reserve(m_files.size());
+	for (const auto& file : m_files)
+		files.push_back(&file);
+	const size_t count = std::min<size_t>(m_top_files, files.size());
+	std::partial_sort(files.begin(), files.begin() + count, files.end(), [](const auto* left, const auto* right)
+	{
+		return left->second.counts.sum > right->second.counts.sum;
+	});
+	top_files.clear();
+	for (size_t i = 0; i < count; ++i)
+		top_files.push_back({files[i]->first, files[i]->second});
+	const size_t file_count = m_files.size();
+	m_lock.UnlockShared();
+	return file_count;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "event_record.h"
+#include "latency_histogram.h"
+#include "platform.h"
+
+namespace ProcessTracer
+{
+	// Duration of the real call of the file hooks, per file. Calls above the threshold are reported
+	// one by one, every call counts towards the histogram of its file and of the whole process.
+	class LatencyProfile
+	{
+	public:
+		static constexpr uint64_t default_threshold_ns = 10'000'000;
+		static constexpr uint32_t default_top_files = 10;
+		static constexpr size_t max_files = 1024; // later files only count towards the process
+
+		struct FileLatency
+		{
+			Timing::LatencyCounts counts;
+			uint64_t failures = 0;
+		};
+
+		struct FileReport
+		{
+			std::u16string path;
+			FileLatency latency;
+		};
+
+		static constexpr bool Profiles(EventRecord::HookId hook_id)
+		{
+			return hook_id == EventRecord::HookId::NtCreateFile || hook_id == EventRecord::HookId::NtWriteFile ||
+				hook_id == EventRecord::HookId::NtSetInformationFile;
+		}
+
+	private:
+		std::atomic<bool> m_enabled{false};
+		uint64_t m_threshold_ns = default_threshold_ns;
+		uint32_t m_top_files = default_top_files;
+		Platform::SharedLock m_lock;
+		FileLatency m_process;
+		std::map<std::u16string, FileLatency, std::less<>> m_files;
+
+	public:
+		LatencyProfile() = default;
+		LatencyProfile(const LatencyProfile&) = delete;
+		LatencyProfile& operator=(const LatencyProfile&) = delete;
+
+		// 0 keeps the default threshold or number of files
+		void Enable(uint64_t threshold_ns, uint32_t top_files);
+
+		// stops profiling, true when it was on; the final report is sent once
+		bool Disable()
+		{
+			return m_enabled.exchange(false, std::memory_order_relaxed);
+		}
+
+		bool Enabled() const
+		{
+			return m_enabled.load(std::memory_order_relaxed);
+		}
+
+		// Counts one call, true when it took longer than the threshold and is reported on its own.
+		bool Add(const char16_t* path, size_t length, uint64_t duration_ns, bool failed);
+		// The totals of the process and the files that took the most time, slowest first. Returns
+		// the number of files seen.
+		size_t Report(FileLatency& process, std::vector<FileReport>& top_files);
+	};
+}
+
+ProcessTracer::LatencyProfile* GetLatencyProfile();
@@ -1,170 +1,124 @@
 #include "pch.h"
 #include "logger.h"
 
-#include <codecvt>
-#include <locale>
-
-#include "hook_func.h"
-#include "origin.h"
-
 ProcessTracer::Logger ProcessTracer::Logger::g_logger(0, 0);
 
-static std::wstring ConvertPipePath(const std::string& ansiPath)
+namespace
 {
-	std::wstring result;
+	constexpr size_t sequence_field_size = sizeof(ProcessTracer::EventRecord::FieldHeader) + sizeof(uint32_t);
+}
 
-	std::string prefix = R"(\\.\pipe\)";
-	if (ansiPath.find(prefix) == 0)
-	{
-		std::string pipeName = ansiPath.substr(prefix.length());
-		result = L"\\Device\\NamedPipe\\" + std::wstring(pipeName.begin(), pipeName.end());
-	}
-	else
-	{
-		result = std::wstring(ansiPath.begin(), ansiPath.end());
-	}
+ProcessTracer::Logger::Logger(int process_tracer_pid, int pid, const TraceClock::Calibration& clock)
+{
+	if (process_tracer_pid == 0)
+		return;
+	m_process_tracer_pid = process_tracer_pid;
+	m_pid = pid;
+	m_clock = TraceClock::Converter(clock);
+}
 
-	return result;
+VOID ProcessTracer::Logger::BeginRecord(EventRecord::RecordWriter& writer, EventRecord::RecordType type,
+                                        EventRecord::HookId hook_id, int32_t status) const
+{
+	writer.Begin(type, hook_id, static_cast<uint32_t>(m_pid), GetCurrentThreadId(), m_clock.Now(), status);
+	// the sequence number is added last, keep room for it however long the message gets
+	writer.Reserve(sequence_field_size);
 }
 
-BOOL ProcessTracer::Logger::WriteToPipe(const char* prefix, const char* message, const char* postfix) const
+BOOL ProcessTracer::Logger::Send(EventRecord::RecordWriter& writer, Lane lane) const
 {
+	writer.Release(sequence_field_size);
 	if (m_process_tracer_pid == 0)
 		return FALSE;
-	std::string fullMessage = "pid:" + std::to_string(m_pid) + " " + std::string(prefix) + message + postfix;
-	DWORD bytesWritten = 0;
-	HANDLE hPipe = CreateFileA(
-		pipe_file_string.c_str(),
-		GENERIC_WRITE,
-		0,
-		nullptr,
-		OPEN_EXISTING,
-		0,
-		nullptr);
-	IO_STATUS_BLOCK iosb = {};
-	auto status = NtWriteFile(
-		hPipe,
-		nullptr, // Event
-		nullptr, // ApcRoutine
-		nullptr, // ApcContext
-		&iosb,
-		(PVOID)fullMessage.c_str(),
-		fullMessage.length(),
-		nullptr,
-		nullptr // Key
-	);
-
-	BOOL result = (status == 0); // STATUS_SUCCESS == 0
-	bytesWritten = (DWORD)iosb.Information;
-
-	CloseHandle(hPipe);
-	return result && (bytesWritten == fullMessage.length());
-}
-
-BOOL ProcessTracer::Logger::WriteToPipeNtCreateProcess(const char* prefix, const char* message,
-                                                       const char* postfix) const
+	// lifecycle records travel on their own connection and are never dropped, only bulk ones are
+	// numbered: the pipeline fills in the sequence number once the record is shipped, so that the
+	// tracer notices gaps the process did not count itself
+	if (lane == Lane::Bulk)
+		writer.AddU32(EventRecord::FieldId::Sequence, 0);
+	const size_t size = writer.Finish();
+	return GetEventPipeline()->Write(writer.Data(), size, lane);
+}
+
+BOOL ProcessTracer::Logger::WriteMessage(EventRecord::RecordType type, EventRecord::HookId hook_id,
+                                         const char* message, Lane lane) const
 {
-	if (m_process_tracer_pid == 0)
-		return FALSE;
-	std::string fullMessage = "pid:" + std::to_string(m_pid) + " " + std::string(prefix) + message + postfix;
-	HANDLE hPipe = nullptr;
-	UNICODE_STRING uPipeName;
-	RtlInitUnicodeString(&uPipeName, pipe_file_w_string.c_str());
-
-	OBJECT_ATTRIBUTES objAttr;
-	InitializeObjectAttributes(&objAttr, &uPipeName, OBJ_CASE_INSENSITIVE, NULL, NULL);
-
-	IO_STATUS_BLOCK ioStatusBlock;
-	NTSTATUS status = NtCreateFile(
-		&hPipe,
-		GENERIC_WRITE | SYNCHRONIZE,
-		&objAttr,
-		&ioStatusBlock,
-		nullptr,
-		0,
-		0,
-		FILE_OPEN,
-		FILE_SYNCHRONOUS_IO_NONALERT,
-		nullptr,
-		0
-	);
-	if (!NT_SUCCESS(status))
-	{
-		if (hPipe)
-		{
-			CloseHandle(hPipe);
-		}
-		return FALSE; // Failed to open pipe
-	}
-	IO_STATUS_BLOCK iosb = {0};
-	status = NtWriteFile(
-		hPipe,
-		nullptr, // Event
-		nullptr, // ApcRoutine
-		nullptr, // ApcContext
-		&iosb,
-		PVOID(fullMessage.c_str()),
-		fullMessage.length(),
-		nullptr,
-		nullptr // Key
-	);
-
-	BOOL result = (status == 0); // STATUS_SUCCESS == 0
-	auto bytesWritten = (DWORD)iosb.Information;
-
-	CloseHandle(hPipe);
-	return result && (bytesWritten == fullMessage.length());
-}
-
-ProcessTracer::Logger::Logger(int process_tracer_pid, int pid)
+	char buffer[hook_record_capacity];
+	EventRecord::RecordWriter writer(buffer, sizeof(buffer));
+	BeginRecord(writer, type, hook_id, 0);
+	writer.AddUtf8(EventRecord::FieldId::Message, message);
+	return Send(writer, lane);
+}
+
+BOOL ProcessTracer::Logger::WriteMessage(EventRecord::RecordType type, EventRecord::HookId hook_id,
+                                         const wchar_t* message) const
 {
-	if (process_tracer_pid == 0)
-		return;
-	m_process_tracer_pid = process_tracer_pid;
-	m_pid = pid;
-	pipe_file_string = "\\\\.\\pipe\\ProcessTracerPipe:" + std::to_string(m_process_tracer_pid);
-	pipe_file_w_string = ConvertPipePath(pipe_file_string);
-	// pipe_file_string = "\\\\.\\pipe\\ProcessTracerPipe";
+	char buffer[hook_record_capacity];
+	EventRecord::RecordWriter writer(buffer, sizeof(buffer));
+	BeginRecord(writer, type, hook_id, 0);
+	writer.AddUtf16(EventRecord::FieldId::Message, reinterpret_cast<const char16_t*>(message),
+	                message ? wcslen(message) : 0);
+	return Send(writer);
 }
 
-BOOL ProcessTracer::Logger::Info(const char* message) const
+BOOL ProcessTracer::Logger::WriteFormatted(EventRecord::RecordType type, EventRecord::HookId hook_id,
+                                           const char* format, va_list args) const
 {
-	return WriteToPipe("[Info] ", message, "\n");
+	char buffer[hook_record_capacity];
+	EventRecord::RecordWriter writer(buffer, sizeof(buffer));
+	BeginRecord(writer, type, hook_id, 0);
+	writer.AddUtf8V(EventRecord::FieldId::Message, format, args);
+	return Send(writer);
+}
+
+BOOL ProcessTracer::Logger::Info(const char* message, Lane lane) const
+{
+	return WriteMessage(EventRecord::RecordType::Info, EventRecord::HookId::None, message, lane);
 }
 
 BOOL ProcessTracer::Logger::Info(const wchar_t* message) const
 {
-	std::wstring temp(message);
-	return Info(std::string(temp.begin(), temp.end()).c_str());
+	return WriteMessage(EventRecord::RecordType::Info, EventRecord::HookId::None, message);
 }
 
 BOOL ProcessTracer::Logger::Error(const char* message) const
 {
-	return WriteToPipe("[Error] ", message, "\n");
+	return WriteMessage(EventRecord::RecordType::Error, EventRecord::HookId::None, message);
 }
 
 BOOL ProcessTracer::Logger::Error(const wchar_t* message) const
 {
-	std::wstring temp(message);
-	return Error(std::string(temp.begin(), temp.end()).c_str());
+	return WriteMessage(EventRecord::RecordType::Error, EventRecord::HookId::None, message);
+}
+
+BOOL ProcessTracer::Logger::HookInfo(EventRecord::HookId hook_id, const char* message, Lane lane) const
+{
+	return WriteMessage(EventRecord::RecordType::HookInfo, hook_id, message, lane);
+}
+
+BOOL ProcessTracer::Logger::HookError(EventRecord::HookId hook_id, const char* message) const
+{
+	return WriteMessage(EventRecord::RecordType::HookError, hook_id, message);
 }
 
-BOOL ProcessTracer::Logger::HookInfo(const char* hook_func_name, const char* message) const
+BOOL ProcessTracer::Logger::Loss(EventRecord::LossStage stage, EventRecord::HookId hook_id, uint64_t lost) const
 {
-	const std::string full_message = std::string(hook_func_name) + " " + message;
-	return WriteToPipe("[Hook] ", full_message.c_str(), "\n");
+	char buffer[128];
+	EventRecord::RecordWriter writer(buffer, sizeof(buffer));
+	BeginRecord(writer, EventRecord::RecordType::Loss, hook_id, 0);
+	writer.AddU64(EventRecord::FieldId::LostCount, lost);
+	writer.AddU32(EventRecord::FieldId::LossStage, static_cast<uint32_t>(stage));
+	return Send(writer, Lane::Lifecycle);
 }
 
-BOOL ProcessTracer::Logger::HookNtCreateProcessInfo(const char* hook_func_name, const char* message) const
+ProcessTracer::HookRecord::HookRecord(EventRecord::HookId hook_id, int32_t status, EventRecord::RecordType type)
+	: m_writer(m_buffer, sizeof(m_buffer))
 {
-	const std::string full_message = std::string(hook_func_name) + " " + message;
-	return WriteToPipeNtCreateProcess("[Hook] ", full_message.c_str(), "\n");
+	Logger::g_logger.BeginRecord(m_writer, type, hook_id, status);
 }
 
-BOOL ProcessTracer::Logger::HookError(const char* hook_func_name, const char* message) const
+BOOL ProcessTracer::HookRecord::Send(Lane lane)
 {
-	const std::string full_message = std::string(hook_func_name) + " " + message;
-	return WriteToPipe("[Hook Error] ", full_message.c_str(), "\n");
+	return Logger::g_logger.Send(m_writer, lane);
 }
 
 void LogError(const char* msg)
@@ -172,74 +126,53 @@ void LogError(const char* msg)
 	auto _ = ProcessTracer::Logger::g_logger.Error(msg);
 }
 
-void LogInfo(const char* msg)
+void LogInfo(const char* msg, ProcessTracer::Lane lane)
 {
-	auto _ = ProcessTracer::Logger::g_logger.Info(msg);
+	auto _ = ProcessTracer::Logger::g_logger.Info(msg, lane);
 }
 
 void LogInfoF(const char* msg, ...)
 {
-	char buffer[1024];
 	va_list args;
 	va_start(args, msg);
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wformat-nonliteral"
-	auto _ = vsnprintf(buffer, sizeof(buffer), msg, args);
-#pragma clang diagnostic pop
+	auto _ = ProcessTracer::Logger::g_logger.WriteFormatted(ProcessTracer::EventRecord::RecordType::Info,
+	                                                        ProcessTracer::EventRecord::HookId::None, msg, args);
 	va_end(args);
-	LogInfo(buffer);
 }
 
 void LogErrorF(const char* msg, ...)
 {
-	char buffer[1024];
 	va_list args;
 	va_start(args, msg);
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wformat-nonliteral"
-	auto _ = vsnprintf(buffer, sizeof(buffer), msg, args);
-#pragma clang diagnostic pop
+	auto _ = ProcessTracer::Logger::g_logger.WriteFormatted(ProcessTracer::EventRecord::RecordType::Error,
+	                                                        ProcessTracer::EventRecord::HookId::None, msg, args);
 	va_end(args);
-	LogError(buffer);
 }
 
-void LogHookInfo(const char* hook_func_name, const char* msg)
+void LogHookInfo(ProcessTracer::EventRecord::HookId hook_id, const char* msg, ProcessTracer::Lane lane)
 {
-	auto _ = ProcessTracer::Logger::g_logger.HookInfo(hook_func_name, msg);
+	auto _ = ProcessTracer::Logger::g_logger.HookInfo(hook_id, msg, lane);
 }
 
-void LogHookInfoF(const char* hook_func_name, const char* msg, ...)
+void LogHookInfoF(ProcessTracer::EventRecord::HookId hook_id, const char* msg, ...)
 {
-	char buffer[1024];
 	va_list args;
 	va_start(args, msg);
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wformat-nonliteral"
-	auto _ = vsnprintf(buffer, sizeof(buffer), msg, args);
-#pragma clang diagnostic pop
+	auto _ = ProcessTracer::Logger::g_logger.WriteFormatted(ProcessTracer::EventRecord::RecordType::HookInfo,
+	                                                        hook_id, msg, args);
 	va_end(args);
-	LogHookInfo(hook_func_name, buffer);
-}
-
-void LogHookNtCreateProcessInfo(const char* hook_func_name, const char* msg)
-{
-	auto _ = ProcessTracer::Logger::g_logger.HookNtCreateProcessInfo(hook_func_name, msg);
 }
 
-void LogHookError(const char* hook_func_name, const char* msg)
+void LogHookError(ProcessTracer::EventRecord::HookId hook_id, const char* msg)
 {
-	auto _ = ProcessTracer::Logger::g_logger.HookError(hook_func_name, msg);
+	auto _ = ProcessTracer::Logger::g_logger.HookError(hook_id, msg);
 }
 
-void LogHookErrorF(const char* hook_func_name, const char* msg, ...)
+void LogHookErrorF(ProcessTracer::EventRecord::HookId hook_id, const char* msg, ...)
 {
-	char buffer[1024];
 	va_list args;
 	va_start(args, msg);
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wformat-nonliteral"
-	auto _ = vsnprintf(buffer, sizeof(buffer), msg, args);
-#pragma clang diagnostic pop
+	auto _ = ProcessTracer::Logger::g_logger.WriteFormatted(ProcessTracer::EventRecord::RecordType::HookError,
+	                                                        hook_id, msg, args);
 	va_end(args);
-	LogHookError(hook_func_name, buffer);
 }
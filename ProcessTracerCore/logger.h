@@ -1,40 +1,77 @@
 #pragma once
-#include <string>
+#include "event_pipeline.h"
+#include "event_record.h"
+#include "trace_clock.h"
 
 namespace ProcessTracer
 {
+	constexpr size_t hook_record_capacity = 4096;
+
 	class Logger
 	{
 		int m_process_tracer_pid = 0;
 		int m_pid = 0;
-		std::string pipe_file_string;
-		std::wstring pipe_file_w_string;
+		TraceClock::Converter m_clock;
 
-		BOOL WriteToPipe(const char* prefix, const char* message, const char* postfix) const;
-		BOOL WriteToPipeNtCreateProcess(const char* prefix, const char* message, const char* postfix) const;
+		BOOL WriteMessage(EventRecord::RecordType type, EventRecord::HookId hook_id, const char* message,
+		                  Lane lane = Lane::Bulk) const;
+		BOOL WriteMessage(EventRecord::RecordType type, EventRecord::HookId hook_id, const wchar_t* message) const;
 
 	public:
 		static Logger g_logger;
 
-		Logger(int process_tracer_pid, int pid);
+		Logger(int process_tracer_pid, int pid, const TraceClock::Calibration& clock = {});
+
+		// nanoseconds since the trace epoch, the timestamp a record begun now would get
+		uint64_t Now() const
+		{
+			return m_clock.Now();
+		}
+
+		// starts a record on behalf of the calling thread
+		VOID BeginRecord(EventRecord::RecordWriter& writer, EventRecord::RecordType type,
+		                 EventRecord::HookId hook_id, int32_t status) const;
+		BOOL Send(EventRecord::RecordWriter& writer, Lane lane = Lane::Bulk) const;
+		// formats into the record itself, no intermediate buffer and no allocation
+		BOOL WriteFormatted(EventRecord::RecordType type, EventRecord::HookId hook_id, const char* format,
+		                    va_list args) const;
 
-		BOOL Info(const char* message) const;
+		BOOL Info(const char* message, Lane lane = Lane::Bulk) const;
 		BOOL Info(const wchar_t* message) const;
 		BOOL Error(const char* message) const;
 		BOOL Error(const wchar_t* message) const;
-		BOOL HookInfo(const char* hook_func_name, const char* message) const;
-		BOOL HookNtCreateProcessInfo(const char* hook_func_name, const char* message) const;
-		BOOL HookError(const char* hook_func_name, const char* message) const;
+		BOOL HookInfo(EventRecord::HookId hook_id, const char* message, Lane lane = Lane::Bulk) const;
+		BOOL HookError(EventRecord::HookId hook_id, const char* message) const;
+		// tells the tracer that lost events of hook_id never left this process
+		BOOL Loss(EventRecord::LossStage stage, EventRecord::HookId hook_id, uint64_t lost) const;
+	};
+
+	// A record built on the stack of the hooked call: add its typed fields, then Send() it.
+	class HookRecord
+	{
+		char m_buffer[hook_record_capacity];
+		EventRecord::RecordWriter m_writer;
+
+	public:
+		explicit HookRecord(EventRecord::HookId hook_id, int32_t status = 0,
+		                    EventRecord::RecordType type = EventRecord::RecordType::HookInfo);
+
+		EventRecord::RecordWriter* operator->()
+		{
+			return &m_writer;
+		}
+
+		BOOL Send(Lane lane = Lane::Bulk);
 	};
 }
 
 // wrap the g_logger call in Logger class
 VOID LogError(const char* msg);
-VOID LogInfo(const char* msg);
+VOID LogInfo(const char* msg, ProcessTracer::Lane lane = ProcessTracer::Lane::Bulk);
 VOID LogInfoF(const char* msg , ...);
 VOID LogErrorF(const char* msg, ...);
-VOID LogHookInfo(const char* hook_func_name, const char* msg);
-VOID LogHookInfoF(const char* hook_func_name, const char* msg, ...);
-VOID LogHookNtCreateProcessInfo(const char* hook_func_name, const char* msg);
-VOID LogHookError(const char* hook_func_name, const char* msg);
-VOID LogHookErrorF(const char* hook_func_name, const char* msg, ...);
+VOID LogHookInfo(ProcessTracer::EventRecord::HookId hook_id, const char* msg,
+                 ProcessTracer::Lane lane = ProcessTracer::Lane::Bulk);
+VOID LogHookInfoF(ProcessTracer::EventRecord::HookId hook_id, const char* msg, ...);
+VOID LogHookError(ProcessTracer::EventRecord::HookId hook_id, const char* msg);
+VOID LogHookErrorF(ProcessTracer::EventRecord::HookId hook_id, const char* msg, ...);
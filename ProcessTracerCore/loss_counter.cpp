@@ -0,0 +1,42 @@
+#include "pch.h"
+#include "loss_counter.h"
+
+void ProcessTracer::LossCounter::Add(EventRecord::LossStage stage, EventRecord::HookId hook_id, uint64_t count)
+{
+	const size_t stage_index = stage == EventRecord::LossStage::Transport ? 1 : 0;
+	size_t hook = static_cast<size_t>(hook_id);
+	if (hook >= hook_count)
+		hook = 0;
+	m_lost[stage_index][hook].fetch_add(count, std::memory_order_relaxed);
+	m_pending.store(true, std::memory_order_release);
+}
+
+void ProcessTracer::LossCounter::AddRecords(EventRecord::LossStage stage, const char* data, size_t length)
+{
+	size_t offset = 0;
+	while (length - offset >= sizeof(EventRecord::RecordHeader))
+	{
+		EventRecord::RecordHeader header;
+		memcpy(&header, data + offset, sizeof(header));
+		if (header.magic != EventRecord::record_magic || header.size < sizeof(header) || header.size > length - offset)
+		{
+			// not a record after all, still one lost message
+			Add(stage, EventRecord::HookId::None);
+			return;
+		}
+		Add(stage, header.hook_id);
+		offset += header.size;
+	}
+}
+
+void ProcessTracer::LossCounter::AddHeader(EventRecord::LossStage stage, const char* head, size_t length)
+{
+	EventRecord::RecordHeader header;
+	if (length < sizeof(header))
+	{
+		Add(stage, EventRecord::HookId::None);
+		return;
+	}
+	memcpy(&header, head, sizeof(header));
+	Add(stage, header.magic == EventRecord::record_magic ? header.hook_id : EventRecord::HookId::None);
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "event_record.h"
+
+namespace ProcessTracer
+{
+	// Events the process could not deliver, per stage and hook. Adding is lock-free, Report hands out
+	// what was added since the previous report and is called by one thread at a time.
+	class LossCounter
+	{
+		static constexpr size_t stage_count = 2; // LossStage::Buffer and LossStage::Transport
+		static constexpr size_t hook_count = static_cast<size_t>(EventRecord::HookId::Count);
+
+		std::atomic<uint64_t> m_lost[stage_count][hook_count] = {};
+		uint64_t m_reported[stage_count][hook_count] = {};
+		std::atomic<bool> m_pending{false};
+
+	public:
+		LossCounter() = default;
+		LossCounter(const LossCounter&) = delete;
+		LossCounter& operator=(const LossCounter&) = delete;
+
+		void Add(EventRecord::LossStage stage, EventRecord::HookId hook_id, uint64_t count = 1);
+		// counts every record of data, which holds whole records back to back
+		void AddRecords(EventRecord::LossStage stage, const char* data, size_t length);
+		// counts the one record whose first length bytes are in head, its header among them
+		void AddHeader(EventRecord::LossStage stage, const char* head, size_t length);
+
+		bool Pending() const
+		{
+			return m_pending.load(std::memory_order_relaxed);
+		}
+
+		// Calls report(stage, hook_id, lost) for every counter that grew since the previous report.
+		template <typename Reporter>
+		void Report(Reporter&& report)
+		{
+			if (!m_pending.exchange(false, std::memory_order_acquire))
+				return;
+			for (size_t stage = 0; stage < stage_count; ++stage)
+			{
+				for (size_t hook = 0; hook < hook_count; ++hook)
+				{
+					const uint64_t lost = m_lost[stage][hook].load(std::memory_order_relaxed);
+					if (lost == m_reported[stage][hook])
+						continue;
+					report(static_cast<EventRecord::LossStage>(stage + 1), static_cast<EventRecord::HookId>(hook),
+					       lost - m_reported[stage][hook]);
+					m_reported[stage][hook] = lost;
+				}
+			}
+		}
+	};
+}
@@ -0,0 +1,293 @@
+#include "pch.h"
+#include "path_filter.h"
+
+#include <algorithm>
+#include <map>
+#include <string>
+
+namespace
+{
+	ProcessTracer::PathFilter g_path_filter;
+
+	enum class EdgeKind : uint8_t
+	{
+		Unit,
+		NonSeparator,
+		Any
+	};
+
+	struct Edge
+	{
+		EdgeKind kind;
+		uint16_t class_id;
+		uint32_t target;
+	};
+
+	// Glob NFA without epsilon moves, '*' and '**' are self loops on the state that follows them.
+	struct NfaState
+	{
+		std::vector<Edge> edges;
+		uint8_t accept = 0;
+	};
+
+	bool DecodeUtf8(const char* text, size_t length, std::u16string& units)
+	{
+		units.clear();
+		for (size_t i = 0; i < length;)
+		{
+			const auto lead = static_cast<uint8_t>(text[i]);
+			uint32_t code_point;
+			size_t extra;
+			if (lead < 0x80)
+				code_point = lead, extra = 0;
+			else if ((lead & 0xE0) == 0xC0)
+				code_point = lead & 0x1F, extra = 1;
+			else if ((lead & 0xF0) == 0xE0)
+				code_point = lead & 0x0F, extra = 2;
+			else if ((lead & 0xF8) == 0xF0)
+				code_point = lead & 0x07, extra = 3;
+			else
+				return false;
+			if (length - i <= extra)
+				return false;
+			for (size_t j = 1; j <= extra; ++j)
+			{
+				const auto next = static_cast<uint8_t>(text[i + j]);
+				if ((next & 0xC0) != 0x80)
+					return false;
+				code_point = code_point << 6 | (next & 0x3F);
+			}
+			i += extra + 1;
+			if (code_point > 0x10FFFF)
+				return false;
+			if (code_point >= 0x10000)
+			{
+				code_point -= 0x10000;
+				units.push_back(static_cast<char16_t>(0xD800 | code_point >> 10));
+				units.push_back(static_cast<char16_t>(0xDC00 | (code_point & 0x3FF)));
+			}
+			else
+				units.push_back(static_cast<char16_t>(code_point));
+		}
+		return true;
+	}
+
+	bool IsSeparator(char16_t unit)
+	{
+		return unit == u'\\' || unit == u'/';
+	}
+
+	char16_t Fold(char16_t unit)
+	{
+		if (unit == u'/')
+			return u'\\';
+		if (unit >= u'A' && unit <= u'Z')
+			return static_cast<char16_t>(unit + (u'a' - u'A'));
+		return unit;
+	}
+
+	// Length of a leading "\??\" or "\\?\", which name the same file as the path without it.
+	size_t NtPrefixLength(const char16_t* path, size_t length)
+	{
+		if (length >= 4 && IsSeparator(path[0]) && path[2] == u'?' && IsSeparator(path[3]) &&
+			(path[1] == u'?' || IsSeparator(path[1])))
+			return 4;
+		return 0;
+	}
+}
+
+ProcessTracer::PathFilter* GetPathFilter()
+{
+	return &g_path_filter;
+}
+
+ProcessTracer::PathFilter::PathFilter()
+{
+	Clear();
+}
+
+uint16_t ProcessTracer::PathFilter::ClassOf(char16_t folded_unit)
+{
+	if (folded_unit == u'\\')
+		return separator_class;
+	if (folded_unit < 128)
+	{
+		if (m_ascii_classes[folded_unit] == other_class)
+		{
+			m_ascii_classes[folded_unit] = m_class_count;
+			if (folded_unit >= u'a' && folded_unit <= u'z')
+				m_ascii_classes[folded_unit - (u'a' - u'A')] = m_class_count;
+			++m_class_count;
+		}
+		return m_ascii_classes[folded_unit];
+	}
+	const auto position = std::lower_bound(m_wide_classes.begin(), m_wide_classes.end(), folded_unit,
+	                                       [](const WideClass& entry, char16_t unit) { return entry.unit < unit; });
+	if (position != m_wide_classes.end() && position->unit == folded_unit)
+		return position->class_id;
+	m_wide_classes.insert(position, {folded_unit, m_class_count});
+	return m_class_count++;
+}
+
+void ProcessTracer::PathFilter::Clear()
+{
+	m_empty = true;
+	m_has_includes = false;
+	m_start = dead_state;
+	m_class_count = 2;
+	for (char16_t unit = 0; unit < 128; ++unit)
+		m_ascii_classes[unit] = IsSeparator(unit) ? separator_class : other_class;
+	m_wide_classes.clear();
+	m_transitions.clear();
+	m_accepts.clear();
+}
+
+bool ProcessTracer::PathFilter::Compile(const char* rules, size_t length)
+{
+	Clear();
+	std::vector<NfaState> nfa;
+	std::vector<uint32_t> starts;
+	std::u16string glob;
+	for (size_t line_start = 0; line_start < length;)
+	{
+		size_t line_end = line_start;
+		while (line_end < length && rules[line_end] != '\n')
+			++line_end;
+		const char* line = rules + line_start;
+		size_t line_length = line_end - line_start;
+		line_start = line_end + 1;
+		if (line_length != 0 && line[line_length - 1] == '\r')
+			--line_length;
+		if (line_length == 0 || line[0] == '#')
+			continue;
+
+		uint8_t accept = include_accept;
+		if (line[0] == '+' || line[0] == '-')
+		{
+			accept = line[0] == '+' ? include_accept : exclude_accept;
+			++line;
+			--line_length;
+		}
+		if (!DecodeUtf8(line, line_length, glob))
+		{
+			Clear();
+			return false;
+		}
+		for (auto& unit : glob)
+			unit = Fold(unit);
+		glob.erase(0, NtPrefixLength(glob.data(), glob.size()));
+
+		auto state = static_cast<uint32_t>(nfa.size());
+		nfa.emplace_back();
+		starts.push_back(state);
+		for (size_t i = 0; i < glob.size(); ++i)
+		{
+			const char16_t unit = glob[i];
+			if (unit == u'*' && i + 1 < glob.size() && glob[i + 1] == u'*')
+			{
+				while (i + 1 < glob.size() && glob[i + 1] == u'*')
+					++i;
+				if (i + 1 < glob.size() && glob[i + 1] == u'\\')
+				{
+					// nothing, or anything that ends with a separator, in front of the rest of the glob
+					++i;
+					const auto directory = static_cast<uint32_t>(nfa.size());
+					nfa.emplace_back();
+					nfa[state].edges.push_back({EdgeKind::Unit, separator_class, state});
+					nfa[state].edges.push_back({EdgeKind::Any, 0, directory});
+					nfa[directory].edges.push_back({EdgeKind::Any, 0, directory});
+					nfa[directory].edges.push_back({EdgeKind::Unit, separator_class, state});
+				}
+				else
+					nfa[state].edges.push_back({EdgeKind::Any, 0, state});
+			}
+			else if (unit == u'*')
+				nfa[state].edges.push_back({EdgeKind::NonSeparator, 0, state});
+			else
+			{
+				const auto next = static_cast<uint32_t>(nfa.size());
+				nfa.emplace_back();
+				if (unit == u'?')
+					nfa[state].edges.push_back({EdgeKind::NonSeparator, 0, next});
+				else
+					nfa[state].edges.push_back({EdgeKind::Unit, ClassOf(unit), next});
+				state = next;
+			}
+		}
+		nfa[state].accept |= accept;
+		m_has_includes |= accept == include_accept;
+	}
+	if (starts.empty())
+	{
+		Clear();
+		return true;
+	}
+
+	// subset construction, DFA state 0 is the empty set
+	std::map<std::vector<uint32_t>, uint16_t> state_ids;
+	std::vector<std::vector<uint32_t>> pending;
+	auto add_state = [&](std::vector<uint32_t>&& nfa_states, uint16_t& id)
+	{
+		const auto found = state_ids.find(nfa_states);
+		if (found != state_ids.end())
+		{
+			id = found->second;
+			return true;
+		}
+		if (m_accepts.size() >= max_states)
+			return false;
+		id = static_cast<uint16_t>(m_accepts.size());
+		uint8_t accept = 0;
+		for (const uint32_t nfa_state : nfa_states)
+			accept |= nfa[nfa_state].accept;
+		m_accepts.push_back(accept);
+		m_transitions.resize(m_accepts.size() * m_class_count, dead_state);
+		state_ids.emplace(nfa_states, id);
+		pending.push_back(std::move(nfa_states));
+		return true;
+	};
+
+	uint16_t id;
+	add_state({}, id);
+	std::sort(starts.begin(), starts.end());
+	add_state(std::move(starts), m_start);
+	for (size_t current = 1; current < pending.size(); ++current)
+	{
+		for (uint16_t class_id = 0; class_id < m_class_count; ++class_id)
+		{
+			std::vector<uint32_t> targets;
+			for (const uint32_t nfa_state : pending[current])
+			{
+				for (const Edge& edge : nfa[nfa_state].edges)
+				{
+					if (edge.kind == EdgeKind::Any ||
+						(edge.kind == EdgeKind::NonSeparator && class_id != separator_class) ||
+						(edge.kind == EdgeKind::Unit && edge.class_id == class_id))
+						targets.push_back(edge.target);
+				}
+			}
+			std::sort(targets.begin(), targets.end());
+			targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+			if (!add_state(std::move(targets), id))
+			{
+				Clear();
+				return false;
+			}
+			m_transitions[current * m_class_count + class_id] = id;
+		}
+	}
+	m_empty = false;
+	return true;
+}
+
+bool ProcessTracer::PathFilter::Matches(const char16_t* path, size_t length) const
+{
+	if (m_empty)
+		return true;
+	uint16_t state = m_start;
+	// the dead state has no way out, the verdict is known as soon as it is reached
+	for (size_t i = NtPrefixLength(path, length); i < length && state != dead_state; ++i)
+		state = m_transitions[size_t{state} * m_class_count + Classify(path[i])];
+	const uint8_t accept = m_accepts[state];
+	return (!m_has_includes || (accept & include_accept)) && !(accept & exclude_accept);
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ProcessTracer
+{
+	// Include and exclude glob rules compiled into one DFA, so the hooks can drop paths nobody asked
+	// for before anything is formatted. A path is reported when it matches an include rule (or there
+	// are none) and no exclude rule.
+	//
+	// rules := one rule per line, "+glob" includes, "-glob" excludes, a bare glob includes,
+	//          empty lines and lines starting with '#' are ignored
+	// glob  := '?' one character except a separator, '*' any run of them, '**' anything, '**\' nothing or
+	//          anything that ends with a separator; everything else is literal
+	// '/' and '\' are the same separator, ASCII letters match case-insensitively, and the NT prefixes
+	// "\??\" and "\\?\" are ignored on both sides.
+	//
+	// Works on UTF-16 code units and knows nothing about the platform the paths come from.
+	class PathFilter
+	{
+	public:
+		static constexpr size_t max_states = 4096;
+
+	private:
+		static constexpr uint16_t dead_state = 0;
+		static constexpr uint16_t separator_class = 0;
+		static constexpr uint16_t other_class = 1;
+		static constexpr uint8_t include_accept = 0x01;
+		static constexpr uint8_t exclude_accept = 0x02;
+
+		struct WideClass
+		{
+			char16_t unit;
+			uint16_t class_id;
+		};
+
+		bool m_empty = true;
+		bool m_has_includes = false;
+		uint16_t m_start = dead_state;
+		uint16_t m_class_count = 2;
+		uint16_t m_ascii_classes[128] = {};
+		std::vector<WideClass> m_wide_classes; // sorted by unit
+		std::vector<uint16_t> m_transitions; // state * m_class_count + class
+		std::vector<uint8_t> m_accepts;
+
+		uint16_t Classify(char16_t unit) const
+		{
+			if (unit < 128)
+				return m_ascii_classes[unit];
+			size_t low = 0, high = m_wide_classes.size();
+			while (low < high)
+			{
+				const size_t middle = (low + high) / 2;
+				if (m_wide_classes[middle].unit < unit)
+					low = middle + 1;
+				else
+					high = middle;
+			}
+			return low < m_wide_classes.size() && m_wide_classes[low].unit == unit
+				       ? m_wide_classes[low].class_id
+				       : other_class;
+		}
+
+		uint16_t ClassOf(char16_t folded_unit);
+
+	public:
+		PathFilter();
+
+		// Replaces the rules. Returns false when they do not parse or need more than max_states
+		// states, the filter then lets every path through.
+		bool Compile(const char* rules, size_t length);
+		void Clear();
+
+		// no rules, every path passes
+		bool Empty() const
+		{
+			return m_empty;
+		}
+
+		bool Matches(const char16_t* path, size_t length) const;
+	};
+}
+
+ProcessTracer::PathFilter* GetPathFilter();
@@ -8,6 +8,10 @@
 #define PCH_H
 
 // 請於此新增您要先行編譯的標頭
+// the portable sources are also built outside Windows, see CMakeLists.txt; the hook harness
+// builds the rest against the fake Windows layer in Tests/FakeWin32
+#if defined(_WIN32) || defined(PROCESS_TRACER_FAKE_WIN32)
 #include "framework.h"
+#endif
 
 #endif //PCH_H
@@ -0,0 +1,73 @@
+#pragma once
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+// The few OS services the portable parts of ProcessTracerCore need. Everything else they use is
+// standard C++, so they also build into the host library of CMakeLists.txt. On Windows the
+// declarations come with pch.h.
+namespace ProcessTracer::Platform
+{
+	// Reader-writer lock that needs no initialization call, so it works in static objects that hooks
+	// reach before DllMain ran.
+	class SharedLock
+	{
+#ifdef _WIN32
+		SRWLOCK m_lock = SRWLOCK_INIT;
+#else
+		pthread_rwlock_t m_lock = PTHREAD_RWLOCK_INITIALIZER;
+#endif
+
+	public:
+		SharedLock() = default;
+		SharedLock(const SharedLock&) = delete;
+		SharedLock& operator=(const SharedLock&) = delete;
+
+#ifdef _WIN32
+		void LockExclusive()
+		{
+			AcquireSRWLockExclusive(&m_lock);
+		}
+
+		void UnlockExclusive()
+		{
+			ReleaseSRWLockExclusive(&m_lock);
+		}
+
+		void LockShared()
+		{
+			AcquireSRWLockShared(&m_lock);
+		}
+
+		void UnlockShared()
+		{
+			ReleaseSRWLockShared(&m_lock);
+		}
+#else
+		~SharedLock()
+		{
+			pthread_rwlock_destroy(&m_lock);
+		}
+
+		void LockExclusive()
+		{
+			pthread_rwlock_wrlock(&m_lock);
+		}
+
+		void UnlockExclusive()
+		{
+			pthread_rwlock_unlock(&m_lock);
+		}
+
+		void LockShared()
+		{
+			pthread_rwlock_rdlock(&m_lock);
+		}
+
+		void UnlockShared()
+		{
+			pthread_rwlock_unlock(&m_lock);
+		}
+#endif
+	};
+}
@@ -0,0 +1,179 @@
+#include "pch.h"
+#include "shared_memory_transport.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// the collector may be gone, do not hang the process on a ring nobody drains
+	constexpr auto block_timeout = std::chrono::milliseconds(1000);
+	constexpr auto block_poll_interval = std::chrono::milliseconds(1);
+
+	uint32_t CurrentProcessId()
+	{
+#ifdef _WIN32
+		return GetCurrentProcessId();
+#else
+		return static_cast<uint32_t>(getpid());
+#endif
+	}
+}
+
+ProcessTracer::SharedMemoryTransport::SharedMemoryTransport(bool block) : m_pid(CurrentProcessId()), m_block(block)
+{
+}
+
+ProcessTracer::SharedMemoryTransport::~SharedMemoryTransport()
+{
+	Close();
+}
+
+#ifdef _WIN32
+bool ProcessTracer::SharedMemoryTransport::Map(int process_tracer_pid)
+{
+	const auto map_name = L"ProcessTracerEvents:" + std::to_wstring(process_tracer_pid);
+	m_mapping = OpenFileMappingW(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, map_name.c_str());
+	if (!m_mapping)
+		return false;
+
+	const auto view = MapViewOfFile(m_mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0);
+	MEMORY_BASIC_INFORMATION info = {};
+	if (!view || VirtualQuery(view, &info, sizeof(info)) == 0 ||
+		!SharedMemoryRing::IsValid(static_cast<SharedMemoryRing::RingHeader*>(view), info.RegionSize))
+	{
+		if (view)
+			UnmapViewOfFile(view);
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+		return false;
+	}
+	m_ring = static_cast<SharedMemoryRing::RingHeader*>(view);
+	return true;
+}
+#else
+bool ProcessTracer::SharedMemoryTransport::Map(int process_tracer_pid)
+{
+	const int fd = shm_open(SharedMemoryRingName(process_tracer_pid).c_str(), O_RDWR, 0);
+	if (fd < 0)
+		return false;
+	struct stat info = {};
+	void* view = MAP_FAILED;
+	if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) > SharedMemoryRing::header_size)
+		view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (view == MAP_FAILED)
+		return false;
+	if (!SharedMemoryRing::IsValid(static_cast<SharedMemoryRing::RingHeader*>(view), static_cast<size_t>(info.st_size)))
+	{
+		munmap(view, static_cast<size_t>(info.st_size));
+		return false;
+	}
+	m_ring = static_cast<SharedMemoryRing::RingHeader*>(view);
+	return true;
+}
+#endif
+
+bool ProcessTracer::SharedMemoryTransport::Write(const char* data, size_t length)
+{
+	if (!m_ring)
+		return false;
+	// A frame larger than half the ring never fits, there is nothing to wait for. Once a write waited
+	// the whole timeout the collector is taken to be gone, so a process that keeps writing is not
+	// held up for a second per event.
+	if (m_block && !m_stalled.load(std::memory_order_relaxed) &&
+		sizeof(SharedMemoryRing::FrameHeader) + length <= m_ring->capacity / 2)
+	{
+		const auto deadline = std::chrono::steady_clock::now() + block_timeout;
+		do
+		{
+			if (SharedMemoryRing::TryWrite(m_ring, data, length, m_pid, false))
+				return true;
+			std::this_thread::sleep_for(block_poll_interval);
+		}
+		while (std::chrono::steady_clock::now() < deadline);
+		m_stalled.store(true, std::memory_order_relaxed);
+	}
+	if (!SharedMemoryRing::TryWrite(m_ring, data, length, m_pid))
+		return false;
+	if (m_stalled.load(std::memory_order_relaxed))
+		m_stalled.store(false, std::memory_order_relaxed);
+	return true;
+}
+
+bool ProcessTracer::SharedMemoryTransport::Drain(uint32_t timeout_ms)
+{
+	if (!m_ring)
+		return true;
+	const uint64_t written = m_ring->reserve_position.load(std::memory_order_acquire);
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+	while (m_ring->read_position.load(std::memory_order_acquire) < written)
+	{
+		if (std::chrono::steady_clock::now() >= deadline)
+			return false;
+		std::this_thread::sleep_for(block_poll_interval);
+	}
+	return true;
+}
+
+void ProcessTracer::SharedMemoryTransport::Close()
+{
+	// The view stays mapped until the process exits: another thread may still be copying a frame
+	// into it and unmapping would turn that into an access violation.
+#ifdef _WIN32
+	if (m_mapping)
+	{
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+	}
+#endif
+}
+
+#ifndef _WIN32
+std::string ProcessTracer::SharedMemoryRingName(int process_tracer_pid)
+{
+	return "/ProcessTracerEvents:" + std::to_string(process_tracer_pid);
+}
+
+ProcessTracer::SharedMemoryRingOwner::~SharedMemoryRingOwner()
+{
+	if (!m_ring)
+		return;
+	munmap(m_ring, m_mapped_size);
+	shm_unlink(m_name.c_str());
+}
+
+bool ProcessTracer::SharedMemoryRingOwner::Create(int process_tracer_pid, uint64_t capacity)
+{
+	if (m_ring || capacity == 0 || (capacity & (capacity - 1)) != 0)
+		return false;
+	m_name = SharedMemoryRingName(process_tracer_pid);
+	// left behind by a tracer with the same pid that did not exit cleanly
+	shm_unlink(m_name.c_str());
+	const int fd = shm_open(m_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0)
+		return false;
+	const size_t size = SharedMemoryRing::header_size + capacity;
+	void* view = MAP_FAILED;
+	if (ftruncate(fd, static_cast<off_t>(size)) == 0)
+		view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (view == MAP_FAILED)
+	{
+		shm_unlink(m_name.c_str());
+		return false;
+	}
+	m_ring = static_cast<SharedMemoryRing::RingHeader*>(view);
+	m_mapped_size = size;
+	// a fresh object reads as zero, the ring only has to be set up
+	SharedMemoryRing::Initialize(m_ring, capacity);
+	return true;
+}
+#endif
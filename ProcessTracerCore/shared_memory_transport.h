@@ -0,0 +1,69 @@
+#pragma once
+#include <atomic>
+#include <string>
+
+#include "shm_ring.h"
+#include "transport.h"
+
+namespace ProcessTracer
+{
+	// Appends each write as one frame to the tracer's shared-memory event ring.
+	// Producers only contend on an atomic reservation, there is no syscall per write.
+	// On Windows the ring is a file mapping, elsewhere a POSIX shared memory object.
+	class SharedMemoryTransport final : public Transport
+	{
+#ifdef _WIN32
+		HANDLE m_mapping = nullptr;
+#endif
+		SharedMemoryRing::RingHeader* m_ring = nullptr;
+		uint32_t m_pid;
+		bool m_block = false;
+		// a blocking write waited in vain, the next ones do not wait until a write fits again
+		std::atomic<bool> m_stalled{false};
+
+	public:
+		// with block set a write waits for the collector to make room, for a bounded time
+		explicit SharedMemoryTransport(bool block);
+		~SharedMemoryTransport() override;
+
+		SharedMemoryTransport(const SharedMemoryTransport&) = delete;
+		SharedMemoryTransport& operator=(const SharedMemoryTransport&) = delete;
+
+		// maps the ring created by the tracer, fails when the tracer did not create one
+		bool Map(int process_tracer_pid);
+
+		bool Write(const char* data, size_t length) override;
+		void Close() override;
+		// waits until the collector read past every frame reserved so far, this process's among them
+		bool Drain(uint32_t timeout_ms) override;
+	};
+
+#ifndef _WIN32
+	// shm_open name of the ring of the tracer process_tracer_pid
+	std::string SharedMemoryRingName(int process_tracer_pid);
+
+	// The tracer side of the ring on POSIX hosts, where no collector creates it: creates the shared
+	// memory object, maps it and removes the name again when destroyed.
+	class SharedMemoryRingOwner
+	{
+		std::string m_name;
+		SharedMemoryRing::RingHeader* m_ring = nullptr;
+		size_t m_mapped_size = 0;
+
+	public:
+		SharedMemoryRingOwner() = default;
+		~SharedMemoryRingOwner();
+
+		SharedMemoryRingOwner(const SharedMemoryRingOwner&) = delete;
+		SharedMemoryRingOwner& operator=(const SharedMemoryRingOwner&) = delete;
+
+		// capacity is a power of two, a stale ring of the same name is replaced
+		bool Create(int process_tracer_pid, uint64_t capacity);
+
+		SharedMemoryRing::RingHeader* Ring() const
+		{
+			return m_ring;
+		}
+	};
+#endif
+}
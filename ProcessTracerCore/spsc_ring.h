@@ -0,0 +1,113 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace ProcessTracer
+{
+	// Lock-free single-producer single-consumer ring of variable-length messages.
+	// Each message is stored as a 32-bit length followed by its bytes and may wrap
+	// around the end of the buffer. Only the owning thread calls TryPush, only the
+	// holder of the ring's pop lock in the pipeline calls Pop and DropFront.
+	class SpscRing
+	{
+		static constexpr size_t length_prefix_size = sizeof(uint32_t);
+
+		std::unique_ptr<char[]> m_buffer;
+		size_t m_capacity;
+		size_t m_mask;
+		alignas(64) std::atomic<size_t> m_head{0};
+		alignas(64) std::atomic<size_t> m_tail{0};
+
+		void CopyIn(size_t position, const void* data, size_t length)
+		{
+			const size_t offset = position & m_mask;
+			const size_t first = length < m_capacity - offset ? length : m_capacity - offset;
+			memcpy(m_buffer.get() + offset, data, first);
+			memcpy(m_buffer.get(), static_cast<const char*>(data) + first, length - first);
+		}
+
+		void CopyOut(size_t position, void* data, size_t length) const
+		{
+			const size_t offset = position & m_mask;
+			const size_t first = length < m_capacity - offset ? length : m_capacity - offset;
+			memcpy(data, m_buffer.get() + offset, first);
+			memcpy(static_cast<char*>(data) + first, m_buffer.get(), length - first);
+		}
+
+	public:
+		// capacity is rounded up to a power of two
+		explicit SpscRing(size_t capacity)
+		{
+			m_capacity = 64;
+			while (m_capacity < capacity)
+				m_capacity <<= 1;
+			m_mask = m_capacity - 1;
+			m_buffer = std::make_unique<char[]>(m_capacity);
+		}
+
+		SpscRing(const SpscRing&) = delete;
+		SpscRing& operator=(const SpscRing&) = delete;
+
+		size_t Capacity() const
+		{
+			return m_capacity;
+		}
+
+		bool TryPush(const char* data, size_t length)
+		{
+			const size_t head = m_head.load(std::memory_order_relaxed);
+			const size_t tail = m_tail.load(std::memory_order_acquire);
+			const size_t required = length_prefix_size + length;
+			if (m_capacity - (head - tail) < required)
+				return false;
+			const auto length_prefix = static_cast<uint32_t>(length);
+			CopyIn(head, &length_prefix, length_prefix_size);
+			CopyIn(head + length_prefix_size, data, length);
+			m_head.store(head + required, std::memory_order_release);
+			return true;
+		}
+
+		// Moves as many whole messages as fit into out, concatenated, and returns the number of bytes written.
+		size_t Pop(char* out, size_t out_capacity)
+		{
+			size_t tail = m_tail.load(std::memory_order_relaxed);
+			const size_t head = m_head.load(std::memory_order_acquire);
+			size_t written = 0;
+			while (tail != head)
+			{
+				uint32_t length = 0;
+				CopyOut(tail, &length, length_prefix_size);
+				if (written + length > out_capacity)
+					break;
+				CopyOut(tail + length_prefix_size, out + written, length);
+				written += length;
+				tail += length_prefix_size + length;
+			}
+			m_tail.store(tail, std::memory_order_release);
+			return written;
+		}
+
+		// Removes the oldest message, copies up to head_capacity of its first bytes into head and
+		// returns its length. false when the ring is empty.
+		bool DropFront(char* head, size_t head_capacity, size_t& length)
+		{
+			const size_t tail = m_tail.load(std::memory_order_relaxed);
+			if (tail == m_head.load(std::memory_order_acquire))
+				return false;
+			uint32_t message_length = 0;
+			CopyOut(tail, &message_length, length_prefix_size);
+			CopyOut(tail + length_prefix_size, head, message_length < head_capacity ? message_length : head_capacity);
+			m_tail.store(tail + length_prefix_size + message_length, std::memory_order_release);
+			length = message_length;
+			return true;
+		}
+
+		bool Empty() const
+		{
+			return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_relaxed);
+		}
+	};
+}
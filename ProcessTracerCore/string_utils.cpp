@@ -0,0 +1,45 @@
+#include "pch.h"
+#include "string_utils.h"
+
+std::vector<std::string> SplitBySpace(const std::string& input)
+{
+	std::vector<std::string> result;
+	size_t pos = 0;
+	const std::string delimiter = " ";
+
+	while (true)
+	{
+		size_t next = input.find(delimiter, pos);
+		if (next == std::string::npos)
+		{
+			result.push_back(input.substr(pos));
+			break;
+		}
+		result.push_back(input.substr(pos, next - pos));
+		pos = next + delimiter.length();
+	}
+
+	return result;
+}
+
+bool StartsWith(const std::string& str, const std::string& prefix) {
+	return str.size() >= prefix.size() &&
+		str.compare(0, prefix.size(), prefix) == 0;
+}
+
+bool EndsWith(const std::string& str, const std::string& suffix) {
+    return str.size() >= suffix.size() &&
+           str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::wstring ReplaceWString(std::wstring origin, std::wstring find, std::wstring replace)
+{
+	auto result = origin;
+	size_t pos = 0;
+	while ((pos = result.find(find, pos)) != std::wstring::npos)
+	{
+		result.replace(pos, find.length(), replace);
+		pos += replace.length();
+	}
+	return result;
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// String helpers that need nothing from the OS, the code page conversions are in utils.h.
+std::vector<std::string> SplitBySpace(const std::string& input);
+bool StartsWith(const std::string& str, const std::string& prefix);
+bool EndsWith(const std::string& str, const std::string& suffix);
+std::wstring ReplaceWString(std::wstring origin, std::wstring find, std::wstring replace);
@@ -0,0 +1,30 @@
+#pragma once
+
+namespace ProcessTracer
+{
+	// Marks the current thread as running tracer code. Hooks entered while a scope is active go
+	// straight to the real function, so the tracer's own I/O is neither logged nor recursed into.
+	class TracerScope
+	{
+		static inline thread_local int t_depth = 0;
+
+	public:
+		TracerScope()
+		{
+			++t_depth;
+		}
+
+		~TracerScope()
+		{
+			--t_depth;
+		}
+
+		TracerScope(const TracerScope&) = delete;
+		TracerScope& operator=(const TracerScope&) = delete;
+
+		static bool Active()
+		{
+			return t_depth != 0;
+		}
+	};
+}
@@ -0,0 +1,161 @@
+#include "pch.h"
+#include "transport.h"
+
+#include "_win32.h"
+#include "shared_memory_transport.h"
+
+namespace
+{
+	constexpr NTSTATUS status_pipe_not_available = static_cast<NTSTATUS>(0xC00000AC);
+	constexpr int connect_retry_count = 5;
+	constexpr DWORD connect_retry_delay_ms = 2;
+	constexpr DWORD drain_poll_interval_ms = 1;
+	// FILE_INFORMATION_CLASS value winternl.h does not name
+	constexpr auto file_pipe_local_information = static_cast<FILE_INFORMATION_CLASS>(24);
+}
+
+ProcessTracer::PipeTransport::PipeTransport(int process_tracer_pid)
+{
+	m_pipe_path = L"\\Device\\NamedPipe\\ProcessTracerPipe:" + std::to_wstring(process_tracer_pid);
+}
+
+ProcessTracer::PipeTransport::~PipeTransport()
+{
+	Disconnect();
+}
+
+BOOL ProcessTracer::PipeTransport::Connect()
+{
+	UNICODE_STRING u_pipe_name;
+	RtlInitUnicodeString(&u_pipe_name, m_pipe_path.c_str());
+
+	OBJECT_ATTRIBUTES obj_attr;
+	InitializeObjectAttributes(&obj_attr, &u_pipe_name, OBJ_CASE_INSENSITIVE, NULL, NULL);
+
+	// NtCreateFile resolves to the Detours trampoline inside this module, so opening
+	// our own pipe never goes through HookNtCreateFile.
+	NTSTATUS status = 0;
+	for (int i = 0; i < connect_retry_count; ++i)
+	{
+		IO_STATUS_BLOCK io_status_block = {};
+		HANDLE pipe = nullptr;
+		status = NtCreateFile(
+			&pipe,
+			GENERIC_WRITE | SYNCHRONIZE,
+			&obj_attr,
+			&io_status_block,
+			nullptr,
+			0,
+			0,
+			FILE_OPEN,
+			FILE_SYNCHRONOUS_IO_NONALERT,
+			nullptr,
+			0
+		);
+		if (NT_SUCCESS(status))
+		{
+			m_pipe = pipe;
+			return TRUE;
+		}
+		// all server instances are busy, the collector will post a new one shortly
+		if (status != status_pipe_not_available)
+			break;
+		Sleep(connect_retry_delay_ms);
+	}
+	return FALSE;
+}
+
+VOID ProcessTracer::PipeTransport::Disconnect()
+{
+	if (m_pipe)
+	{
+		CloseHandle(m_pipe);
+		m_pipe = nullptr;
+	}
+}
+
+BOOL ProcessTracer::PipeTransport::WriteConnected(const char* data, size_t length) const
+{
+	IO_STATUS_BLOCK iosb = {};
+	const auto status = NtWriteFile(
+		m_pipe,
+		nullptr, // Event
+		nullptr, // ApcRoutine
+		nullptr, // ApcContext
+		&iosb,
+		const_cast<char*>(data),
+		static_cast<ULONG>(length),
+		nullptr,
+		nullptr // Key
+	);
+	return NT_SUCCESS(status) && iosb.Information == length;
+}
+
+bool ProcessTracer::PipeTransport::Write(const char* data, size_t length)
+{
+	AcquireSRWLockExclusive(&m_lock);
+	bool result = false;
+	if (m_pipe || Connect())
+	{
+		result = WriteConnected(data, length);
+		if (!result)
+		{
+			// the collector side may have recycled the server instance, reconnect once
+			Disconnect();
+			result = Connect() && WriteConnected(data, length);
+		}
+	}
+	ReleaseSRWLockExclusive(&m_lock);
+	return result;
+}
+
+// A write is done once the bytes sit in the pipe, not once the collector read them. Until it has,
+// they take up the write quota of this end; a read the server has pending adds to it instead.
+bool ProcessTracer::PipeTransport::Drain(uint32_t timeout_ms)
+{
+	const ULONGLONG deadline = GetTickCount64() + timeout_ms;
+	// a writer stuck on a full pipe holds the lock, do not wait for it past the deadline
+	while (!TryAcquireSRWLockExclusive(&m_lock))
+	{
+		if (GetTickCount64() >= deadline)
+			return false;
+		Sleep(drain_poll_interval_ms);
+	}
+	bool drained = true;
+	while (m_pipe)
+	{
+		FILE_PIPE_LOCAL_INFORMATION information = {};
+		IO_STATUS_BLOCK iosb = {};
+		if (!NT_SUCCESS(NtQueryInformationFile(m_pipe, &iosb, &information, sizeof(information),
+			file_pipe_local_information)))
+		{
+			drained = false;
+			break;
+		}
+		if (information.WriteQuotaAvailable >= information.OutboundQuota)
+			break;
+		if (GetTickCount64() >= deadline)
+		{
+			drained = false;
+			break;
+		}
+		Sleep(drain_poll_interval_ms);
+	}
+	ReleaseSRWLockExclusive(&m_lock);
+	return drained;
+}
+
+void ProcessTracer::PipeTransport::Close()
+{
+	AcquireSRWLockExclusive(&m_lock);
+	Disconnect();
+	ReleaseSRWLockExclusive(&m_lock);
+}
+
+std::unique_ptr<ProcessTracer::Transport> ProcessTracer::CreateTransport(int process_tracer_pid, bool block)
+{
+	auto shared_memory_transport = std::make_unique<SharedMemoryTransport>(block);
+	if (shared_memory_transport->Map(process_tracer_pid))
+		return shared_memory_transport;
+	return std::make_unique<PipeTransport>(process_tracer_pid);
+}
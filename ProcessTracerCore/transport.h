@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace ProcessTracer
+{
+	// A byte channel from the injected process to the ProcessTracer collector.
+	// Implementations keep their connection open for the lifetime of the process
+	// and must be safe to call from any thread.
+	class Transport
+	{
+	public:
+		virtual ~Transport() = default;
+
+		virtual bool Write(const char* data, size_t length) = 0;
+		virtual void Close() = 0;
+
+		// Waits until the collector has read everything written so far, for at most timeout_ms. False
+		// when it has not by then. Transports that hand the data over in Write have nothing to wait for.
+		virtual bool Drain(uint32_t)
+		{
+			return true;
+		}
+	};
+
+#ifdef _WIN32
+	class PipeTransport final : public Transport
+	{
+		std::wstring m_pipe_path;
+		HANDLE m_pipe = nullptr;
+		SRWLOCK m_lock = SRWLOCK_INIT;
+
+		BOOL Connect();
+		VOID Disconnect();
+		BOOL WriteConnected(const char* data, size_t length) const;
+
+	public:
+		explicit PipeTransport(int process_tracer_pid);
+		~PipeTransport() override;
+
+		PipeTransport(const PipeTransport&) = delete;
+		PipeTransport& operator=(const PipeTransport&) = delete;
+
+		bool Write(const char* data, size_t length) override;
+		void Close() override;
+		// polls the pipe's write quota, FlushFileBuffers would wait for the collector without a timeout
+		bool Drain(uint32_t timeout_ms) override;
+	};
+
+	// Prefers the tracer's shared-memory event ring and falls back to its named pipe, which always
+	// blocks. block makes writes to a full ring wait instead of failing.
+	std::unique_ptr<Transport> CreateTransport(int process_tracer_pid, bool block);
+#endif
+}
@@ -0,0 +1,135 @@
+#include "pch.h"
+#include "unix_socket_transport.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/sockios.h>
+#endif
+
+namespace
+{
+	constexpr int connect_retry_count = 5;
+	constexpr long connect_retry_delay_ns = 2000000;
+	constexpr long drain_poll_interval_ns = 100000;
+}
+
+ProcessTracer::UnixSocketTransport::~UnixSocketTransport()
+{
+	Disconnect();
+}
+
+bool ProcessTracer::UnixSocketTransport::Connect()
+{
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if (m_path.size() >= sizeof(address.sun_path))
+		return false;
+	memcpy(address.sun_path, m_path.c_str(), m_path.size() + 1);
+
+	for (int i = 0; i < connect_retry_count; ++i)
+	{
+		const int socket_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (socket_fd < 0)
+			return false;
+		if (connect(socket_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0)
+		{
+			m_socket = socket_fd;
+			return true;
+		}
+		const int error = errno;
+		close(socket_fd);
+		// the collector's backlog is full, it accepts again shortly
+		if (error != EAGAIN && error != EINTR)
+			break;
+		const timespec delay = {0, connect_retry_delay_ns};
+		nanosleep(&delay, nullptr);
+	}
+	return false;
+}
+
+void ProcessTracer::UnixSocketTransport::Disconnect()
+{
+	if (m_socket >= 0)
+	{
+		close(m_socket);
+		m_socket = -1;
+	}
+}
+
+bool ProcessTracer::UnixSocketTransport::WriteConnected(const char* data, size_t length) const
+{
+	while (length > 0)
+	{
+		// a collector that went away fails the write instead of raising SIGPIPE
+		const ssize_t written = send(m_socket, data, length, MSG_NOSIGNAL);
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		data += written;
+		length -= static_cast<size_t>(written);
+	}
+	return true;
+}
+
+bool ProcessTracer::UnixSocketTransport::Write(const char* data, size_t length)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	if (m_socket < 0 && !Connect())
+		return false;
+	if (WriteConnected(data, length))
+		return true;
+	// the collector may have dropped the connection, reconnect once
+	Disconnect();
+	return Connect() && WriteConnected(data, length);
+}
+
+bool ProcessTracer::UnixSocketTransport::Drain(uint32_t timeout_ms)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	if (m_socket < 0)
+		return true;
+#ifdef SIOCOUTQ
+	// a Unix socket counts sent bytes against the sender until the receiver has read them
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+	for (;;)
+	{
+		int unread = 0;
+		if (ioctl(m_socket, SIOCOUTQ, &unread) != 0)
+			return false;
+		if (unread == 0)
+			return true;
+		if (std::chrono::steady_clock::now() >= deadline)
+			return false;
+		const timespec delay = {0, drain_poll_interval_ns};
+		nanosleep(&delay, nullptr);
+	}
+#else
+	static_cast<void>(timeout_ms);
+	return true;
+#endif
+}
+
+void ProcessTracer::UnixSocketTransport::Close()
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	Disconnect();
+}
+
+std::string ProcessTracer::UnixSocketTransport::Path(int process_tracer_pid)
+{
+	const char* directory = getenv("TMPDIR");
+	if (!directory || !*directory)
+		directory = "/tmp";
+	return std::string(directory) + "/ProcessTracerPipe." + std::to_string(process_tracer_pid);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <mutex>
+#include <string>
+
+#include "transport.h"
+
+namespace ProcessTracer
+{
+	// The named pipe of PipeTransport as a Unix domain stream socket, for collectors on POSIX hosts.
+	// Connects on the first write and keeps the connection until Close; a failed write reconnects
+	// once and sends again.
+	class UnixSocketTransport final : public Transport
+	{
+		std::string m_path;
+		int m_socket = -1;
+		std::mutex m_lock;
+
+		bool Connect();
+		void Disconnect();
+		bool WriteConnected(const char* data, size_t length) const;
+
+	public:
+		explicit UnixSocketTransport(std::string path) : m_path(std::move(path))
+		{
+		}
+		~UnixSocketTransport() override;
+
+		UnixSocketTransport(const UnixSocketTransport&) = delete;
+		UnixSocketTransport& operator=(const UnixSocketTransport&) = delete;
+
+		bool Write(const char* data, size_t length) override;
+		void Close() override;
+		// waits for the socket's send queue to empty, which is when the collector read the last byte
+		bool Drain(uint32_t timeout_ms) override;
+
+		// where the collector of process_tracer_pid listens, the counterpart of the pipe name
+		static std::string Path(int process_tracer_pid);
+	};
+}
@@ -4,10 +4,17 @@
 #include "framework.h"
 #include "utils.h"
 
-#include <vector>
+#include "utf16_to_utf8.h"
 
 std::string ConvertWStringToString(LPCWSTR wstr, UINT codepage)
 {
+	if (codepage == CP_UTF8)
+	{
+		std::string str;
+		if (wstr)
+			ProcessTracer::Utf8::AppendFromUtf16(str, reinterpret_cast<const char16_t*>(wstr), wcslen(wstr));
+		return str;
+	}
 	int len = WideCharToMultiByte(codepage, 0, wstr, -1, nullptr, 0, NULL, NULL);
 	std::string str(len, 0);
 	WideCharToMultiByte(codepage, 0, wstr, -1, const_cast<LPSTR>(str.data()), len, NULL, NULL);
@@ -16,49 +23,6 @@ std::string ConvertWStringToString(LPCWSTR wstr, UINT codepage)
 	return str;
 }
 
-std::vector<std::string> SplitBySpace(const std::string& input)
-{
-	std::vector<std::string> result;
-	size_t pos = 0;
-	const std::string delimiter = " ";
-
-	while (true)
-	{
-		size_t next = input.find(delimiter, pos);
-		if (next == std::string::npos)
-		{
-			result.push_back(input.substr(pos));
-			break;
-		}
-		result.push_back(input.substr(pos, next - pos));
-		pos = next + delimiter.length();
-	}
-
-	return result;
-}
-
-bool StartsWith(const std::string& str, const std::string& prefix) {
-	return str.size() >= prefix.size() &&
-		str.compare(0, prefix.size(), prefix) == 0;
-}
-
-bool EndsWith(const std::string& str, const std::string& suffix) {
-    return str.size() >= suffix.size() &&
-           str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
-}
-
-std::wstring ReplaceWString(std::wstring origin, std::wstring find, std::wstring replace)
-{
-	auto result = origin;
-	size_t pos = 0;
-	while ((pos = result.find(find, pos)) != std::wstring::npos)
-	{
-		result.replace(pos, find.length(), replace);
-		pos += replace.length();
-	}
-	return result;
-}
-
 std::wstring ConvertStringToWString(const std::string& origin , UINT code_page)
 {
 	int wide_char_len = MultiByteToWideChar(
@@ -0,0 +1,143 @@
+#include "pch.h"
+#include "write_aggregator.h"
+
+namespace
+{
+	ProcessTracer::WriteAggregator g_write_aggregator;
+
+	// Two threads writing to a fresh handle at once can both claim a slot, their totals are merged on Take.
+	void Merge(ProcessTracer::WriteSummary& summary, const ProcessTracer::WriteSummary& part)
+	{
+		if (summary.count == 0)
+		{
+			summary = part;
+			return;
+		}
+		summary.count += part.count;
+		summary.bytes += part.bytes;
+		if (part.first_timestamp < summary.first_timestamp)
+		{
+			summary.first_timestamp = part.first_timestamp;
+			if (part.first_offset != ProcessTracer::WriteSummary::no_offset)
+				summary.first_offset = part.first_offset;
+		}
+		if (part.last_timestamp > summary.last_timestamp)
+		{
+			summary.last_timestamp = part.last_timestamp;
+			if (part.last_offset != ProcessTracer::WriteSummary::no_offset)
+				summary.last_offset = part.last_offset;
+		}
+	}
+}
+
+ProcessTracer::WriteAggregator* GetWriteAggregator()
+{
+	return &g_write_aggregator;
+}
+
+// Waits out a short claim, a writer killed in the middle leaves the slot unusable rather than hanging us.
+uintptr_t ProcessTracer::WriteAggregator::LoadSettledKey(const Slot& slot)
+{
+	uintptr_t key = slot.key.load(std::memory_order_acquire);
+	for (int attempt = 0; key == claiming_key && attempt < claim_wait_attempts; ++attempt)
+		key = slot.key.load(std::memory_order_acquire);
+	return key;
+}
+
+ProcessTracer::WriteAggregator::Slot* ProcessTracer::WriteAggregator::Find(uintptr_t key)
+{
+	const size_t home = Hash(key);
+	for (size_t probe = 0; probe < max_probe; ++probe)
+	{
+		Slot& slot = m_slots[(home + probe) & (slot_count - 1)];
+		const uintptr_t current = LoadSettledKey(slot);
+		if (current == key)
+			return &slot;
+		if (current == empty_key)
+			return nullptr;
+	}
+	return nullptr;
+}
+
+ProcessTracer::WriteAggregator::Slot* ProcessTracer::WriteAggregator::Claim(uintptr_t key)
+{
+	const size_t home = Hash(key);
+	for (size_t probe = 0; probe < max_probe; ++probe)
+	{
+		Slot& slot = m_slots[(home + probe) & (slot_count - 1)];
+		uintptr_t current = slot.key.load(std::memory_order_relaxed);
+		if (current == key)
+			return &slot;
+		if (current != empty_key && current != erased_key)
+			continue;
+		if (!slot.key.compare_exchange_strong(current, claiming_key, std::memory_order_acquire,
+		                                      std::memory_order_relaxed))
+		{
+			if (current == key)
+				return &slot;
+			continue;
+		}
+		slot.count.store(0, std::memory_order_relaxed);
+		slot.bytes.store(0, std::memory_order_relaxed);
+		slot.first_offset.store(WriteSummary::no_offset, std::memory_order_relaxed);
+		slot.last_offset.store(WriteSummary::no_offset, std::memory_order_relaxed);
+		slot.first_timestamp.store(0, std::memory_order_relaxed);
+		slot.last_timestamp.store(0, std::memory_order_relaxed);
+		slot.key.store(key, std::memory_order_release);
+		return &slot;
+	}
+	return nullptr;
+}
+
+bool ProcessTracer::WriteAggregator::Add(uintptr_t key, uint64_t bytes, uint64_t offset, uint64_t timestamp)
+{
+	if (key == empty_key || key == erased_key || key == claiming_key)
+		return false;
+	Slot* slot = Find(key);
+	if (!slot)
+		slot = Claim(key);
+	if (!slot)
+		return false;
+
+	slot->count.fetch_add(1, std::memory_order_relaxed);
+	slot->bytes.fetch_add(bytes, std::memory_order_relaxed);
+	if (offset != WriteSummary::no_offset)
+	{
+		uint64_t unset = WriteSummary::no_offset;
+		slot->first_offset.compare_exchange_strong(unset, offset, std::memory_order_relaxed);
+		slot->last_offset.store(offset, std::memory_order_relaxed);
+	}
+	uint64_t unset_timestamp = 0;
+	slot->first_timestamp.compare_exchange_strong(unset_timestamp, timestamp, std::memory_order_relaxed);
+	slot->last_timestamp.store(timestamp, std::memory_order_relaxed);
+	return true;
+}
+
+bool ProcessTracer::WriteAggregator::Take(uintptr_t key, WriteSummary& summary)
+{
+	bool found = false;
+	const size_t home = Hash(key);
+	for (size_t probe = 0; probe < max_probe; ++probe)
+	{
+		Slot& slot = m_slots[(home + probe) & (slot_count - 1)];
+		uintptr_t current = LoadSettledKey(slot);
+		if (current == empty_key)
+			break;
+		if (current != key)
+			continue;
+
+		WriteSummary part;
+		part.count = slot.count.load(std::memory_order_relaxed);
+		part.bytes = slot.bytes.load(std::memory_order_relaxed);
+		part.first_offset = slot.first_offset.load(std::memory_order_relaxed);
+		part.last_offset = slot.last_offset.load(std::memory_order_relaxed);
+		part.first_timestamp = slot.first_timestamp.load(std::memory_order_relaxed);
+		part.last_timestamp = slot.last_timestamp.load(std::memory_order_relaxed);
+		// only one caller gets to report the slot
+		if (!slot.key.compare_exchange_strong(current, erased_key, std::memory_order_acq_rel))
+			continue;
+		Merge(summary, part);
+		found = true;
+	}
+	return found;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace ProcessTracer
+{
+	// Totals of the writes to one handle.
+	struct WriteSummary
+	{
+		static constexpr uint64_t no_offset = UINT64_MAX; // every write used the file pointer
+
+		uint64_t count = 0;
+		uint64_t bytes = 0;
+		uint64_t first_offset = no_offset;
+		uint64_t last_offset = no_offset;
+		uint64_t first_timestamp = 0;
+		uint64_t last_timestamp = 0;
+	};
+
+	// Accumulates writes per handle so a handle produces one summary event instead of one event per
+	// call. Same open addressing layout as HandlePathTable: a writer claims a slot once with a
+	// compare-exchange, every later write to that handle only adds to its counters.
+	class WriteAggregator
+	{
+	public:
+		static constexpr size_t slot_bits = 9;
+		static constexpr size_t slot_count = size_t{1} << slot_bits;
+		static constexpr size_t max_probe = 16;
+
+	private:
+		static constexpr uintptr_t empty_key = 0;
+		static constexpr uintptr_t erased_key = 1;
+		static constexpr uintptr_t claiming_key = 2; // a writer is resetting the counters
+		static constexpr int claim_wait_attempts = 64;
+
+		struct Slot
+		{
+			std::atomic<uintptr_t> key{empty_key};
+			std::atomic<uint64_t> count{0};
+			std::atomic<uint64_t> bytes{0};
+			std::atomic<uint64_t> first_offset{WriteSummary::no_offset};
+			std::atomic<uint64_t> last_offset{WriteSummary::no_offset};
+			std::atomic<uint64_t> first_timestamp{0};
+			std::atomic<uint64_t> last_timestamp{0};
+		};
+
+		Slot m_slots[slot_count];
+
+		static size_t Hash(uintptr_t key)
+		{
+			const uint64_t mixed = static_cast<uint64_t>(key >> 2) * 0x9E3779B97F4A7C15ull;
+			return static_cast<size_t>(mixed >> (64 - slot_bits));
+		}
+
+		static uintptr_t LoadSettledKey(const Slot& slot);
+		Slot* Find(uintptr_t key);
+		Slot* Claim(uintptr_t key);
+
+	public:
+		WriteAggregator() = default;
+		WriteAggregator(const WriteAggregator&) = delete;
+		WriteAggregator& operator=(const WriteAggregator&) = delete;
+
+		// Counts one write, offset is WriteSummary::no_offset when the file pointer was used.
+		// Returns false when the table is full, the caller then reports the write on its own.
+		bool Add(uintptr_t key, uint64_t bytes, uint64_t offset, uint64_t timestamp);
+		// Removes the totals of key, false when nothing was written through it.
+		bool Take(uintptr_t key, WriteSummary& summary);
+
+		// Takes every remaining handle, for process exit.
+		template <typename Callback>
+		void Drain(Callback&& callback)
+		{
+			for (auto& slot : m_slots)
+			{
+				const uintptr_t key = slot.key.load(std::memory_order_acquire);
+				if (key == empty_key || key == erased_key || key == claiming_key)
+					continue;
+				WriteSummary summary;
+				if (Take(key, summary))
+					callback(key, summary);
+			}
+		}
+	};
+}
+
+ProcessTracer::WriteAggregator* GetWriteAggregator();
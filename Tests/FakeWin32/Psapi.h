@@ -0,0 +1,4 @@
+#pragma once
+#include <windows.h>
+
+extern "C" DWORD WINAPI GetMappedFileNameW(HANDLE process, LPVOID address, LPWSTR filename, DWORD size);
@@ -0,0 +1,14 @@
+#pragma once
+#include <windows.h>
+// Detours is never asked to patch anything on the host, the harness calls the hooks directly.
+
+typedef BOOL (WINAPI *PDETOUR_CREATE_PROCESS_ROUTINEW)(LPCWSTR application_name, LPWSTR command_line,
+                                                       LPSECURITY_ATTRIBUTES process_attributes,
+                                                       LPSECURITY_ATTRIBUTES thread_attributes, BOOL inherit_handles,
+                                                       DWORD creation_flags, LPVOID environment,
+                                                       LPCWSTR current_directory, LPSTARTUPINFOW startup_info,
+                                                       LPPROCESS_INFORMATION process_information);
+
+BOOL WINAPI DetourUpdateProcessWithDll(HANDLE process, LPCSTR* dlls, DWORD count);
+BOOL WINAPI DetourProcessViaHelperW(DWORD pid, LPCSTR dll, PDETOUR_CREATE_PROCESS_ROUTINEW create_process);
+BOOL WINAPI DetourCopyPayloadToProcess(HANDLE process, REFGUID guid, LPCVOID data, DWORD size);
@@ -0,0 +1,308 @@
+#include <time.h>
+
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "fake_object.h"
+
+namespace
+{
+	using ProcessTracer::FakeWin32::File;
+	using ProcessTracer::FakeWin32::NtCall;
+	using ProcessTracer::FakeWin32::Objects;
+
+	constexpr auto call_count = static_cast<size_t>(NtCall::Count);
+	constexpr NTSTATUS status_not_implemented = static_cast<int32_t>(0xC0000002);
+	constexpr NTSTATUS status_info_length_mismatch = static_cast<int32_t>(0xC0000004);
+	constexpr NTSTATUS status_invalid_handle = static_cast<int32_t>(0xC0000008);
+	constexpr NTSTATUS status_invalid_parameter = static_cast<int32_t>(0xC000000D);
+	constexpr ULONG file_rename_information = 10;
+	constexpr ULONG file_rename_information_ex = 65;
+
+	std::atomic<NTSTATUS> g_statuses[call_count];
+	std::atomic<uint64_t> g_calls[call_count];
+	std::atomic<uint64_t> g_call_cost_ns{0};
+	std::atomic<bool> g_file_costs_set{false};
+	std::mutex g_file_costs_lock;
+	std::vector<std::pair<std::u16string, uint64_t>> g_file_costs;
+
+	uint64_t Nanoseconds()
+	{
+		timespec now{};
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		return static_cast<uint64_t>(now.tv_sec) * 1000000000 + static_cast<uint64_t>(now.tv_nsec);
+	}
+
+	std::u16string UnicodeText(const UNICODE_STRING* text)
+	{
+		if (!text || !text->Buffer)
+			return {};
+		return {reinterpret_cast<const char16_t*>(text->Buffer), text->Length / sizeof(WCHAR)};
+	}
+
+	uint64_t FileCost(const std::u16string& name, uint64_t cost)
+	{
+		std::lock_guard<std::mutex> guard(g_file_costs_lock);
+		for (const auto& [name_part, file_cost] : g_file_costs)
+		{
+			if (name.find(name_part) != std::u16string::npos)
+				return file_cost;
+		}
+		return cost;
+	}
+
+	// Counts the call and spends its cost, returns the status it is scripted to fail with. The file
+	// the call is on, by handle or by name, is only looked at when some file has a cost of its own.
+	NTSTATUS Enter(NtCall call, HANDLE file = nullptr, const UNICODE_STRING* name = nullptr)
+	{
+		const auto index = static_cast<size_t>(call);
+		g_calls[index].fetch_add(1, std::memory_order_relaxed);
+		uint64_t cost = g_call_cost_ns.load(std::memory_order_relaxed);
+		if (g_file_costs_set.load(std::memory_order_relaxed) && (file || name))
+			cost = FileCost(file ? ProcessTracer::FakeWin32::HandleName(file) : UnicodeText(name), cost);
+		if (cost && !ProcessTracer::FakeWin32::AdvanceVirtualClock(cost))
+		{
+			const uint64_t end = Nanoseconds() + cost;
+			while (Nanoseconds() < end)
+			{
+			}
+		}
+		return g_statuses[index].load(std::memory_order_relaxed);
+	}
+
+	// a relative name joined to its root, as the object manager resolves it
+	bool ResolveName(HANDLE root, std::u16string name, std::u16string& resolved)
+	{
+		if (!root)
+		{
+			resolved = std::move(name);
+			return true;
+		}
+		const auto directory = Objects().FindLocked<File>(root);
+		if (!directory)
+			return false;
+		resolved = directory->name;
+		if (!name.empty())
+			resolved.append(u"\\").append(name);
+		return true;
+	}
+
+	HANDLE InsertFile(std::u16string name)
+	{
+		const auto file = new File;
+		file->name = std::move(name);
+		return Objects().Insert(file);
+	}
+
+	VOID Complete(PIO_STATUS_BLOCK io_status, NTSTATUS status, ULONG_PTR information)
+	{
+		if (!io_status)
+			return;
+		io_status->Status = status;
+		io_status->Information = information;
+	}
+}
+
+void ProcessTracer::FakeWin32::SetStatus(NtCall call, NTSTATUS status)
+{
+	g_statuses[static_cast<size_t>(call)].store(status, std::memory_order_relaxed);
+}
+
+void ProcessTracer::FakeWin32::SetCallCost(uint64_t nanoseconds)
+{
+	g_call_cost_ns.store(nanoseconds, std::memory_order_relaxed);
+}
+
+void ProcessTracer::FakeWin32::SetFileCost(const std::u16string& name_part, uint64_t nanoseconds)
+{
+	std::lock_guard<std::mutex> guard(g_file_costs_lock);
+	g_file_costs.emplace_back(name_part, nanoseconds);
+	g_file_costs_set.store(true, std::memory_order_relaxed);
+}
+
+uint64_t ProcessTracer::FakeWin32::CallCount(NtCall call)
+{
+	return g_calls[static_cast<size_t>(call)].load(std::memory_order_relaxed);
+}
+
+void ProcessTracer::FakeWin32::ResetCalls()
+{
+	for (auto& calls : g_calls)
+		calls.store(0, std::memory_order_relaxed);
+	for (auto& status : g_statuses)
+		status.store(0, std::memory_order_relaxed);
+	g_call_cost_ns.store(0, std::memory_order_relaxed);
+	std::lock_guard<std::mutex> guard(g_file_costs_lock);
+	g_file_costs.clear();
+	g_file_costs_set.store(false, std::memory_order_relaxed);
+}
+
+HANDLE ProcessTracer::FakeWin32::OpenUntraced(const char16_t* path)
+{
+	return InsertFile(path);
+}
+
+std::u16string ProcessTracer::FakeWin32::HandleName(HANDLE handle)
+{
+	std::shared_lock<std::shared_mutex> guard(Objects().Lock());
+	const auto file = Objects().FindLocked<File>(handle);
+	return file ? file->name : std::u16string();
+}
+
+VOID NTAPI RtlInitUnicodeString(PUNICODE_STRING destination, PCWSTR source)
+{
+	const size_t length = source ? std::char_traits<char16_t>::length(reinterpret_cast<const char16_t*>(source)) : 0;
+	destination->Length = static_cast<USHORT>(length * sizeof(WCHAR));
+	destination->MaximumLength = static_cast<USHORT>(destination->Length + sizeof(WCHAR));
+	destination->Buffer = const_cast<PWSTR>(source);
+}
+
+NTSTATUS NTAPI NtCreateFile(PHANDLE FileHandle, ACCESS_MASK, PCOBJECT_ATTRIBUTES ObjectAttributes,
+                            PIO_STATUS_BLOCK IoStatusBlock, PLARGE_INTEGER, ULONG, ULONG, ULONG CreateDisposition,
+                            ULONG, PVOID, ULONG)
+{
+	NTSTATUS status = Enter(NtCall::CreateFile, nullptr, ObjectAttributes ? ObjectAttributes->ObjectName : nullptr);
+	if (!ObjectAttributes || !ObjectAttributes->ObjectName)
+		status = status_invalid_parameter;
+	if (!NT_SUCCESS(status))
+		return status;
+	std::u16string name;
+	{
+		std::shared_lock<std::shared_mutex> guard(Objects().Lock());
+		if (!ResolveName(ObjectAttributes->RootDirectory, UnicodeText(ObjectAttributes->ObjectName), name))
+			return status_invalid_handle;
+	}
+	*FileHandle = InsertFile(std::move(name));
+	// FILE_CREATED or FILE_OPENED, there is no namespace to tell which
+	Complete(IoStatusBlock, 0, CreateDisposition == FILE_CREATE ? 2 : 1);
+	return 0;
+}
+
+NTSTATUS NTAPI NtWriteFile(HANDLE FileHandle, HANDLE, PIO_APC_ROUTINE, PVOID, PIO_STATUS_BLOCK IoStatusBlock,
+                           PVOID, ULONG Length, PLARGE_INTEGER, PULONG)
+{
+	// the hot path, the handle is not looked up
+	const NTSTATUS status = FileHandle ? Enter(NtCall::WriteFile, FileHandle) : status_invalid_handle;
+	Complete(IoStatusBlock, status, NT_SUCCESS(status) ? Length : 0);
+	return status;
+}
+
+NTSTATUS NTAPI ZwWriteFile(HANDLE FileHandle, HANDLE Event, PIO_APC_ROUTINE ApcRoutine, PVOID ApcContext,
+                           PIO_STATUS_BLOCK IoStatusBlock, PVOID Buffer, ULONG Length, PLARGE_INTEGER ByteOffset,
+                           PULONG Key)
+{
+	return NtWriteFile(FileHandle, Event, ApcRoutine, ApcContext, IoStatusBlock, Buffer, Length, ByteOffset, Key);
+}
+
+NTSTATUS NTAPI NtQueryObject(HANDLE Handle, OBJECT_INFORMATION_CLASS ObjectInformationClass, PVOID ObjectInformation,
+                             ULONG ObjectInformationLength, PULONG ReturnLength)
+{
+	const NTSTATUS status = Enter(NtCall::QueryObject);
+	if (!NT_SUCCESS(status))
+		return status;
+	if (ObjectInformationClass != static_cast<OBJECT_INFORMATION_CLASS>(ObjectNameInformation))
+		return status_not_implemented;
+	std::shared_lock<std::shared_mutex> guard(Objects().Lock());
+	const auto file = Objects().FindLocked<File>(Handle);
+	if (!file)
+		return status_invalid_handle;
+	// the name follows the structure and is terminated, like the kernel returns it
+	const size_t name_bytes = file->name.size() * sizeof(WCHAR);
+	const size_t needed = sizeof(OBJECT_NAME_INFORMATION) + name_bytes + sizeof(WCHAR);
+	if (ReturnLength)
+		*ReturnLength = static_cast<ULONG>(needed);
+	if (needed > ObjectInformationLength)
+		return status_info_length_mismatch;
+	const auto information = static_cast<POBJECT_NAME_INFORMATION>(ObjectInformation);
+	const auto name = reinterpret_cast<char16_t*>(information + 1);
+	memcpy(name, file->name.c_str(), name_bytes + sizeof(WCHAR));
+	information->Name.Length = static_cast<USHORT>(name_bytes);
+	information->Name.MaximumLength = static_cast<USHORT>(name_bytes + sizeof(WCHAR));
+	information->Name.Buffer = reinterpret_cast<PWSTR>(name);
+	return 0;
+}
+
+NTSTATUS NTAPI NtSetInformationFile(HANDLE FileHandle, PIO_STATUS_BLOCK IoStatusBlock, PVOID FileInformation,
+                                    ULONG Length, FILE_INFORMATION_CLASS FileInformationClass)
+{
+	const NTSTATUS status = Enter(NtCall::SetInformationFile, FileHandle);
+	if (!NT_SUCCESS(status))
+		return status;
+	const auto information_class = static_cast<ULONG>(FileInformationClass);
+	std::unique_lock<std::shared_mutex> guard(Objects().Lock());
+	const auto file = Objects().FindLocked<File>(FileHandle);
+	if (!file)
+		return status_invalid_handle;
+	if (information_class == file_rename_information || information_class == file_rename_information_ex)
+	{
+		const auto rename = static_cast<const ProcessTracer::FakeWin32::RenameInformation*>(FileInformation);
+		if (!rename || Length < sizeof(*rename))
+			return status_invalid_parameter;
+		std::u16string name(reinterpret_cast<const char16_t*>(rename->FileName), rename->FileNameLength / sizeof(WCHAR));
+		if (!ResolveName(rename->RootDirectory, std::move(name), file->name))
+			return status_invalid_handle;
+	}
+	Complete(IoStatusBlock, 0, 0);
+	return 0;
+}
+
+NTSTATUS NTAPI NtClose(HANDLE Handle)
+{
+	Enter(NtCall::Close);
+	return Objects().Close(Handle) ? 0 : status_invalid_handle;
+}
+
+NTSTATUS NTAPI NtDuplicateObject(HANDLE SourceProcessHandle, HANDLE SourceHandle, HANDLE TargetProcessHandle,
+                                 PHANDLE TargetHandle, ACCESS_MASK, ULONG, ULONG Options)
+{
+	const NTSTATUS status = Enter(NtCall::DuplicateObject);
+	if (SourceProcessHandle != GetCurrentProcess() ||
+		(TargetProcessHandle && TargetProcessHandle != GetCurrentProcess()))
+		return status_not_implemented;
+	const std::u16string name = ProcessTracer::FakeWin32::HandleName(SourceHandle);
+	// the source is closed even when the duplication fails
+	if (Options & DUPLICATE_CLOSE_SOURCE)
+		Objects().Close(SourceHandle);
+	if (!NT_SUCCESS(status))
+		return status;
+	if (name.empty())
+		return status_invalid_handle;
+	if (TargetHandle && TargetProcessHandle)
+		*TargetHandle = InsertFile(name);
+	return 0;
+}
+
+NTSTATUS NTAPI NtCreateSection(PHANDLE, ACCESS_MASK, PCOBJECT_ATTRIBUTES, PLARGE_INTEGER, ULONG, ULONG, HANDLE)
+{
+	return status_not_implemented;
+}
+
+NTSTATUS NTAPI ZwCreateSection(PHANDLE, ACCESS_MASK, PCOBJECT_ATTRIBUTES, PLARGE_INTEGER, ULONG, ULONG, HANDLE)
+{
+	return status_not_implemented;
+}
+
+NTSTATUS NTAPI NtCreateSectionEx(PHANDLE, ACCESS_MASK, PCOBJECT_ATTRIBUTES, PLARGE_INTEGER, ULONG, ULONG, HANDLE,
+                                 PMEM_EXTENDED_PARAMETER, ULONG)
+{
+	return status_not_implemented;
+}
+
+NTSTATUS NTAPI NtMapViewOfSection(HANDLE, HANDLE, PVOID*, ULONG_PTR, SIZE_T, PLARGE_INTEGER, PSIZE_T,
+                                  SECTION_INHERIT, ULONG, ULONG)
+{
+	return status_not_implemented;
+}
+
+NTSTATUS NTAPI NtQuerySection(HANDLE, SECTION_INFORMATION_CLASS, PVOID, SIZE_T, PSIZE_T)
+{
+	return status_not_implemented;
+}
+
+NTSTATUS NTAPI NtCreateUserProcess(PHANDLE, PHANDLE, ACCESS_MASK, ACCESS_MASK, PCOBJECT_ATTRIBUTES,
+                                   PCOBJECT_ATTRIBUTES, ULONG, ULONG, PRTL_USER_PROCESS_PARAMETERS, PPS_CREATE_INFO,
+                                   PPS_ATTRIBUTE_LIST)
+{
+	return status_not_implemented;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <shared_mutex>
+#include <string>
+#include <unordered_set>
+
+#include "fake_win32.h"
+
+// The kernel objects behind fake handles, shared by fake_win32.cpp and fake_nt.cpp.
+namespace ProcessTracer::FakeWin32
+{
+	struct Object
+	{
+		virtual ~Object() = default;
+
+		// false keeps the object alive after its handle was closed, see Thread
+		virtual bool DeleteOnClose()
+		{
+			return true;
+		}
+	};
+
+	// A file opened through NtCreateFile has only a name, one opened through CreateFileW also a
+	// descriptor.
+	struct File final : Object
+	{
+		std::u16string name;
+		int fd = -1;
+
+		~File() override;
+	};
+
+	// Every open handle; lookups and renames take the lock, closes remove the object.
+	class ObjectTable
+	{
+		std::shared_mutex m_lock;
+		std::unordered_set<Object*> m_objects;
+
+	public:
+		HANDLE Insert(Object* object);
+		bool Close(HANDLE handle);
+
+		std::shared_mutex& Lock()
+		{
+			return m_lock;
+		}
+
+		// the object behind an open handle, nullptr for a stale handle or another type; hold Lock()
+		template <typename T>
+		T* FindLocked(HANDLE handle)
+		{
+			const auto found = m_objects.find(static_cast<Object*>(handle));
+			return found == m_objects.end() ? nullptr : dynamic_cast<T*>(*found);
+		}
+	};
+
+	ObjectTable& Objects();
+
+	// false unless the virtual clock is on, see UseVirtualClock
+	bool AdvanceVirtualClock(uint64_t nanoseconds);
+}
@@ -0,0 +1,742 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <detours.h>
+#include <Psapi.h>
+#include <shellapi.h>
+
+#include "fake_object.h"
+#include "utf16_to_utf8.h"
+
+namespace
+{
+	using ProcessTracer::FakeWin32::File;
+	using ProcessTracer::FakeWin32::Object;
+	using ProcessTracer::FakeWin32::Objects;
+
+	thread_local DWORD t_last_error = ERROR_SUCCESS;
+
+	const HANDLE current_process = reinterpret_cast<HANDLE>(static_cast<intptr_t>(-1));
+
+	struct Event final : Object
+	{
+		std::mutex lock;
+		std::condition_variable signaled_changed;
+		bool signaled;
+		bool manual_reset;
+
+		Event(bool manual_reset, bool signaled) : signaled(signaled), manual_reset(manual_reset)
+		{
+		}
+
+		// true when the event was signaled within timeout_ms, an auto-reset event is reset again
+		bool Wait(DWORD timeout_ms)
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			auto is_signaled = [this] { return signaled; };
+			if (timeout_ms == INFINITE)
+				signaled_changed.wait(guard, is_signaled);
+			else if (!signaled_changed.wait_for(guard, std::chrono::milliseconds(timeout_ms), is_signaled))
+				return false;
+			if (!manual_reset)
+				signaled = false;
+			return true;
+		}
+	};
+
+	// The handle of a thread may be closed while it runs, the object stays until JoinThreads.
+	struct Thread final : Object
+	{
+		pthread_t thread{};
+		LPTHREAD_START_ROUTINE start = nullptr;
+		LPVOID parameter = nullptr;
+		Event finished{true, false};
+		bool handle_closed = false;
+		bool joined = false;
+
+		bool DeleteOnClose() override;
+	};
+
+	std::mutex g_threads_lock;
+	std::vector<Thread*> g_threads;
+
+	bool Thread::DeleteOnClose()
+	{
+		std::lock_guard<std::mutex> guard(g_threads_lock);
+		handle_closed = true;
+		return joined;
+	}
+
+	void* ThreadMain(void* parameter)
+	{
+		const auto thread = static_cast<Thread*>(parameter);
+		thread->start(thread->parameter);
+		{
+			std::lock_guard<std::mutex> guard(thread->finished.lock);
+			thread->finished.signaled = true;
+		}
+		thread->finished.signaled_changed.notify_all();
+		return nullptr;
+	}
+
+	struct Mapping final : Object
+	{
+		int fd = -1;
+		uint64_t size = 0;
+
+		~Mapping() override
+		{
+			if (fd >= 0)
+				close(fd);
+		}
+	};
+
+	std::mutex g_views_lock;
+	std::map<const void*, size_t> g_views;
+
+	std::atomic<bool> g_virtual_clock{false};
+	std::atomic<uint64_t> g_virtual_ns{0};
+	// added to the monotonic clock, so it continues where the virtual clock stopped
+	std::atomic<uint64_t> g_clock_offset_ns{0};
+
+	uint64_t Nanoseconds()
+	{
+		timespec now{};
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		return static_cast<uint64_t>(now.tv_sec) * 1000000000 + static_cast<uint64_t>(now.tv_nsec) +
+			g_clock_offset_ns.load(std::memory_order_relaxed);
+	}
+
+	std::string NarrowPath(LPCWSTR path)
+	{
+		std::string narrow;
+		if (path)
+		{
+			const auto text = reinterpret_cast<const char16_t*>(path);
+			ProcessTracer::Utf8::AppendFromUtf16(narrow, text, std::char_traits<char16_t>::length(text));
+		}
+		return narrow;
+	}
+
+	DWORD ErrorFromErrno(int error)
+	{
+		switch (error)
+		{
+		case ENOENT:
+			return ERROR_FILE_NOT_FOUND;
+		case EEXIST:
+			return ERROR_ALREADY_EXISTS;
+		case ENOMEM:
+		case ENOSPC:
+			return ERROR_NOT_ENOUGH_MEMORY;
+		default:
+			return ERROR_INVALID_PARAMETER;
+		}
+	}
+
+	// the descriptor of a file opened by CreateFileW, -1 otherwise
+	int Descriptor(HANDLE handle)
+	{
+		std::shared_lock<std::shared_mutex> guard(Objects().Lock());
+		const auto file = Objects().FindLocked<File>(handle);
+		return file ? file->fd : -1;
+	}
+}
+
+ProcessTracer::FakeWin32::File::~File()
+{
+	if (fd >= 0)
+		close(fd);
+}
+
+HANDLE ProcessTracer::FakeWin32::ObjectTable::Insert(Object* object)
+{
+	std::unique_lock<std::shared_mutex> guard(m_lock);
+	m_objects.insert(object);
+	return object;
+}
+
+bool ProcessTracer::FakeWin32::ObjectTable::Close(HANDLE handle)
+{
+	std::unique_lock<std::shared_mutex> guard(m_lock);
+	const auto found = m_objects.find(static_cast<Object*>(handle));
+	if (found == m_objects.end())
+		return false;
+	const auto object = *found;
+	m_objects.erase(found);
+	guard.unlock();
+	if (object->DeleteOnClose())
+		delete object;
+	return true;
+}
+
+ProcessTracer::FakeWin32::ObjectTable& ProcessTracer::FakeWin32::Objects()
+{
+	static ObjectTable objects;
+	return objects;
+}
+
+void ProcessTracer::FakeWin32::UseVirtualClock(bool on)
+{
+	if (on)
+	{
+		g_virtual_ns.store(Nanoseconds(), std::memory_order_relaxed);
+		g_virtual_clock.store(true, std::memory_order_relaxed);
+		return;
+	}
+	g_virtual_clock.store(false, std::memory_order_relaxed);
+	const uint64_t virtual_ns = g_virtual_ns.load(std::memory_order_relaxed);
+	const uint64_t now = Nanoseconds();
+	if (virtual_ns > now)
+		g_clock_offset_ns.fetch_add(virtual_ns - now, std::memory_order_relaxed);
+}
+
+bool ProcessTracer::FakeWin32::AdvanceVirtualClock(uint64_t nanoseconds)
+{
+	if (!g_virtual_clock.load(std::memory_order_relaxed))
+		return false;
+	g_virtual_ns.fetch_add(nanoseconds, std::memory_order_relaxed);
+	return true;
+}
+
+void ProcessTracer::FakeWin32::JoinThreads()
+{
+	std::vector<Thread*> threads;
+	{
+		std::lock_guard<std::mutex> guard(g_threads_lock);
+		threads.swap(g_threads);
+	}
+	for (const auto thread : threads)
+	{
+		pthread_join(thread->thread, nullptr);
+		std::lock_guard<std::mutex> guard(g_threads_lock);
+		thread->joined = true;
+		if (thread->handle_closed)
+			delete thread;
+	}
+}
+
+DWORD WINAPI GetCurrentProcessId()
+{
+	return static_cast<DWORD>(getpid());
+}
+
+DWORD WINAPI GetCurrentThreadId()
+{
+	thread_local const auto thread_id = static_cast<DWORD>(syscall(SYS_gettid));
+	return thread_id;
+}
+
+HANDLE WINAPI GetCurrentProcess()
+{
+	return current_process;
+}
+
+DWORD WINAPI GetProcessId(HANDLE process)
+{
+	return process == current_process ? GetCurrentProcessId() : 0;
+}
+
+DWORD WINAPI GetLastError()
+{
+	return t_last_error;
+}
+
+VOID WINAPI SetLastError(DWORD error)
+{
+	t_last_error = error;
+}
+
+BOOL WINAPI CloseHandle(HANDLE handle)
+{
+	if (handle == current_process)
+		return TRUE;
+	if (Objects().Close(handle))
+		return TRUE;
+	SetLastError(ERROR_INVALID_HANDLE);
+	return FALSE;
+}
+
+VOID WINAPI Sleep(DWORD milliseconds)
+{
+	timespec duration{static_cast<time_t>(milliseconds / 1000), static_cast<long>(milliseconds % 1000) * 1000000};
+	while (nanosleep(&duration, &duration) != 0 && errno == EINTR)
+	{
+	}
+}
+
+ULONGLONG WINAPI GetTickCount64()
+{
+	timespec now{};
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return static_cast<ULONGLONG>(now.tv_sec) * 1000 + static_cast<ULONGLONG>(now.tv_nsec) / 1000000;
+}
+
+BOOL WINAPI QueryPerformanceCounter(LARGE_INTEGER* counter)
+{
+	const uint64_t now = g_virtual_clock.load(std::memory_order_relaxed)
+		                     ? g_virtual_ns.load(std::memory_order_relaxed)
+		                     : Nanoseconds();
+	counter->QuadPart = static_cast<LONGLONG>(now);
+	return TRUE;
+}
+
+BOOL WINAPI QueryPerformanceFrequency(LARGE_INTEGER* frequency)
+{
+	frequency->QuadPart = 1000000000;
+	return TRUE;
+}
+
+VOID WINAPI GetSystemInfo(LPSYSTEM_INFO info)
+{
+	info->dwPageSize = static_cast<DWORD>(sysconf(_SC_PAGESIZE));
+	info->dwAllocationGranularity = 64 * 1024;
+}
+
+VOID WINAPI AcquireSRWLockExclusive(PSRWLOCK lock)
+{
+	pthread_rwlock_wrlock(&lock->lock);
+}
+
+VOID WINAPI ReleaseSRWLockExclusive(PSRWLOCK lock)
+{
+	pthread_rwlock_unlock(&lock->lock);
+}
+
+VOID WINAPI AcquireSRWLockShared(PSRWLOCK lock)
+{
+	pthread_rwlock_rdlock(&lock->lock);
+}
+
+VOID WINAPI ReleaseSRWLockShared(PSRWLOCK lock)
+{
+	pthread_rwlock_unlock(&lock->lock);
+}
+
+BOOLEAN WINAPI TryAcquireSRWLockExclusive(PSRWLOCK lock)
+{
+	return pthread_rwlock_trywrlock(&lock->lock) == 0;
+}
+
+BOOL WINAPI InitOnceExecuteOnce(PINIT_ONCE init_once, PINIT_ONCE_FN function, PVOID parameter, LPVOID* context)
+{
+	if (init_once->done.load(std::memory_order_acquire))
+		return TRUE;
+	pthread_mutex_lock(&init_once->lock);
+	// like Windows, a failed initialization is tried again by the next caller
+	BOOL succeeded = init_once->done.load(std::memory_order_relaxed);
+	if (!succeeded)
+	{
+		succeeded = function(init_once, parameter, context);
+		init_once->done.store(succeeded, std::memory_order_release);
+	}
+	pthread_mutex_unlock(&init_once->lock);
+	return succeeded;
+}
+
+HANDLE WINAPI CreateEventW(LPSECURITY_ATTRIBUTES, BOOL manual_reset, BOOL initial_state, LPCWSTR name)
+{
+	if (name)
+	{
+		SetLastError(ERROR_CALL_NOT_IMPLEMENTED);
+		return nullptr;
+	}
+	return Objects().Insert(new Event(manual_reset, initial_state));
+}
+
+BOOL WINAPI SetEvent(HANDLE handle)
+{
+	std::shared_lock<std::shared_mutex> guard(Objects().Lock());
+	const auto event = Objects().FindLocked<Event>(handle);
+	if (!event)
+	{
+		SetLastError(ERROR_INVALID_HANDLE);
+		return FALSE;
+	}
+	{
+		std::lock_guard<std::mutex> event_guard(event->lock);
+		event->signaled = true;
+	}
+	if (event->manual_reset)
+		event->signaled_changed.notify_all();
+	else
+		event->signaled_changed.notify_one();
+	return TRUE;
+}
+
+BOOL WINAPI ResetEvent(HANDLE handle)
+{
+	std::shared_lock<std::shared_mutex> guard(Objects().Lock());
+	const auto event = Objects().FindLocked<Event>(handle);
+	if (!event)
+	{
+		SetLastError(ERROR_INVALID_HANDLE);
+		return FALSE;
+	}
+	std::lock_guard<std::mutex> event_guard(event->lock);
+	event->signaled = false;
+	return TRUE;
+}
+
+DWORD WINAPI WaitForSingleObject(HANDLE handle, DWORD milliseconds)
+{
+	Event* event;
+	{
+		// waiting on a handle that another thread closes is undefined on Windows as well
+		std::shared_lock<std::shared_mutex> guard(Objects().Lock());
+		event = Objects().FindLocked<Event>(handle);
+		if (const auto thread = Objects().FindLocked<Thread>(handle))
+			event = &thread->finished;
+	}
+	if (!event)
+	{
+		SetLastError(ERROR_INVALID_HANDLE);
+		return WAIT_FAILED;
+	}
+	return event->Wait(milliseconds) ? WAIT_OBJECT_0 : WAIT_TIMEOUT;
+}
+
+HANDLE WINAPI CreateThread(LPSECURITY_ATTRIBUTES, SIZE_T, LPTHREAD_START_ROUTINE start, LPVOID parameter, DWORD,
+                           LPDWORD thread_id)
+{
+	const auto thread = new Thread;
+	thread->start = start;
+	thread->parameter = parameter;
+	if (pthread_create(&thread->thread, nullptr, ThreadMain, thread) != 0)
+	{
+		delete thread;
+		SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+		return nullptr;
+	}
+	{
+		std::lock_guard<std::mutex> guard(g_threads_lock);
+		g_threads.push_back(thread);
+	}
+	if (thread_id)
+		*thread_id = 0;
+	return Objects().Insert(thread);
+}
+
+DWORD WINAPI ResumeThread(HANDLE)
+{
+	SetLastError(ERROR_CALL_NOT_IMPLEMENTED);
+	return static_cast<DWORD>(-1);
+}
+
+BOOL WINAPI TerminateProcess(HANDLE, UINT)
+{
+	SetLastError(ERROR_CALL_NOT_IMPLEMENTED);
+	return FALSE;
+}
+
+VOID WINAPI ExitProcess(UINT exit_code)
+{
+	exit(static_cast<int>(exit_code));
+}
+
+DWORD WINAPI GetModuleFileNameW(HMODULE, LPWSTR, DWORD)
+{
+	SetLastError(ERROR_CALL_NOT_IMPLEMENTED);
+	return 0;
+}
+
+DWORD WINAPI GetModuleFileNameA(HMODULE, LPSTR, DWORD)
+{
+	SetLastError(ERROR_CALL_NOT_IMPLEMENTED);
+	return 0;
+}
+
+HANDLE WINAPI CreateFileW(LPCWSTR file_name, DWORD, DWORD, LPSECURITY_ATTRIBUTES, DWORD disposition, DWORD,
+                          HANDLE)
+{
+	const std::string path = NarrowPath(file_name);
+	int flags = O_RDWR | O_CLOEXEC;
+	switch (disposition)
+	{
+	case CREATE_NEW:
+		flags |= O_CREAT | O_EXCL;
+		break;
+	case CREATE_ALWAYS:
+		flags |= O_CREAT | O_TRUNC;
+		break;
+	case OPEN_ALWAYS:
+		flags |= O_CREAT;
+		break;
+	case TRUNCATE_EXISTING:
+		flags |= O_TRUNC;
+		break;
+	default:
+		break;
+	}
+	const bool existed = access(path.c_str(), F_OK) == 0;
+	const int fd = open(path.c_str(), flags, 0644);
+	if (fd < 0)
+	{
+		SetLastError(ErrorFromErrno(errno));
+		return INVALID_HANDLE_VALUE;
+	}
+	// Windows reports an existing file this way, the call itself succeeds
+	SetLastError(existed && (disposition == OPEN_ALWAYS || disposition == CREATE_ALWAYS)
+		             ? ERROR_ALREADY_EXISTS
+		             : ERROR_SUCCESS);
+	const auto file = new File;
+	file->name.assign(reinterpret_cast<const char16_t*>(file_name));
+	file->fd = fd;
+	return Objects().Insert(file);
+}
+
+BOOL WINAPI ReadFile(HANDLE handle, LPVOID buffer, DWORD length, LPDWORD read_bytes, LPVOID)
+{
+	const int fd = Descriptor(handle);
+	const ssize_t result = fd < 0 ? -1 : read(fd, buffer, length);
+	if (result < 0)
+	{
+		SetLastError(fd < 0 ? ERROR_INVALID_HANDLE : ErrorFromErrno(errno));
+		return FALSE;
+	}
+	if (read_bytes)
+		*read_bytes = static_cast<DWORD>(result);
+	return TRUE;
+}
+
+BOOL WINAPI WriteFile(HANDLE handle, LPCVOID buffer, DWORD length, LPDWORD written, LPVOID)
+{
+	const int fd = Descriptor(handle);
+	const ssize_t result = fd < 0 ? -1 : write(fd, buffer, length);
+	if (result < 0)
+	{
+		SetLastError(fd < 0 ? ERROR_INVALID_HANDLE : ErrorFromErrno(errno));
+		return FALSE;
+	}
+	if (written)
+		*written = static_cast<DWORD>(result);
+	return TRUE;
+}
+
+BOOL WINAPI GetFileSizeEx(HANDLE handle, PLARGE_INTEGER size)
+{
+	struct stat status{};
+	const int fd = Descriptor(handle);
+	if (fd < 0 || fstat(fd, &status) != 0)
+	{
+		SetLastError(ERROR_INVALID_HANDLE);
+		return FALSE;
+	}
+	size->QuadPart = status.st_size;
+	return TRUE;
+}
+
+BOOL WINAPI SetFilePointerEx(HANDLE handle, LARGE_INTEGER distance, PLARGE_INTEGER new_position, DWORD method)
+{
+	const int whence = method == FILE_END ? SEEK_END : method == FILE_CURRENT ? SEEK_CUR : SEEK_SET;
+	const int fd = Descriptor(handle);
+	const off_t position = fd < 0 ? -1 : lseek(fd, distance.QuadPart, whence);
+	if (position < 0)
+	{
+		SetLastError(ERROR_INVALID_PARAMETER);
+		return FALSE;
+	}
+	if (new_position)
+		new_position->QuadPart = position;
+	return TRUE;
+}
+
+BOOL WINAPI SetEndOfFile(HANDLE handle)
+{
+	const int fd = Descriptor(handle);
+	const off_t position = fd < 0 ? -1 : lseek(fd, 0, SEEK_CUR);
+	if (position < 0 || ftruncate(fd, position) != 0)
+	{
+		SetLastError(fd < 0 ? ERROR_INVALID_HANDLE : ErrorFromErrno(errno));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+BOOL WINAPI FlushFileBuffers(HANDLE handle)
+{
+	const int fd = Descriptor(handle);
+	if (fd < 0 || fsync(fd) != 0)
+	{
+		SetLastError(ERROR_INVALID_HANDLE);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+DWORD WINAPI GetFinalPathNameByHandleW(HANDLE handle, LPWSTR path, DWORD size, DWORD)
+{
+	const std::u16string name = ProcessTracer::FakeWin32::HandleName(handle);
+	if (name.empty())
+	{
+		SetLastError(ERROR_INVALID_HANDLE);
+		return 0;
+	}
+	// like Windows, a buffer too small gets nothing and the size it needs
+	if (name.size() >= size)
+		return static_cast<DWORD>(name.size() + 1);
+	memcpy(path, name.c_str(), (name.size() + 1) * sizeof(char16_t));
+	return static_cast<DWORD>(name.size());
+}
+
+HANDLE WINAPI CreateFileMappingW(HANDLE handle, LPSECURITY_ATTRIBUTES, DWORD, DWORD maximum_size_high,
+                                 DWORD maximum_size_low, LPCWSTR name)
+{
+	// named and pagefile-backed sections have no use in the harness
+	const int fd = Descriptor(handle);
+	if (name || fd < 0)
+	{
+		SetLastError(name ? ERROR_CALL_NOT_IMPLEMENTED : ERROR_INVALID_HANDLE);
+		return nullptr;
+	}
+	uint64_t size = static_cast<uint64_t>(maximum_size_high) << 32 | maximum_size_low;
+	struct stat status{};
+	if (fstat(fd, &status) != 0)
+	{
+		SetLastError(ErrorFromErrno(errno));
+		return nullptr;
+	}
+	if (size == 0)
+		size = static_cast<uint64_t>(status.st_size);
+	// a mapping larger than its file extends the file, as on Windows
+	if (size > static_cast<uint64_t>(status.st_size) && ftruncate(fd, static_cast<off_t>(size)) != 0)
+	{
+		SetLastError(ErrorFromErrno(errno));
+		return nullptr;
+	}
+	const auto mapping = new Mapping;
+	mapping->fd = dup(fd);
+	mapping->size = size;
+	SetLastError(ERROR_SUCCESS);
+	return Objects().Insert(mapping);
+}
+
+HANDLE WINAPI OpenFileMappingA(DWORD, BOOL, LPCSTR)
+{
+	SetLastError(ERROR_FILE_NOT_FOUND);
+	return nullptr;
+}
+
+HANDLE WINAPI OpenFileMappingW(DWORD, BOOL, LPCWSTR)
+{
+	SetLastError(ERROR_FILE_NOT_FOUND);
+	return nullptr;
+}
+
+LPVOID WINAPI MapViewOfFile(HANDLE handle, DWORD access, DWORD offset_high, DWORD offset_low, SIZE_T size)
+{
+	int fd;
+	uint64_t mapping_size;
+	{
+		std::shared_lock<std::shared_mutex> guard(Objects().Lock());
+		const auto mapping = Objects().FindLocked<Mapping>(handle);
+		if (!mapping)
+		{
+			SetLastError(ERROR_INVALID_HANDLE);
+			return nullptr;
+		}
+		fd = mapping->fd;
+		mapping_size = mapping->size;
+	}
+	const uint64_t offset = static_cast<uint64_t>(offset_high) << 32 | offset_low;
+	if (size == 0)
+		size = static_cast<SIZE_T>(mapping_size - offset);
+	if (offset + size > mapping_size)
+	{
+		SetLastError(ERROR_INVALID_PARAMETER);
+		return nullptr;
+	}
+	const int protection = access & FILE_MAP_WRITE ? PROT_READ | PROT_WRITE : PROT_READ;
+	void* view = mmap(nullptr, size, protection, MAP_SHARED, fd, static_cast<off_t>(offset));
+	if (view == MAP_FAILED)
+	{
+		SetLastError(ErrorFromErrno(errno));
+		return nullptr;
+	}
+	std::lock_guard<std::mutex> guard(g_views_lock);
+	g_views[view] = size;
+	return view;
+}
+
+BOOL WINAPI UnmapViewOfFile(LPCVOID address)
+{
+	size_t size;
+	{
+		std::lock_guard<std::mutex> guard(g_views_lock);
+		const auto found = g_views.find(address);
+		if (found == g_views.end())
+		{
+			SetLastError(ERROR_INVALID_PARAMETER);
+			return FALSE;
+		}
+		size = found->second;
+		g_views.erase(found);
+	}
+	return munmap(const_cast<void*>(address), size) == 0;
+}
+
+BOOL WINAPI FlushViewOfFile(LPCVOID address, SIZE_T size)
+{
+	// msync wants a page aligned start
+	const auto page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+	const auto start = reinterpret_cast<uintptr_t>(address) & ~(page - 1);
+	const size_t length = size + (reinterpret_cast<uintptr_t>(address) - start);
+	if (msync(reinterpret_cast<void*>(start), length, MS_ASYNC) != 0)
+	{
+		SetLastError(ErrorFromErrno(errno));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+int WINAPI WideCharToMultiByte(UINT, DWORD, LPCWSTR, int, LPSTR, int, LPCSTR, BOOL*)
+{
+	SetLastError(ERROR_CALL_NOT_IMPLEMENTED);
+	return 0;
+}
+
+int WINAPI MultiByteToWideChar(UINT, DWORD, LPCSTR, int, LPWSTR, int)
+{
+	SetLastError(ERROR_CALL_NOT_IMPLEMENTED);
+	return 0;
+}
+
+BOOL WINAPI ShellExecuteExW(SHELLEXECUTEINFOW*)
+{
+	SetLastError(ERROR_CALL_NOT_IMPLEMENTED);
+	return FALSE;
+}
+
+DWORD WINAPI GetMappedFileNameW(HANDLE, LPVOID, LPWSTR, DWORD)
+{
+	SetLastError(ERROR_CALL_NOT_IMPLEMENTED);
+	return 0;
+}
+
+BOOL WINAPI DetourUpdateProcessWithDll(HANDLE, LPCSTR*, DWORD)
+{
+	return FALSE;
+}
+
+BOOL WINAPI DetourProcessViaHelperW(DWORD, LPCSTR, PDETOUR_CREATE_PROCESS_ROUTINEW)
+{
+	return FALSE;
+}
+
+BOOL WINAPI DetourCopyPayloadToProcess(HANDLE, REFGUID, LPCVOID, DWORD)
+{
+	return FALSE;
+}
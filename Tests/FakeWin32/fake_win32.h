@@ -0,0 +1,54 @@
+#pragma once
+// the Windows declarations the way the hook sources include them
+#include "framework.h"
+#include "_win32.h"
+
+// Controls of the fake Windows layer. Kernel objects (events, threads, files, mappings) are heap
+// objects behind their HANDLE, so handle values are unique while open and get reused after a close,
+// like real ones. The NT file calls the hooks wrap never touch the disk: NtCreateFile hands out a
+// handle that remembers its name, NtQueryObject answers with that name, NtWriteFile succeeds with
+// every byte written and NtSetInformationFile renames on FileRenameInformation.
+namespace ProcessTracer::FakeWin32
+{
+	enum class NtCall
+	{
+		CreateFile,
+		WriteFile,
+		QueryObject,
+		SetInformationFile,
+		Close,
+		DuplicateObject,
+		Count
+	};
+
+	// FILE_RENAME_INFORMATION, which winternl.h does not declare
+	struct RenameInformation
+	{
+		BOOLEAN ReplaceIfExists;
+		HANDLE RootDirectory;
+		ULONG FileNameLength;
+		WCHAR FileName[1];
+	};
+
+	// Fails every following call with status, 0 restores success. A failed create returns no handle,
+	// a failed write writes nothing.
+	void SetStatus(NtCall call, NTSTATUS status);
+	// Time each scripted NT call spends in the "kernel". It is spun, not slept, so it counts as work.
+	void SetCallCost(uint64_t nanoseconds);
+	// Calls on a file whose name contains name_part spend nanoseconds instead, a stand-in for a slow
+	// disk or a file a scanner holds up. ResetCalls forgets them.
+	void SetFileCost(const std::u16string& name_part, uint64_t nanoseconds);
+	uint64_t CallCount(NtCall call);
+	void ResetCalls();
+	// While on, QueryPerformanceCounter stands still and call costs advance it instead of being spun,
+	// so a measured call takes exactly its cost however the threads are scheduled. One clock for every
+	// thread; it never runs back when switched off.
+	void UseVirtualClock(bool on);
+	// A handle opened before the hooks were attached, its name is only known to NtQueryObject.
+	HANDLE OpenUntraced(const char16_t* path);
+	// Name of an open handle, empty when it is not a file.
+	std::u16string HandleName(HANDLE handle);
+
+	// Waits for every thread CreateThread started, they have to be told to stop first.
+	void JoinThreads();
+}
@@ -0,0 +1,23 @@
+#pragma once
+// The two MSVC intrinsics trace_clock.h uses. Hosts without a TSC report none, which makes the
+// clock fall back to QueryPerformanceCounter.
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+
+inline void __cpuid(int info[4], int leaf)
+{
+	asm volatile("cpuid" : "=a"(info[0]), "=b"(info[1]), "=c"(info[2]), "=d"(info[3]) : "a"(leaf), "c"(0));
+}
+#else
+#include <cstdint>
+
+inline uint64_t __rdtsc()
+{
+	return 0;
+}
+
+inline void __cpuid(int info[4], int)
+{
+	info[0] = info[1] = info[2] = info[3] = 0;
+}
+#endif
@@ -0,0 +1,16 @@
+#pragma once
+#include <windows.h>
+
+typedef struct _SHELLEXECUTEINFOW
+{
+	DWORD cbSize;
+	ULONG fMask;
+	LPCWSTR lpVerb;
+	LPCWSTR lpFile;
+	LPCWSTR lpParameters;
+	LPCWSTR lpDirectory;
+	int nShow;
+	HANDLE hProcess;
+} SHELLEXECUTEINFOW, *LPSHELLEXECUTEINFOW;
+
+extern "C" BOOL WINAPI ShellExecuteExW(SHELLEXECUTEINFOW* info);
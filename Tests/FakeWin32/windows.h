@@ -0,0 +1,284 @@
+#pragma once
+// The part of the Windows SDK the hook sources use, implemented on POSIX by fake_win32.cpp so that
+// hook_func.cpp and the pipeline behind it run unchanged on any host, see fake_win32.h. Types keep
+// their Windows sizes; the harness is built with -fshort-wchar, so WCHAR is two bytes as well.
+// The C library's wide string functions and std::wstring still assume four byte characters, the
+// code paths that need them (process creation, ShellExecuteExW elevation) are not driven here.
+#include <pthread.h>
+
+#include <atomic>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cwchar>
+#include <string>
+#include <vector>
+
+#define WINAPI
+#define CALLBACK
+#define NTAPI
+#define APIENTRY
+#define __stdcall
+#define EXTERN_C extern "C"
+
+#define _In_
+#define _In_opt_
+#define _Out_
+#define _Out_opt_
+#define _Outptr_
+#define _Inout_
+#define _Inout_opt_
+#define _In_reads_bytes_(size)
+#define _In_reads_bytes_opt_(size)
+#define _Out_writes_bytes_(size)
+#define _Inout_updates_opt_(size)
+#define _Readable_bytes_(size)
+#define _Writable_bytes_(size)
+#define _Post_readable_byte_size_(size)
+#define _At_(target, annotations)
+#define _Return_type_success_(expression)
+#define OPTIONAL
+#define IN
+#define OUT
+#define CONST const
+#define VOID void
+
+#define TRUE 1
+#define FALSE 0
+#define MAX_PATH 260
+#define INFINITE 0xFFFFFFFF
+#define INVALID_HANDLE_VALUE (reinterpret_cast<HANDLE>(static_cast<intptr_t>(-1)))
+
+#define CP_ACP 0
+#define CP_UTF8 65001
+
+#define WAIT_OBJECT_0 0
+#define WAIT_TIMEOUT 258
+#define WAIT_FAILED 0xFFFFFFFF
+
+#define ERROR_SUCCESS 0
+#define ERROR_FILE_NOT_FOUND 2
+#define ERROR_INVALID_HANDLE 6
+#define ERROR_NOT_ENOUGH_MEMORY 8
+#define ERROR_INVALID_PARAMETER 87
+#define ERROR_CALL_NOT_IMPLEMENTED 120
+#define ERROR_ALREADY_EXISTS 183
+#define ERROR_PIPE_BUSY 231
+
+#define DELETE 0x00010000
+#define SYNCHRONIZE 0x00100000
+#define GENERIC_READ 0x80000000
+#define GENERIC_WRITE 0x40000000
+#define FILE_READ_DATA 0x0001
+#define FILE_WRITE_DATA 0x0002
+#define FILE_APPEND_DATA 0x0004
+#define FILE_WRITE_ATTRIBUTES 0x0100
+
+#define FILE_SHARE_READ 0x1
+#define FILE_SHARE_WRITE 0x2
+#define FILE_SHARE_DELETE 0x4
+#define CREATE_NEW 1
+#define CREATE_ALWAYS 2
+#define OPEN_EXISTING 3
+#define OPEN_ALWAYS 4
+#define TRUNCATE_EXISTING 5
+#define FILE_ATTRIBUTE_NORMAL 0x80
+#define FILE_BEGIN 0
+#define FILE_CURRENT 1
+#define FILE_END 2
+#define FILE_NAME_NORMALIZED 0x0
+
+#define PAGE_READONLY 0x02
+#define PAGE_READWRITE 0x04
+#define PAGE_WRITECOPY 0x08
+#define PAGE_EXECUTE_READWRITE 0x40
+#define PAGE_EXECUTE_WRITECOPY 0x80
+#define SEC_FILE 0x800000
+#define FILE_MAP_WRITE 0x0002
+#define FILE_MAP_READ 0x0004
+#define FILE_MAP_ALL_ACCESS 0xF001F
+
+#define DUPLICATE_CLOSE_SOURCE 0x1
+#define DUPLICATE_SAME_ACCESS 0x2
+#define CREATE_SUSPENDED 0x4
+
+#define DLL_PROCESS_DETACH 0
+#define DLL_PROCESS_ATTACH 1
+#define DLL_THREAD_ATTACH 2
+#define DLL_THREAD_DETACH 3
+
+typedef int BOOL;
+typedef unsigned char BOOLEAN;
+typedef unsigned char BYTE;
+typedef unsigned char UCHAR;
+typedef char CHAR;
+typedef wchar_t WCHAR;
+typedef short SHORT;
+typedef unsigned short USHORT;
+typedef unsigned short WORD;
+typedef int INT;
+typedef unsigned int UINT;
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef uint32_t DWORD;
+typedef int64_t LONGLONG;
+typedef uint64_t ULONGLONG;
+typedef uint64_t DWORD64;
+typedef intptr_t LONG_PTR;
+typedef uintptr_t ULONG_PTR;
+typedef uintptr_t DWORD_PTR;
+typedef size_t SIZE_T;
+typedef SIZE_T* PSIZE_T;
+typedef ULONG* PULONG;
+typedef DWORD* PDWORD;
+typedef DWORD* LPDWORD;
+typedef DWORD ACCESS_MASK;
+
+typedef void* PVOID;
+typedef void* LPVOID;
+typedef const void* LPCVOID;
+typedef void* HANDLE;
+typedef HANDLE* PHANDLE;
+typedef struct HINSTANCE__* HINSTANCE;
+typedef HINSTANCE HMODULE;
+
+typedef CHAR* LPSTR;
+typedef CHAR* PSTR;
+typedef const CHAR* LPCSTR;
+typedef WCHAR* LPWSTR;
+typedef WCHAR* PWSTR;
+typedef const WCHAR* LPCWSTR;
+typedef const WCHAR* PCWSTR;
+
+typedef union _LARGE_INTEGER
+{
+	struct
+	{
+		DWORD LowPart;
+		LONG HighPart;
+	};
+
+	LONGLONG QuadPart;
+} LARGE_INTEGER, *PLARGE_INTEGER;
+
+typedef struct _GUID
+{
+	uint32_t Data1;
+	uint16_t Data2;
+	uint16_t Data3;
+	uint8_t Data4[8];
+} GUID;
+
+typedef const GUID& REFGUID;
+
+typedef struct _SECURITY_ATTRIBUTES
+{
+	DWORD nLength;
+	LPVOID lpSecurityDescriptor;
+	BOOL bInheritHandle;
+} SECURITY_ATTRIBUTES, *LPSECURITY_ATTRIBUTES;
+
+typedef struct _STARTUPINFOW
+{
+	DWORD cb;
+} STARTUPINFOW, *LPSTARTUPINFOW;
+
+typedef struct _PROCESS_INFORMATION
+{
+	HANDLE hProcess;
+	HANDLE hThread;
+	DWORD dwProcessId;
+	DWORD dwThreadId;
+} PROCESS_INFORMATION, *LPPROCESS_INFORMATION;
+
+typedef struct _MEM_EXTENDED_PARAMETER
+{
+	DWORD64 Type;
+	DWORD64 ULong64;
+} MEM_EXTENDED_PARAMETER, *PMEM_EXTENDED_PARAMETER;
+
+typedef struct _SYSTEM_INFO
+{
+	DWORD dwPageSize;
+	DWORD dwAllocationGranularity;
+} SYSTEM_INFO, *LPSYSTEM_INFO;
+
+// SRW locks and one-time initialization need no initialization call on Windows, the pthread
+// primitives behind them have static initializers too
+typedef struct _RTL_SRWLOCK
+{
+	pthread_rwlock_t lock;
+} SRWLOCK, *PSRWLOCK;
+
+#define SRWLOCK_INIT {PTHREAD_RWLOCK_INITIALIZER}
+
+typedef struct _RTL_RUN_ONCE
+{
+	pthread_mutex_t lock;
+	std::atomic<bool> done;
+} INIT_ONCE, *PINIT_ONCE;
+
+#define INIT_ONCE_STATIC_INIT {PTHREAD_MUTEX_INITIALIZER, {false}}
+
+typedef BOOL (WINAPI *PINIT_ONCE_FN)(PINIT_ONCE init_once, PVOID parameter, PVOID* context);
+typedef DWORD (WINAPI *LPTHREAD_START_ROUTINE)(LPVOID parameter);
+
+extern "C" {
+DWORD WINAPI GetCurrentProcessId();
+DWORD WINAPI GetCurrentThreadId();
+HANDLE WINAPI GetCurrentProcess();
+DWORD WINAPI GetProcessId(HANDLE process);
+DWORD WINAPI GetLastError();
+VOID WINAPI SetLastError(DWORD error);
+BOOL WINAPI CloseHandle(HANDLE handle);
+VOID WINAPI Sleep(DWORD milliseconds);
+ULONGLONG WINAPI GetTickCount64();
+BOOL WINAPI QueryPerformanceCounter(LARGE_INTEGER* counter);
+BOOL WINAPI QueryPerformanceFrequency(LARGE_INTEGER* frequency);
+VOID WINAPI GetSystemInfo(LPSYSTEM_INFO info);
+
+VOID WINAPI AcquireSRWLockExclusive(PSRWLOCK lock);
+VOID WINAPI ReleaseSRWLockExclusive(PSRWLOCK lock);
+VOID WINAPI AcquireSRWLockShared(PSRWLOCK lock);
+VOID WINAPI ReleaseSRWLockShared(PSRWLOCK lock);
+BOOLEAN WINAPI TryAcquireSRWLockExclusive(PSRWLOCK lock);
+BOOL WINAPI InitOnceExecuteOnce(PINIT_ONCE init_once, PINIT_ONCE_FN function, PVOID parameter, LPVOID* context);
+
+HANDLE WINAPI CreateEventW(LPSECURITY_ATTRIBUTES attributes, BOOL manual_reset, BOOL initial_state, LPCWSTR name);
+BOOL WINAPI SetEvent(HANDLE event);
+BOOL WINAPI ResetEvent(HANDLE event);
+DWORD WINAPI WaitForSingleObject(HANDLE handle, DWORD milliseconds);
+HANDLE WINAPI CreateThread(LPSECURITY_ATTRIBUTES attributes, SIZE_T stack_size, LPTHREAD_START_ROUTINE start,
+                           LPVOID parameter, DWORD flags, LPDWORD thread_id);
+DWORD WINAPI ResumeThread(HANDLE thread);
+BOOL WINAPI TerminateProcess(HANDLE process, UINT exit_code);
+VOID WINAPI ExitProcess(UINT exit_code);
+DWORD WINAPI GetModuleFileNameW(HMODULE module, LPWSTR filename, DWORD size);
+DWORD WINAPI GetModuleFileNameA(HMODULE module, LPSTR filename, DWORD size);
+
+HANDLE WINAPI CreateFileW(LPCWSTR file_name, DWORD access, DWORD share_mode, LPSECURITY_ATTRIBUTES attributes,
+                          DWORD disposition, DWORD flags, HANDLE template_file);
+BOOL WINAPI ReadFile(HANDLE file, LPVOID buffer, DWORD length, LPDWORD read, LPVOID overlapped);
+BOOL WINAPI WriteFile(HANDLE file, LPCVOID buffer, DWORD length, LPDWORD written, LPVOID overlapped);
+BOOL WINAPI GetFileSizeEx(HANDLE file, PLARGE_INTEGER size);
+BOOL WINAPI SetFilePointerEx(HANDLE file, LARGE_INTEGER distance, PLARGE_INTEGER new_position, DWORD method);
+BOOL WINAPI SetEndOfFile(HANDLE file);
+BOOL WINAPI FlushFileBuffers(HANDLE file);
+DWORD WINAPI GetFinalPathNameByHandleW(HANDLE file, LPWSTR path, DWORD size, DWORD flags);
+HANDLE WINAPI CreateFileMappingW(HANDLE file, LPSECURITY_ATTRIBUTES attributes, DWORD protect, DWORD maximum_size_high,
+                                 DWORD maximum_size_low, LPCWSTR name);
+HANDLE WINAPI OpenFileMappingA(DWORD access, BOOL inherit, LPCSTR name);
+HANDLE WINAPI OpenFileMappingW(DWORD access, BOOL inherit, LPCWSTR name);
+LPVOID WINAPI MapViewOfFile(HANDLE mapping, DWORD access, DWORD offset_high, DWORD offset_low, SIZE_T size);
+BOOL WINAPI UnmapViewOfFile(LPCVOID address);
+BOOL WINAPI FlushViewOfFile(LPCVOID address, SIZE_T size);
+
+int WINAPI WideCharToMultiByte(UINT code_page, DWORD flags, LPCWSTR wide, int wide_length, LPSTR multi_byte,
+                               int multi_byte_length, LPCSTR default_char, BOOL* used_default_char);
+int WINAPI MultiByteToWideChar(UINT code_page, DWORD flags, LPCSTR multi_byte, int multi_byte_length, LPWSTR wide,
+                               int wide_length);
+}
+
+#define GetFinalPathNameByHandle GetFinalPathNameByHandleW
@@ -0,0 +1,77 @@
+#include "allocation_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	std::atomic<uint64_t> g_allocations{0};
+
+	void* Allocate(size_t size)
+	{
+		g_allocations.fetch_add(1, std::memory_order_relaxed);
+		if (void* memory = malloc(size ? size : 1))
+			return memory;
+		throw std::bad_alloc();
+	}
+}
+
+uint64_t ProcessTracer::HookHarness::Allocations()
+{
+	return g_allocations.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t size)
+{
+	return Allocate(size);
+}
+
+void* operator new[](size_t size)
+{
+	return Allocate(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return Allocate(size);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return nullptr;
+	}
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return Allocate(size);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return nullptr;
+	}
+}
+
+void operator delete(void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	free(memory);
+}
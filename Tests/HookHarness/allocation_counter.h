@@ -0,0 +1,9 @@
+#pragma once
+#include <cstdint>
+
+namespace ProcessTracer::HookHarness
+{
+	// Heap allocations of the whole process so far. Linking this in replaces the global operator
+	// new, every form of it is counted.
+	uint64_t Allocations();
+}
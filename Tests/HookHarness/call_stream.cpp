@@ -0,0 +1,315 @@
+#include "call_stream.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "hook_host.h"
+#include "hook_func.h"
+
+namespace
+{
+	using ProcessTracer::HookHarness::Call;
+	using ProcessTracer::HookHarness::CallStream;
+	using ProcessTracer::HookHarness::CallType;
+	using ProcessTracer::HookHarness::ReplayMode;
+
+	constexpr auto file_rename_information = static_cast<FILE_INFORMATION_CLASS>(10);
+	constexpr size_t max_rename_length = 1024;
+	// the fake layer never reads what is written
+	const char g_write_data[64 * 1024] = {};
+
+	std::u16string Widen(const std::string& text)
+	{
+		return {text.begin(), text.end()};
+	}
+
+	std::u16string Number(size_t value)
+	{
+		return Widen(std::to_string(value));
+	}
+
+	void AddCall(CallStream& stream, size_t thread, const Call& call)
+	{
+		if (stream.threads.size() <= thread)
+			stream.threads.resize(thread + 1);
+		stream.threads[thread].push_back(call);
+	}
+
+	uint32_t AddPath(CallStream& stream, std::u16string path)
+	{
+		stream.paths.push_back(std::move(path));
+		return static_cast<uint32_t>(stream.paths.size() - 1);
+	}
+
+	struct Gate
+	{
+		std::mutex lock;
+		std::condition_variable changed;
+		size_t waiting = 0;
+		bool open = false;
+
+		void Wait()
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			++waiting;
+			changed.notify_all();
+			changed.wait(guard, [this] { return open; });
+		}
+	};
+
+	class ThreadReplay
+	{
+		const CallStream& m_stream;
+		ReplayMode m_mode;
+		std::vector<HANDLE> m_slots;
+		IO_STATUS_BLOCK m_io = {};
+
+		void Create(const Call& call)
+		{
+			const std::u16string& path = m_stream.paths[call.path];
+			UNICODE_STRING name;
+			name.Length = static_cast<USHORT>(path.size() * sizeof(WCHAR));
+			name.MaximumLength = name.Length;
+			name.Buffer = reinterpret_cast<PWSTR>(const_cast<char16_t*>(path.data()));
+			OBJECT_ATTRIBUTES attributes;
+			InitializeObjectAttributes(&attributes, &name, OBJ_CASE_INSENSITIVE, nullptr, nullptr);
+			HANDLE handle = nullptr;
+			constexpr ULONG options = FILE_SYNCHRONOUS_IO_NONALERT | FILE_NON_DIRECTORY_FILE;
+			if (m_mode == ReplayMode::Hooked)
+				HookNtCreateFile(&handle, call.access, &attributes, &m_io, nullptr, FILE_ATTRIBUTE_NORMAL,
+				                 FILE_SHARE_READ, call.disposition, options, nullptr, 0);
+			else
+				NtCreateFile(&handle, call.access, &attributes, &m_io, nullptr, FILE_ATTRIBUTE_NORMAL, FILE_SHARE_READ,
+				             call.disposition, options, nullptr, 0);
+			m_slots[call.slot] = handle;
+		}
+
+		void Write(const Call& call)
+		{
+			LARGE_INTEGER offset;
+			offset.QuadPart = call.offset;
+			const PLARGE_INTEGER byte_offset = call.offset >= 0 ? &offset : nullptr;
+			const auto buffer = const_cast<char*>(g_write_data);
+			if (m_mode == ReplayMode::Hooked)
+				HookNtWriteFile(m_slots[call.slot], nullptr, nullptr, nullptr, &m_io, buffer, call.length, byte_offset,
+				                nullptr);
+			else
+				NtWriteFile(m_slots[call.slot], nullptr, nullptr, nullptr, &m_io, buffer, call.length, byte_offset,
+				            nullptr);
+		}
+
+		void Rename(const Call& call)
+		{
+			using ProcessTracer::FakeWin32::RenameInformation;
+			const std::u16string& path = m_stream.paths[call.path];
+			alignas(RenameInformation) char buffer[sizeof(RenameInformation) + max_rename_length * sizeof(WCHAR)];
+			const auto information = reinterpret_cast<RenameInformation*>(buffer);
+			const size_t length = path.size() < max_rename_length ? path.size() : max_rename_length;
+			information->ReplaceIfExists = TRUE;
+			information->RootDirectory = nullptr;
+			information->FileNameLength = static_cast<ULONG>(length * sizeof(WCHAR));
+			memcpy(information->FileName, path.data(), length * sizeof(WCHAR));
+			const auto size = static_cast<ULONG>(sizeof(RenameInformation) + length * sizeof(WCHAR));
+			if (m_mode == ReplayMode::Hooked)
+				HookNtSetInformationFile(m_slots[call.slot], &m_io, information, size, file_rename_information);
+			else
+				NtSetInformationFile(m_slots[call.slot], &m_io, information, size, file_rename_information);
+		}
+
+		void Close(const Call& call)
+		{
+			if (m_mode == ReplayMode::Hooked)
+				HookNtClose(m_slots[call.slot]);
+			else
+				NtClose(m_slots[call.slot]);
+			m_slots[call.slot] = nullptr;
+		}
+
+	public:
+		ThreadReplay(const CallStream& stream, const std::vector<Call>& calls, ReplayMode mode)
+			: m_stream(stream), m_mode(mode)
+		{
+			size_t slots = 0;
+			for (const auto& call : calls)
+				slots = call.slot + size_t{1} > slots ? call.slot + size_t{1} : slots;
+			m_slots.resize(slots);
+		}
+
+		void Run(const std::vector<Call>& calls)
+		{
+			for (const auto& call : calls)
+			{
+				switch (call.type)
+				{
+				case CallType::Create:
+					Create(call);
+					break;
+				case CallType::Write:
+					Write(call);
+					break;
+				case CallType::Rename:
+					Rename(call);
+					break;
+				case CallType::Close:
+					Close(call);
+					break;
+				}
+			}
+		}
+	};
+}
+
+size_t ProcessTracer::HookHarness::CallStream::Calls() const
+{
+	size_t calls = 0;
+	for (const auto& thread : threads)
+		calls += thread.size();
+	return calls;
+}
+
+size_t ProcessTracer::HookHarness::CallStream::Calls(CallType type) const
+{
+	size_t calls = 0;
+	for (const auto& thread : threads)
+		for (const auto& call : thread)
+			calls += call.type == type;
+	return calls;
+}
+
+bool ProcessTracer::HookHarness::ParseCallStream(std::istream& input, CallStream& stream, std::string& error)
+{
+	std::string line;
+	for (size_t line_number = 1; std::getline(input, line); ++line_number)
+	{
+		const size_t comment = line.find('#');
+		if (comment != std::string::npos)
+			line.erase(comment);
+		std::istringstream fields(line);
+		size_t thread;
+		std::string type;
+		if (!(fields >> thread))
+		{
+			if (line.find_first_not_of(" \t\r") == std::string::npos)
+				continue;
+			error = "line " + std::to_string(line_number) + ": expected a thread number";
+			return false;
+		}
+		Call call = {};
+		call.offset = -1;
+		bool parsed = static_cast<bool>(fields >> type >> call.slot);
+		std::string path;
+		if (parsed && type == "create")
+		{
+			call.type = CallType::Create;
+			parsed = static_cast<bool>(fields >> std::hex >> call.access >> std::dec >> call.disposition >> std::ws);
+			std::getline(fields, path);
+		}
+		else if (parsed && type == "write")
+		{
+			call.type = CallType::Write;
+			parsed = static_cast<bool>(fields >> call.length);
+			if (parsed && !(fields >> call.offset))
+				call.offset = -1;
+		}
+		else if (parsed && type == "rename")
+		{
+			call.type = CallType::Rename;
+			std::getline(fields >> std::ws, path);
+		}
+		else if (parsed && type == "close")
+		{
+			call.type = CallType::Close;
+		}
+		else
+		{
+			parsed = false;
+		}
+		while (!path.empty() && (path.back() == ' ' || path.back() == '\t' || path.back() == '\r'))
+			path.pop_back();
+		if (parsed && (call.type == CallType::Create || call.type == CallType::Rename))
+		{
+			parsed = !path.empty();
+			call.path = AddPath(stream, Widen(path));
+		}
+		if (!parsed)
+		{
+			error = "line " + std::to_string(line_number) + ": malformed " + (type.empty() ? "call" : type);
+			return false;
+		}
+		AddCall(stream, thread, call);
+	}
+	return true;
+}
+
+ProcessTracer::HookHarness::CallStream ProcessTracer::HookHarness::GenerateCallStream(
+	const WorkloadOptions& options)
+{
+	CallStream stream;
+	for (size_t thread = 0; thread < options.threads; ++thread)
+	{
+		const std::u16string directory = u"\\??\\C:\\build\\obj\\t" + Number(thread) + u"\\";
+		for (size_t file = 0; file < options.files_per_thread; ++file)
+		{
+			const std::u16string name = directory + u"unit" + Number(file) + u".obj";
+			// like a compiler, a renamed output is written to a temporary name first
+			const bool renamed = options.rename_every && file % options.rename_every == 0;
+			Call create = {};
+			create.type = CallType::Create;
+			create.path = AddPath(stream, renamed ? name + u".tmp" : name);
+			create.access = GENERIC_WRITE | SYNCHRONIZE;
+			create.disposition = FILE_OVERWRITE_IF;
+			AddCall(stream, thread, create);
+			for (size_t write = 0; write < options.writes_per_file; ++write)
+			{
+				Call call = {};
+				call.type = CallType::Write;
+				call.length = options.write_bytes;
+				call.offset = static_cast<int64_t>(write * options.write_bytes);
+				AddCall(stream, thread, call);
+			}
+			if (renamed)
+			{
+				Call rename = {};
+				rename.type = CallType::Rename;
+				rename.path = AddPath(stream, name);
+				AddCall(stream, thread, rename);
+			}
+			Call close = {};
+			close.type = CallType::Close;
+			AddCall(stream, thread, close);
+		}
+	}
+	return stream;
+}
+
+double ProcessTracer::HookHarness::Replay(const CallStream& stream, ReplayMode mode, size_t repeat)
+{
+	Gate gate;
+	std::vector<std::thread> threads;
+	threads.reserve(stream.threads.size());
+	for (const auto& calls : stream.threads)
+	{
+		threads.emplace_back([&stream, &calls, &gate, mode, repeat]
+		{
+			ThreadReplay replay(stream, calls, mode);
+			gate.Wait();
+			for (size_t round = 0; round < repeat; ++round)
+				replay.Run(calls);
+			if (mode == ReplayMode::Hooked)
+				DetachThread();
+		});
+	}
+	{
+		std::unique_lock<std::mutex> guard(gate.lock);
+		gate.changed.wait(guard, [&] { return gate.waiting == threads.size(); });
+		gate.open = true;
+	}
+	const auto start = std::chrono::steady_clock::now();
+	gate.changed.notify_all();
+	for (auto& thread : threads)
+		thread.join();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+// File calls of many threads, replayed through the hooks or straight into the fake NT layer.
+//
+// A recorded stream is text, one call per line, '#' starts a comment:
+//   <thread> create <slot> <access mask> <disposition> <path>
+//   <thread> write <slot> <length> [offset]
+//   <thread> rename <slot> <path>
+//   <thread> close <slot>
+// Threads and slots are small numbers, a slot is one of the thread's handle variables. Paths are
+// ASCII NT paths and run to the end of the line. Every thread runs its calls in order, the threads
+// run concurrently.
+namespace ProcessTracer::HookHarness
+{
+	enum class CallType : uint8_t
+	{
+		Create,
+		Write,
+		Rename,
+		Close
+	};
+
+	struct Call
+	{
+		CallType type;
+		uint16_t slot;
+		uint32_t path; // index into CallStream::paths
+		uint32_t length;
+		int64_t offset; // -1 writes at the file pointer
+		uint32_t access;
+		uint32_t disposition;
+	};
+
+	struct CallStream
+	{
+		std::vector<std::vector<Call>> threads;
+		std::vector<std::u16string> paths;
+
+		size_t Calls() const;
+		size_t Calls(CallType type) const;
+	};
+
+	// false with the line number in error when a line does not parse
+	bool ParseCallStream(std::istream& input, CallStream& stream, std::string& error);
+
+	// The shape of a build: every thread creates its files, writes each one sequentially, renames
+	// every rename_every-th file and closes it. 0 never renames.
+	struct WorkloadOptions
+	{
+		size_t threads = 4;
+		size_t files_per_thread = 16;
+		size_t writes_per_file = 8;
+		uint32_t write_bytes = 4096;
+		size_t rename_every = 4;
+	};
+
+	CallStream GenerateCallStream(const WorkloadOptions& options);
+
+	enum class ReplayMode
+	{
+		Hooked, // through HookNtCreateFile and friends, a Session has to be open
+		Direct // the same calls without the hooks, the baseline
+	};
+
+	// Runs every thread of the stream on a thread of its own, repeat times in a row. The threads are
+	// all started before the first call, so only the calls are timed. Returns the seconds taken.
+	double Replay(const CallStream& stream, ReplayMode mode, size_t repeat = 1);
+}
@@ -0,0 +1,155 @@
+#include "hook_host.h"
+
+#include <chrono>
+#include <unistd.h>
+
+#include "hook_func.h"
+#include "hook_info.h"
+#include "hook_timing.h"
+#include "logger.h"
+#include "origin.h"
+#include "unix_socket_transport.h"
+
+namespace
+{
+	std::atomic<int64_t> g_exit_code{-1};
+
+	VOID WINAPI RecordExitCode(UINT exit_code)
+	{
+		g_exit_code.store(exit_code, std::memory_order_relaxed);
+	}
+}
+
+bool ProcessTracer::HookHarness::CaptureTransport::Write(const char* data, size_t length)
+{
+	if (m_write_ns != 0)
+	{
+		const auto end = std::chrono::steady_clock::now() + std::chrono::nanoseconds(m_write_ns);
+		while (std::chrono::steady_clock::now() < end)
+		{
+		}
+	}
+	std::lock_guard<std::mutex> guard(m_lock);
+	m_bytes += length;
+	while (length > 0)
+	{
+		EventRecord::RecordReader reader;
+		if (!reader.Open(data, length))
+		{
+			m_malformed += length;
+			break;
+		}
+		const auto& header = reader.Header();
+		const auto type = static_cast<size_t>(header.type);
+		const auto hook = static_cast<size_t>(header.hook_id);
+		if (type < type_count && hook < hook_count)
+			++m_records[type][hook];
+		else
+			m_malformed += header.size;
+		if (m_observer)
+			m_observer(header);
+		if (m_keep)
+			m_kept.emplace_back(data, header.size);
+		data += header.size;
+		length -= header.size;
+	}
+	return true;
+}
+
+uint64_t ProcessTracer::HookHarness::CaptureTransport::Records(EventRecord::RecordType type,
+                                                               EventRecord::HookId hook_id) const
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	return m_records[static_cast<size_t>(type)][static_cast<size_t>(hook_id)];
+}
+
+uint64_t ProcessTracer::HookHarness::CaptureTransport::Records() const
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	uint64_t records = 0;
+	for (const auto& hooks : m_records)
+		for (const uint64_t count : hooks)
+			records += count;
+	return records;
+}
+
+uint64_t ProcessTracer::HookHarness::CaptureTransport::Bytes() const
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	return m_bytes;
+}
+
+uint64_t ProcessTracer::HookHarness::CaptureTransport::Malformed() const
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	return m_malformed;
+}
+
+std::vector<std::string> ProcessTracer::HookHarness::CaptureTransport::TakeRecords()
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	return std::move(m_kept);
+}
+
+ProcessTracer::HookHarness::Session::Session(const SessionOptions& options)
+{
+	const auto hook_info = GetHookInfoInstance();
+	hook_info->process_tracer_pid = 1;
+	hook_info->aggregate_writes = options.aggregate_writes;
+	hook_info->hook_mask = ~uint64_t{0};
+	RealExitProcess = RecordExitCode;
+	RealCreateFileMappingW = CreateFileMappingW;
+	g_exit_code.store(-1, std::memory_order_relaxed);
+
+	std::unique_ptr<Transport> bulk;
+	std::unique_ptr<Transport> lifecycle;
+	if (options.collector_path.empty())
+	{
+		auto bulk_capture = std::make_unique<CaptureTransport>(options.keep_records, options.transport_write_ns,
+		                                                       options.on_bulk_record);
+		auto lifecycle_capture = std::make_unique<CaptureTransport>(options.keep_records);
+		m_bulk = bulk_capture.get();
+		m_lifecycle = lifecycle_capture.get();
+		bulk = std::move(bulk_capture);
+		lifecycle = std::move(lifecycle_capture);
+	}
+	else
+	{
+		m_bulk = m_lifecycle = nullptr;
+		bulk = std::make_unique<UnixSocketTransport>(options.collector_path);
+		lifecycle = std::make_unique<UnixSocketTransport>(options.collector_path);
+	}
+	GetEventPipeline()->Open(std::move(bulk), std::move(lifecycle), options.batch, options.budget,
+	                         [](EventRecord::LossStage stage, EventRecord::HookId hook_id, uint64_t lost)
+	                         {
+		                         Logger::g_logger.Loss(stage, hook_id, lost);
+	                         });
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	Logger::g_logger = Logger(hook_info->process_tracer_pid, static_cast<int>(getpid()),
+	                          {TraceClock::Source::Qpc, static_cast<uint64_t>(counter.QuadPart), 1000000000});
+}
+
+ProcessTracer::HookHarness::Session::~Session()
+{
+	GetEventPipeline()->Close();
+	FakeWin32::JoinThreads();
+	Logger::g_logger = Logger(0, 0);
+}
+
+void ProcessTracer::HookHarness::Session::Flush()
+{
+	GetEventPipeline()->Flush();
+	GetEventPipeline()->ReportLosses();
+}
+
+int64_t ProcessTracer::HookHarness::Session::ExitCode()
+{
+	return g_exit_code.load(std::memory_order_relaxed);
+}
+
+void ProcessTracer::HookHarness::DetachThread()
+{
+	GetHookTiming()->DetachThread();
+	GetEventPipeline()->DetachThread();
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "fake_win32.h"
+#include "event_pipeline.h"
+#include "event_record.h"
+
+// Runs the hooks of hook_func.cpp in this process against the fake Windows layer, with the
+// pipeline shipping into memory instead of to a collector.
+namespace ProcessTracer::HookHarness
+{
+	// The collector end of a lane: counts every record it is handed by type and hook, and keeps the
+	// records themselves when asked to.
+	// Called by a CaptureTransport for every record it receives, on the thread that shipped it.
+	using RecordObserver = void (*)(const EventRecord::RecordHeader& header);
+
+	class CaptureTransport final : public Transport
+	{
+		static constexpr size_t type_count = static_cast<size_t>(EventRecord::RecordType::Loss) + 1;
+		static constexpr size_t hook_count = static_cast<size_t>(EventRecord::HookId::Count);
+
+		mutable std::mutex m_lock;
+		uint64_t m_records[type_count][hook_count] = {};
+		uint64_t m_bytes = 0;
+		uint64_t m_malformed = 0;
+		bool m_keep;
+		std::vector<std::string> m_kept;
+		uint64_t m_write_ns;
+		RecordObserver m_observer;
+
+	public:
+		explicit CaptureTransport(bool keep_records, uint64_t write_ns = 0, RecordObserver observer = nullptr)
+			: m_keep(keep_records), m_write_ns(write_ns), m_observer(observer)
+		{
+		}
+
+		bool Write(const char* data, size_t length) override;
+
+		void Close() override
+		{
+		}
+
+		uint64_t Records(EventRecord::RecordType type, EventRecord::HookId hook_id) const;
+		uint64_t Records() const;
+		uint64_t Bytes() const;
+		// bytes that did not parse as a whole record
+		uint64_t Malformed() const;
+		// the records received so far, in order, when the transport keeps them
+		std::vector<std::string> TakeRecords();
+	};
+
+	struct SessionOptions
+	{
+		BatchPolicy batch;
+		BufferBudget budget;
+		bool aggregate_writes = false;
+		bool keep_records = false;
+		// time every bulk write spends, spun like the system call of a real transport
+		uint64_t transport_write_ns = 0;
+		RecordObserver on_bulk_record = nullptr;
+		// when set, both lanes are UnixSocketTransports to the collector listening there and Bulk() and
+		// Lifecycle() must not be called
+		std::string collector_path;
+	};
+
+	// Sets up what DllMain sets up for the hooks: the logger and its clock, the hook info and an open
+	// pipeline whose two lanes end in CaptureTransports or at a collector. RealExitProcess only records its exit code.
+	// The pipeline starts its sender thread once per process, later sessions ship on Flush only.
+	class Session
+	{
+		CaptureTransport* m_bulk;
+		CaptureTransport* m_lifecycle;
+
+	public:
+		explicit Session(const SessionOptions& options = {});
+		~Session();
+
+		Session(const Session&) = delete;
+		Session& operator=(const Session&) = delete;
+
+		CaptureTransport& Bulk()
+		{
+			return *m_bulk;
+		}
+
+		CaptureTransport& Lifecycle()
+		{
+			return *m_lifecycle;
+		}
+
+		// ships everything queued so far, then the losses
+		void Flush();
+		// the exit code HookExitProcess passed on, -1 while it was not called
+		static int64_t ExitCode();
+	};
+
+	// what DLL_THREAD_DETACH does for a thread that called hooks
+	void DetachThread();
+}
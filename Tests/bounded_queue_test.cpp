@@ -0,0 +1,108 @@
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.h"
+#include "test_check.h"
+
+namespace
+{
+	void TestCapacity()
+	{
+		CHECK_EQUAL(ProcessTracer::BoundedQueue<int>(0).Capacity(), size_t{2});
+		CHECK_EQUAL(ProcessTracer::BoundedQueue<int>(5).Capacity(), size_t{8});
+		CHECK_EQUAL(ProcessTracer::BoundedQueue<int>(64).Capacity(), size_t{64});
+	}
+
+	// Full and empty are reported lap after lap, values come out in order and are moved, not copied.
+	void TestFullAndEmpty()
+	{
+		ProcessTracer::BoundedQueue<std::string> queue(4);
+		std::string value;
+		CHECK(!queue.TryPop(value));
+		for (int lap = 0; lap < 5; ++lap)
+		{
+			for (int i = 0; i < 4; ++i)
+			{
+				std::string pushed = std::string(100, static_cast<char>('a' + i)) + std::to_string(lap);
+				CHECK(queue.TryPush(pushed));
+				CHECK(pushed.empty());
+			}
+			std::string rejected = "rejected";
+			CHECK(!queue.TryPush(rejected));
+			CHECK_EQUAL(rejected, "rejected");
+			for (int i = 0; i < 4; ++i)
+			{
+				CHECK(queue.TryPop(value));
+				CHECK_EQUAL(value, std::string(100, static_cast<char>('a' + i)) + std::to_string(lap));
+			}
+			CHECK(!queue.TryPop(value));
+		}
+	}
+
+	// Producers and consumers at once through a queue that is mostly full or empty: every value comes
+	// out exactly once, and the values of one producer come out in the order it pushed them.
+	void TestManyProducersAndConsumers()
+	{
+		constexpr uint64_t producers = 4;
+		constexpr uint64_t consumers = 3;
+		constexpr uint64_t per_producer = 200000;
+		ProcessTracer::BoundedQueue<uint64_t> queue(16);
+		std::atomic<uint64_t> popped{0};
+		std::atomic<uint64_t> sum{0};
+		std::atomic<bool> ordered{true};
+		std::vector<std::thread> threads;
+		for (uint64_t producer = 0; producer < producers; ++producer)
+		{
+			threads.emplace_back([&queue, producer]
+			{
+				for (uint64_t i = 0; i < per_producer; ++i)
+				{
+					uint64_t value = producer << 32 | i;
+					while (!queue.TryPush(value))
+						std::this_thread::yield();
+				}
+			});
+		}
+		for (uint64_t consumer = 0; consumer < consumers; ++consumer)
+		{
+			threads.emplace_back([&]
+			{
+				// what this consumer saw last of each producer
+				uint64_t last[producers];
+				for (auto& value : last)
+					value = UINT64_MAX;
+				uint64_t value;
+				while (popped.load(std::memory_order_relaxed) < producers * per_producer)
+				{
+					if (!queue.TryPop(value))
+					{
+						std::this_thread::yield();
+						continue;
+					}
+					const uint64_t producer = value >> 32;
+					const uint64_t index = value & 0xFFFFFFFF;
+					if (last[producer] != UINT64_MAX && index <= last[producer])
+						ordered.store(false);
+					last[producer] = index;
+					sum.fetch_add(index, std::memory_order_relaxed);
+					popped.fetch_add(1, std::memory_order_relaxed);
+				}
+			});
+		}
+		for (auto& thread : threads)
+			thread.join();
+		CHECK_EQUAL(popped.load(), producers * per_producer);
+		CHECK_EQUAL(sum.load(), producers * (per_producer * (per_producer - 1) / 2));
+		CHECK(ordered.load());
+	}
+}
+
+int main()
+{
+	TestCapacity();
+	TestFullAndEmpty();
+	TestManyProducersAndConsumers();
+	return ProcessTracer::Test::Result("bounded_queue_test");
+}
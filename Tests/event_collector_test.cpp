@@ -0,0 +1,95 @@
+#include <string>
+#include <vector>
+
+#include "event_collector.h"
+#include "test_check.h"
+
+using namespace ProcessTracer::EventRecord;
+
+namespace
+{
+	constexpr uint32_t sender_pid = 4242;
+
+	// a record as the logger sends it, numbered when sequence is given
+	template <typename Add>
+	std::string Record(HookId hook_id, const uint32_t* sequence, Add&& add)
+	{
+		char buffer[512];
+		RecordWriter writer(buffer, sizeof(buffer));
+		writer.Begin(RecordType::HookInfo, hook_id, sender_pid, 7, 0, 0);
+		add(writer);
+		if (sequence)
+			writer.AddU32(FieldId::Sequence, *sequence);
+		return std::string(buffer, writer.Finish());
+	}
+
+	std::string BulkRecord(uint32_t sequence)
+	{
+		return Record(HookId::NtWriteFile, &sequence, [](RecordWriter& writer)
+		{
+			writer.AddUtf16(FieldId::Path, u"C:\\a.obj", 8);
+		});
+	}
+
+	// The lines of numbered records are marked, the gap between them and the lifecycle records are
+	// not, and the exit line carries the count of bulk records the process shipped.
+	void TestBulkLines()
+	{
+		std::string stream = BulkRecord(0);
+		stream += Record(HookId::CreateProcessInternalW, nullptr, [](RecordWriter& writer)
+		{
+			writer.AddU32(FieldId::ProcessId, 5151);
+		});
+		stream += BulkRecord(1);
+		stream += BulkRecord(4);
+		stream += Record(HookId::ExitProcess, nullptr, [](RecordWriter& writer)
+		{
+			writer.AddU32(FieldId::ExitCode, 0);
+			writer.AddU32(FieldId::BulkCount, 3);
+		});
+
+		SequenceTracker sequences;
+		EventCollector collector(&sequences);
+		CHECK_EQUAL(collector.Collect(stream.data(), stream.size(), true), stream.size());
+		const std::vector<LineInfo>& infos = collector.Infos();
+		CHECK_EQUAL(infos.size(), size_t{6});
+		if (infos.size() != 6)
+			return;
+		const LineKind kinds[] = {
+			LineKind::Other, LineKind::ProcessCreated, LineKind::Other, LineKind::Loss, LineKind::Other,
+			LineKind::ProcessExited
+		};
+		const uint16_t flags[] = {line_flag_bulk, 0, line_flag_bulk, 0, line_flag_bulk, 0};
+		for (size_t line = 0; line < infos.size(); ++line)
+		{
+			CHECK(infos[line].kind == kinds[line]);
+			CHECK_EQUAL(infos[line].flags, flags[line]);
+			CHECK_EQUAL(infos[line].sender_pid, sender_pid);
+		}
+		CHECK_EQUAL(infos[4].sequence, 4u);
+		CHECK_EQUAL(infos[5].sequence, 3u);
+	}
+
+	// An exit from a process that does not count its bulk records waits for none.
+	void TestExitWithoutCount()
+	{
+		const std::string exit = Record(HookId::ExitProcess, nullptr, [](RecordWriter& writer)
+		{
+			writer.AddU32(FieldId::ExitCode, 1);
+		});
+		EventCollector collector;
+		collector.Collect(exit.data(), exit.size(), true);
+		CHECK_EQUAL(collector.Infos().size(), size_t{1});
+		if (collector.Infos().empty())
+			return;
+		CHECK(collector.Infos()[0].kind == LineKind::ProcessExited);
+		CHECK_EQUAL(collector.Infos()[0].sequence, 0u);
+	}
+}
+
+int main()
+{
+	TestBulkLines();
+	TestExitWithoutCount();
+	return ProcessTracer::Test::Result("event_collector_test");
+}
@@ -0,0 +1,237 @@
+#include <cstddef>
+#include <string>
+
+#include "event_formatter.h"
+#include "test_check.h"
+
+using namespace ProcessTracer::EventRecord;
+
+namespace
+{
+	constexpr uint32_t pid = 1234;
+
+	// a record of one hook call, fields are added by the caller
+	class TestRecord
+	{
+		char m_buffer[4096];
+		RecordWriter m_writer{m_buffer, sizeof(m_buffer)};
+
+	public:
+		explicit TestRecord(HookId hook_id, RecordType type = RecordType::HookInfo, int32_t status = 0)
+		{
+			m_writer.Begin(type, hook_id, pid, 5678, 1000, status);
+		}
+
+		RecordWriter* operator->()
+		{
+			return &m_writer;
+		}
+
+		std::string Format()
+		{
+			const size_t size = m_writer.Finish();
+			std::string line;
+			CHECK(FormatRecord(m_writer.Data(), size, line));
+			return line;
+		}
+	};
+
+	void AddPath(RecordWriter* writer, const std::u16string& path)
+	{
+		writer->AddUtf16(FieldId::Path, path.data(), path.size());
+	}
+
+	void TestNtCreateFile()
+	{
+		TestRecord record(HookId::NtCreateFile);
+		record->AddU32(FieldId::AccessMask, 0x80100080);
+		record->AddU32(FieldId::Disposition, 1);
+		AddPath(record.operator->(), u"C:\\out\\main.obj");
+		CHECK_EQUAL(record.Format(),
+		            "pid:1234 [Hook] NtCreateFile [DesiredAccess] 10000000000100000000000010000000, "
+		            "[FileName] C:\\out\\main.obj");
+	}
+
+	void TestLifecycle()
+	{
+		TestRecord created(HookId::CreateProcessInternalW);
+		created->AddU32(FieldId::ProcessId, 42);
+		CHECK_EQUAL(created.Format(), "pid:1234 [Hook] CreateProcessInternalW Process created successfully with PID: 42");
+
+		TestRecord creating(HookId::CreateProcessInternalW);
+		const std::u16string application = u"C:\\cl.exe";
+		const std::u16string command_line = u"cl /c main.cpp";
+		creating->AddUtf16(FieldId::ApplicationName, application.data(), application.size());
+		creating->AddUtf16(FieldId::CommandLine, command_line.data(), command_line.size());
+		CHECK_EQUAL(creating.Format(),
+		            "pid:1234 [Hook] CreateProcessInternalW [ApplicationName] C:\\cl.exe, [CommandLine] cl /c main.cpp");
+
+		TestRecord exited(HookId::ExitProcess);
+		exited->AddU32(FieldId::ExitCode, 0);
+		CHECK_EQUAL(exited.Format(), "pid:1234 [Hook] ExitProcess 1234 Exited");
+
+		TestRecord shell(HookId::ShellExecuteExW);
+		const std::u16string verb = u"runas";
+		shell->AddUtf16(FieldId::Verb, verb.data(), verb.size());
+		CHECK_EQUAL(shell.Format(), "pid:1234 [Hook] ShellExecuteExW verb:runas");
+	}
+
+	void TestMessages()
+	{
+		TestRecord info(HookId::None, RecordType::Info);
+		info->AddUtf8(FieldId::Message, "Attaching functions...");
+		CHECK_EQUAL(info.Format(), "pid:1234 [Info] Attaching functions...");
+
+		TestRecord error(HookId::None, RecordType::Error);
+		error->AddUtf8(FieldId::Message, "failed");
+		CHECK_EQUAL(error.Format(), "pid:1234 [Error] failed");
+
+		TestRecord hook_error(HookId::NtWriteFile, RecordType::HookError);
+		hook_error->AddUtf8(FieldId::Message, "boom");
+		CHECK_EQUAL(hook_error.Format(), "pid:1234 [Hook Error] NtWriteFile boom");
+
+		TestRecord called(HookId::ZwWriteFile);
+		CHECK_EQUAL(called.Format(), "pid:1234 [Hook] ZwWriteFile called");
+	}
+
+	void TestWriteSummary()
+	{
+		TestRecord summary(HookId::NtWriteFile);
+		summary->AddU64(FieldId::WriteCount, 3);
+		summary->AddU64(FieldId::TotalBytes, 12288);
+		summary->AddU64(FieldId::FirstOffset, 0);
+		summary->AddU64(FieldId::LastOffset, 8192);
+		summary->AddU64(FieldId::FirstTimestamp, 10);
+		summary->AddU64(FieldId::LastTimestamp, 20);
+		AddPath(summary.operator->(), u"C:\\out\\a.lib");
+		CHECK_EQUAL(summary.Format(),
+		            "pid:1234 [Hook] NtWriteFile C:\\out\\a.lib [Writes] 3, [Bytes] 12288, [Offsets] 0-8192, "
+		            "[Time] 10-20");
+
+		// appended through the file pointer, no offsets
+		TestRecord appended(HookId::NtWriteFile);
+		appended->AddU64(FieldId::WriteCount, 1);
+		appended->AddU64(FieldId::TotalBytes, 5);
+		appended->AddU64(FieldId::FirstTimestamp, 7);
+		appended->AddU64(FieldId::LastTimestamp, 7);
+		AddPath(appended.operator->(), u"log");
+		CHECK_EQUAL(appended.Format(), "pid:1234 [Hook] NtWriteFile log [Writes] 1, [Bytes] 5, [Time] 7-7");
+	}
+
+	void TestStatsRecords()
+	{
+		TestRecord loss(HookId::NtWriteFile, RecordType::Loss);
+		loss->AddU64(FieldId::LostCount, 5);
+		loss->AddU32(FieldId::LossStage, static_cast<uint32_t>(LossStage::Buffer));
+		CHECK_EQUAL(loss.Format(), "pid:1234 [Loss] NtWriteFile [Stage] buffer, [Lost] 5");
+
+		TestRecord slow(HookId::NtCreateFile, RecordType::SlowCall, static_cast<int32_t>(0xC0000034));
+		slow->AddU64(FieldId::Duration, 1500);
+		AddPath(slow.operator->(), u"x");
+		CHECK_EQUAL(slow.Format(), "pid:1234 [Slow] NtCreateFile [Duration] 1500, [Status] 0xC0000034, [FileName] x");
+
+		TestRecord timing(HookId::NtWriteFile, RecordType::HookTiming);
+		const uint64_t values[] = {9, 1, 2, 3, 4, 5, 6};
+		for (size_t i = 0; i < 7; ++i)
+			timing->AddU64(static_cast<FieldId>(static_cast<size_t>(FieldId::CallCount) + i), values[i]);
+		CHECK_EQUAL(timing.Format(),
+		            "pid:1234 [Timing] NtWriteFile [Calls] 9, [Tracer] p50 1, p99 2, max 3, [Real] p50 4, p99 5, max 6");
+	}
+
+	void TestText()
+	{
+		// two, three and four byte sequences, the last one a surrogate pair
+		TestRecord record(HookId::NtSetInformationFile);
+		AddPath(record.operator->(), u"C:\\caf\u00e9\\\u20ac\\\U0001F600");
+		CHECK_EQUAL(record.Format(), "pid:1234 [Hook] NtSetInformationFile C:\\caf\xc3\xa9\\\xe2\x82\xac\\\xf0\x9f\x98\x80");
+
+		// a path longer than the 256 unit conversion chunk, with a surrogate pair across the chunk border
+		std::u16string long_path(255, u'a');
+		long_path += u"\U0001F600";
+		long_path += std::u16string(300, u'b');
+		TestRecord long_record(HookId::NtWriteFile);
+		AddPath(long_record.operator->(), long_path);
+		CHECK_EQUAL(long_record.Format(),
+		            "pid:1234 [Hook] NtWriteFile " + std::string(255, 'a') + "\xf0\x9f\x98\x80" + std::string(300, 'b'));
+
+		// unknown hooks are printed by number
+		TestRecord unknown(static_cast<HookId>(999));
+		CHECK_EQUAL(unknown.Format(), "pid:1234 [Hook] 999 called");
+	}
+
+	void TestTruncation()
+	{
+		char buffer[sizeof(RecordHeader) + sizeof(FieldHeader) + 8];
+		RecordWriter writer(buffer, sizeof(buffer));
+		writer.Begin(RecordType::HookInfo, HookId::NtWriteFile, pid, 1, 0, 0);
+		const std::u16string path = u"0123456789";
+		writer.AddUtf16(FieldId::Path, path.data(), path.size());
+		const size_t size = writer.Finish();
+		RecordReader reader;
+		CHECK(reader.Open(buffer, size));
+		CHECK(reader.Header().flags & record_flag_truncated);
+		std::string line;
+		CHECK(FormatRecord(buffer, size, line));
+		CHECK_EQUAL(line, "pid:1234 [Hook] NtWriteFile 0123");
+	}
+
+	void TestRejected()
+	{
+		TestRecord record(HookId::NtWriteFile);
+		char copy[64];
+		const size_t size = record->Finish();
+		memcpy(copy, record->Data(), size);
+
+		std::string line = "kept";
+		CHECK(!FormatRecord(copy, sizeof(RecordHeader) - 1, line));
+		copy[0] = 'p';
+		CHECK(!FormatRecord(copy, size, line));
+		copy[0] = static_cast<char>(record_magic);
+		copy[1] = record_version + 1;
+		CHECK(!FormatRecord(copy, size, line));
+		copy[1] = record_version;
+		// the header claims more bytes than there are
+		CHECK(!FormatRecord(copy, size - 1, line));
+		CHECK_EQUAL(line, "kept");
+		CHECK_EQUAL(PeekRecordSize(copy, size), size);
+		CHECK_EQUAL(PeekRecordSize(copy, sizeof(RecordHeader) - 1), 0u);
+	}
+
+	// The writer stops at 254 fields, a record from elsewhere may claim all 255.
+	void TestFieldLimit()
+	{
+		char buffer[4096];
+		RecordWriter writer(buffer, sizeof(buffer));
+		writer.Begin(RecordType::HookInfo, HookId::NtWriteFile, pid, 1, 0, 0);
+		for (size_t i = 0; i + 1 < UINT8_MAX; ++i)
+			writer.AddU32(FieldId::Length, 1);
+		size_t size = writer.Finish();
+		CHECK_EQUAL(static_cast<uint8_t>(buffer[offsetof(RecordHeader, field_count)]), uint8_t{UINT8_MAX - 1});
+		const std::u16string path = u"C:\\last.obj";
+		const FieldHeader last = {FieldId::Path, FieldType::Utf16, static_cast<uint16_t>(path.size() * sizeof(char16_t))};
+		memcpy(buffer + size, &last, sizeof(last));
+		memcpy(buffer + size + sizeof(last), path.data(), last.length);
+		size += sizeof(last) + last.length;
+		buffer[offsetof(RecordHeader, field_count)] = static_cast<char>(UINT8_MAX);
+		const uint32_t record_size = static_cast<uint32_t>(size);
+		memcpy(buffer + offsetof(RecordHeader, size), &record_size, sizeof(record_size));
+
+		std::string line;
+		CHECK(FormatRecord(buffer, size, line));
+		CHECK_EQUAL(line, "pid:1234 [Hook] NtWriteFile C:\\last.obj");
+	}
+}
+
+int main()
+{
+	TestNtCreateFile();
+	TestLifecycle();
+	TestMessages();
+	TestWriteSummary();
+	TestStatsRecords();
+	TestText();
+	TestTruncation();
+	TestRejected();
+	TestFieldLimit();
+	return ProcessTracer::Test::Result("event_formatter_test");
+}
@@ -0,0 +1,166 @@
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hook_host.h"
+#include "event_collector.h"
+#include "event_pipeline.h"
+#include "hook_func.h"
+#include "logger.h"
+#include "test_check.h"
+
+using namespace ProcessTracer::EventRecord;
+using ProcessTracer::HookHarness::Session;
+using ProcessTracer::HookHarness::SessionOptions;
+
+namespace
+{
+	// A record of producer thread, numbered per thread in the timestamp field.
+	void WriteRecord(uint32_t thread, uint64_t seq, size_t padding)
+	{
+		char buffer[1024];
+		RecordWriter writer(buffer, sizeof(buffer));
+		writer.Begin(RecordType::Info, HookId::None, 1, thread, seq, 0);
+		const std::string text(padding, 'p');
+		writer.AddUtf8(FieldId::Message, text.data(), text.size());
+		const size_t size = writer.Finish();
+		while (!GetEventPipeline()->Write(writer.Data(), size))
+			std::this_thread::yield();
+	}
+
+	// Every producer's records have to arrive once and in the order it wrote them.
+	bool CheckOrder(const std::vector<std::string>& records, size_t threads, uint64_t per_thread)
+	{
+		std::map<uint32_t, uint64_t> next;
+		for (const auto& data : records)
+		{
+			RecordReader reader;
+			if (!reader.Open(data.data(), data.size()))
+				return false;
+			const auto& header = reader.Header();
+			if (header.timestamp != next[header.tid]++)
+				return false;
+		}
+		if (next.size() != threads)
+			return false;
+		for (const auto& [thread, count] : next)
+		{
+			if (count != per_thread)
+				return false;
+		}
+		return true;
+	}
+
+	// Producers far outnumber the cores and their rings are small, so the sender drains while they
+	// push, rings fill up and block, and threads that finish retire their rings while others go on.
+	void TestManyProducers(size_t threads, uint64_t per_thread, size_t ring_bytes)
+	{
+		SessionOptions options;
+		options.keep_records = true;
+		options.budget.thread_buffer_bytes = ring_bytes;
+		Session session(options);
+		std::vector<std::thread> producers;
+		for (size_t thread = 0; thread < threads; ++thread)
+		{
+			producers.emplace_back([thread, per_thread]
+			{
+				for (uint64_t seq = 0; seq < per_thread; ++seq)
+					WriteRecord(static_cast<uint32_t>(thread), seq, (thread * 31 + seq) % 200);
+				ProcessTracer::HookHarness::DetachThread();
+			});
+		}
+		for (auto& producer : producers)
+			producer.join();
+		session.Flush();
+		const auto records = session.Bulk().TakeRecords();
+		CHECK_EQUAL(records.size(), threads * per_thread);
+		CHECK(CheckOrder(records, threads, per_thread));
+		CHECK_EQUAL(session.Bulk().Malformed(), uint64_t{0});
+	}
+
+	// Under drop-oldest a producer whose ring is full drops its oldest records right away, also while
+	// the sender is in the middle of writing a batch.
+	void TestDropOldestDuringWrite()
+	{
+		using Clock = std::chrono::steady_clock;
+		SessionOptions options;
+		options.budget.thread_buffer_bytes = 4 * 1024;
+		options.budget.buffer_policy = ProcessTracer::Injection::OverflowPolicy::DropOldest;
+		options.transport_write_ns = 500000000;
+		Session session(options);
+		for (uint64_t seq = 0; seq < 16; ++seq)
+			WriteRecord(1, seq, 100);
+		std::thread flusher([&session]
+		{
+			session.Flush();
+		});
+		// long enough for the flush to pop the records and start writing them
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		const auto start = Clock::now();
+		for (uint64_t seq = 16; seq < 1000; ++seq)
+			WriteRecord(1, seq, 100);
+		const auto elapsed = Clock::now() - start;
+		flusher.join();
+		CHECK(elapsed < std::chrono::milliseconds(100));
+	}
+
+	// Lifecycle records go straight to their own transport.
+	void TestLifecycleLane()
+	{
+		SessionOptions options;
+		options.keep_records = true;
+		Session session(options);
+		char buffer[256];
+		RecordWriter writer(buffer, sizeof(buffer));
+		writer.Begin(RecordType::HookInfo, HookId::ExitProcess, 1, 1, 0, 0);
+		const size_t size = writer.Finish();
+		CHECK(GetEventPipeline()->Write(writer.Data(), size, ProcessTracer::Lane::Lifecycle));
+		CHECK_EQUAL(session.Lifecycle().Records(RecordType::HookInfo, HookId::ExitProcess), uint64_t{1});
+		CHECK_EQUAL(session.Bulk().Records(), uint64_t{0});
+	}
+
+	// The exit counts the numbered bulk records that were shipped before it, not the ones a full ring
+	// dropped, so the collector knows how many lines to wait for.
+	void TestExitCount()
+	{
+		SessionOptions options;
+		options.keep_records = true;
+		options.budget.thread_buffer_bytes = 4 * 1024;
+		options.budget.buffer_policy = ProcessTracer::Injection::OverflowPolicy::DropNewest;
+		Session session(options);
+		for (uint32_t event = 0; event < 2000; ++event)
+		{
+			ProcessTracer::HookRecord record(HookId::NtWriteFile);
+			record->AddU32(FieldId::Length, event);
+			record.Send();
+		}
+		HookExitProcess(0);
+		uint32_t numbered = 0;
+		for (const auto& data : session.Bulk().TakeRecords())
+		{
+			uint32_t sequence;
+			numbered += FindU32(data.data(), data.size(), FieldId::Sequence, sequence);
+		}
+		CHECK(numbered > 0 && numbered < 2000);
+		uint32_t bulk_count = 0;
+		for (const auto& data : session.Lifecycle().TakeRecords())
+		{
+			RecordReader reader;
+			if (reader.Open(data.data(), data.size()) && reader.Header().hook_id == HookId::ExitProcess)
+				CHECK(FindU32(data.data(), data.size(), FieldId::BulkCount, bulk_count));
+		}
+		CHECK_EQUAL(bulk_count, numbered);
+	}
+}
+
+int main()
+{
+	TestManyProducers(4, 20000, 64 * 1024);
+	TestManyProducers(64, 2000, 1024);
+	TestDropOldestDuringWrite();
+	TestLifecycleLane();
+	TestExitCount();
+	return ProcessTracer::Test::Result("event_pipeline_test");
+}
@@ -0,0 +1,262 @@
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "event_record.h"
+#include "test_check.h"
+
+using namespace ProcessTracer::EventRecord;
+
+namespace
+{
+	// One field as the test wrote it, to compare with what the reader gives back.
+	struct Expected
+	{
+		FieldId id;
+		FieldType type;
+		std::string value;
+	};
+
+	void Add(RecordWriter& writer, std::vector<Expected>& expected, FieldId id, uint32_t value)
+	{
+		CHECK(writer.AddU32(id, value));
+		expected.push_back({id, FieldType::U32, std::string(reinterpret_cast<const char*>(&value), sizeof(value))});
+	}
+
+	void Add(RecordWriter& writer, std::vector<Expected>& expected, FieldId id, uint64_t value)
+	{
+		writer.AddU64(id, value);
+		expected.push_back({id, FieldType::U64, std::string(reinterpret_cast<const char*>(&value), sizeof(value))});
+	}
+
+	void Add(RecordWriter& writer, std::vector<Expected>& expected, FieldId id, const std::string& text)
+	{
+		writer.AddUtf8(id, text.data(), text.size());
+		expected.push_back({id, FieldType::Utf8, text});
+	}
+
+	void Add(RecordWriter& writer, std::vector<Expected>& expected, FieldId id, const std::u16string& text)
+	{
+		writer.AddUtf16(id, text.data(), text.size());
+		expected.push_back({id, FieldType::Utf16, std::string(reinterpret_cast<const char*>(text.data()),
+		                                                      text.size() * sizeof(char16_t))});
+	}
+
+	// Reads the record back, its fields have to be the expected ones in order.
+	bool ReadsBack(const char* data, size_t size, const std::vector<Expected>& expected)
+	{
+		RecordReader reader;
+		if (!reader.Open(data, size))
+			return false;
+		Field field;
+		for (const auto& want : expected)
+		{
+			if (!reader.Next(field) || field.id != want.id || field.type != want.type ||
+				std::string(field.value, field.length) != want.value)
+				return false;
+		}
+		return !reader.Next(field);
+	}
+
+	void TestHeaderRoundTrip()
+	{
+		char buffer[256];
+		RecordWriter writer(buffer, sizeof(buffer));
+		writer.Begin(RecordType::HookError, HookId::NtCreateFile, 0xFFFFFFFFu, 5678, 0x0123456789ABCDEFull,
+		             static_cast<int32_t>(0xC0000034));
+		const size_t size = writer.Finish();
+		CHECK_EQUAL(size, sizeof(RecordHeader));
+		CHECK_EQUAL(PeekRecordSize(buffer, size), size);
+		CHECK_EQUAL(PeekRecordSize(buffer, sizeof(RecordHeader) - 1), size_t{0});
+
+		RecordReader reader;
+		CHECK(reader.Open(buffer, size));
+		const auto& header = reader.Header();
+		CHECK_EQUAL(header.magic, record_magic);
+		CHECK_EQUAL(header.version, record_version);
+		CHECK_EQUAL(header.type, RecordType::HookError);
+		CHECK_EQUAL(header.hook_id, HookId::NtCreateFile);
+		CHECK_EQUAL(header.pid, 0xFFFFFFFFu);
+		CHECK_EQUAL(header.tid, uint32_t{5678});
+		CHECK_EQUAL(header.timestamp, uint64_t{0x0123456789ABCDEF});
+		CHECK_EQUAL(header.status, static_cast<int32_t>(0xC0000034));
+		CHECK_EQUAL(header.flags, uint16_t{0});
+		CHECK_EQUAL(header.field_count, uint8_t{0});
+		Field field;
+		CHECK(!reader.Next(field));
+	}
+
+	// Every field type, empty strings and strings with bytes the text lines could not carry.
+	void TestFieldsRoundTrip()
+	{
+		char buffer[1024];
+		RecordWriter writer(buffer, sizeof(buffer));
+		writer.Begin(RecordType::HookInfo, HookId::NtCreateFile, 1, 2, 3, 0);
+		std::vector<Expected> expected;
+		Add(writer, expected, FieldId::AccessMask, uint32_t{0x80100080});
+		Add(writer, expected, FieldId::Disposition, uint32_t{0});
+		Add(writer, expected, FieldId::TotalBytes, uint64_t{0xFFFFFFFFFFFFFFFF});
+		Add(writer, expected, FieldId::Path, std::u16string(u"C:\\out\\\u00e4\U0001F600, [x]\n.obj"));
+		Add(writer, expected, FieldId::Message, std::string("line\nbreak, [FileName] \0 nul", 28));
+		Add(writer, expected, FieldId::Verb, std::u16string());
+		Add(writer, expected, FieldId::Message, std::string());
+		const size_t size = writer.Finish();
+		CHECK(ReadsBack(buffer, size, expected));
+
+		RecordReader reader;
+		CHECK(reader.Open(buffer, size));
+		Field field;
+		CHECK(reader.Next(field));
+		CHECK_EQUAL(field.AsU32(), uint32_t{0x80100080});
+		CHECK_EQUAL(field.AsU64(), uint64_t{0x80100080});
+		CHECK(reader.Next(field));
+		CHECK(reader.Next(field));
+		CHECK_EQUAL(field.AsU64(), uint64_t{0xFFFFFFFFFFFFFFFF});
+		// a number of the other width reads as 0
+		CHECK_EQUAL(field.AsU32(), uint32_t{0});
+	}
+
+	// Records written back to back are found one after the other by their size.
+	void TestStream()
+	{
+		std::string stream;
+		for (uint32_t i = 0; i < 50; ++i)
+		{
+			char buffer[512];
+			RecordWriter writer(buffer, sizeof(buffer));
+			writer.Begin(RecordType::HookInfo, HookId::NtWriteFile, 1, i, i, 0);
+			writer.AddUtf8(FieldId::Message, std::string(i * 3, 's').c_str());
+			stream.append(buffer, writer.Finish());
+		}
+		size_t offset = 0;
+		uint32_t count = 0;
+		while (offset < stream.size())
+		{
+			const size_t size = PeekRecordSize(stream.data() + offset, stream.size() - offset);
+			RecordReader reader;
+			CHECK(size != 0 && reader.Open(stream.data() + offset, size));
+			CHECK_EQUAL(reader.Header().tid, count);
+			offset += size;
+			++count;
+		}
+		CHECK_EQUAL(count, uint32_t{50});
+		CHECK_EQUAL(offset, stream.size());
+	}
+
+	// Strings are cut to the buffer, UTF-16 on a whole code unit, numbers that do not fit are left out.
+	void TestTruncation()
+	{
+		char buffer[sizeof(RecordHeader) + sizeof(FieldHeader) + 7];
+		RecordWriter writer(buffer, sizeof(buffer));
+		writer.Begin(RecordType::HookInfo, HookId::NtCreateFile, 1, 2, 3, 0);
+		const std::u16string path = u"C:\\a\\b";
+		writer.AddUtf16(FieldId::Path, path.data(), path.size());
+		CHECK(!writer.AddU32(FieldId::AccessMask, 1));
+		const size_t size = writer.Finish();
+		RecordReader reader;
+		CHECK(reader.Open(buffer, size));
+		CHECK(reader.Header().flags & record_flag_truncated);
+		Field field;
+		CHECK(reader.Next(field));
+		CHECK_EQUAL(field.length, uint16_t{6});
+		CHECK(!reader.Next(field));
+
+		// at most 255 fields
+		std::vector<char> large(4096);
+		RecordWriter many(large.data(), large.size());
+		many.Begin(RecordType::Info, HookId::None, 1, 2, 3, 0);
+		for (int i = 0; i < 300; ++i)
+			many.AddU32(FieldId::Length, static_cast<uint32_t>(i));
+		RecordReader many_reader;
+		CHECK(many_reader.Open(large.data(), many.Finish()));
+		CHECK_EQUAL(many_reader.Header().field_count, uint8_t{255});
+		CHECK(many_reader.Header().flags & record_flag_truncated);
+	}
+
+	// Cut or damaged records are rejected or stop at the damaged field, never read past the end.
+	void TestMalformed()
+	{
+		char buffer[256];
+		RecordWriter writer(buffer, sizeof(buffer));
+		writer.Begin(RecordType::HookInfo, HookId::NtCreateFile, 1, 2, 3, 0);
+		writer.AddUtf8(FieldId::Message, "message");
+		const size_t size = writer.Finish();
+		RecordReader reader;
+		CHECK(!reader.Open(buffer, size - 1));
+		CHECK(!reader.Open(buffer, sizeof(RecordHeader) - 1));
+		CHECK(!reader.Open("pid:1 [Info] text line\n", 23));
+
+		std::string wrong_version(buffer, size);
+		wrong_version[1] = static_cast<char>(record_version + 1);
+		CHECK(!reader.Open(wrong_version.data(), wrong_version.size()));
+
+		std::string long_field(buffer, size);
+		const uint16_t length = 200;
+		memcpy(long_field.data() + sizeof(RecordHeader) + offsetof(FieldHeader, length), &length, sizeof(length));
+		CHECK(reader.Open(long_field.data(), long_field.size()));
+		Field field;
+		CHECK(!reader.Next(field));
+	}
+
+	// Random records of random fields read back as written.
+	void TestRandomRoundTrip()
+	{
+		std::mt19937 random(4);
+		std::vector<char> buffer(64 * 1024);
+		for (int round = 0; round < 2000; ++round)
+		{
+			RecordWriter writer(buffer.data(), buffer.size());
+			writer.Begin(static_cast<RecordType>(random() % 8 + 1), static_cast<HookId>(random() % 16),
+			             random(), random(), random(), static_cast<int32_t>(random()));
+			std::vector<Expected> expected;
+			const size_t fields = random() % 20;
+			for (size_t i = 0; i < fields; ++i)
+			{
+				const auto id = static_cast<FieldId>(random() % 35 + 1);
+				switch (random() % 4)
+				{
+				case 0:
+					Add(writer, expected, id, static_cast<uint32_t>(random()));
+					break;
+				case 1:
+					Add(writer, expected, id, static_cast<uint64_t>(random()) << 32 | random());
+					break;
+				case 2:
+				{
+					std::string text(random() % 300, '\0');
+					for (auto& c : text)
+						c = static_cast<char>(random());
+					Add(writer, expected, id, text);
+					break;
+				}
+				default:
+				{
+					std::u16string text(random() % 300, u'\0');
+					for (auto& c : text)
+						c = static_cast<char16_t>(random());
+					Add(writer, expected, id, text);
+					break;
+				}
+				}
+			}
+			const size_t size = writer.Finish();
+			if (!ReadsBack(buffer.data(), size, expected))
+			{
+				CHECK(ReadsBack(buffer.data(), size, expected));
+				return;
+			}
+		}
+	}
+}
+
+int main()
+{
+	TestHeaderRoundTrip();
+	TestFieldsRoundTrip();
+	TestStream();
+	TestTruncation();
+	TestMalformed();
+	TestRandomRoundTrip();
+	return ProcessTracer::Test::Result("event_record_test");
+}
@@ -0,0 +1,207 @@
+#include <atomic>
+#include <climits>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "handle_path_table.h"
+#include "test_check.h"
+
+namespace
+{
+	// Handle values are multiples of four and never 0, like Windows handles; here they come from
+	// file descriptors, which the kernel reuses the way it reuses handles.
+	uintptr_t Key(int fd)
+	{
+		return static_cast<uintptr_t>(fd + 1) * 4;
+	}
+
+	std::u16string Widen(const std::string& text)
+	{
+		return std::u16string(text.begin(), text.end());
+	}
+
+	// What NtQueryObject would answer: the path the kernel has for the descriptor.
+	std::u16string QueryName(int fd)
+	{
+		char link[64];
+		snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+		char target[PATH_MAX];
+		const ssize_t length = readlink(link, target, sizeof(target));
+		return length > 0 ? Widen(std::string(target, static_cast<size_t>(length))) : std::u16string();
+	}
+
+	std::u16string Lookup(const ProcessTracer::HandlePathTable& table, uintptr_t key)
+	{
+		char16_t buffer[ProcessTracer::HandlePathTable::max_path_length];
+		return std::u16string(buffer, table.Lookup(key, buffer, std::size(buffer)));
+	}
+
+	// Real descriptors are opened, duplicated and closed at random, and the table is kept the way the
+	// hooks keep it: insert on open and duplicate, erase on close. Every lookup is either a miss or
+	// the name the kernel has for the descriptor, never the name of a file closed before.
+	void TestDescriptors()
+	{
+		char directory_template[] = "/tmp/handle_path_table_test.XXXXXX";
+		char directory[PATH_MAX];
+		// the kernel names files by their resolved path
+		const bool created = mkdtemp(directory_template) && realpath(directory_template, directory);
+		CHECK(created);
+		if (!created)
+			return;
+		const auto owned_table = std::make_unique<ProcessTracer::HandlePathTable>();
+		auto& table = *owned_table;
+		std::mt19937 random(9);
+		std::vector<int> open_fds;
+		size_t hits = 0;
+		size_t lookups = 0;
+		for (int step = 0; step < 20000; ++step)
+		{
+			const auto action = random() % 8;
+			if (action < 3 && open_fds.size() < 300)
+			{
+				const std::string path = std::string(directory) + "/file" + std::to_string(random() % 500);
+				const int fd = open(path.c_str(), O_WRONLY | O_CREAT, 0600);
+				CHECK(fd >= 0);
+				if (fd < 0)
+					continue;
+				const auto name = Widen(path);
+				table.Insert(Key(fd), name.data(), name.size());
+				open_fds.push_back(fd);
+			}
+			else if (action == 3 && !open_fds.empty())
+			{
+				const int source = open_fds[random() % open_fds.size()];
+				const int fd = dup(source);
+				CHECK(fd >= 0);
+				if (fd < 0)
+					continue;
+				char16_t path[ProcessTracer::HandlePathTable::max_path_length];
+				const size_t length = table.Lookup(Key(source), path, std::size(path));
+				if (length != 0)
+					table.Insert(Key(fd), path, length);
+				open_fds.push_back(fd);
+			}
+			else if (action < 6 && !open_fds.empty())
+			{
+				const size_t index = random() % open_fds.size();
+				table.Erase(Key(open_fds[index]));
+				close(open_fds[index]);
+				open_fds[index] = open_fds.back();
+				open_fds.pop_back();
+			}
+			else if (!open_fds.empty())
+			{
+				const int fd = open_fds[random() % open_fds.size()];
+				const auto cached = Lookup(table, Key(fd));
+				++lookups;
+				if (cached.empty())
+					continue;
+				++hits;
+				if (cached != QueryName(fd))
+				{
+					CHECK(cached == QueryName(fd));
+					break;
+				}
+			}
+		}
+		// fewer than 300 handles spread over 1024 slots, nearly every lookup hits
+		CHECK(hits * 100 >= lookups * 95);
+		for (const int fd : open_fds)
+			close(fd);
+		for (int i = 0; i < 500; ++i)
+			unlink((std::string(directory) + "/file" + std::to_string(i)).c_str());
+		rmdir(directory);
+	}
+
+	// More handles than slots: inserts start failing, lookups of the handles that did not fit miss
+	// and never answer with another handle's path.
+	void TestFull()
+	{
+		const auto owned_table = std::make_unique<ProcessTracer::HandlePathTable>();
+		auto& table = *owned_table;
+		const size_t handles = ProcessTracer::HandlePathTable::slot_count * 2;
+		size_t inserted = 0;
+		for (size_t i = 0; i < handles; ++i)
+		{
+			const auto name = Widen("C:\\f" + std::to_string(i));
+			inserted += table.Insert(Key(static_cast<int>(i)), name.data(), name.size());
+		}
+		CHECK(inserted < handles);
+		for (size_t i = 0; i < handles; ++i)
+		{
+			const auto cached = Lookup(table, Key(static_cast<int>(i)));
+			if (!cached.empty() && cached != Widen("C:\\f" + std::to_string(i)))
+			{
+				CHECK(cached.empty());
+				break;
+			}
+		}
+		// a path too long for a slot is not cached and drops an older entry
+		const auto name = Widen("C:\\short");
+		table.Erase(Key(1));
+		CHECK(table.Insert(Key(1), name.data(), name.size()));
+		const std::u16string long_path(ProcessTracer::HandlePathTable::max_path_length + 1, u'x');
+		CHECK(!table.Insert(Key(1), long_path.data(), long_path.size()));
+		CHECK(Lookup(table, Key(1)).empty());
+	}
+
+	// Writers keep replacing the paths of a few handles while readers look them up. Every path names
+	// its handle and is all one letter, so a torn copy would show.
+	void TestConcurrentReaders()
+	{
+		const auto owned_table = std::make_unique<ProcessTracer::HandlePathTable>();
+		auto& table = *owned_table;
+		constexpr int handles = 8;
+		std::atomic<bool> stop{false};
+		std::atomic<bool> consistent{true};
+		std::vector<std::thread> readers;
+		for (int reader = 0; reader < 2; ++reader)
+		{
+			readers.emplace_back([&table, &stop, &consistent]
+			{
+				while (!stop.load(std::memory_order_relaxed))
+				{
+					for (int fd = 0; fd < handles; ++fd)
+					{
+						const auto path = Lookup(table, Key(fd));
+						if (path.empty())
+							continue;
+						const bool fits = path.size() >= 2 && path[0] == static_cast<char16_t>(u'0' + fd) &&
+							path.find_first_not_of(path[1], 1) == std::u16string::npos;
+						if (!fits)
+							consistent.store(false, std::memory_order_relaxed);
+					}
+					std::this_thread::yield();
+				}
+			});
+		}
+		for (int round = 0; round < 100000; ++round)
+		{
+			const int fd = round % handles;
+			std::u16string path(static_cast<size_t>(round % 200 + 2), static_cast<char16_t>(u'a' + round % 26));
+			path[0] = static_cast<char16_t>(u'0' + fd);
+			if (round % 7 == 0)
+				table.Erase(Key(fd));
+			else
+				table.Insert(Key(fd), path.data(), path.size());
+		}
+		stop.store(true);
+		for (auto& reader : readers)
+			reader.join();
+		CHECK(consistent.load());
+	}
+}
+
+int main()
+{
+	TestDescriptors();
+	TestFull();
+	TestConcurrentReaders();
+	return ProcessTracer::Test::Result("handle_path_table_test");
+}
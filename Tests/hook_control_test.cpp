@@ -0,0 +1,197 @@
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hook_host.h"
+#include "hook_control.h"
+#include "hook_func.h"
+#include "test_check.h"
+
+using namespace ProcessTracer::EventRecord;
+using ProcessTracer::HookHarness::Session;
+using ProcessTracer::HookHarness::SessionOptions;
+
+namespace
+{
+	// the tracer's block, attached before any hook runs
+	ProcessTracer::Control::ControlBlock g_block = {};
+
+	void SetHookWord(HookId hook_id, uint32_t word)
+	{
+		g_block.hooks[static_cast<size_t>(hook_id)].store(word, std::memory_order_relaxed);
+	}
+
+	void AttachBlock()
+	{
+		g_block.magic = ProcessTracer::Control::control_magic;
+		g_block.version = ProcessTracer::Control::control_version;
+		g_block.hook_count = static_cast<uint32_t>(HookId::Count);
+		for (size_t i = 0; i < ProcessTracer::Control::max_hooks; ++i)
+			SetHookWord(static_cast<HookId>(i), ProcessTracer::Control::DefaultHookWord(static_cast<HookId>(i)));
+		GetHookControl()->Attach(&g_block);
+	}
+
+	// A file the traced program writes through the hooks.
+	class TracedFile
+	{
+		std::u16string m_path;
+		UNICODE_STRING m_name = {};
+		OBJECT_ATTRIBUTES m_attributes = {};
+		IO_STATUS_BLOCK m_io = {};
+		HANDLE m_handle = nullptr;
+
+	public:
+		explicit TracedFile(std::u16string path) : m_path(std::move(path))
+		{
+			m_name.Length = static_cast<USHORT>(m_path.size() * sizeof(WCHAR));
+			m_name.MaximumLength = m_name.Length;
+			m_name.Buffer = reinterpret_cast<PWSTR>(m_path.data());
+			InitializeObjectAttributes(&m_attributes, &m_name, OBJ_CASE_INSENSITIVE, nullptr, nullptr);
+			HookNtCreateFile(&m_handle, GENERIC_WRITE, &m_attributes, &m_io, nullptr, FILE_ATTRIBUTE_NORMAL, 0,
+			                 FILE_OVERWRITE_IF, FILE_SYNCHRONOUS_IO_NONALERT, nullptr, 0);
+		}
+
+		~TracedFile()
+		{
+			HookNtClose(m_handle);
+		}
+
+		TracedFile(const TracedFile&) = delete;
+		TracedFile& operator=(const TracedFile&) = delete;
+
+		void Write(ULONG length)
+		{
+			char data[256] = {};
+			HookNtWriteFile(m_handle, nullptr, nullptr, nullptr, &m_io, data, length, nullptr, nullptr);
+		}
+	};
+
+	uint64_t WriteEvents(Session& session)
+	{
+		return session.Bulk().Records(RecordType::HookInfo, HookId::NtWriteFile);
+	}
+
+	// A rate of N logs the first of every N calls of a thread.
+	void TestSampling()
+	{
+		Session session;
+		SetHookWord(HookId::NtWriteFile, ProcessTracer::Control::hook_enabled | 4);
+		std::thread([]
+		{
+			TracedFile file(u"C:\\out\\sampled.obj");
+			for (int i = 0; i < 400; ++i)
+				file.Write(16);
+			ProcessTracer::HookHarness::DetachThread();
+		}).join();
+		SetHookWord(HookId::NtWriteFile, ProcessTracer::Control::hook_enabled | 1);
+		session.Flush();
+		CHECK_EQUAL(WriteEvents(session), uint64_t{100});
+		// switched off means no event at all, whatever the rate
+		CHECK(!GetHookControl()->ShouldLog(HookId::NtCreateSection));
+	}
+
+	// Summaries count every write, with the hook switched off or sampled.
+	void TestSummariesIgnoreSwitches()
+	{
+		for (const uint32_t word : {uint32_t{0}, ProcessTracer::Control::hook_enabled | 8})
+		{
+			SessionOptions options;
+			options.aggregate_writes = true;
+			options.keep_records = true;
+			Session session(options);
+			SetHookWord(HookId::NtWriteFile, word);
+			{
+				TracedFile file(u"C:\\out\\summary.obj");
+				for (int i = 0; i < 50; ++i)
+					file.Write(100);
+			}
+			SetHookWord(HookId::NtWriteFile, ProcessTracer::Control::hook_enabled | 1);
+			session.Flush();
+			uint64_t count = 0;
+			uint64_t bytes = 0;
+			for (const auto& data : session.Bulk().TakeRecords())
+			{
+				RecordReader reader;
+				if (!reader.Open(data.data(), data.size()) || reader.Header().hook_id != HookId::NtWriteFile)
+					continue;
+				Field field;
+				while (reader.Next(field))
+				{
+					if (field.id == FieldId::WriteCount)
+						count += field.AsU64();
+					else if (field.id == FieldId::TotalBytes)
+						bytes += field.AsU64();
+				}
+			}
+			CHECK_EQUAL(count, uint64_t{50});
+			CHECK_EQUAL(bytes, uint64_t{5000});
+		}
+	}
+
+	// The tracer flips the switch while producers keep writing. Once every producer made calls after
+	// the flip, a switched off hook adds no event and a switched on one adds events again.
+	void TestFlipWhileRunning()
+	{
+		constexpr int producers = 3;
+		Session session;
+		std::atomic<bool> stop{false};
+		std::atomic<uint64_t> calls[producers] = {};
+		std::vector<std::thread> threads;
+		for (int producer = 0; producer < producers; ++producer)
+		{
+			threads.emplace_back([&stop, &calls, producer]
+			{
+				TracedFile file(u"C:\\out\\producer" + std::u16string(1, static_cast<char16_t>(u'0' + producer)));
+				while (!stop.load(std::memory_order_relaxed))
+				{
+					file.Write(32);
+					calls[producer].fetch_add(1, std::memory_order_release);
+				}
+				ProcessTracer::HookHarness::DetachThread();
+			});
+		}
+		// waits until every producer made calls that started after now
+		const auto wait_for_calls = [&calls]
+		{
+			uint64_t start[producers];
+			for (int producer = 0; producer < producers; ++producer)
+				start[producer] = calls[producer].load(std::memory_order_acquire);
+			for (int producer = 0; producer < producers; ++producer)
+			{
+				while (calls[producer].load(std::memory_order_acquire) < start[producer] + 64)
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		};
+		for (int round = 0; round < 10; ++round)
+		{
+			const bool enabled = round % 2 == 0;
+			SetHookWord(HookId::NtWriteFile, enabled ? ProcessTracer::Control::hook_enabled | 1 : 0);
+			wait_for_calls();
+			session.Flush();
+			const uint64_t before = WriteEvents(session);
+			wait_for_calls();
+			session.Flush();
+			const uint64_t after = WriteEvents(session);
+			if (enabled)
+				CHECK(after > before);
+			else
+				CHECK_EQUAL(after, before);
+		}
+		stop.store(true);
+		for (auto& thread : threads)
+			thread.join();
+		SetHookWord(HookId::NtWriteFile, ProcessTracer::Control::hook_enabled | 1);
+	}
+}
+
+int main()
+{
+	AttachBlock();
+	TestSampling();
+	TestSummariesIgnoreSwitches();
+	TestFlipWhileRunning();
+	ProcessTracer::HookHarness::DetachThread();
+	return ProcessTracer::Test::Result("hook_control_test");
+}
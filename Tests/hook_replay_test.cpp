@@ -0,0 +1,261 @@
+#include <sstream>
+#include <string>
+
+#include "call_stream.h"
+#include "hook_host.h"
+#include "hook_func.h"
+#include "test_check.h"
+
+using namespace ProcessTracer::EventRecord;
+using namespace ProcessTracer::HookHarness;
+using ProcessTracer::FakeWin32::CallCount;
+using ProcessTracer::FakeWin32::NtCall;
+
+namespace
+{
+	const auto status_object_name_not_found = static_cast<NTSTATUS>(static_cast<int32_t>(0xC0000034));
+	const auto status_disk_full = static_cast<NTSTATUS>(static_cast<int32_t>(0xC000007F));
+
+	uint64_t HookRecords(CaptureTransport& transport, HookId hook_id)
+	{
+		return transport.Records(RecordType::HookInfo, hook_id);
+	}
+
+	CallStream Parse(const char* text)
+	{
+		std::istringstream input(text);
+		CallStream stream;
+		std::string error;
+		CHECK(ParseCallStream(input, stream, error));
+		CHECK_EQUAL(error, "");
+		return stream;
+	}
+
+	// the Path of every record of hook_id, in the order they were shipped
+	std::vector<std::u16string> Paths(const std::vector<std::string>& records, HookId hook_id)
+	{
+		std::vector<std::u16string> paths;
+		for (const auto& data : records)
+		{
+			RecordReader reader;
+			if (!reader.Open(data.data(), data.size()) || reader.Header().hook_id != hook_id)
+				continue;
+			Field field;
+			while (reader.Next(field))
+			{
+				if (field.id == FieldId::Path)
+					paths.emplace_back(reinterpret_cast<const char16_t*>(field.value), field.length / sizeof(char16_t));
+			}
+		}
+		return paths;
+	}
+
+	void TestGeneratedStream()
+	{
+		WorkloadOptions options;
+		options.threads = 3;
+		options.files_per_thread = 5;
+		options.writes_per_file = 4;
+		options.rename_every = 2;
+		const CallStream stream = GenerateCallStream(options);
+		CHECK_EQUAL(stream.threads.size(), size_t{3});
+		CHECK_EQUAL(stream.Calls(CallType::Create), size_t{15});
+		CHECK_EQUAL(stream.Calls(CallType::Write), size_t{60});
+		CHECK_EQUAL(stream.Calls(CallType::Rename), size_t{9});
+		CHECK_EQUAL(stream.Calls(CallType::Close), size_t{15});
+
+		Session session;
+		ProcessTracer::FakeWin32::ResetCalls();
+		Replay(stream, ReplayMode::Hooked);
+		session.Flush();
+		CHECK_EQUAL(HookRecords(session.Bulk(), HookId::NtCreateFile), uint64_t{15});
+		CHECK_EQUAL(HookRecords(session.Bulk(), HookId::NtWriteFile), uint64_t{60});
+		CHECK_EQUAL(HookRecords(session.Bulk(), HookId::NtSetInformationFile), uint64_t{9});
+		CHECK_EQUAL(session.Bulk().Records(RecordType::Loss, HookId::None), uint64_t{0});
+		CHECK_EQUAL(session.Bulk().Malformed(), uint64_t{0});
+		// every handle came through HookNtCreateFile, so its name is never asked for
+		CHECK_EQUAL(CallCount(NtCall::QueryObject), uint64_t{0});
+		CHECK_EQUAL(CallCount(NtCall::CreateFile), uint64_t{15});
+		CHECK_EQUAL(CallCount(NtCall::WriteFile), uint64_t{60});
+		CHECK_EQUAL(CallCount(NtCall::Close), uint64_t{15});
+	}
+
+	void TestAggregatedWrites()
+	{
+		WorkloadOptions options;
+		options.threads = 2;
+		options.files_per_thread = 3;
+		options.writes_per_file = 10;
+		options.rename_every = 0;
+		SessionOptions session_options;
+		session_options.aggregate_writes = true;
+		Session session(session_options);
+		Replay(GenerateCallStream(options), ReplayMode::Hooked);
+		session.Flush();
+		// one summary per file, sent when its handle is closed
+		CHECK_EQUAL(HookRecords(session.Bulk(), HookId::NtWriteFile), uint64_t{6});
+		CHECK_EQUAL(HookRecords(session.Bulk(), HookId::NtCreateFile), uint64_t{6});
+	}
+
+	void TestRenamedFile()
+	{
+		const CallStream stream = Parse(
+			"# a compiler writes its output under a temporary name\n"
+			"0 create 0 40100000 5 \\??\\C:\\out\\main.obj.tmp\n"
+			"0 write 0 512\n"
+			"0 rename 0 \\??\\C:\\out\\main.obj\n"
+			"0 write 0 64 512\n"
+			"0 close 0\n");
+		CHECK_EQUAL(stream.Calls(), size_t{5});
+
+		SessionOptions options;
+		options.keep_records = true;
+		Session session(options);
+		ProcessTracer::FakeWin32::ResetCalls();
+		Replay(stream, ReplayMode::Hooked);
+		session.Flush();
+		const auto records = session.Bulk().TakeRecords();
+		CHECK_EQUAL(Paths(records, HookId::NtCreateFile).size(), size_t{1});
+		const auto writes = Paths(records, HookId::NtWriteFile);
+		CHECK_EQUAL(writes.size(), size_t{2});
+		CHECK(writes.size() == 2 && writes[0] == u"\\??\\C:\\out\\main.obj.tmp");
+		// the cached name went away with the rename, the kernel is asked once for the new one
+		CHECK(writes.size() == 2 && writes[1] == u"\\??\\C:\\out\\main.obj");
+		CHECK_EQUAL(CallCount(NtCall::QueryObject), uint64_t{1});
+		const auto renames = Paths(records, HookId::NtSetInformationFile);
+		CHECK(renames.size() == 1 && renames[0] == u"\\??\\C:\\out\\main.obj.tmp");
+	}
+
+	void TestUntracedHandle()
+	{
+		SessionOptions options;
+		options.keep_records = true;
+		Session session(options);
+		ProcessTracer::FakeWin32::ResetCalls();
+		const HANDLE handle = ProcessTracer::FakeWin32::OpenUntraced(u"\\??\\C:\\log\\build.log");
+		char data[16] = {};
+		IO_STATUS_BLOCK io = {};
+		for (int i = 0; i < 3; ++i)
+			CHECK(NT_SUCCESS(HookNtWriteFile(handle, nullptr, nullptr, nullptr, &io, data, sizeof(data), nullptr,
+			                                 nullptr)));
+		HookNtClose(handle);
+		DetachThread();
+		session.Flush();
+		const auto writes = Paths(session.Bulk().TakeRecords(), HookId::NtWriteFile);
+		CHECK_EQUAL(writes.size(), size_t{3});
+		CHECK(!writes.empty() && writes.back() == u"\\??\\C:\\log\\build.log");
+		// queried on the first write only
+		CHECK_EQUAL(CallCount(NtCall::QueryObject), uint64_t{1});
+	}
+
+	void TestFailedCalls()
+	{
+		SessionOptions options;
+		options.aggregate_writes = true;
+		Session session(options);
+		const CallStream stream = Parse(
+			"0 create 0 40100000 5 \\??\\C:\\out\\a.obj\n"
+			"0 write 0 100\n"
+			"0 write 0 100\n"
+			"0 close 0\n");
+
+		ProcessTracer::FakeWin32::SetStatus(NtCall::CreateFile, status_object_name_not_found);
+		Replay(stream, ReplayMode::Hooked);
+		ProcessTracer::FakeWin32::SetStatus(NtCall::CreateFile, 0);
+		session.Flush();
+		// no handle, nothing to name, and both writes to it fail
+		CHECK_EQUAL(HookRecords(session.Bulk(), HookId::NtCreateFile), uint64_t{0});
+		CHECK_EQUAL(HookRecords(session.Bulk(), HookId::NtWriteFile), uint64_t{2});
+
+		ProcessTracer::FakeWin32::SetStatus(NtCall::WriteFile, status_disk_full);
+		Replay(stream, ReplayMode::Hooked);
+		ProcessTracer::FakeWin32::SetStatus(NtCall::WriteFile, 0);
+		session.Flush();
+		CHECK_EQUAL(HookRecords(session.Bulk(), HookId::NtCreateFile), uint64_t{1});
+		// failed writes are not folded into the summary
+		CHECK_EQUAL(HookRecords(session.Bulk(), HookId::NtWriteFile), uint64_t{4});
+	}
+
+	// Opens path through the hook, relative to root when it is given.
+	NTSTATUS CreateThroughHook(HANDLE& handle, const std::u16string& path, HANDLE root = nullptr)
+	{
+		UNICODE_STRING name;
+		name.Length = static_cast<USHORT>(path.size() * sizeof(WCHAR));
+		name.MaximumLength = name.Length;
+		name.Buffer = reinterpret_cast<PWSTR>(const_cast<char16_t*>(path.data()));
+		OBJECT_ATTRIBUTES attributes;
+		InitializeObjectAttributes(&attributes, &name, OBJ_CASE_INSENSITIVE, root, nullptr);
+		IO_STATUS_BLOCK io = {};
+		return HookNtCreateFile(&handle, GENERIC_WRITE, &attributes, &io, nullptr, FILE_ATTRIBUTE_NORMAL, 0,
+		                        FILE_OVERWRITE_IF, FILE_SYNCHRONOUS_IO_NONALERT, nullptr, 0);
+	}
+
+	// A relative open is logged with the name the handle resolves to, a create without object
+	// attributes fails without a record.
+	void TestCreateFileNames()
+	{
+		SessionOptions options;
+		options.keep_records = true;
+		Session session(options);
+		HANDLE directory = nullptr;
+		CHECK(NT_SUCCESS(CreateThroughHook(directory, u"\\??\\C:\\out")));
+		HANDLE file = nullptr;
+		CHECK(NT_SUCCESS(CreateThroughHook(file, u"main.obj", directory)));
+
+		HANDLE unnamed = nullptr;
+		IO_STATUS_BLOCK io = {};
+		CHECK(!NT_SUCCESS(HookNtCreateFile(&unnamed, GENERIC_WRITE, nullptr, &io, nullptr, FILE_ATTRIBUTE_NORMAL, 0,
+		                                   FILE_OPEN, 0, nullptr, 0)));
+		HookNtClose(file);
+		HookNtClose(directory);
+		session.Flush();
+		const auto creates = Paths(session.Bulk().TakeRecords(), HookId::NtCreateFile);
+		CHECK_EQUAL(creates.size(), size_t{2});
+		CHECK(creates.size() == 2 && creates[1] == u"\\??\\C:\\out\\main.obj");
+	}
+
+	// A mapping of a file names it, a pagefile-backed mapping or a handle without a name has no Path.
+	void TestFileMappingPaths()
+	{
+		SessionOptions options;
+		options.keep_records = true;
+		Session session(options);
+		HANDLE file = nullptr;
+		CHECK(NT_SUCCESS(CreateThroughHook(file, u"\\??\\C:\\out\\main.pdb")));
+		for (const HANDLE handle : {file, INVALID_HANDLE_VALUE, reinterpret_cast<HANDLE>(uintptr_t{0x7FFC})})
+		{
+			const HANDLE mapping = HookCreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping)
+				CloseHandle(mapping);
+		}
+		HookNtClose(file);
+		session.Flush();
+		const auto records = session.Bulk().TakeRecords();
+		CHECK_EQUAL(session.Bulk().Records(RecordType::HookInfo, HookId::CreateFileMappingW), uint64_t{3});
+		const auto paths = Paths(records, HookId::CreateFileMappingW);
+		CHECK_EQUAL(paths.size(), size_t{1});
+		CHECK(paths.size() == 1 && paths[0] == u"\\??\\C:\\out\\main.pdb");
+	}
+
+	void TestMalformedStream()
+	{
+		std::istringstream input("0 create 0 1 5 \\??\\C:\\a\n0 write\n");
+		CallStream stream;
+		std::string error;
+		CHECK(!ParseCallStream(input, stream, error));
+		CHECK_EQUAL(error, "line 2: malformed write");
+	}
+}
+
+int main()
+{
+	TestGeneratedStream();
+	TestAggregatedWrites();
+	TestRenamedFile();
+	TestUntracedHandle();
+	TestFailedCalls();
+	TestCreateFileNames();
+	TestFileMappingPaths();
+	TestMalformedStream();
+	return ProcessTracer::Test::Result("hook_replay_test");
+}
@@ -0,0 +1,116 @@
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hook_host.h"
+#include "hook_func.h"
+#include "hook_timing.h"
+#include "test_check.h"
+
+using ProcessTracer::EventRecord::HookId;
+using ProcessTracer::Timing::LatencyCounts;
+
+namespace
+{
+	constexpr uint64_t call_cost_ns = 20000;
+
+	struct Totals
+	{
+		LatencyCounts tracer;
+		LatencyCounts real;
+	};
+
+	Totals Merge(HookId hook_id)
+	{
+		Totals totals;
+		GetHookTiming()->Merge(hook_id, totals.tracer, totals.real);
+		return totals;
+	}
+
+	// Writes from a thread of their own, which detaches like a thread of the traced program.
+	void WriteOnThread(int writes)
+	{
+		std::thread([writes]
+		{
+			std::u16string path = u"C:\\out\\timed.obj";
+			UNICODE_STRING name = {};
+			name.Length = static_cast<USHORT>(path.size() * sizeof(WCHAR));
+			name.MaximumLength = name.Length;
+			name.Buffer = reinterpret_cast<PWSTR>(path.data());
+			OBJECT_ATTRIBUTES attributes;
+			InitializeObjectAttributes(&attributes, &name, OBJ_CASE_INSENSITIVE, nullptr, nullptr);
+			IO_STATUS_BLOCK io = {};
+			HANDLE handle = nullptr;
+			HookNtCreateFile(&handle, GENERIC_WRITE, &attributes, &io, nullptr, FILE_ATTRIBUTE_NORMAL, 0,
+			                 FILE_OVERWRITE_IF, FILE_SYNCHRONOUS_IO_NONALERT, nullptr, 0);
+			char data[32] = {};
+			for (int i = 0; i < writes; ++i)
+				HookNtWriteFile(handle, nullptr, nullptr, nullptr, &io, data, sizeof(data), nullptr, nullptr);
+			HookNtClose(handle);
+			ProcessTracer::HookHarness::DetachThread();
+		}).join();
+	}
+
+	// Every hooked call is timed while timing is on: the real function's share holds the time the
+	// fake kernel spins. Built with PROCESS_TRACER_HOOK_TIMING=0 the hooks record nothing at all.
+	void TestThroughHooks()
+	{
+		ProcessTracer::HookHarness::Session session;
+		ProcessTracer::FakeWin32::SetCallCost(call_cost_ns);
+		GetHookTiming()->Enable();
+		WriteOnThread(100);
+		CHECK(GetHookTiming()->Disable());
+		WriteOnThread(50);
+		ProcessTracer::FakeWin32::SetCallCost(0);
+		const Totals writes = Merge(HookId::NtWriteFile);
+		const Totals creates = Merge(HookId::NtCreateFile);
+#if PROCESS_TRACER_HOOK_TIMING
+		CHECK_EQUAL(writes.real.count, uint64_t{100});
+		CHECK_EQUAL(writes.tracer.count, uint64_t{100});
+		CHECK_EQUAL(creates.real.count, uint64_t{1});
+		CHECK(writes.real.Percentile(0.5) >= call_cost_ns);
+		// the tracer's share is the hook's own work, far below the spun kernel time
+		CHECK(writes.tracer.Percentile(0.5) < writes.real.Percentile(0.5));
+#else
+		CHECK_EQUAL(writes.real.count + writes.tracer.count + creates.real.count, uint64_t{0});
+#endif
+	}
+
+	// Short-lived threads hand their histograms on; nothing recorded by an exited thread is lost,
+	// also while a report merges at the same time.
+	void TestShortLivedThreads()
+	{
+		const Totals before = Merge(HookId::NtClose);
+		constexpr int threads = 100;
+		constexpr int records = 10;
+		std::thread reporter([]
+		{
+			for (int i = 0; i < 200; ++i)
+			{
+				Merge(HookId::NtClose);
+				std::this_thread::yield();
+			}
+		});
+		for (int thread = 0; thread < threads; ++thread)
+		{
+			std::thread([]
+			{
+				for (int i = 0; i < records; ++i)
+					GetHookTiming()->Record(HookId::NtClose, 100, 1000);
+				GetHookTiming()->DetachThread();
+			}).join();
+		}
+		reporter.join();
+		const Totals after = Merge(HookId::NtClose);
+		CHECK_EQUAL(after.tracer.count - before.tracer.count, uint64_t{threads * records});
+		CHECK_EQUAL(after.real.sum - before.real.sum, uint64_t{threads * records * 1000});
+	}
+}
+
+int main()
+{
+	TestThroughHooks();
+	TestShortLivedThreads();
+	ProcessTracer::HookHarness::DetachThread();
+	return ProcessTracer::Test::Result("hook_timing_test");
+}
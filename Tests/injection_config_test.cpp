@@ -0,0 +1,158 @@
+#include <cstring>
+#include <string>
+
+#include "injection_config.h"
+#include "test_check.h"
+
+using namespace ProcessTracer::Injection;
+using ProcessTracer::EventRecord::HookId;
+
+namespace
+{
+	ConfigHeader MakeHeader(const std::string& path_filter)
+	{
+		ConfigHeader header = {};
+		header.magic = config_magic;
+		header.version = config_version;
+		header.header_size = sizeof(ConfigHeader);
+		header.tracer_pid = 4242;
+		header.flags = config_flag_can_elevate | config_flag_aggregate_writes;
+		header.hook_mask = HookBit(HookId::NtCreateFile) | HookBit(HookId::NtWriteFile);
+		header.batch_bytes = 16384;
+		header.batch_latency_ms = 5;
+		header.clock_source = 1;
+		header.path_filter_length = static_cast<uint32_t>(path_filter.size());
+		header.clock_epoch = 0x0123456789ABCDEFull;
+		header.clock_frequency = 10000000;
+		header.latency_threshold_us = 250;
+		header.latency_top_files = 16;
+		header.buffer_bytes = 1 << 20;
+		header.buffer_policy = OverflowPolicy::DropOldest;
+		header.transport_policy = OverflowPolicy::Block;
+		return header;
+	}
+
+	// The payload as the tracer writes it: the header, padding up to header_size, the filter rules.
+	std::string Encode(const ConfigHeader& header, const std::string& path_filter)
+	{
+		std::string payload(reinterpret_cast<const char*>(&header), sizeof(header));
+		payload.resize(header.header_size, '\0');
+		return payload + path_filter;
+	}
+
+	void TestRoundTrip()
+	{
+		const std::string rules = "+C:\\out\\**\n-**\\*.tmp\n";
+		const ConfigHeader header = MakeHeader(rules);
+		const std::string payload = Encode(header, rules);
+		Config config = {};
+		CHECK(Decode(payload.data(), payload.size(), config));
+		CHECK(memcmp(&config.header, &header, sizeof(header)) == 0);
+		CHECK_EQUAL(std::string(config.path_filter, config.path_filter_length), rules);
+		// no filter rules at all
+		const std::string bare = Encode(MakeHeader(""), "");
+		CHECK(Decode(bare.data(), bare.size(), config));
+		CHECK_EQUAL(config.path_filter_length, size_t{0});
+	}
+
+	// A newer tracer may grow the header; this reader takes the fields it knows and finds the rules
+	// after the whole header.
+	void TestNewerWriter()
+	{
+		const std::string rules = "+D:\\build\\**";
+		ConfigHeader header = MakeHeader(rules);
+		header.version = config_version + 1;
+		header.header_size = sizeof(ConfigHeader) + 24;
+		std::string payload = Encode(header, rules);
+		payload[sizeof(ConfigHeader)] = 'x';
+		Config config = {};
+		CHECK(Decode(payload.data(), payload.size(), config));
+		CHECK_EQUAL(config.header.tracer_pid, uint32_t{4242});
+		CHECK_EQUAL(std::string(config.path_filter, config.path_filter_length), rules);
+	}
+
+	void TestRejected()
+	{
+		const std::string rules = "+C:\\out\\**";
+		const ConfigHeader good = MakeHeader(rules);
+		Config config = {};
+		CHECK(!Decode(nullptr, 100, config));
+		// the old "pid canElevate" text payload
+		const std::string text = "4242 1";
+		CHECK(!Decode(text.data(), text.size(), config));
+
+		ConfigHeader header = good;
+		header.magic = 0;
+		std::string payload = Encode(header, rules);
+		CHECK(!Decode(payload.data(), payload.size(), config));
+
+		header = good;
+		header.version = config_version - 1;
+		payload = Encode(header, rules);
+		CHECK(!Decode(payload.data(), payload.size(), config));
+
+		header = good;
+		header.header_size = sizeof(ConfigHeader) - 8;
+		payload = Encode(good, rules);
+		memcpy(&payload[0], &header, sizeof(header));
+		CHECK(!Decode(payload.data(), payload.size(), config));
+
+		// header and rules longer than the payload
+		header = good;
+		header.header_size = 4096;
+		payload = Encode(good, rules);
+		memcpy(&payload[0], &header, sizeof(header));
+		CHECK(!Decode(payload.data(), payload.size(), config));
+		header = good;
+		header.path_filter_length = UINT32_MAX;
+		payload = Encode(header, rules);
+		CHECK(!Decode(payload.data(), payload.size(), config));
+
+		// every truncation of a valid payload
+		payload = Encode(good, rules);
+		for (size_t size = 0; size < payload.size(); ++size)
+		{
+			if (Decode(payload.data(), size, config))
+			{
+				CHECK_EQUAL(size, payload.size());
+				break;
+			}
+		}
+	}
+
+	void TestSelectHooks()
+	{
+		constexpr uint64_t lifecycle = HookBit(HookId::CreateProcessInternalW) | HookBit(HookId::ExitProcess) |
+			HookBit(HookId::ShellExecuteExW);
+		constexpr uint64_t handle_table = HookBit(HookId::NtClose) | HookBit(HookId::NtDuplicateObject);
+
+		// the process tree is followed even when nothing is requested
+		CHECK_EQUAL(SelectHooks(0, 0), lifecycle);
+		// bits outside the known hooks, HookId::None included, are never detoured
+		CHECK_EQUAL(SelectHooks(~uint64_t{0}, 0), all_hooks);
+		CHECK_EQUAL(SelectHooks(HookBit(HookId::None) | HookBit(HookId::Count), 0), lifecycle);
+		CHECK_EQUAL(all_hooks & HookBit(HookId::None), uint64_t{0});
+
+		// hooks that name files through the handle table bring the hooks that keep it current
+		for (const HookId hook_id : {HookId::CreateFileMappingW, HookId::NtWriteFile, HookId::NtCreateFile,
+		                             HookId::NtSetInformationFile, HookId::NtCreateSection, HookId::ZwCreateSection,
+		                             HookId::NtCreateSectionEx})
+			CHECK_EQUAL(SelectHooks(HookBit(hook_id), 0), lifecycle | handle_table | HookBit(hook_id));
+		for (const HookId hook_id : {HookId::ZwWriteFile, HookId::NtCreateUserProcess, HookId::NtMapViewOfSection})
+			CHECK_EQUAL(SelectHooks(HookBit(hook_id), 0), lifecycle | HookBit(hook_id));
+
+		// write summaries need NtWriteFile whatever the mask says
+		CHECK_EQUAL(SelectHooks(0, config_flag_aggregate_writes),
+		            lifecycle | handle_table | HookBit(HookId::NtWriteFile));
+		CHECK_EQUAL(SelectHooks(0, config_flag_can_elevate | config_flag_hook_timing), lifecycle);
+	}
+}
+
+int main()
+{
+	TestRoundTrip();
+	TestNewerWriter();
+	TestRejected();
+	TestSelectHooks();
+	return ProcessTracer::Test::Result("injection_config_test");
+}
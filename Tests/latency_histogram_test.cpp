@@ -0,0 +1,147 @@
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "latency_histogram.h"
+#include "test_check.h"
+
+using namespace ProcessTracer::Timing;
+
+namespace
+{
+	uint64_t LowerBound(size_t bucket)
+	{
+		return bucket == 0 ? 0 : BucketUpperBound(bucket - 1) + 1;
+	}
+
+	// The buckets tile the values without gaps, both bounds land in their own bucket, and no bucket
+	// spans more than an eighth of its smallest value.
+	void TestBucketBounds()
+	{
+		for (size_t bucket = 0; bucket < bucket_count; ++bucket)
+		{
+			const uint64_t lower = LowerBound(bucket);
+			const uint64_t upper = BucketUpperBound(bucket);
+			const uint64_t width = upper - lower + 1;
+			const bool fits = upper >= lower && BucketOf(lower) == bucket && BucketOf(upper) == bucket &&
+				(lower < 8 ? width == 1 : width <= lower / 8);
+			if (!fits)
+			{
+				fprintf(stderr, "bucket %zu: %llu to %llu\n", bucket, static_cast<unsigned long long>(lower),
+				        static_cast<unsigned long long>(upper));
+				CHECK(fits);
+				return;
+			}
+		}
+		CHECK_EQUAL(BucketUpperBound(bucket_count - 1), (uint64_t{1} << max_value_bits) - 1);
+		// anything larger shares the last bucket
+		CHECK_EQUAL(BucketOf(uint64_t{1} << max_value_bits), bucket_count - 1);
+		CHECK_EQUAL(BucketOf(UINT64_MAX), bucket_count - 1);
+		// every power of two starts a bucket
+		for (unsigned bit = 0; bit < max_value_bits; ++bit)
+		{
+			const uint64_t value = uint64_t{1} << bit;
+			CHECK_EQUAL(LowerBound(BucketOf(value)), value);
+		}
+	}
+
+	void TestPercentiles()
+	{
+		LatencyCounts counts;
+		CHECK_EQUAL(counts.Percentile(0.5), uint64_t{0});
+		for (uint64_t value = 1; value <= 1000; ++value)
+			counts.Add(value);
+		CHECK_EQUAL(counts.count, uint64_t{1000});
+		CHECK_EQUAL(counts.sum, uint64_t{500500});
+		CHECK_EQUAL(counts.max, uint64_t{1000});
+		// a percentile is the upper bound of its bucket, within an eighth above the exact value
+		for (const double fraction : {0.01, 0.25, 0.5, 0.9, 0.99, 0.999})
+		{
+			const auto exact = static_cast<uint64_t>(fraction * 1000 + 0.5);
+			const uint64_t percentile = counts.Percentile(fraction);
+			CHECK(percentile >= exact && percentile <= exact + exact / 8);
+		}
+		CHECK_EQUAL(counts.Percentile(0), uint64_t{1});
+		// never above the largest value recorded
+		CHECK_EQUAL(counts.Percentile(1), uint64_t{1000});
+	}
+
+	// Merging histograms gives the histogram of all their values, and a thread's histogram merges
+	// into the same counts as plain counting.
+	void TestMerge()
+	{
+		std::mt19937_64 random(16);
+		LatencyCounts all;
+		LatencyCounts parts[4];
+		ThreadLatencyHistogram thread_histograms[4];
+		for (int i = 0; i < 100000; ++i)
+		{
+			const uint64_t value = random() >> (random() % 64);
+			all.Add(value);
+			parts[i % 4].Add(value);
+			thread_histograms[i % 4].Record(value);
+		}
+		LatencyCounts merged;
+		LatencyCounts merged_threads;
+		for (int part = 0; part < 4; ++part)
+		{
+			merged.Merge(parts[part]);
+			thread_histograms[part].MergeInto(merged_threads);
+		}
+		for (const LatencyCounts* counts : {&merged, &merged_threads})
+		{
+			bool same = counts->count == all.count && counts->sum == all.sum && counts->max == all.max;
+			for (size_t bucket = 0; bucket < bucket_count; ++bucket)
+				same &= counts->buckets[bucket] == all.buckets[bucket];
+			CHECK(same);
+		}
+	}
+
+	// Readers merge while the owners record: counts only grow, and the last merge has every value.
+	void TestConcurrentRecording()
+	{
+		constexpr int threads = 3;
+		constexpr uint64_t values = 200000;
+		ThreadLatencyHistogram histograms[threads];
+		std::atomic<int> running{threads};
+		std::vector<std::thread> writers;
+		for (int thread = 0; thread < threads; ++thread)
+		{
+			writers.emplace_back([&histograms, &running, thread]
+			{
+				for (uint64_t value = 0; value < values; ++value)
+					histograms[thread].Record(value % 5000);
+				running.fetch_sub(1);
+			});
+		}
+		uint64_t previous = 0;
+		bool growing = true;
+		while (running.load() != 0)
+		{
+			LatencyCounts counts;
+			for (const auto& histogram : histograms)
+				histogram.MergeInto(counts);
+			growing &= counts.count >= previous;
+			previous = counts.count;
+			std::this_thread::yield();
+		}
+		for (auto& writer : writers)
+			writer.join();
+		CHECK(growing);
+		LatencyCounts counts;
+		for (const auto& histogram : histograms)
+			histogram.MergeInto(counts);
+		CHECK_EQUAL(counts.count, threads * values);
+		CHECK_EQUAL(counts.max, uint64_t{4999});
+	}
+}
+
+int main()
+{
+	TestBucketBounds();
+	TestPercentiles();
+	TestMerge();
+	TestConcurrentRecording();
+	return ProcessTracer::Test::Result("latency_histogram_test");
+}
@@ -0,0 +1,194 @@
+#include <string>
+#include <vector>
+
+#include "call_stream.h"
+#include "hook_host.h"
+#include "hook_func.h"
+#include "hook_timing.h"
+#include "latency_profile.h"
+#include "test_check.h"
+
+using namespace ProcessTracer::EventRecord;
+using namespace ProcessTracer::HookHarness;
+using ProcessTracer::FakeWin32::NtCall;
+
+namespace
+{
+	const auto status_disk_full = static_cast<NTSTATUS>(static_cast<int32_t>(0xC000007F));
+	constexpr uint64_t threshold_ns = 1000000;
+
+	// the profile is measured by the hook timing, which a build can leave out
+#if PROCESS_TRACER_HOOK_TIMING
+	// the slow files of the workload and what every call on them costs, slowest first
+	struct SlowFile
+	{
+		const char16_t* name;
+		uint64_t cost_ns;
+	};
+
+	const SlowFile slow_files[] = {{u"unit5.obj", 3000000}, {u"unit6.obj", 2000000}, {u"unit7.obj", 1500000}};
+
+	struct Profile
+	{
+		std::vector<std::u16string> slow_paths;
+		std::vector<uint64_t> slow_durations;
+		uint64_t slow_failures = 0;
+		// the process first, then the top files
+		std::vector<std::u16string> profile_paths;
+		std::vector<std::vector<std::pair<FieldId, uint64_t>>> profiles;
+	};
+
+	uint64_t Value(const std::vector<std::pair<FieldId, uint64_t>>& fields, FieldId id)
+	{
+		for (const auto& [field_id, value] : fields)
+		{
+			if (field_id == id)
+				return value;
+		}
+		return UINT64_MAX;
+	}
+
+	Profile Read(const std::vector<std::string>& records)
+	{
+		Profile profile;
+		for (const auto& data : records)
+		{
+			RecordReader reader;
+			if (!reader.Open(data.data(), data.size()))
+				continue;
+			const RecordType type = reader.Header().type;
+			if (type != RecordType::SlowCall && type != RecordType::LatencyProfile)
+				continue;
+			std::u16string path;
+			std::vector<std::pair<FieldId, uint64_t>> values;
+			Field field;
+			while (reader.Next(field))
+			{
+				if (field.id == FieldId::Path)
+					path.assign(reinterpret_cast<const char16_t*>(field.value), field.length / sizeof(char16_t));
+				else
+					values.emplace_back(field.id, field.AsU64());
+			}
+			if (type == RecordType::SlowCall)
+			{
+				profile.slow_paths.push_back(path);
+				profile.slow_durations.push_back(Value(values, FieldId::Duration));
+				profile.slow_failures += reader.Header().status != 0;
+			}
+			else
+			{
+				profile.profile_paths.push_back(path);
+				profile.profiles.push_back(values);
+			}
+		}
+		return profile;
+	}
+
+	bool EndsWith(const std::u16string& path, const char16_t* name)
+	{
+		const std::u16string suffix(name);
+		return path.size() >= suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+	}
+
+	// A build on one thread, so the calls run in the same order every time: 16 object files of 8 writes
+	// each, every fourth written to a temporary name whose rename fails. Three files sit on a slow disk,
+	// every other call is free. The fake layer's virtual clock advances by exactly those costs, so every
+	// measured duration, and with it the order of the top files, is the same on any machine and load.
+	void TestStandInWorkload()
+	{
+		WorkloadOptions options;
+		options.threads = 1;
+		options.files_per_thread = 16;
+		options.writes_per_file = 8;
+		options.rename_every = 4;
+		const CallStream stream = GenerateCallStream(options);
+
+		SessionOptions session_options;
+		session_options.keep_records = true;
+		Session session(session_options);
+		ProcessTracer::FakeWin32::ResetCalls();
+		for (const auto& file : slow_files)
+			ProcessTracer::FakeWin32::SetFileCost(file.name, file.cost_ns);
+		ProcessTracer::FakeWin32::SetStatus(NtCall::SetInformationFile, status_disk_full);
+		ProcessTracer::FakeWin32::UseVirtualClock(true);
+		GetLatencyProfile()->Enable(threshold_ns, 2);
+		Replay(stream, ReplayMode::Hooked);
+		CHECK(GetLatencyProfile()->Disable());
+		ProcessTracer::FakeWin32::UseVirtualClock(false);
+		SendLatencyProfile();
+		session.Flush();
+		ProcessTracer::FakeWin32::ResetCalls();
+		const Profile profile = Read(session.Bulk().TakeRecords());
+		// in profiling mode no file call is reported one by one unless it is slow
+		CHECK_EQUAL(session.Bulk().Records(RecordType::HookInfo, HookId::NtWriteFile), uint64_t{0});
+		CHECK_EQUAL(session.Bulk().Records(RecordType::HookInfo, HookId::NtCreateFile), uint64_t{0});
+
+		// the create and the 8 writes of every slow file, nothing else
+		const size_t calls_per_file = 1 + options.writes_per_file;
+		CHECK_EQUAL(profile.slow_paths.size(), std::size(slow_files) * calls_per_file);
+		for (size_t i = 0; i < profile.slow_paths.size(); ++i)
+		{
+			const auto& file = slow_files[i / calls_per_file];
+			CHECK(EndsWith(profile.slow_paths[i], file.name));
+			CHECK_EQUAL(profile.slow_durations[i], file.cost_ns);
+		}
+		CHECK_EQUAL(profile.slow_failures, uint64_t{0});
+
+		// the process, then the two files that took the most time
+		CHECK_EQUAL(profile.profiles.size(), size_t{3});
+		if (profile.profiles.size() != 3)
+			return;
+		const auto& process = profile.profiles[0];
+		CHECK(profile.profile_paths[0].empty());
+		CHECK_EQUAL(Value(process, FieldId::CallCount), uint64_t{16 + 16 * 8 + 4});
+		CHECK_EQUAL(Value(process, FieldId::FailedCount), uint64_t{4});
+		CHECK_EQUAL(Value(process, FieldId::FileCount), uint64_t{16});
+		// 27 of 148 calls are slow: the median is a free call, the 99th and 99.9th percentiles are not
+		CHECK(Value(process, FieldId::LatencyP50) < threshold_ns);
+		CHECK(Value(process, FieldId::LatencyP99) >= slow_files[0].cost_ns);
+		CHECK(Value(process, FieldId::LatencyP999) >= slow_files[0].cost_ns);
+		CHECK_EQUAL(Value(process, FieldId::LatencyMax), slow_files[0].cost_ns);
+		CHECK_EQUAL(Value(process, FieldId::LatencyTotal), calls_per_file *
+		            (slow_files[0].cost_ns + slow_files[1].cost_ns + slow_files[2].cost_ns));
+		for (size_t top = 0; top < 2; ++top)
+		{
+			const auto& file = profile.profiles[top + 1];
+			CHECK(EndsWith(profile.profile_paths[top + 1], slow_files[top].name));
+			CHECK_EQUAL(Value(file, FieldId::CallCount), uint64_t{calls_per_file});
+			CHECK_EQUAL(Value(file, FieldId::FailedCount), uint64_t{0});
+			CHECK(Value(file, FieldId::LatencyP50) >= slow_files[top].cost_ns);
+			CHECK_EQUAL(Value(file, FieldId::LatencyTotal), calls_per_file * slow_files[top].cost_ns);
+		}
+	}
+#endif
+
+	// Without the profile the same workload reports every call and no slow one, however long it took.
+	void TestProfileOff()
+	{
+		WorkloadOptions options;
+		options.threads = 1;
+		options.files_per_thread = 4;
+		options.writes_per_file = 2;
+		Session session;
+		ProcessTracer::FakeWin32::ResetCalls();
+		ProcessTracer::FakeWin32::SetFileCost(u"unit1.obj", 2 * threshold_ns);
+		Replay(GenerateCallStream(options), ReplayMode::Hooked);
+		CHECK(!GetLatencyProfile()->Disable());
+		session.Flush();
+		ProcessTracer::FakeWin32::ResetCalls();
+		CHECK_EQUAL(session.Bulk().Records(RecordType::HookInfo, HookId::NtWriteFile), uint64_t{8});
+		CHECK_EQUAL(session.Bulk().Records(RecordType::HookInfo, HookId::NtCreateFile), uint64_t{4});
+		CHECK_EQUAL(session.Bulk().Records(RecordType::SlowCall, HookId::NtWriteFile), uint64_t{0});
+		CHECK_EQUAL(session.Bulk().Records(RecordType::SlowCall, HookId::NtCreateFile), uint64_t{0});
+	}
+}
+
+int main()
+{
+#if PROCESS_TRACER_HOOK_TIMING
+	TestStandInWorkload();
+#endif
+	TestProfileOff();
+	ProcessTracer::HookHarness::DetachThread();
+	return ProcessTracer::Test::Result("latency_profile_test");
+}
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "hook_host.h"
+#include "hook_func.h"
+#include "line_classifier.h"
+#include "logger.h"
+#include "socket_collector.h"
+#include "test_check.h"
+#include "unix_socket_transport.h"
+
+using namespace ProcessTracer::EventRecord;
+using ProcessTracer::HookHarness::Session;
+using ProcessTracer::HookHarness::SessionOptions;
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	constexpr size_t flooders = 2;
+	constexpr uint64_t flood_rate = 1000000; // events per second, all flooders together
+	constexpr auto flood_time = std::chrono::milliseconds(1000);
+	constexpr auto marker_interval = std::chrono::milliseconds(2);
+	constexpr size_t max_markers = 1000;
+	constexpr char marker_text[] = "lifecycle ";
+	constexpr char flood_path[] = "\\flood\\";
+	// events sent while the sink is held up, so the exit finds the collector behind
+	constexpr uint64_t backlog_events = 100000;
+	constexpr auto sink_hold = std::chrono::milliseconds(200);
+
+	// what the collector's sink saw, written on its thread only and read once the collector is gone
+	struct Received
+	{
+		std::vector<Clock::time_point> marker_arrival = std::vector<Clock::time_point>(max_markers);
+		uint64_t flood_lines = 0;
+		// flood lines that arrived before the exit line, UINT64_MAX while it did not arrive
+		uint64_t flood_lines_before_exit = UINT64_MAX;
+		// the sink sleeps until then, as a slow consumer would
+		std::atomic<Clock::rep> hold_until{0};
+	};
+
+	void Receive(void* context, const char* lines, size_t length)
+	{
+		const auto received = static_cast<Received*>(context);
+		while (Clock::now().time_since_epoch().count() < received->hold_until.load())
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		const auto now = Clock::now();
+		ScanLines(lines, length, [received, now](const LineView& line)
+		{
+			const std::string text(line.text, line.length);
+			const size_t marker = text.find(marker_text);
+			if (line.kind == LineKind::ProcessExited)
+				received->flood_lines_before_exit = received->flood_lines;
+			else if (marker != std::string::npos)
+			{
+				const size_t index = std::stoul(text.substr(marker + sizeof(marker_text) - 1));
+				if (index < max_markers)
+					received->marker_arrival[index] = now;
+			}
+			else if (text.find(flood_path) != std::string::npos)
+				++received->flood_lines;
+		});
+	}
+
+	// One NtWriteFile event as the hook sends it.
+	void SendFloodEvent(uint64_t index)
+	{
+		ProcessTracer::HookRecord record(HookId::NtWriteFile);
+		record->AddU32(FieldId::Length, 4096);
+		char16_t path[] = u"C:\\flood\\unit0.obj";
+		path[13] = static_cast<char16_t>(u'0' + index % 10);
+		record->AddUtf16(FieldId::Path, path, sizeof(path) / sizeof(path[0]) - 1);
+		record.Send();
+	}
+
+	// Threads send file events at flood_rate for flood_time while lifecycle events go out every
+	// marker_interval. Lifecycle events reach the collector's sink quickly although the bulk lane is
+	// saturated. Then the sink stalls, a backlog of file events piles up in front of the collector and
+	// the process exits: the exit reaches the sink only after every file event.
+	void TestFlood()
+	{
+		const std::string path = ProcessTracer::UnixSocketTransport::Path(getpid()) + ".flood";
+		Received received;
+		void* collector = CreateSocketCollector(path.c_str(), Receive, &received);
+		CHECK(collector != nullptr);
+		if (!collector)
+			return;
+		SessionOptions options;
+		options.collector_path = path;
+		options.budget.thread_buffer_bytes = 1024 * 1024;
+		uint64_t flood_events = 0;
+		std::vector<Clock::time_point> marker_sent(max_markers);
+		size_t markers = 0;
+		Clock::duration flood_duration{};
+		{
+			Session session(options);
+			std::atomic<bool> flooding{true};
+			std::vector<uint64_t> sent(flooders);
+			std::vector<std::thread> threads;
+			const auto start = Clock::now();
+			for (size_t flooder = 0; flooder < flooders; ++flooder)
+			{
+				threads.emplace_back([&sent, &flooding, start, flooder]
+				{
+					constexpr uint64_t per_second = flood_rate / flooders;
+					uint64_t events = 0;
+					while (flooding.load(std::memory_order_relaxed))
+					{
+						const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start);
+						const uint64_t due = per_second * static_cast<uint64_t>(elapsed.count()) / 1000000;
+						if (events >= due)
+						{
+							std::this_thread::yield();
+							continue;
+						}
+						// catch up in bursts, checking the clock once per burst
+						for (const uint64_t burst_end = std::min(due, events + 64); events < burst_end; ++events)
+							SendFloodEvent(events);
+					}
+					sent[flooder] = events;
+					ProcessTracer::HookHarness::DetachThread();
+				});
+			}
+			while (Clock::now() - start < flood_time && markers < max_markers)
+			{
+				std::this_thread::sleep_for(marker_interval);
+				marker_sent[markers] = Clock::now();
+				const std::string marker = marker_text + std::to_string(markers);
+				ProcessTracer::Logger::g_logger.HookInfo(HookId::CreateProcessInternalW, marker.c_str(),
+				                                         ProcessTracer::Lane::Lifecycle);
+				++markers;
+			}
+			flooding.store(false);
+			for (auto& thread : threads)
+				thread.join();
+			flood_duration = Clock::now() - start;
+			for (const uint64_t events : sent)
+				flood_events += events;
+			received.hold_until.store((Clock::now() + sink_hold).time_since_epoch().count());
+			for (uint64_t event = 0; event < backlog_events; ++event)
+				SendFloodEvent(event);
+			HookExitProcess(3);
+			CHECK_EQUAL(Session::ExitCode(), int64_t{3});
+		}
+		DestroySocketCollector(collector);
+
+		CHECK_EQUAL(received.flood_lines, flood_events + backlog_events);
+		CHECK_EQUAL(received.flood_lines_before_exit, flood_events + backlog_events);
+		std::vector<double> latencies_ms;
+		for (size_t marker = 0; marker < markers; ++marker)
+		{
+			CHECK(received.marker_arrival[marker] != Clock::time_point{});
+			latencies_ms.push_back(
+				std::chrono::duration<double, std::milli>(received.marker_arrival[marker] - marker_sent[marker]).count());
+		}
+		std::sort(latencies_ms.begin(), latencies_ms.end());
+		if (latencies_ms.empty())
+			return;
+		const double p50 = latencies_ms[latencies_ms.size() / 2];
+		const double p99 = latencies_ms[latencies_ms.size() * 99 / 100];
+		const double rate = static_cast<double>(flood_events) / std::chrono::duration<double>(flood_duration).count();
+		printf("flood of %.0f events/s: %zu lifecycle events, p50 %.3f ms, p99 %.3f ms, max %.3f ms\n", rate,
+		       markers, p50, p99, latencies_ms.back());
+		// generous for a loaded single-core machine, a lane stuck behind the flood takes seconds
+		CHECK(p99 < 100.0);
+	}
+}
+
+int main()
+{
+	TestFlood();
+	return ProcessTracer::Test::Result("lifecycle_flood_test");
+}
@@ -0,0 +1,273 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include "event_formatter.h"
+#include "line_classifier.h"
+#include "test_check.h"
+
+using namespace ProcessTracer::EventRecord;
+
+namespace
+{
+	constexpr uint32_t sender_pid = 4242;
+	const std::string sender = "pid:" + std::to_string(sender_pid) + " ";
+
+	// what the collector renders from a record the hooks send, without the sender's "pid:N "
+	template <typename Add>
+	std::string Rendered(RecordType type, HookId hook_id, Add&& add)
+	{
+		char buffer[512];
+		RecordWriter writer(buffer, sizeof(buffer));
+		writer.Begin(type, hook_id, sender_pid, 1, 0, 0);
+		add(writer);
+		std::string line;
+		CHECK(FormatRecord(buffer, writer.Finish(), line));
+		CHECK(line.compare(0, sender.size(), sender) == 0);
+		return line.substr(sender.size());
+	}
+
+	std::string Rendered(RecordType type, HookId hook_id, const char* message)
+	{
+		return Rendered(type, hook_id, [message](RecordWriter& writer)
+		{
+			writer.AddUtf8(FieldId::Message, message);
+		});
+	}
+
+	std::string Rendered(HookId hook_id, FieldId id, uint32_t value)
+	{
+		return Rendered(RecordType::HookInfo, hook_id, [id, value](RecordWriter& writer)
+		{
+			writer.AddU32(id, value);
+		});
+	}
+
+	// a rendered line up to the pid it names, which the rules parse themselves
+	std::string UpToPid(const std::string& text, uint32_t pid)
+	{
+		const size_t at = text.find(std::to_string(pid));
+		CHECK(at != std::string::npos);
+		return text.substr(0, at);
+	}
+
+	const std::string created = UpToPid(Rendered(HookId::CreateProcessInternalW, FieldId::ProcessId, 5151), 5151);
+	// the exit names the sender itself
+	const std::string exited = UpToPid(Rendered(HookId::ExitProcess, FieldId::ExitCode, 0), sender_pid);
+	const std::string shell_start = Rendered(RecordType::HookInfo, HookId::ShellExecuteExW,
+	                                         shell_execute_start_message);
+	const std::string shell_error = Rendered(RecordType::HookInfo, HookId::ShellExecuteExW,
+	                                         shell_execute_error_message);
+	const std::string permission = Rendered(RecordType::Info, HookId::None, permission_request_message);
+	const std::string loss = Rendered(RecordType::Loss, HookId::NtWriteFile, [](RecordWriter& writer)
+	{
+		writer.AddU64(FieldId::LostCount, 12);
+		writer.AddU32(FieldId::LossStage, static_cast<uint32_t>(LossStage::Buffer));
+	});
+
+	bool StartsWith(const std::string& text, const std::string& prefix)
+	{
+		return text.compare(0, prefix.size(), prefix) == 0;
+	}
+
+	uint32_t ReferencePid(const std::string& text, bool stop_at_space)
+	{
+		const size_t digits = std::min(text.find_first_not_of("0123456789"), text.size());
+		if (digits == 0 || digits > 10)
+			return 0;
+		if (stop_at_space ? digits == text.size() || text[digits] != ' ' : digits != text.size())
+			return 0;
+		const uint64_t pid = std::stoull(text.substr(0, digits));
+		return pid <= INT32_MAX ? static_cast<uint32_t>(pid) : 0;
+	}
+
+	// the rules as the tracer's comparisons spelled them out, one message after the other
+	LineKind ReferenceClassify(const std::string& line, uint32_t& pid)
+	{
+		pid = 0;
+		if (line == "[CloseApp]")
+			return LineKind::CloseApp;
+		if (StartsWith(line, "[ChildProcess] "))
+		{
+			pid = ReferencePid(line.substr(15), false);
+			return LineKind::ChildProcess;
+		}
+		const size_t space = line.find(' ');
+		if (space == std::string::npos)
+			return LineKind::Other;
+		const std::string text = line.substr(space + 1);
+		if (StartsWith(text, created))
+		{
+			pid = ReferencePid(text.substr(created.size()), false);
+			return LineKind::ProcessCreated;
+		}
+		if (StartsWith(text, exited))
+		{
+			pid = ReferencePid(text.substr(exited.size()), true);
+			return LineKind::ProcessExited;
+		}
+		if (text == shell_start)
+			return LineKind::ShellExecuteStart;
+		if (text == shell_error)
+			return LineKind::ShellExecuteError;
+		if (text == permission)
+			return LineKind::PermissionRequest;
+		if (StartsWith(text, "[Loss] "))
+			return LineKind::Loss;
+		return LineKind::Other;
+	}
+
+	LineKind Classify(const std::string& line, uint32_t& pid)
+	{
+		return ClassifyLine(line.data(), line.size(), pid);
+	}
+
+	// Every line the tracer acts on, as the collector renders it from the record the hooks send.
+	void TestKnownLines()
+	{
+		uint32_t pid;
+		CHECK(Classify(sender + shell_start, pid) == LineKind::ShellExecuteStart);
+		CHECK(Classify(sender + shell_error, pid) == LineKind::ShellExecuteError);
+		CHECK(Classify(sender + permission, pid) == LineKind::PermissionRequest);
+		CHECK(Classify(sender + loss, pid) == LineKind::Loss);
+		CHECK(Classify(sender + created + "5151", pid) == LineKind::ProcessCreated);
+		CHECK_EQUAL(pid, 5151u);
+		CHECK(Classify(sender + Rendered(HookId::ExitProcess, FieldId::ExitCode, 1), pid) == LineKind::ProcessExited);
+		CHECK_EQUAL(pid, sender_pid);
+		// the same hooks with other messages
+		CHECK(Classify(sender + Rendered(RecordType::HookInfo, HookId::ShellExecuteExW, "HookShellExecuteW Finished"),
+		               pid) == LineKind::Other);
+		CHECK(Classify(sender + Rendered(RecordType::Info, HookId::None, "Attaching functions..."), pid) ==
+			LineKind::Other);
+
+		CHECK(Classify("[CloseApp]", pid) == LineKind::CloseApp);
+		CHECK(Classify("[CloseApp] ", pid) == LineKind::Other);
+		CHECK(Classify("[ChildProcess] 4242", pid) == LineKind::ChildProcess);
+		CHECK_EQUAL(pid, 4242u);
+		CHECK(Classify("[ChildProcess] 42x", pid) == LineKind::ChildProcess);
+		CHECK_EQUAL(pid, 0u);
+		CHECK(Classify("pid:7 " + created + "2147483647", pid) == LineKind::ProcessCreated);
+		CHECK_EQUAL(pid, 2147483647u);
+		CHECK(Classify("pid:7 " + created + "2147483648", pid) == LineKind::ProcessCreated);
+		CHECK_EQUAL(pid, 0u);
+		CHECK(Classify("pid:7 " + exited + "99 code 0", pid) == LineKind::ProcessExited);
+		CHECK_EQUAL(pid, 99u);
+		CHECK(Classify("pid:7 " + exited + "99", pid) == LineKind::ProcessExited);
+		CHECK_EQUAL(pid, 0u);
+		CHECK(Classify("pid:7 " + shell_start, pid) == LineKind::ShellExecuteStart);
+		CHECK(Classify("pid:7 " + shell_error, pid) == LineKind::ShellExecuteError);
+		CHECK(Classify("pid:7 " + shell_error + " ", pid) == LineKind::Other);
+		CHECK(Classify("pid:7 " + permission, pid) == LineKind::PermissionRequest);
+		CHECK(Classify("pid:7 " + loss, pid) == LineKind::Loss);
+		CHECK(Classify("pid:7 [Loss]", pid) == LineKind::Other);
+		CHECK(Classify("", pid) == LineKind::Other);
+		CHECK(Classify("pid:7", pid) == LineKind::Other);
+		CHECK(Classify("pid:7 ", pid) == LineKind::Other);
+	}
+
+	// Lines made of the pieces the rules look at, truncated and with bytes changed at random, are
+	// classified as the spelled-out rules classify them.
+	void TestFuzz()
+	{
+		const std::vector<std::string> senders = {"", "pid:1234 ", "pid:1 ", " ", "pid:12", "[CloseApp]"};
+		const std::vector<std::string> texts = {
+			"[CloseApp]", "[ChildProcess] ", created, exited, shell_start, shell_error, permission, loss, "[Loss] ",
+			"[Hook] ", "[Info] ", "[Hook] NtWriteFile ", ""
+		};
+		const std::vector<std::string> pids = {"", "0", "17", "4294967295", "2147483647", "12345678901", "8 ", "9x"};
+		const std::vector<std::string> tails = {"", " code 0", "x", " ", "\t"};
+		const std::string alphabet = " [](){}:0123456789CEHLSIPxokecs\r\t\x80\xff";
+		std::mt19937 random(21);
+		for (int round = 0; round < 300000; ++round)
+		{
+			std::string line = senders[random() % senders.size()] + texts[random() % texts.size()] +
+				pids[random() % pids.size()] + tails[random() % tails.size()];
+			if (random() % 3 == 0)
+				line.resize(random() % (line.size() + 1));
+			for (size_t changes = random() % 3; changes > 0 && !line.empty(); --changes)
+				line[random() % line.size()] = alphabet[random() % alphabet.size()];
+			uint32_t pid = 1;
+			uint32_t expected_pid = 1;
+			const LineKind kind = Classify(line, pid);
+			const LineKind expected = ReferenceClassify(line, expected_pid);
+			CHECK(kind == expected);
+			CHECK_EQUAL(pid, expected_pid);
+			if (kind != expected || pid != expected_pid)
+				return;
+		}
+	}
+
+	// Every vector scan against the scalar one, for every start alignment, length and position of the
+	// byte, with and without later matches.
+	void TestFindByte()
+	{
+		std::vector<char> buffer(160, 'a');
+		for (size_t offset = 0; offset < 32; ++offset)
+		{
+			for (size_t length = 0; length <= 96; ++length)
+			{
+				const char* begin = buffer.data() + offset;
+				const char* end = begin + length;
+				for (size_t position = 0; position <= length; ++position)
+				{
+					std::fill(buffer.begin(), buffer.end(), 'a');
+					if (position < length)
+						buffer[offset + position] = '\n';
+					// bytes right after the range must not be found
+					buffer[offset + length] = '\n';
+					if (position + 5 < length)
+						buffer[offset + position + 5] = '\n';
+					const char* expected = begin + position;
+					CHECK(Detail::FindByteScalar(begin, end, '\n') == expected);
+					CHECK(FindByte(begin, end, '\n') == expected);
+#ifdef PROCESS_TRACER_SSE2
+					CHECK(Detail::FindByteSse2(begin, end, '\n') == expected);
+#endif
+#ifdef PROCESS_TRACER_AVX2
+					if (ProcessTracer::Simd::avx2_supported)
+						CHECK(Detail::FindByteAvx2(begin, end, '\n') == expected);
+#endif
+				}
+			}
+		}
+		// the sign bit set in every other byte
+		const std::string high(64, '\xff');
+		CHECK(FindByte(high.data(), high.data() + high.size(), '\xfe') == high.data() + high.size());
+		CHECK(FindByte(high.data(), high.data() + high.size(), '\xff') == high.data());
+	}
+
+	// Views point into the buffer, a "\r\n" end is cut and an unterminated rest is not consumed.
+	void TestScanLines()
+	{
+		const std::string data = "[CloseApp]\r\npid:3 " + exited + "12 code 1\n\npid:3 [Info] rest\n" +
+			std::string(100, 'x') + "\n[ChildProcess] 5";
+		std::vector<LineView> views;
+		const size_t consumed = ScanLines(data.data(), data.size(), [&views](const LineView& view)
+		{
+			views.push_back(view);
+		});
+		CHECK_EQUAL(consumed, data.size() - std::string("[ChildProcess] 5").size());
+		CHECK_EQUAL(views.size(), size_t{5});
+		if (views.size() != 5)
+			return;
+		CHECK(views[0].text == data.data());
+		CHECK_EQUAL(std::string(views[0].text, views[0].length), "[CloseApp]");
+		CHECK(views[0].kind == LineKind::CloseApp);
+		CHECK(views[1].kind == LineKind::ProcessExited);
+		CHECK_EQUAL(views[1].pid, 12u);
+		CHECK_EQUAL(views[2].length, size_t{0});
+		CHECK(views[3].kind == LineKind::Other);
+		CHECK_EQUAL(std::string(views[3].text, views[3].length), "pid:3 [Info] rest");
+		CHECK_EQUAL(views[4].length, size_t{100});
+		CHECK_EQUAL(ScanLines(data.data(), 0, [](const LineView&) {}), size_t{0});
+	}
+}
+
+int main()
+{
+	TestKnownLines();
+	TestFuzz();
+	TestFindByte();
+	TestScanLines();
+	return ProcessTracer::Test::Result("line_classifier_test");
+}
@@ -0,0 +1,95 @@
+#include <string>
+
+#include "allocation_counter.h"
+#include "hook_host.h"
+#include "hook_func.h"
+#include "logger.h"
+#include "test_check.h"
+
+using namespace ProcessTracer::EventRecord;
+using ProcessTracer::HookHarness::Allocations;
+using ProcessTracer::HookHarness::Session;
+
+namespace
+{
+	constexpr uint64_t calls = 10000;
+
+	// Heap allocations of calls calls of log, after one call that sets up the thread's buffer.
+	template <typename Log>
+	uint64_t AllocationsOf(Log&& log)
+	{
+		log(0);
+		const uint64_t before = Allocations();
+		for (uint64_t i = 1; i <= calls; ++i)
+			log(i);
+		return Allocations() - before;
+	}
+
+	// Every form of logging formats into a record on the stack, none of them allocates.
+	void TestLoggingAllocationFree()
+	{
+		Session session;
+		CHECK_EQUAL(AllocationsOf([](uint64_t) { LogInfo("message"); }), uint64_t{0});
+		CHECK_EQUAL(AllocationsOf([](uint64_t) { LogError("message"); }), uint64_t{0});
+		CHECK_EQUAL(AllocationsOf([](uint64_t i)
+		{
+			LogInfoF("formatted %llu %s", static_cast<unsigned long long>(i), "text");
+		}), uint64_t{0});
+		CHECK_EQUAL(AllocationsOf([](uint64_t i) { LogErrorF("formatted %d", static_cast<int>(i)); }), uint64_t{0});
+		CHECK_EQUAL(AllocationsOf([](uint64_t) { LogHookInfo(HookId::NtCreateFile, "message"); }), uint64_t{0});
+		CHECK_EQUAL(AllocationsOf([](uint64_t i)
+		{
+			LogHookInfoF(HookId::NtWriteFile, "[Length] %llu", static_cast<unsigned long long>(i));
+		}), uint64_t{0});
+		CHECK_EQUAL(AllocationsOf([](uint64_t) { LogHookError(HookId::NtCreateFile, "message"); }), uint64_t{0});
+		CHECK_EQUAL(AllocationsOf([](uint64_t i) { LogHookErrorF(HookId::NtCreateFile, "%x", static_cast<unsigned>(i)); }),
+		            uint64_t{0});
+		CHECK_EQUAL(AllocationsOf([](uint64_t) { ProcessTracer::Logger::g_logger.Info(L"wide message"); }), uint64_t{0});
+		const std::u16string path = u"C:\\out\\main.obj";
+		CHECK_EQUAL(AllocationsOf([&path](uint64_t i)
+		{
+			ProcessTracer::HookRecord record(HookId::NtCreateFile);
+			record->AddU32(FieldId::AccessMask, static_cast<uint32_t>(i));
+			record->AddUtf16(FieldId::Path, path.data(), path.size());
+			record.Send();
+		}), uint64_t{0});
+
+		session.Flush();
+		// every call above made it to the collector
+		CHECK_EQUAL(session.Bulk().Records(), 10 * (calls + 1));
+		CHECK_EQUAL(session.Bulk().Malformed(), uint64_t{0});
+	}
+
+	// A write through the hook to a file it saw created allocates nothing either.
+	void TestWriteHookAllocationFree()
+	{
+		Session session;
+		const std::u16string path = u"C:\\out\\main.obj";
+		UNICODE_STRING name;
+		name.Length = static_cast<USHORT>(path.size() * sizeof(WCHAR));
+		name.MaximumLength = name.Length;
+		name.Buffer = reinterpret_cast<PWSTR>(const_cast<char16_t*>(path.data()));
+		OBJECT_ATTRIBUTES attributes;
+		InitializeObjectAttributes(&attributes, &name, OBJ_CASE_INSENSITIVE, nullptr, nullptr);
+		IO_STATUS_BLOCK io = {};
+		HANDLE handle = nullptr;
+		CHECK_EQUAL(HookNtCreateFile(&handle, GENERIC_WRITE, &attributes, &io, nullptr, FILE_ATTRIBUTE_NORMAL, 0,
+		                             FILE_OVERWRITE_IF, FILE_SYNCHRONOUS_IO_NONALERT, nullptr, 0), NTSTATUS{0});
+		char data[512] = {};
+		CHECK_EQUAL(AllocationsOf([handle, &io, &data](uint64_t)
+		{
+			HookNtWriteFile(handle, nullptr, nullptr, nullptr, &io, data, sizeof(data), nullptr, nullptr);
+		}), uint64_t{0});
+		HookNtClose(handle);
+		session.Flush();
+		CHECK_EQUAL(session.Bulk().Records(RecordType::HookInfo, HookId::NtWriteFile), calls + 1);
+	}
+}
+
+int main()
+{
+	TestLoggingAllocationFree();
+	TestWriteHookAllocationFree();
+	ProcessTracer::HookHarness::DetachThread();
+	return ProcessTracer::Test::Result("logger_test");
+}
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "hook_host.h"
+#include "line_classifier.h"
+#include "logger.h"
+#include "socket_collector.h"
+#include "test_check.h"
+#include "unix_socket_transport.h"
+
+using namespace ProcessTracer::EventRecord;
+using ProcessTracer::HookHarness::Session;
+using ProcessTracer::HookHarness::SessionOptions;
+using ProcessTracer::Injection::OverflowPolicy;
+
+namespace
+{
+	constexpr size_t producers = 4;
+	constexpr uint64_t events_per_producer = 500000;
+	constexpr char event_path[] = "\\overload\\";
+	// what the process may grow by while it sends several times that much
+	constexpr size_t rss_bound = 32 * 1024 * 1024;
+	// the sink takes this long for every batch, far slower than the producers
+	constexpr auto sink_delay = std::chrono::milliseconds(2);
+
+	// what the collector's sink saw, written on its thread only and read once the collector is gone
+	struct Received
+	{
+		uint64_t events = 0;
+		uint64_t lost[5] = {}; // by LossStage
+		uint64_t lost_without_hook = 0;
+	};
+
+	uint64_t ParseAfter(const std::string& text, const char* label)
+	{
+		const size_t at = text.find(label);
+		return at == std::string::npos ? 0 : std::stoull(text.substr(at + strlen(label)));
+	}
+
+	void Receive(void* context, const char* lines, size_t length)
+	{
+		const auto received = static_cast<Received*>(context);
+		std::this_thread::sleep_for(sink_delay);
+		ScanLines(lines, length, [received](const LineView& line)
+		{
+			const std::string text(line.text, line.length);
+			if (line.kind == LineKind::Loss)
+			{
+				const uint64_t lost = ParseAfter(text, "[Lost] ");
+				const char* const stages[] = {"", "buffer", "transport", "sequence", "collector"};
+				for (size_t stage = 1; stage < 5; ++stage)
+				{
+					if (text.find(std::string("[Stage] ") + stages[stage] + ",") != std::string::npos)
+						received->lost[stage] += lost;
+				}
+				if (text.find("[Loss] [Stage]") != std::string::npos)
+					received->lost_without_hook += lost;
+			}
+			else if (text.find(event_path) != std::string::npos)
+				++received->events;
+		});
+	}
+
+	size_t ResidentBytes()
+	{
+		FILE* statm = fopen("/proc/self/statm", "r");
+		if (!statm)
+			return 0;
+		unsigned long size = 0;
+		unsigned long resident = 0;
+		const int read = fscanf(statm, "%lu %lu", &size, &resident);
+		fclose(statm);
+		return read == 2 ? resident * static_cast<size_t>(sysconf(_SC_PAGESIZE)) : 0;
+	}
+
+	void SendEvent(uint64_t index)
+	{
+		ProcessTracer::HookRecord record(HookId::NtWriteFile);
+		record->AddU32(FieldId::Length, 4096);
+		char16_t path[] = u"C:\\overload\\unit0.obj";
+		path[16] = static_cast<char16_t>(u'0' + index % 10);
+		record->AddUtf16(FieldId::Path, path, sizeof(path) / sizeof(path[0]) - 1);
+		record.Send();
+	}
+
+	// Producers send as fast as they can into small thread buffers while the collector's sink is slow,
+	// so most events are dropped. The process does not grow with what it sends, and every event is
+	// accounted for exactly once: delivered, or in a loss line of the hook it belongs to. The buffer
+	// losses the process reports are not reported again as sequence gaps.
+	void TestOverload(OverflowPolicy policy, const char* name)
+	{
+		const std::string path = ProcessTracer::UnixSocketTransport::Path(getpid()) + ".overload";
+		Received received;
+		void* collector = CreateSocketCollector(path.c_str(), Receive, &received);
+		CHECK(collector != nullptr);
+		if (!collector)
+			return;
+		SessionOptions options;
+		options.collector_path = path;
+		options.budget.thread_buffer_bytes = 64 * 1024;
+		options.budget.buffer_policy = policy;
+		const size_t rss_before = ResidentBytes();
+		size_t rss_max = rss_before;
+		{
+			Session session(options);
+			std::atomic<size_t> running{producers};
+			std::vector<std::thread> threads;
+			for (size_t producer = 0; producer < producers; ++producer)
+			{
+				threads.emplace_back([&running]
+				{
+					for (uint64_t event = 0; event < events_per_producer; ++event)
+						SendEvent(event);
+					ProcessTracer::HookHarness::DetachThread();
+					running.fetch_sub(1);
+				});
+			}
+			while (running.load() != 0)
+			{
+				rss_max = std::max(rss_max, ResidentBytes());
+				std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			}
+			for (auto& thread : threads)
+				thread.join();
+			session.Flush();
+		}
+		DestroySocketCollector(collector);
+		rss_max = std::max(rss_max, ResidentBytes());
+
+		const uint64_t sent = producers * events_per_producer;
+		const uint64_t lost = received.lost[static_cast<size_t>(LossStage::Buffer)] +
+			received.lost[static_cast<size_t>(LossStage::Transport)];
+		printf("%s: %llu sent, %llu delivered, %llu lost in the buffer, %llu in transport, RSS grew %zu KB\n", name,
+		       static_cast<unsigned long long>(sent), static_cast<unsigned long long>(received.events),
+		       static_cast<unsigned long long>(received.lost[static_cast<size_t>(LossStage::Buffer)]),
+		       static_cast<unsigned long long>(received.lost[static_cast<size_t>(LossStage::Transport)]),
+		       (rss_max - rss_before) / 1024);
+		CHECK(received.lost[static_cast<size_t>(LossStage::Buffer)] > 0);
+		CHECK_EQUAL(received.events + lost, sent);
+		CHECK_EQUAL(received.lost[static_cast<size_t>(LossStage::Sequence)], uint64_t{0});
+		CHECK_EQUAL(received.lost_without_hook, uint64_t{0});
+		CHECK(rss_max - rss_before < rss_bound);
+	}
+}
+
+int main()
+{
+	TestOverload(OverflowPolicy::DropNewest, "drop-newest");
+	TestOverload(OverflowPolicy::DropOldest, "drop-oldest");
+	return ProcessTracer::Test::Result("overload_test");
+}
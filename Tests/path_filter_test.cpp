@@ -0,0 +1,263 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include "path_filter.h"
+#include "test_check.h"
+
+namespace
+{
+	// The glob language of PathFilter, matched by backtracking straight from its description.
+	class ReferenceGlob
+	{
+		static bool IsSeparator(char16_t unit)
+		{
+			return unit == u'\\' || unit == u'/';
+		}
+
+		static std::u16string Normalize(const std::u16string& text)
+		{
+			std::u16string folded = text;
+			for (auto& unit : folded)
+			{
+				if (unit == u'/')
+					unit = u'\\';
+				else if (unit >= u'A' && unit <= u'Z')
+					unit = static_cast<char16_t>(unit + (u'a' - u'A'));
+			}
+			if (folded.size() >= 4 && folded[0] == u'\\' && folded[2] == u'?' && folded[3] == u'\\' &&
+				(folded[1] == u'?' || folded[1] == u'\\'))
+				folded.erase(0, 4);
+			return folded;
+		}
+
+		static bool Match(const std::u16string& glob, size_t g, const std::u16string& path, size_t p)
+		{
+			if (g == glob.size())
+				return p == path.size();
+			if (glob[g] == u'*')
+			{
+				size_t stars = 0;
+				while (g + stars < glob.size() && glob[g + stars] == u'*')
+					++stars;
+				if (stars == 1)
+				{
+					// any run of non-separators
+					for (size_t end = p;; ++end)
+					{
+						if (Match(glob, g + 1, path, end))
+							return true;
+						if (end == path.size() || path[end] == u'\\')
+							return false;
+					}
+				}
+				const size_t rest = g + stars;
+				if (rest < glob.size() && glob[rest] == u'\\')
+				{
+					// nothing, or anything that ends with a separator
+					if (Match(glob, rest + 1, path, p))
+						return true;
+					for (size_t end = p + 1; end <= path.size(); ++end)
+					{
+						if (path[end - 1] == u'\\' && Match(glob, rest + 1, path, end))
+							return true;
+					}
+					return false;
+				}
+				for (size_t end = p; end <= path.size(); ++end)
+				{
+					if (Match(glob, rest, path, end))
+						return true;
+				}
+				return false;
+			}
+			if (p == path.size())
+				return false;
+			if (glob[g] == u'?')
+				return path[p] != u'\\' && Match(glob, g + 1, path, p + 1);
+			return glob[g] == path[p] && Match(glob, g + 1, path, p + 1);
+		}
+
+	public:
+		static bool Matches(const std::u16string& glob, const std::u16string& path)
+		{
+			return Match(Normalize(glob), 0, Normalize(path), 0);
+		}
+	};
+
+	struct Rule
+	{
+		bool include;
+		std::u16string glob;
+	};
+
+	bool ReferencePasses(const std::vector<Rule>& rules, const std::u16string& path)
+	{
+		bool has_includes = false;
+		bool included = false;
+		for (const Rule& rule : rules)
+		{
+			const bool matches = ReferenceGlob::Matches(rule.glob, path);
+			if (!rule.include && matches)
+				return false;
+			has_includes |= rule.include;
+			included |= rule.include && matches;
+		}
+		return !has_includes || included;
+	}
+
+	// UTF-8 rule text, one rule per line
+	std::string RuleText(const std::vector<Rule>& rules)
+	{
+		std::string text;
+		for (const Rule& rule : rules)
+		{
+			text += rule.include ? '+' : '-';
+			for (const char16_t unit : rule.glob)
+			{
+				if (unit < 0x80)
+					text += static_cast<char>(unit);
+				else
+				{
+					// every unit the tests use is below U+0800
+					text += static_cast<char>(0xC0 | unit >> 6);
+					text += static_cast<char>(0x80 | (unit & 0x3F));
+				}
+			}
+			text += '\n';
+		}
+		return text;
+	}
+
+	bool Passes(const ProcessTracer::PathFilter& filter, const std::u16string& path)
+	{
+		return filter.Matches(path.data(), path.size());
+	}
+
+	void TestExamples()
+	{
+		ProcessTracer::PathFilter filter;
+		const std::string rules = "# build outputs\r\n+C:/out/**\n\n-**/*.tmp\n-**/obj/**\n";
+		CHECK(filter.Compile(rules.data(), rules.size()));
+		CHECK(!filter.Empty());
+		CHECK(Passes(filter, u"C:\\out\\main.exe"));
+		CHECK(Passes(filter, u"\\??\\c:\\OUT\\bin\\main.exe"));
+		CHECK(Passes(filter, u"\\\\?\\C:/out/lib/a.lib"));
+		CHECK(!Passes(filter, u"C:\\out\\main.exe.tmp"));
+		CHECK(!Passes(filter, u"C:\\out\\obj\\main.obj"));
+		CHECK(!Passes(filter, u"C:\\output\\main.exe"));
+		CHECK(!Passes(filter, u"C:\\src\\main.cpp"));
+		CHECK(!Passes(filter, u""));
+
+		// '**/' also matches device paths of the same file
+		const std::string device = "**/src/*.cpp";
+		CHECK(filter.Compile(device.data(), device.size()));
+		CHECK(Passes(filter, u"C:\\project\\src\\main.cpp"));
+		CHECK(Passes(filter, u"\\Device\\HarddiskVolume3\\project\\src\\main.cpp"));
+		CHECK(Passes(filter, u"src\\main.cpp"));
+		CHECK(!Passes(filter, u"C:\\project\\src\\detail\\main.cpp"));
+
+		// exclude rules only
+		const std::string excludes = "-**/*.pdb";
+		CHECK(filter.Compile(excludes.data(), excludes.size()));
+		CHECK(Passes(filter, u"C:\\out\\main.exe"));
+		CHECK(!Passes(filter, u"C:\\out\\main.PDB"));
+
+		// no rules at all, and rules that do not parse, let every path through
+		CHECK(filter.Compile("# nothing\n", 10));
+		CHECK(filter.Empty());
+		const std::string invalid = "+C:/out/\xFF**";
+		CHECK(!filter.Compile(invalid.data(), invalid.size()));
+		CHECK(filter.Empty());
+		CHECK(Passes(filter, u"D:\\anything"));
+	}
+
+	// Non-ASCII letters are matched exactly, they do not fold.
+	void TestWideUnits()
+	{
+		ProcessTracer::PathFilter filter;
+		const std::string rules = "C:/\xC3\xA9t\xC3\xA9/**";
+		CHECK(filter.Compile(rules.data(), rules.size()));
+		CHECK(Passes(filter, u"C:\\\u00E9t\u00E9\\a.txt"));
+		CHECK(Passes(filter, u"c:\\\u00E9T\u00E9\\a.txt"));
+		CHECK(!Passes(filter, u"C:\\\u00C9t\u00E9\\a.txt"));
+		CHECK(!Passes(filter, u"C:\\\u0100t\u00E9\\a.txt"));
+	}
+
+	// More states than the filter allows: it does not compile and lets everything through.
+	void TestStateLimit()
+	{
+		std::string rules;
+		for (int i = 0; i < 16; ++i)
+			rules += "**a" + std::string(static_cast<size_t>(i), '?') + "b*\n";
+		ProcessTracer::PathFilter filter;
+		CHECK(!filter.Compile(rules.data(), rules.size()));
+		CHECK(filter.Empty());
+	}
+
+	std::u16string RandomText(std::mt19937& random, const char16_t* alphabet, size_t alphabet_size, size_t max_length)
+	{
+		std::u16string text;
+		const size_t length = random() % (max_length + 1);
+		for (size_t i = 0; i < length; ++i)
+			text += alphabet[random() % alphabet_size];
+		return text;
+	}
+
+	// Random rule sets against random paths over a small alphabet, so that globs and paths meet
+	// often, compared with the reference.
+	void TestAgainstReference()
+	{
+		static constexpr char16_t glob_units[] = u"aaB.\\/?**\u00E9";
+		static constexpr char16_t path_units[] = u"aAbB.\\/?\u00E9\u00C9";
+		std::mt19937 random(13);
+		size_t not_compiled = 0;
+		size_t passed = 0;
+		size_t checked = 0;
+		for (int round = 0; round < 3000; ++round)
+		{
+			std::vector<Rule> rules(random() % 3 + 1);
+			for (Rule& rule : rules)
+			{
+				rule.include = random() % 3 != 0;
+				rule.glob = RandomText(random, glob_units, std::size(glob_units) - 1, 7);
+				if (random() % 8 == 0)
+					rule.glob.insert(0, u"\\??\\");
+			}
+			const std::string text = RuleText(rules);
+			ProcessTracer::PathFilter filter;
+			if (!filter.Compile(text.data(), text.size()))
+			{
+				++not_compiled;
+				continue;
+			}
+			for (int i = 0; i < 40; ++i)
+			{
+				std::u16string path = RandomText(random, path_units, std::size(path_units) - 1, 9);
+				if (random() % 8 == 0)
+					path.insert(0, random() % 2 ? u"\\??\\" : u"//?/");
+				const bool expected = ReferencePasses(rules, path);
+				++checked;
+				passed += expected;
+				if (Passes(filter, path) != expected)
+				{
+					fprintf(stderr, "rules:\n%spath of %zu units, expected %d\n", text.c_str(), path.size(), expected);
+					CHECK_EQUAL(Passes(filter, path), expected);
+					return;
+				}
+			}
+		}
+		// the suite is only worth something when both verdicts are common
+		CHECK(not_compiled < 30);
+		CHECK(passed > checked / 10 && passed < checked * 9 / 10);
+	}
+}
+
+int main()
+{
+	TestExamples();
+	TestWideUnits();
+	TestStateLimit();
+	TestAgainstReference();
+	return ProcessTracer::Test::Result("path_filter_test");
+}
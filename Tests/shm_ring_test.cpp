@@ -0,0 +1,277 @@
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "shared_memory_transport.h"
+#include "test_check.h"
+
+using namespace ProcessTracer::SharedMemoryRing;
+
+namespace
+{
+	uint64_t NowMs()
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	bool IsAlive(uint32_t pid)
+	{
+		return kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM;
+	}
+
+	// Reads every committed frame into frames.
+	size_t Drain(RingHeader* ring, ReaderState& state, uint64_t now_ms, std::vector<std::string>& frames)
+	{
+		return ReadFrames(ring, state, now_ms, [&frames](const char* data, size_t length)
+		{
+			frames.emplace_back(data, length);
+		}, IsAlive);
+	}
+
+	std::string Message(uint32_t seq)
+	{
+		return std::to_string(seq) + std::string(seq % 37, 'm');
+	}
+
+	// A pid that is known not to run any more.
+	uint32_t ExitedPid()
+	{
+		const pid_t child = fork();
+		if (child == 0)
+			_exit(0);
+		waitpid(child, nullptr, 0);
+		return static_cast<uint32_t>(child);
+	}
+
+	// Frames of every size go around a small ring many times, the ends of the laps become fillers the
+	// reader never hands out.
+	void TestWrapAround()
+	{
+		ProcessTracer::SharedMemoryRingOwner owner;
+		CHECK(owner.Create(getpid(), 256));
+		ReaderState state;
+		std::vector<std::string> frames;
+		uint32_t written = 0;
+		for (uint32_t round = 0; round < 500; ++round)
+		{
+			while (TryWrite(owner.Ring(), Message(written).data(), Message(written).size(), getpid(), false))
+				++written;
+			Drain(owner.Ring(), state, NowMs(), frames);
+		}
+		CHECK_EQUAL(frames.size(), size_t{written});
+		for (uint32_t seq = 0; seq < frames.size(); ++seq)
+		{
+			if (frames[seq] != Message(seq))
+			{
+				CHECK_EQUAL(frames[seq], Message(seq));
+				break;
+			}
+		}
+		CHECK_EQUAL(owner.Ring()->dropped_frames.load(), uint64_t{0});
+		CHECK(owner.Ring()->reserve_position.load() > 256 * 100);
+	}
+
+	// A full ring counts the frames it turns away, draining it makes room again.
+	void TestFull()
+	{
+		ProcessTracer::SharedMemoryRingOwner owner;
+		CHECK(owner.Create(getpid(), 256));
+		const std::string payload(24, 'f');
+		size_t written = 0;
+		while (TryWrite(owner.Ring(), payload.data(), payload.size(), getpid()))
+			++written;
+		// 32 byte frames fill 256 bytes exactly
+		CHECK_EQUAL(written, size_t{8});
+		CHECK(!TryWrite(owner.Ring(), payload.data(), payload.size(), getpid()));
+		CHECK_EQUAL(owner.Ring()->dropped_frames.load(), uint64_t{2});
+		CHECK_EQUAL(owner.Ring()->dropped_bytes.load(), uint64_t{48});
+		// a frame that never fits is counted as lost, even without account_loss
+		const std::string huge(200, 'h');
+		CHECK(!TryWrite(owner.Ring(), huge.data(), huge.size(), getpid(), false));
+		CHECK_EQUAL(owner.Ring()->dropped_frames.load(), uint64_t{3});
+
+		ReaderState state;
+		std::vector<std::string> frames;
+		CHECK_EQUAL(Drain(owner.Ring(), state, NowMs(), frames), size_t{8});
+		CHECK(TryWrite(owner.Ring(), payload.data(), payload.size(), getpid()));
+	}
+
+	// Claims a frame of size bytes for pid at the reservation, as a producer does before it copies.
+	void ClaimFrame(RingHeader* ring, uint32_t size, uint32_t pid)
+	{
+		const uint64_t position = ring->reserve_position.load();
+		CHECK(Claim(ring, position, Pack(0, FreeTag(position)), Pack(size, pid)));
+		CHECK_EQUAL(ring->reserve_position.load(), position + size);
+	}
+
+	// The frame of a producer that died between claim and commit is skipped once it is overdue, the
+	// frames behind it arrive. Its size was part of the claim, so the reader knows how far to skip.
+	void TestDeadClaimer()
+	{
+		ProcessTracer::SharedMemoryRingOwner owner;
+		CHECK(owner.Create(getpid(), 1024));
+		const auto ring = owner.Ring();
+		CHECK(TryWrite(ring, "before", 6, getpid()));
+		ClaimFrame(ring, 64, ExitedPid());
+		CHECK(TryWrite(ring, "after", 5, getpid()));
+
+		ReaderState state;
+		std::vector<std::string> frames;
+		CHECK_EQUAL(Drain(ring, state, 10000, frames), size_t{1});
+		CHECK_EQUAL(Drain(ring, state, 10000 + stalled_frame_timeout_ms - 1, frames), size_t{0});
+		CHECK_EQUAL(state.skipped_frames, uint64_t{0});
+		CHECK_EQUAL(Drain(ring, state, 10000 + stalled_frame_timeout_ms, frames), size_t{2});
+		CHECK_EQUAL(state.skipped_frames, uint64_t{1});
+		CHECK_EQUAL(frames.size(), size_t{2});
+		CHECK_EQUAL(frames.back(), std::string("after"));
+		CHECK_EQUAL(ring->read_position.load(), ring->reserve_position.load());
+	}
+
+	// A claimer that died before it advanced the reservation holds up nobody: the next producer
+	// advances it, and so does the reader when it skips the frame.
+	void TestClaimerDiedBeforeAdvancing()
+	{
+		ProcessTracer::SharedMemoryRingOwner owner;
+		CHECK(owner.Create(getpid(), 1024));
+		const auto ring = owner.Ring();
+		const uint64_t position = ring->reserve_position.load();
+		FrameAt(ring, position)->word.store(Pack(48, ExitedPid()));
+		CHECK(TryWrite(ring, "next", 4, getpid()));
+		CHECK_EQUAL(ring->reserve_position.load(), position + 48 + 16);
+
+		FrameAt(ring, ring->reserve_position.load())->word.store(Pack(32, ExitedPid()));
+		ReaderState state;
+		std::vector<std::string> frames;
+		CHECK_EQUAL(Drain(ring, state, 1, frames), size_t{0});
+		// every overdue frame gets its own timeout
+		CHECK_EQUAL(Drain(ring, state, 1 + stalled_frame_timeout_ms, frames), size_t{2});
+		CHECK_EQUAL(Drain(ring, state, 1 + 2 * stalled_frame_timeout_ms, frames), size_t{1});
+		CHECK_EQUAL(state.skipped_frames, uint64_t{2});
+		CHECK_EQUAL(ring->reserve_position.load(), position + 48 + 16 + 32);
+		CHECK(TryWrite(ring, "last", 4, getpid()));
+		CHECK_EQUAL(Drain(ring, state, 2 + 2 * stalled_frame_timeout_ms, frames), size_t{1});
+		CHECK_EQUAL(frames.back(), std::string("last"));
+	}
+
+	// However long a live producer takes to copy its frame, the reader waits for it.
+	void TestLiveClaimerNotSkipped()
+	{
+		ProcessTracer::SharedMemoryRingOwner owner;
+		CHECK(owner.Create(getpid(), 1024));
+		const auto ring = owner.Ring();
+		ClaimFrame(ring, 32, getpid());
+		ReaderState state;
+		std::vector<std::string> frames;
+		for (uint64_t now = 1; now < 100 * stalled_frame_timeout_ms; now += stalled_frame_timeout_ms)
+			CHECK_EQUAL(Drain(ring, state, now, frames), size_t{0});
+		CHECK_EQUAL(state.skipped_frames, uint64_t{0});
+		CHECK_EQUAL(ring->read_position.load(), uint64_t{0});
+	}
+
+	// A stale producer that read the reservation a lap ago cannot claim the offset again.
+	void TestStaleClaimFails()
+	{
+		ProcessTracer::SharedMemoryRingOwner owner;
+		CHECK(owner.Create(getpid(), 256));
+		const auto ring = owner.Ring();
+		CHECK(TryWrite(ring, "x", 1, getpid()));
+		ReaderState state;
+		std::vector<std::string> frames;
+		Drain(ring, state, 1, frames);
+		// position 0 is free again, but for position 256
+		CHECK(!Claim(ring, 0, Pack(0, FreeTag(0)), Pack(16, getpid())));
+		CHECK(Claim(ring, 16, Pack(0, FreeTag(16)), Pack(16, getpid())));
+	}
+
+	// Producer processes map the ring through SharedMemoryTransport and write while this process reads,
+	// with a ring small enough to fill up. Blocking writes lose nothing, every producer's frames arrive
+	// in the order it wrote them.
+	void TestProcesses(uint32_t processes, uint32_t per_process)
+	{
+		ProcessTracer::SharedMemoryRingOwner owner;
+		CHECK(owner.Create(getpid(), 4096));
+		const int tracer_pid = getpid();
+		std::vector<pid_t> children;
+		for (uint32_t process = 0; process < processes; ++process)
+		{
+			const pid_t child = fork();
+			if (child == 0)
+			{
+				ProcessTracer::SharedMemoryTransport transport(true);
+				if (!transport.Map(tracer_pid))
+					_exit(2);
+				for (uint32_t seq = 0; seq < per_process; ++seq)
+				{
+					const std::string message = std::to_string(process) + ":" + Message(seq);
+					if (!transport.Write(message.data(), message.size()))
+						_exit(3);
+				}
+				_exit(0);
+			}
+			children.push_back(child);
+		}
+
+		ReaderState state;
+		std::map<uint32_t, uint32_t> next;
+		bool in_order = true;
+		const auto check = [&next, &in_order](const char* data, size_t length)
+		{
+			const std::string frame(data, length);
+			const auto colon = frame.find(':');
+			const auto process = static_cast<uint32_t>(std::stoul(frame.substr(0, colon)));
+			in_order = in_order && frame.substr(colon + 1) == Message(next[process]++);
+		};
+		size_t running = children.size();
+		while (running > 0)
+		{
+			if (ReadFrames(owner.Ring(), state, NowMs(), check, IsAlive) == 0)
+				usleep(100);
+			for (auto& child : children)
+			{
+				int status = 0;
+				if (child == 0 || waitpid(child, &status, WNOHANG) != child)
+					continue;
+				CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+				child = 0;
+				--running;
+			}
+		}
+		ReadFrames(owner.Ring(), state, NowMs(), check, IsAlive);
+
+		CHECK(in_order);
+		CHECK_EQUAL(next.size(), size_t{processes});
+		for (const auto& [process, count] : next)
+			CHECK_EQUAL(count, per_process);
+		CHECK_EQUAL(owner.Ring()->dropped_frames.load(), uint64_t{0});
+		CHECK_EQUAL(state.skipped_frames, uint64_t{0});
+	}
+
+	// Without a tracer ring there is nothing to map.
+	void TestMapMissing()
+	{
+		ProcessTracer::SharedMemoryTransport transport(false);
+		CHECK(!transport.Map(static_cast<int>(ExitedPid())));
+		CHECK(!transport.Write("x", 1));
+	}
+}
+
+int main()
+{
+	TestWrapAround();
+	TestFull();
+	TestDeadClaimer();
+	TestClaimerDiedBeforeAdvancing();
+	TestLiveClaimerNotSkipped();
+	TestStaleClaimFails();
+	TestProcesses(1, 20000);
+	TestProcesses(4, 20000);
+	TestMapMissing();
+	return ProcessTracer::Test::Result("shm_ring_test");
+}
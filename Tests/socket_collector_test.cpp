@@ -0,0 +1,224 @@
+#include <cerrno>
+#include <chrono>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "event_formatter.h"
+#include "socket_collector.h"
+#include "test_check.h"
+#include "unix_socket_transport.h"
+
+using namespace ProcessTracer::EventRecord;
+
+namespace
+{
+	// what the sink was handed, called on the sink thread only and read once the collector is gone
+	struct Received
+	{
+		std::string lines;
+		size_t calls = 0;
+	};
+
+	void Keep(void* context, const char* lines, size_t length)
+	{
+		const auto received = static_cast<Received*>(context);
+		received->lines.append(lines, length);
+		++received->calls;
+	}
+
+	std::string Path()
+	{
+		return ProcessTracer::UnixSocketTransport::Path(getpid()) + ".collector";
+	}
+
+	std::string Record(uint32_t pid, uint32_t sequence)
+	{
+		char data[256];
+		RecordWriter writer(data, sizeof(data));
+		writer.Begin(RecordType::HookInfo, HookId::NtWriteFile, pid, pid, sequence, 0);
+		writer.AddU32(FieldId::Length, sequence * 3);
+		writer.AddU32(FieldId::Sequence, sequence);
+		const std::u16string path = u"C:\\out\\unit" + std::u16string(1, static_cast<char16_t>(u'a' + sequence % 26));
+		writer.AddUtf16(FieldId::Path, path.data(), path.size());
+		return std::string(data, writer.Finish());
+	}
+
+	std::string Rendered(const std::string& record)
+	{
+		std::string line;
+		FormatRecord(record.data(), record.size(), line);
+		return line + '\n';
+	}
+
+	// a text line between the records
+	std::string Marker(uint32_t pid, uint32_t sequence)
+	{
+		return "pid:" + std::to_string(pid) + " [Info] marker " + std::to_string(sequence) + "\n";
+	}
+
+	// the lines of data that start with prefix, in order
+	std::string LinesStartingWith(const std::string& data, const std::string& prefix)
+	{
+		std::string lines;
+		size_t start = 0;
+		while (start < data.size())
+		{
+			const size_t end = data.find('\n', start) + 1;
+			if (data.compare(start, prefix.size(), prefix) == 0)
+				lines.append(data, start, end - start);
+			start = end;
+		}
+		return lines;
+	}
+
+	// Producers with a connection each write batches of records and text lines through
+	// UnixSocketTransport, the way the hooks ship them. Every line reaches the sink once, the lines of
+	// one producer in the order it sent them, and the sequence numbers show no gap.
+	void TestManyProducers()
+	{
+		constexpr uint32_t producers = 8;
+		constexpr uint32_t records = 3000;
+		constexpr uint32_t batch = 32;
+		const std::string path = Path();
+		Received received;
+		void* collector = CreateSocketCollector(path.c_str(), Keep, &received);
+		CHECK(collector != nullptr);
+		if (!collector)
+			return;
+
+		std::vector<std::string> expected(producers);
+		uint64_t sent_bytes = 0;
+		for (uint32_t producer = 0; producer < producers; ++producer)
+		{
+			for (uint32_t sequence = 0; sequence < records; ++sequence)
+			{
+				expected[producer] += Rendered(Record(producer + 1, sequence));
+				if (sequence % 1000 == 999)
+					expected[producer] += Marker(producer + 1, sequence);
+			}
+		}
+		std::vector<std::thread> threads;
+		std::vector<uint64_t> bytes(producers);
+		for (uint32_t producer = 0; producer < producers; ++producer)
+		{
+			threads.emplace_back([&path, &bytes, producer]
+			{
+				ProcessTracer::UnixSocketTransport transport(path);
+				std::string data;
+				for (uint32_t sequence = 0; sequence < records; ++sequence)
+				{
+					data += Record(producer + 1, sequence);
+					if (sequence % 1000 == 999)
+						data += Marker(producer + 1, sequence);
+					if (sequence % batch == batch - 1 || sequence == records - 1)
+					{
+						CHECK(transport.Write(data.data(), data.size()));
+						bytes[producer] += data.size();
+						data.clear();
+					}
+				}
+				transport.Close();
+			});
+		}
+		for (auto& thread : threads)
+			thread.join();
+		for (const uint64_t producer_bytes : bytes)
+			sent_bytes += producer_bytes;
+		// every producer closed its connection, wait until the collector saw them all go
+		ProcessTracer::Collector::SocketCollectorStats stats = {};
+		for (int wait = 0; wait < 5000 && stats.closed < producers; ++wait)
+		{
+			GetSocketCollectorStats(collector, &stats);
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		DestroySocketCollector(collector);
+
+		CHECK_EQUAL(stats.connections, uint64_t{producers});
+		CHECK_EQUAL(stats.closed, uint64_t{producers});
+		CHECK_EQUAL(stats.bytes, sent_bytes);
+		CHECK_EQUAL(stats.lines, uint64_t{producers * (records + records / 1000)});
+		for (uint32_t producer = 0; producer < producers; ++producer)
+		{
+			const std::string prefix = "pid:" + std::to_string(producer + 1) + " ";
+			CHECK(LinesStartingWith(received.lines, prefix) == expected[producer]);
+		}
+		CHECK(received.lines.find("[Loss]") == std::string::npos);
+		// whole reads are handed on at once, not line by line
+		CHECK(received.calls < stats.lines / 4);
+	}
+
+	int Connect(const std::string& path)
+	{
+		const int socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		sockaddr_un address = {};
+		address.sun_family = AF_UNIX;
+		path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+		CHECK(connect(socket_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0);
+		return socket_fd;
+	}
+
+	void Send(int socket_fd, const std::string& data)
+	{
+		size_t sent = 0;
+		while (sent < data.size())
+		{
+			const ssize_t written = write(socket_fd, data.data() + sent, data.size() - sent);
+			CHECK(written > 0);
+			if (written <= 0)
+				return;
+			sent += static_cast<size_t>(written);
+		}
+	}
+
+	// Messages split over several reads, a text line longer than a read and, when the collector
+	// stops, a connection still open with a line that has no end yet.
+	void TestPartialMessages()
+	{
+		const std::string path = Path();
+		Received received;
+		void* collector = CreateSocketCollector(path.c_str(), Keep, &received);
+		CHECK(collector != nullptr);
+		if (!collector)
+			return;
+		const int socket_fd = Connect(path);
+		const std::string record = Record(7, 0);
+		for (size_t split : {size_t{1}, sizeof(RecordHeader) + 2})
+		{
+			Send(socket_fd, record.substr(0, split));
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			Send(socket_fd, record.substr(split));
+		}
+		const std::string long_line = "pid:7 [Info] " + std::string(300 * 1024, 'x');
+		Send(socket_fd, long_line + "\n");
+		Send(socket_fd, "pid:7 [Info] unfinished");
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		DestroySocketCollector(collector);
+		close(socket_fd);
+
+		// the same sequence number twice reads as a new thread with the same id, not as a loss
+		const std::string rendered = Rendered(record);
+		CHECK(received.lines == rendered + rendered + long_line + "\npid:7 [Info] unfinished\n");
+	}
+
+	void TestCreateFails()
+	{
+		errno = 0;
+		CHECK(CreateSocketCollector(("/tmp/" + std::string(200, 'p')).c_str(), Keep, nullptr) == nullptr);
+		CHECK_EQUAL(errno, ENAMETOOLONG);
+		errno = 0;
+		CHECK(CreateSocketCollector("/nonexistent-directory/collector", Keep, nullptr) == nullptr);
+		CHECK(errno != 0);
+	}
+}
+
+int main()
+{
+	TestManyProducers();
+	TestPartialMessages();
+	TestCreateFails();
+	return ProcessTracer::Test::Result("socket_collector_test");
+}
@@ -0,0 +1,181 @@
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spsc_ring.h"
+#include "test_check.h"
+
+namespace
+{
+	// Message seq is its sequence number followed by up to max_body bytes derived from it, so a reader
+	// can tell the length and check every byte.
+	size_t MessageLength(uint32_t seq, size_t max_body = 300)
+	{
+		return sizeof(seq) + (seq * 7) % (max_body + 1);
+	}
+
+	std::string Message(uint32_t seq, size_t max_body = 300)
+	{
+		std::string message(MessageLength(seq, max_body), '\0');
+		memcpy(message.data(), &seq, sizeof(seq));
+		for (size_t i = sizeof(seq); i < message.size(); ++i)
+			message[i] = static_cast<char>(seq + i);
+		return message;
+	}
+
+	// Checks the concatenated messages in data, which have to continue at next. false on the first
+	// message that is not the expected one.
+	bool CheckMessages(const char* data, size_t length, uint32_t& next, size_t max_body = 300)
+	{
+		while (length > 0)
+		{
+			uint32_t seq;
+			if (length < sizeof(seq))
+				return false;
+			memcpy(&seq, data, sizeof(seq));
+			const std::string expected = Message(next, max_body);
+			if (seq != next || length < expected.size() || memcmp(data, expected.data(), expected.size()) != 0)
+				return false;
+			data += expected.size();
+			length -= expected.size();
+			++next;
+		}
+		return true;
+	}
+
+	void TestCapacity()
+	{
+		CHECK_EQUAL(ProcessTracer::SpscRing(1).Capacity(), size_t{64});
+		CHECK_EQUAL(ProcessTracer::SpscRing(100).Capacity(), size_t{128});
+		CHECK_EQUAL(ProcessTracer::SpscRing(4096).Capacity(), size_t{4096});
+	}
+
+	void TestFull()
+	{
+		ProcessTracer::SpscRing ring(64);
+		const std::string message(28, 'a');
+		CHECK(ring.Empty());
+		// two messages of 4 + 28 bytes fill the ring exactly
+		CHECK(ring.TryPush(message.data(), message.size()));
+		CHECK(ring.TryPush(message.data(), message.size()));
+		CHECK(!ring.TryPush("b", 1));
+		CHECK(!ProcessTracer::SpscRing(64).TryPush(std::string(61, 'c').data(), 61));
+
+		char out[64];
+		// a message that does not fit into out stays queued
+		CHECK_EQUAL(ring.Pop(out, 27), size_t{0});
+		CHECK_EQUAL(ring.Pop(out, 40), size_t{28});
+		CHECK(ring.TryPush("b", 1));
+		CHECK_EQUAL(ring.Pop(out, sizeof(out)), size_t{29});
+		CHECK(ring.Empty());
+	}
+
+	void TestWrapAround()
+	{
+		// every message size against every offset of a small ring, the largest message fills it
+		constexpr size_t max_body = 64 - 2 * sizeof(uint32_t);
+		ProcessTracer::SpscRing ring(64);
+		char out[64];
+		uint32_t pushed = 0;
+		uint32_t next = 0;
+		bool ordered = true;
+		for (int round = 0; round < 10000; ++round)
+		{
+			const std::string message = Message(pushed, max_body);
+			if (ring.TryPush(message.data(), message.size()))
+			{
+				++pushed;
+				continue;
+			}
+			const size_t popped = ring.Pop(out, sizeof(out));
+			ordered = ordered && popped != 0 && CheckMessages(out, popped, next, max_body);
+		}
+		CHECK(ordered);
+	}
+
+	void TestDropFront()
+	{
+		ProcessTracer::SpscRing ring(64);
+		CHECK(ring.TryPush("0123456789", 10));
+		CHECK(ring.TryPush("abc", 3));
+		char head[4];
+		size_t length = 0;
+		CHECK(ring.DropFront(head, sizeof(head), length));
+		CHECK_EQUAL(length, size_t{10});
+		CHECK_EQUAL(std::string(head, 4), "0123");
+		CHECK(ring.DropFront(head, sizeof(head), length));
+		CHECK_EQUAL(length, size_t{3});
+		CHECK_EQUAL(std::string(head, 3), "abc");
+		CHECK(!ring.DropFront(head, sizeof(head), length));
+	}
+
+	// One producer and one consumer as fast as they go, with a ring small enough to be full most
+	// of the time. Every message has to arrive once, in order and intact.
+	void TestConcurrent(size_t capacity, bool drop_front)
+	{
+		constexpr uint32_t messages = 300000;
+		ProcessTracer::SpscRing ring(capacity);
+		std::atomic<bool> produced{false};
+		std::thread producer([&]
+		{
+			for (uint32_t seq = 0; seq < messages; ++seq)
+			{
+				const std::string message = Message(seq);
+				while (!ring.TryPush(message.data(), message.size()))
+					std::this_thread::yield();
+			}
+			produced.store(true);
+		});
+
+		std::vector<char> out(1024);
+		uint32_t next = 0;
+		bool ordered = true;
+		while (ordered && next < messages)
+		{
+			size_t popped;
+			if (drop_front && next % 3 == 0)
+			{
+				// the consumer may also drop the oldest message, it is gone as a whole
+				char head[sizeof(uint32_t)];
+				size_t length;
+				popped = 0;
+				if (ring.DropFront(head, sizeof(head), length))
+				{
+					uint32_t seq;
+					memcpy(&seq, head, sizeof(seq));
+					ordered = seq == next && length == MessageLength(next);
+					++next;
+					continue;
+				}
+			}
+			else
+			{
+				popped = ring.Pop(out.data(), out.size());
+				ordered = CheckMessages(out.data(), popped, next);
+			}
+			if (popped == 0)
+				std::this_thread::yield();
+		}
+		// after a failure the rest is discarded, the producer must not wait for room forever
+		while (!produced.load())
+			ring.Pop(out.data(), out.size());
+		producer.join();
+		CHECK(ordered);
+		CHECK_EQUAL(next, messages);
+		CHECK(ring.Empty());
+	}
+}
+
+int main()
+{
+	TestCapacity();
+	TestFull();
+	TestWrapAround();
+	TestDropFront();
+	TestConcurrent(1024, false);
+	TestConcurrent(64 * 1024, false);
+	TestConcurrent(1024, true);
+	return ProcessTracer::Test::Result("spsc_ring_test");
+}
@@ -0,0 +1,47 @@
+#include <string>
+#include <vector>
+
+#include "string_utils.h"
+#include "test_check.h"
+
+namespace
+{
+	void TestSplitBySpace()
+	{
+		CHECK(SplitBySpace("1234 1") == (std::vector<std::string>{"1234", "1"}));
+		CHECK(SplitBySpace("1234") == (std::vector<std::string>{"1234"}));
+		// every space separates, empty parts are kept
+		CHECK(SplitBySpace("") == (std::vector<std::string>{""}));
+		CHECK(SplitBySpace(" ") == (std::vector<std::string>{"", ""}));
+		CHECK(SplitBySpace("a  b ") == (std::vector<std::string>{"a", "", "b", ""}));
+		CHECK(SplitBySpace("tab\tstays") == (std::vector<std::string>{"tab\tstays"}));
+	}
+
+	void TestAffixes()
+	{
+		CHECK(StartsWith("ProcessTracerPipe:12", "ProcessTracerPipe:"));
+		CHECK(StartsWith("abc", ""));
+		CHECK(!StartsWith("ab", "abc"));
+		CHECK(!StartsWith("xbc", "ab"));
+		CHECK(EndsWith("C:\\out\\main.obj", ".obj"));
+		CHECK(EndsWith("abc", ""));
+		CHECK(!EndsWith("bc", "abc"));
+		CHECK(!EndsWith("abc", "ab"));
+	}
+
+	void TestReplaceWString()
+	{
+		CHECK(ReplaceWString(L"a \"b\" c", L"\"", L"\\\"") == L"a \\\"b\\\" c");
+		CHECK(ReplaceWString(L"aaa", L"a", L"aa") == L"aaaaaa");
+		CHECK(ReplaceWString(L"abc", L"x", L"y") == L"abc");
+		CHECK(ReplaceWString(L"", L"x", L"y").empty());
+	}
+}
+
+int main()
+{
+	TestSplitBySpace();
+	TestAffixes();
+	TestReplaceWString();
+	return ProcessTracer::Test::Result("string_utils_test");
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdio>
+#include <string_view>
+#include <type_traits>
+
+// The few assertions the host tests need. A failed check is printed and counted, the test goes on,
+// and main returns Result() so ctest sees the failure.
+namespace ProcessTracer::Test
+{
+	inline int& Failures()
+	{
+		static int failures = 0;
+		return failures;
+	}
+
+	inline void Check(bool passed, const char* expression, const char* file, int line)
+	{
+		if (passed)
+			return;
+		fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, expression);
+		++Failures();
+	}
+
+	namespace Detail
+	{
+		template <typename T>
+		void Print(const T& value)
+		{
+			if constexpr (std::is_enum_v<T>)
+				fprintf(stderr, "%lld", static_cast<long long>(value));
+			else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+				fprintf(stderr, "%lld", static_cast<long long>(value));
+			else if constexpr (std::is_integral_v<T>)
+				fprintf(stderr, "%llu", static_cast<unsigned long long>(value));
+			else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+			{
+				const std::string_view text = value;
+				fprintf(stderr, "\"%.*s\"", static_cast<int>(text.size()), text.data());
+			}
+			else
+				fprintf(stderr, "?");
+		}
+	}
+
+	template <typename Actual, typename Expected>
+	void CheckEqual(const Actual& actual, const Expected& expected, const char* expression, const char* file,
+	                int line)
+	{
+		if (actual == expected)
+			return;
+		fprintf(stderr, "%s:%d: CHECK_EQUAL(%s) failed: got ", file, line, expression);
+		Detail::Print(actual);
+		fprintf(stderr, ", expected ");
+		Detail::Print(expected);
+		fprintf(stderr, "\n");
+		++Failures();
+	}
+
+	// exit code of the test executable
+	inline int Result(const char* name)
+	{
+		if (Failures() != 0)
+		{
+			fprintf(stderr, "%s: %d check(s) failed\n", name, Failures());
+			return 1;
+		}
+		printf("%s: all checks passed\n", name);
+		return 0;
+	}
+}
+
+#define CHECK(expression) ProcessTracer::Test::Check((expression), #expression, __FILE__, __LINE__)
+#define CHECK_EQUAL(actual, expected) \
+	ProcessTracer::Test::CheckEqual((actual), (expected), #actual, __FILE__, __LINE__)
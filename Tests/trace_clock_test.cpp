@@ -0,0 +1,113 @@
+#include <cmath>
+#include <ctime>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "fake_win32.h"
+#include "trace_clock.h"
+#include "test_check.h"
+
+using namespace ProcessTracer::TraceClock;
+
+namespace
+{
+	uint64_t MonotonicNanoseconds()
+	{
+		timespec now{};
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		return static_cast<uint64_t>(now.tv_sec) * 1000000000 + static_cast<uint64_t>(now.tv_nsec);
+	}
+
+	// delta ticks in nanoseconds, exact
+	uint64_t Reference(uint64_t delta, uint64_t frequency)
+	{
+		return static_cast<uint64_t>(static_cast<unsigned __int128>(delta) * 1000000000 / frequency);
+	}
+
+	// The fixed-point conversion stays within a part per million of the exact one, for counter
+	// frequencies of QPC and of TSCs, over a year of ticks.
+	void TestConversion()
+	{
+		for (const uint64_t frequency : {uint64_t{10000000}, uint64_t{24000000}, uint64_t{1000000000},
+		                                 uint64_t{2903997000}, uint64_t{3000000000}, uint64_t{5200000000}})
+		{
+			const uint64_t epoch = 123456789;
+			const Converter converter({Source::Tsc, epoch, frequency});
+			CHECK_EQUAL(converter.ToNanoseconds(epoch - 1), uint64_t{0});
+			CHECK_EQUAL(converter.ToNanoseconds(epoch), uint64_t{0});
+			const uint64_t year = frequency * 365 * 24 * 3600;
+			for (uint64_t delta = 1; delta < year; delta = delta * 3 + 7)
+			{
+				const uint64_t exact = Reference(delta, frequency);
+				const uint64_t converted = converter.ToNanoseconds(epoch + delta);
+				const uint64_t error = converted > exact ? converted - exact : exact - converted;
+				if (error > exact / 1000000 + 1)
+				{
+					CHECK_EQUAL(converted, exact);
+					break;
+				}
+			}
+		}
+		// a frequency of zero is no calibration, every stamp is 0
+		CHECK_EQUAL(Converter({Source::Qpc, 0, 0}).ToNanoseconds(1000), uint64_t{0});
+	}
+
+	// The calibrated clock runs at the rate of the monotonic clock, within 0.1%.
+	void TestCalibrationAccuracy()
+	{
+		const Calibration calibration = Calibrate();
+		CHECK(calibration.frequency != 0);
+		const Converter converter(calibration);
+		const uint64_t clock_start = converter.Now();
+		const uint64_t monotonic_start = MonotonicNanoseconds();
+		Sleep(200);
+		const uint64_t clock_elapsed = converter.Now() - clock_start;
+		const uint64_t monotonic_elapsed = MonotonicNanoseconds() - monotonic_start;
+		const double error = std::fabs(static_cast<double>(clock_elapsed) - static_cast<double>(monotonic_elapsed)) /
+			static_cast<double>(monotonic_elapsed);
+		if (error > 0.001)
+		{
+			fprintf(stderr, "source %u: %llu ns against %llu ns\n", static_cast<unsigned>(calibration.source),
+			        static_cast<unsigned long long>(clock_elapsed), static_cast<unsigned long long>(monotonic_elapsed));
+			CHECK(error <= 0.001);
+		}
+	}
+
+	// A process that got the calibration stamps in between what this process stamps before and after
+	// it ran, so events of different processes order by their timestamps.
+	void TestAcrossProcesses()
+	{
+		const Calibration calibration = Calibrate();
+		const Converter converter(calibration);
+		int pipe_ends[2];
+		CHECK_EQUAL(pipe(pipe_ends), 0);
+		for (int round = 0; round < 20; ++round)
+		{
+			const uint64_t before = converter.Now();
+			const pid_t child = fork();
+			if (child == 0)
+			{
+				// what an injected process does with the calibration it was handed
+				const uint64_t stamp = Converter(calibration).Now();
+				_exit(write(pipe_ends[1], &stamp, sizeof(stamp)) == sizeof(stamp) ? 0 : 1);
+			}
+			int status = 0;
+			waitpid(child, &status, 0);
+			const uint64_t after = converter.Now();
+			uint64_t stamp = 0;
+			CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+			CHECK_EQUAL(read(pipe_ends[0], &stamp, sizeof(stamp)), static_cast<ssize_t>(sizeof(stamp)));
+			CHECK(before <= stamp && stamp <= after);
+		}
+		close(pipe_ends[0]);
+		close(pipe_ends[1]);
+	}
+}
+
+int main()
+{
+	TestConversion();
+	TestCalibrationAccuracy();
+	TestAcrossProcesses();
+	return ProcessTracer::Test::Result("trace_clock_test");
+}
@@ -0,0 +1,74 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include "test_check.h"
+#include "trace_file.h"
+
+using namespace ProcessTracer::TraceFile;
+
+namespace
+{
+	// the CRC the table computes byte by byte, which the C# reader does too
+	uint32_t ReferenceCrc(const uint8_t* bytes, size_t length)
+	{
+		uint32_t crc = ~0u;
+		for (size_t i = 0; i < length; ++i)
+			crc = crc >> 8 ^ Detail::crc_tables[0][(crc ^ bytes[i]) & 0xFF];
+		return ~crc;
+	}
+
+	// Every start alignment and the lengths around the folding steps, at once and in pieces.
+	void TestCrc()
+	{
+		CHECK_EQUAL(Crc32("123456789", 9), 0xCBF43926u);
+		CHECK_EQUAL(Crc32("", 0), 0u);
+		std::mt19937 random(25);
+		std::vector<uint8_t> data(4096 + 64);
+		for (auto& byte : data)
+			byte = static_cast<uint8_t>(random());
+		for (size_t offset = 0; offset < 16; ++offset)
+		{
+			for (size_t length = 0; length <= 4096; length += length < 300 ? 1 : 61)
+			{
+				const uint8_t* bytes = data.data() + offset;
+				const uint32_t expected = ReferenceCrc(bytes, length);
+				CHECK_EQUAL(Crc32(bytes, length), expected);
+				const size_t split = random() % (length + 1);
+				CHECK_EQUAL(Crc32(bytes + split, length - split, Crc32(bytes, split)), expected);
+				if (Crc32(bytes, length) != expected)
+					return;
+			}
+		}
+	}
+
+	void TestBlock()
+	{
+		const std::string payload = "pid:1 [Hook] NtWriteFile C:\\a.obj\n";
+		std::string block(header_size, '\0');
+		FormatHeader(block.data(), 7, static_cast<uint32_t>(payload.size()), Crc32(payload.data(), payload.size()));
+		CHECK_EQUAL(block.substr(0, sizeof(block_tag) - 1), std::string(block_tag));
+		CHECK(block.back() == '\n');
+		block += payload;
+		uint32_t length = 0;
+		CHECK(CheckBlock(block.data(), block.size(), length));
+		CHECK_EQUAL(length, static_cast<uint32_t>(payload.size()));
+		// cut short, a changed payload byte, a header that does not parse
+		CHECK(!CheckBlock(block.data(), block.size() - 1, length));
+		std::string changed = block;
+		changed.back() = 'x';
+		CHECK(!CheckBlock(changed.data(), changed.size(), length));
+		changed = block;
+		changed[sizeof(block_tag) - 1] = 'G';
+		CHECK(!CheckBlock(changed.data(), changed.size(), length));
+		const std::string zeros(header_size + 8, '\0');
+		CHECK(!CheckBlock(zeros.data(), zeros.size(), length));
+	}
+}
+
+int main()
+{
+	TestCrc();
+	TestBlock();
+	return ProcessTracer::Test::Result("trace_file_test");
+}
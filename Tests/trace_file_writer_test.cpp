@@ -0,0 +1,166 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <windows.h>
+
+#include "test_check.h"
+#include "trace_file.h"
+#include "trace_file_writer.h"
+
+using namespace ProcessTracer::TraceFile;
+
+namespace
+{
+	std::string FilePath()
+	{
+		return "/tmp/trace_file_writer_test." + std::to_string(getpid()) + ".log";
+	}
+
+	std::wstring WidePath(const std::string& path)
+	{
+		return std::wstring(path.begin(), path.end());
+	}
+
+	std::string ReadAll(const std::string& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		std::ostringstream content;
+		content << file.rdbuf();
+		return content.str();
+	}
+
+	void WriteAll(const std::string& path, const std::string& content)
+	{
+		std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+	}
+
+	// the payload of every intact block, skipping anything else as --recover does
+	std::string Recover(const std::string& content, size_t& blocks)
+	{
+		std::string payload;
+		blocks = 0;
+		for (size_t position = 0; position < content.size();)
+		{
+			uint32_t length;
+			if (CheckBlock(content.data() + position, content.size() - position, length))
+			{
+				payload.append(content, position + header_size, length);
+				position += header_size + length;
+				++blocks;
+				continue;
+			}
+			const size_t next = content.find(block_tag, position + 1);
+			position = next == std::string::npos ? content.size() : next;
+		}
+		return payload;
+	}
+
+	std::string Block(const std::string& payload, uint32_t sequence)
+	{
+		std::string block(header_size, '\0');
+		FormatHeader(block.data(), sequence, static_cast<uint32_t>(payload.size()),
+		             Crc32(payload.data(), payload.size()));
+		return block + payload;
+	}
+
+	bool Append(const std::string& path, const std::string& text)
+	{
+		TraceFileWriter writer;
+		return writer.Open(WidePath(path).c_str()) && writer.Write(text.data(), text.size()) && writer.Close();
+	}
+
+	// Appending to a closed file continues after its last block, the file has no preallocated tail.
+	void TestReopen()
+	{
+		const std::string path = FilePath();
+		remove(path.c_str());
+		CHECK(Append(path, "first\n"));
+		CHECK(Append(path, "second\n"));
+		const std::string content = ReadAll(path);
+		size_t blocks;
+		CHECK_EQUAL(Recover(content, blocks), std::string("first\nsecond\n"));
+		CHECK_EQUAL(blocks, size_t{2});
+		CHECK_EQUAL(content.size(), 2 * header_size + 13);
+		remove(path.c_str());
+	}
+
+	// The tracer is killed after a flush while a block is open: the file ends in that torn block and
+	// the zeroed preallocated tail. The next writer starts right after the flushed block.
+	void TestKilled()
+	{
+		const std::string path = FilePath();
+		remove(path.c_str());
+		// never closed, as a killed tracer leaves it
+		const auto killed = new TraceFileWriter;
+		CHECK(killed->Open(WidePath(path).c_str()));
+		const std::string flushed(3000, 'f');
+		CHECK(killed->Write(flushed.data(), flushed.size()));
+		killed->Flush();
+		const std::string torn(2000, 't');
+		CHECK(killed->Write(torn.data(), torn.size()));
+		struct stat status{};
+		CHECK(stat(path.c_str(), &status) == 0 && static_cast<size_t>(status.st_size) > header_size + 5000);
+
+		CHECK(Append(path, "after\n"));
+		const std::string content = ReadAll(path);
+		size_t blocks;
+		CHECK_EQUAL(Recover(content, blocks), flushed + "after\n");
+		CHECK_EQUAL(blocks, size_t{2});
+		CHECK_EQUAL(content.size(), 2 * header_size + flushed.size() + 6);
+		remove(path.c_str());
+	}
+
+	// A block whose header was stamped but whose payload did not reach the disk, and blocks more than
+	// one read back from the end: the last intact one is found and the torn one written over.
+	void TestTornBlock()
+	{
+		const std::string path = FilePath();
+		std::string intact;
+		for (uint32_t sequence = 0; sequence < 3; ++sequence)
+			intact += Block(std::string(700 * 1024, static_cast<char>('a' + sequence)), sequence);
+		std::string torn = Block(std::string(1000, 'x'), 3);
+		torn.replace(header_size + 10, 100, 100, '\0');
+		WriteAll(path, intact + torn + std::string(3 * 1024 * 1024, '\0'));
+
+		CHECK(Append(path, "after\n"));
+		const std::string content = ReadAll(path);
+		CHECK_EQUAL(content.size(), intact.size() + header_size + 6);
+		CHECK(content.compare(0, intact.size(), intact) == 0);
+		uint32_t sequence = 0;
+		uint32_t length = 0;
+		uint32_t crc = 0;
+		CHECK(ParseHeader(content.data() + intact.size(), header_size, sequence, length, crc));
+		CHECK_EQUAL(sequence, 3u);
+		remove(path.c_str());
+	}
+
+	// A text file without blocks keeps its lines, only the zeroed tail goes.
+	void TestPlainText()
+	{
+		const std::string path = FilePath();
+		WriteAll(path, std::string("old line\n") + std::string(100000, '\0'));
+		CHECK(Append(path, "new\n"));
+		const std::string content = ReadAll(path);
+		CHECK_EQUAL(content.substr(0, 9), std::string("old line\n"));
+		size_t blocks;
+		CHECK_EQUAL(Recover(content, blocks), std::string("new\n"));
+		CHECK_EQUAL(content.size(), 9 + header_size + 4);
+
+		WriteAll(path, std::string(5000, '\0'));
+		CHECK(Append(path, "new\n"));
+		CHECK_EQUAL(ReadAll(path).size(), header_size + 4);
+		remove(path.c_str());
+	}
+}
+
+int main()
+{
+	TestReopen();
+	TestKilled();
+	TestTornBlock();
+	TestPlainText();
+	return ProcessTracer::Test::Result("trace_file_writer_test");
+}
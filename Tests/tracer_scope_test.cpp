@@ -0,0 +1,132 @@
+#include <string>
+
+#include "hook_host.h"
+#include "hook_func.h"
+#include "tracer_scope.h"
+#include "test_check.h"
+
+using namespace ProcessTracer::EventRecord;
+using ProcessTracer::FakeWin32::CallCount;
+using ProcessTracer::FakeWin32::NtCall;
+using ProcessTracer::HookHarness::Session;
+using ProcessTracer::HookHarness::SessionOptions;
+
+namespace
+{
+	// A file opened through the hook, the way the traced program opens it.
+	class TracedFile
+	{
+		std::u16string m_path;
+		UNICODE_STRING m_name = {};
+		OBJECT_ATTRIBUTES m_attributes = {};
+		IO_STATUS_BLOCK m_io = {};
+
+	public:
+		HANDLE handle = nullptr;
+
+		explicit TracedFile(const char16_t* path) : m_path(path)
+		{
+			m_name.Length = static_cast<USHORT>(m_path.size() * sizeof(WCHAR));
+			m_name.MaximumLength = m_name.Length;
+			m_name.Buffer = reinterpret_cast<PWSTR>(m_path.data());
+			InitializeObjectAttributes(&m_attributes, &m_name, OBJ_CASE_INSENSITIVE, nullptr, nullptr);
+		}
+
+		NTSTATUS Create()
+		{
+			return HookNtCreateFile(&handle, GENERIC_WRITE, &m_attributes, &m_io, nullptr, FILE_ATTRIBUTE_NORMAL, 0,
+			                        FILE_OVERWRITE_IF, FILE_SYNCHRONOUS_IO_NONALERT, nullptr, 0);
+		}
+
+		NTSTATUS Write()
+		{
+			char data[64] = {};
+			return HookNtWriteFile(handle, nullptr, nullptr, nullptr, &m_io, data, sizeof(data), nullptr, nullptr);
+		}
+	};
+
+	void TestNestedScopes()
+	{
+		CHECK(!ProcessTracer::TracerScope::Active());
+		{
+			ProcessTracer::TracerScope outer;
+			{
+				ProcessTracer::TracerScope inner;
+				CHECK(ProcessTracer::TracerScope::Active());
+			}
+			CHECK(ProcessTracer::TracerScope::Active());
+		}
+		CHECK(!ProcessTracer::TracerScope::Active());
+	}
+
+	// Hooks entered from tracer code still make the real call, but log nothing.
+	void TestHooksInsideScope()
+	{
+		Session session;
+		ProcessTracer::FakeWin32::ResetCalls();
+		TracedFile file(u"C:\\tracer\\own.log");
+		{
+			ProcessTracer::TracerScope scope;
+			CHECK_EQUAL(file.Create(), NTSTATUS{0});
+			CHECK_EQUAL(file.Write(), NTSTATUS{0});
+			CHECK_EQUAL(file.Write(), NTSTATUS{0});
+		}
+		CHECK_EQUAL(CallCount(NtCall::CreateFile), uint64_t{1});
+		CHECK_EQUAL(CallCount(NtCall::WriteFile), uint64_t{2});
+		// the same calls from the program are logged again
+		CHECK_EQUAL(file.Write(), NTSTATUS{0});
+		HookNtClose(file.handle);
+		session.Flush();
+		CHECK_EQUAL(session.Bulk().Records(RecordType::HookInfo, HookId::NtCreateFile), uint64_t{0});
+		CHECK_EQUAL(session.Bulk().Records(RecordType::HookInfo, HookId::NtWriteFile), uint64_t{1});
+	}
+
+	// The transport writes every record through the hooked NtWriteFile, as the pipe does on Windows.
+	// Without the scope every shipped record would log another write, which would be shipped in turn.
+	HANDLE g_transport_handle = nullptr;
+	uint64_t g_transport_writes = 0;
+
+	void WriteThroughHook(const RecordHeader&)
+	{
+		IO_STATUS_BLOCK io = {};
+		char data[32] = {};
+		CHECK(ProcessTracer::TracerScope::Active());
+		HookNtWriteFile(g_transport_handle, nullptr, nullptr, nullptr, &io, data, sizeof(data), nullptr, nullptr);
+		++g_transport_writes;
+	}
+
+	void TestTransportThroughHooks()
+	{
+		TracedFile pipe(u"\\Device\\NamedPipe\\ProcessTracerPipe:1");
+		{
+			ProcessTracer::TracerScope scope;
+			CHECK_EQUAL(pipe.Create(), NTSTATUS{0});
+		}
+		g_transport_handle = pipe.handle;
+		SessionOptions options;
+		options.on_bulk_record = WriteThroughHook;
+		Session session(options);
+		TracedFile file(u"C:\\out\\main.obj");
+		CHECK_EQUAL(file.Create(), NTSTATUS{0});
+		constexpr uint64_t writes = 1000;
+		for (uint64_t i = 0; i < writes; ++i)
+			file.Write();
+		HookNtClose(file.handle);
+		session.Flush();
+		// one create and the program's writes, nothing of the transport's own writes
+		CHECK_EQUAL(session.Bulk().Records(), writes + 1);
+		CHECK_EQUAL(g_transport_writes, writes + 1);
+		CHECK_EQUAL(session.Bulk().Records(RecordType::HookInfo, HookId::NtWriteFile), writes);
+		ProcessTracer::TracerScope scope;
+		HookNtClose(pipe.handle);
+	}
+}
+
+int main()
+{
+	TestNestedScopes();
+	TestHooksInsideScope();
+	TestTransportThroughHooks();
+	ProcessTracer::HookHarness::DetachThread();
+	return ProcessTracer::Test::Result("tracer_scope_test");
+}
@@ -0,0 +1,157 @@
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+#include "test_check.h"
+#include "unix_socket_transport.h"
+
+namespace
+{
+	// Accepts one connection after the other and keeps what arrives. Drop closes the current one
+	// from the collector side.
+	class Collector
+	{
+		std::string m_path;
+		int m_listen;
+		std::mutex m_lock;
+		std::string m_received;
+		int m_connection = -1;
+		int m_connections = 0;
+		std::thread m_thread;
+
+		void Run()
+		{
+			for (;;)
+			{
+				const int connection = accept(m_listen, nullptr, nullptr);
+				if (connection < 0)
+					return;
+				{
+					std::lock_guard<std::mutex> guard(m_lock);
+					m_connection = connection;
+					++m_connections;
+				}
+				char buffer[4096];
+				ssize_t received;
+				while ((received = read(connection, buffer, sizeof(buffer))) > 0)
+				{
+					std::lock_guard<std::mutex> guard(m_lock);
+					m_received.append(buffer, static_cast<size_t>(received));
+				}
+				std::lock_guard<std::mutex> guard(m_lock);
+				m_connection = -1;
+				close(connection);
+			}
+		}
+
+	public:
+		explicit Collector(std::string path) : m_path(std::move(path))
+		{
+			unlink(m_path.c_str());
+			m_listen = socket(AF_UNIX, SOCK_STREAM, 0);
+			sockaddr_un address = {};
+			address.sun_family = AF_UNIX;
+			m_path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+			CHECK(bind(m_listen, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0);
+			CHECK(listen(m_listen, 16) == 0);
+			m_thread = std::thread([this] { Run(); });
+		}
+
+		~Collector()
+		{
+			shutdown(m_listen, SHUT_RDWR);
+			m_thread.join();
+			close(m_listen);
+			unlink(m_path.c_str());
+		}
+
+		void Drop()
+		{
+			std::lock_guard<std::mutex> guard(m_lock);
+			if (m_connection >= 0)
+				shutdown(m_connection, SHUT_RDWR);
+		}
+
+		// what arrived once length bytes did
+		std::string Received(size_t length)
+		{
+			for (;;)
+			{
+				{
+					std::lock_guard<std::mutex> guard(m_lock);
+					if (m_received.size() >= length)
+						return m_received;
+				}
+				std::this_thread::yield();
+			}
+		}
+
+		int Connections()
+		{
+			std::lock_guard<std::mutex> guard(m_lock);
+			return m_connections;
+		}
+	};
+
+	std::string TestPath()
+	{
+		return ProcessTracer::UnixSocketTransport::Path(getpid());
+	}
+
+	void TestNoCollector()
+	{
+		unlink(TestPath().c_str());
+		ProcessTracer::UnixSocketTransport transport(TestPath());
+		CHECK(!transport.Write("lost", 4));
+		CHECK(!ProcessTracer::UnixSocketTransport(std::string(200, 'x')).Write("lost", 4));
+	}
+
+	void TestOneConnection()
+	{
+		Collector collector(TestPath());
+		ProcessTracer::UnixSocketTransport transport(TestPath());
+		std::string expected;
+		for (int i = 0; i < 100; ++i)
+		{
+			const std::string message = "event " + std::to_string(i) + "\n";
+			CHECK(transport.Write(message.data(), message.size()));
+			expected += message;
+		}
+		transport.Close();
+		CHECK_EQUAL(collector.Received(expected.size()), expected);
+		// connected once, kept for every write
+		CHECK_EQUAL(collector.Connections(), 1);
+	}
+
+	void TestReconnect()
+	{
+		Collector collector(TestPath());
+		ProcessTracer::UnixSocketTransport transport(TestPath());
+		CHECK(transport.Write("first\n", 6));
+		CHECK_EQUAL(collector.Received(6), "first\n");
+		collector.Drop();
+		// the dropped connection fails the write, it goes out again on a new one
+		CHECK(transport.Write("second\n", 7));
+		CHECK_EQUAL(collector.Received(13), "first\nsecond\n");
+		CHECK_EQUAL(collector.Connections(), 2);
+
+		// Close ends the connection, the next write opens another
+		transport.Close();
+		CHECK(transport.Write("third\n", 6));
+		transport.Close();
+		CHECK_EQUAL(collector.Received(19), "first\nsecond\nthird\n");
+		CHECK_EQUAL(collector.Connections(), 3);
+	}
+}
+
+int main()
+{
+	TestNoCollector();
+	TestOneConnection();
+	TestReconnect();
+	return ProcessTracer::Test::Result("unix_socket_transport_test");
+}
@@ -0,0 +1,284 @@
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "test_check.h"
+#include "utf16_to_utf8.h"
+
+using namespace ProcessTracer::Utf8;
+
+namespace
+{
+	std::string Convert(const std::u16string& input, bool* valid = nullptr)
+	{
+		std::string output;
+		const bool converted = AppendFromUtf16(output, input.data(), input.size());
+		if (valid)
+			*valid = converted;
+		return output;
+	}
+
+	void TestAscii()
+	{
+		CHECK_EQUAL(Convert(u""), "");
+		CHECK_EQUAL(Convert(u"C:\\Windows\\System32\\kernel32.dll"), "C:\\Windows\\System32\\kernel32.dll");
+		// long enough for the vector path, with the first non-ASCII unit at every position of a block
+		for (size_t position = 0; position < 40; ++position)
+		{
+			std::u16string input(40, u'x');
+			input[position] = u'\u00e9';
+			std::string expected(40, 'x');
+			expected.replace(position, 1, "\xc3\xa9");
+			CHECK_EQUAL(Convert(input), expected);
+		}
+	}
+
+	void TestEncodedLengths()
+	{
+		CHECK_EQUAL(Convert(u"\u007f"), "\x7f");
+		CHECK_EQUAL(Convert(u"\u0080"), "\xc2\x80");
+		CHECK_EQUAL(Convert(u"\u07ff"), "\xdf\xbf");
+		CHECK_EQUAL(Convert(u"\u0800"), "\xe0\xa0\x80");
+		CHECK_EQUAL(Convert(u"\uffff"), "\xef\xbf\xbf");
+		CHECK_EQUAL(Convert(u"\U00010000"), "\xf0\x90\x80\x80");
+		CHECK_EQUAL(Convert(u"\U0010ffff"), "\xf4\x8f\xbf\xbf");
+	}
+
+	void TestUnpairedSurrogates()
+	{
+		bool valid = true;
+		CHECK_EQUAL(Convert(std::u16string{u'a', 0xD800, u'b'}, &valid), "a\xef\xbf\xbd" "b");
+		CHECK(!valid);
+		CHECK_EQUAL(Convert(std::u16string{0xDC00}, &valid), "\xef\xbf\xbd");
+		CHECK(!valid);
+		// a high surrogate at the very end has no partner
+		CHECK_EQUAL(Convert(std::u16string{u'a', 0xDBFF}, &valid), "a\xef\xbf\xbd");
+		CHECK(!valid);
+		CHECK_EQUAL(Convert(std::u16string{0xDBFF, 0xDFFF}, &valid), "\xf4\x8f\xbf\xbf");
+		CHECK(valid);
+	}
+
+	// UTF-8 of one code point as the standard spells it out, returns its length.
+	size_t Encode(uint32_t code_point, char* out)
+	{
+		if (code_point < 0x80)
+		{
+			out[0] = static_cast<char>(code_point);
+			return 1;
+		}
+		if (code_point < 0x800)
+		{
+			out[0] = static_cast<char>(0xC0 | code_point >> 6);
+			out[1] = static_cast<char>(0x80 | (code_point & 0x3F));
+			return 2;
+		}
+		if (code_point < 0x10000)
+		{
+			out[0] = static_cast<char>(0xE0 | code_point >> 12);
+			out[1] = static_cast<char>(0x80 | (code_point >> 6 & 0x3F));
+			out[2] = static_cast<char>(0x80 | (code_point & 0x3F));
+			return 3;
+		}
+		out[0] = static_cast<char>(0xF0 | code_point >> 18);
+		out[1] = static_cast<char>(0x80 | (code_point >> 12 & 0x3F));
+		out[2] = static_cast<char>(0x80 | (code_point >> 6 & 0x3F));
+		out[3] = static_cast<char>(0x80 | (code_point & 0x3F));
+		return 4;
+	}
+
+	// Strict decoder: rejects overlong forms, surrogates and values above U+10FFFF.
+	bool Decode(const std::string& text, std::vector<uint32_t>& code_points)
+	{
+		code_points.clear();
+		for (size_t i = 0; i < text.size();)
+		{
+			const auto lead = static_cast<uint8_t>(text[i]);
+			size_t extra;
+			uint32_t code_point;
+			uint32_t minimum;
+			if (lead < 0x80)
+				extra = 0, code_point = lead, minimum = 0;
+			else if ((lead & 0xE0) == 0xC0)
+				extra = 1, code_point = lead & 0x1F, minimum = 0x80;
+			else if ((lead & 0xF0) == 0xE0)
+				extra = 2, code_point = lead & 0x0F, minimum = 0x800;
+			else if ((lead & 0xF8) == 0xF0)
+				extra = 3, code_point = lead & 0x07, minimum = 0x10000;
+			else
+				return false;
+			if (text.size() - i <= extra)
+				return false;
+			for (size_t j = 1; j <= extra; ++j)
+			{
+				const auto next = static_cast<uint8_t>(text[i + j]);
+				if ((next & 0xC0) != 0x80)
+					return false;
+				code_point = code_point << 6 | (next & 0x3F);
+			}
+			if (code_point < minimum || code_point > 0x10FFFF || (code_point >= 0xD800 && code_point <= 0xDFFF))
+				return false;
+			code_points.push_back(code_point);
+			i += extra + 1;
+		}
+		return true;
+	}
+
+	void AppendUtf16(std::u16string& text, uint32_t code_point)
+	{
+		if (code_point < 0x10000)
+			text += static_cast<char16_t>(code_point);
+		else
+		{
+			text += static_cast<char16_t>(0xD800 + ((code_point - 0x10000) >> 10));
+			text += static_cast<char16_t>(0xDC00 + ((code_point - 0x10000) & 0x3FF));
+		}
+	}
+
+	// Every Unicode scalar value on its own, then all of them in one string that decodes back to the
+	// same code points.
+	void TestEveryCodePoint()
+	{
+		std::u16string all;
+		std::vector<uint32_t> code_points;
+		for (uint32_t code_point = 0; code_point <= 0x10FFFF; ++code_point)
+		{
+			if (code_point >= 0xD800 && code_point <= 0xDFFF)
+				continue;
+			std::u16string input;
+			AppendUtf16(input, code_point);
+			char expected[4];
+			const size_t expected_length = Encode(code_point, expected);
+			char output[8];
+			const auto result = FromUtf16(input.data(), input.size(), output, sizeof(output));
+			if (!result.valid || result.read != input.size() || result.written != expected_length ||
+				memcmp(output, expected, expected_length) != 0)
+			{
+				fprintf(stderr, "U+%04X\n", code_point);
+				CHECK(false);
+				return;
+			}
+			all += input;
+			code_points.push_back(code_point);
+		}
+		bool valid = false;
+		std::vector<uint32_t> decoded;
+		CHECK(Decode(Convert(all, &valid), decoded));
+		CHECK(valid);
+		CHECK(decoded == code_points);
+	}
+
+	// Every UTF-16 unit after every high surrogate: a low one completes the pair, anything else
+	// leaves the surrogate unpaired.
+	void TestEveryUnitAfterHighSurrogate()
+	{
+		char expected[8];
+		char output[8];
+		for (uint32_t high = 0xD800; high <= 0xDBFF; ++high)
+		{
+			for (uint32_t next = 0; next <= 0xFFFF; ++next)
+			{
+				const char16_t input[] = {static_cast<char16_t>(high), static_cast<char16_t>(next)};
+				size_t expected_length;
+				const bool pair = next >= 0xDC00 && next <= 0xDFFF;
+				if (pair)
+					expected_length = Encode(0x10000 + ((high - 0xD800) << 10) + (next - 0xDC00), expected);
+				else
+				{
+					expected_length = Encode(0xFFFD, expected);
+					const bool surrogate = next >= 0xD800 && next <= 0xDFFF;
+					expected_length += Encode(surrogate ? 0xFFFD : next, expected + expected_length);
+				}
+				const auto result = FromUtf16(input, 2, output, sizeof(output));
+				if (result.valid != pair || result.read != 2 || result.written != expected_length ||
+					memcmp(output, expected, expected_length) != 0)
+				{
+					fprintf(stderr, "%04X %04X\n", high, next);
+					CHECK(false);
+					return;
+				}
+			}
+		}
+	}
+
+	// Each ASCII copy against the scalar one: a non-ASCII unit at every position of inputs up to a few
+	// vector blocks long, at every offset. A vector copy stops on a block boundary at or before the
+	// first non-ASCII unit, and what it wrote is the ASCII bytes.
+	template <typename Copy>
+	void CheckCopy(const char* name, size_t block, Copy&& copy)
+	{
+		for (size_t count = 0; count <= 4 * 32 + 3; ++count)
+		{
+			for (size_t position = 0; position <= count; ++position)
+			{
+				std::u16string input(count, u'a');
+				for (size_t i = 0; i < count; ++i)
+					input[i] = static_cast<char16_t>(u' ' + i % 95);
+				if (position < count)
+					input[position] = position % 2 ? u'\u0100' : u'\u0080';
+				for (const size_t start : {size_t{0}, size_t{1}})
+				{
+					if (start > position)
+						continue;
+					std::string output(count, '\0');
+					const size_t end = copy(input.data(), count, output.data(), start);
+					const bool stopped_right = end <= position && (end - start) % block == 0 &&
+						position - end < block;
+					bool copied_right = true;
+					for (size_t i = start; i < end; ++i)
+						copied_right &= output[i] == static_cast<char>(input[i]);
+					if (!stopped_right || !copied_right)
+					{
+						fprintf(stderr, "%s: %zu units from %zu, non-ASCII at %zu, stopped at %zu\n", name, count,
+						        start, position, end);
+						CHECK(false);
+						return;
+					}
+				}
+			}
+		}
+	}
+
+	void TestAsciiCopies()
+	{
+		CheckCopy("scalar", 1, Detail::CopyAsciiScalar);
+#ifdef PROCESS_TRACER_SSE2
+		CheckCopy("SSE2", 16, Detail::CopyAsciiSse2);
+#endif
+#ifdef PROCESS_TRACER_AVX2
+		if (ProcessTracer::Simd::avx2_supported)
+			CheckCopy("AVX2", 32, Detail::CopyAsciiAvx2);
+		else
+			fprintf(stderr, "no AVX2 on this CPU, its ASCII copy is not checked\n");
+#endif
+	}
+
+	void TestCapacity()
+	{
+		const std::u16string input = u"ab\u00e9\u20ac\U0001F600";
+		char output[16];
+		// only whole characters are written
+		const size_t expected_read[] = {0, 1, 2, 2, 3, 3, 3, 4, 4, 4, 4, 6};
+		const size_t expected_written[] = {0, 1, 2, 2, 4, 4, 4, 7, 7, 7, 7, 11};
+		for (size_t capacity = 0; capacity < std::size(expected_read); ++capacity)
+		{
+			const auto result = FromUtf16(input.data(), input.size(), output, capacity);
+			CHECK_EQUAL(result.read, expected_read[capacity]);
+			CHECK_EQUAL(result.written, expected_written[capacity]);
+			CHECK(result.valid);
+		}
+		CHECK_EQUAL(MaxLength(input.size()), 18u);
+	}
+}
+
+int main()
+{
+	TestAscii();
+	TestEncodedLengths();
+	TestUnpairedSurrogates();
+	TestCapacity();
+	TestEveryCodePoint();
+	TestEveryUnitAfterHighSurrogate();
+	TestAsciiCopies();
+	return ProcessTracer::Test::Result("utf16_to_utf8_test");
+}